@@ -0,0 +1,316 @@
+#ifndef linsim_asf_h_HAS_ALREADY_BEEN_INCLUDED
+#define linsim_asf_h_HAS_ALREADY_BEEN_INCLUDED
+/**
+ * @addtogroup linsim
+ * @{
+ *****************************************************************************
+ * Stand-in for the ASF include file of the target.
+ * Provides the few AVR and ASF services the lib code and the frame buffer
+ *  driver use, so they build unmodified for the host:
+ * - The interrupts cannot preempt the simulated code. cli and sei do nothing.
+ * - The sleep manager counts the locks of the drivers, and sleeping in any
+ *    mode lets the virtual clock run up to the next event.
+ * - The pins keep their level, and can be traced. The pull-up sets an
+ *    input high. The interrupt of a pin is called by the simulator.
+ * - The timer/counters, the DMA and the USART in SPI mode are modelled in
+ *    their own files. The registers of the TWI master are kept.
+ * - The watchdog is not simulated, and the CPU always starts from a power
+ *    on reset.
+ * - The EEPROM is kept in memory for the run, in its own file.
+ * - The text sent to the UART is dropped.
+ *****************************************************************************
+ * @file
+ * ASF stand-in for the Linux simulator
+ * @author software@arreckx.com
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "config/conf_board.h"
+#include "linsim.h"
+#include "tc.h"
+#include "dma.h"
+#include "usart_spi.h"
+#include "twi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/************************************************************************/
+/* Interrupts                                                           */
+/************************************************************************/
+
+/** The simulated code cannot be interrupted */
+#define cli() ((void)0)
+
+/** The simulated code cannot be interrupted */
+#define sei() ((void)0)
+
+/** State of the interrupts */
+typedef uint8_t irqflags_t;
+
+/** The simulated code cannot be interrupted */
+static inline irqflags_t cpu_irq_save( void )
+{
+   return 0;
+}
+
+/** The simulated code cannot be interrupted */
+static inline void cpu_irq_restore( irqflags_t flags )
+{
+   (void)flags;
+}
+
+/** An interrupt handler is a plain function, called by the simulator */
+#define ISR(vector) void vector( void )
+
+/************************************************************************/
+/* Sleep                                                                */
+/************************************************************************/
+
+/** Sleep modes of the sleep manager, from the shallowest */
+enum sleepmgr_mode
+{
+   SLEEPMGR_ACTIVE = 0,
+   SLEEPMGR_IDLE,
+   SLEEPMGR_ESTDBY,
+   SLEEPMGR_PSAVE,
+   SLEEPMGR_STDBY,
+   SLEEPMGR_PDOWN,
+   SLEEPMGR_NR_OF_MODES,
+};
+
+/** Number of locks of each sleep mode */
+extern uint8_t sleepmgr_locks[SLEEPMGR_NR_OF_MODES];
+
+/** Clear the locks, but the one of the deepest mode, as the ASF does */
+static inline void sleepmgr_init( void )
+{
+   uint_fast8_t i;
+
+   for ( i=0; i<SLEEPMGR_PDOWN; ++i )
+   {
+      sleepmgr_locks[i] = 0;
+   }
+
+   sleepmgr_locks[SLEEPMGR_PDOWN] = 1;
+}
+
+/** Forbid the modes deeper than the given one */
+static inline void sleepmgr_lock_mode( enum sleepmgr_mode mode )
+{
+   ++sleepmgr_locks[mode];
+}
+
+/** Release a lock taken with #sleepmgr_lock_mode */
+static inline void sleepmgr_unlock_mode( enum sleepmgr_mode mode )
+{
+   --sleepmgr_locks[mode];
+}
+
+/** @return The deepest mode allowed */
+static inline enum sleepmgr_mode sleepmgr_get_sleep_mode( void )
+{
+   int mode = SLEEPMGR_ACTIVE;
+
+   while ( ! sleepmgr_locks[mode] )
+   {
+      ++mode;
+   }
+
+   return (enum sleepmgr_mode)mode;
+}
+
+/** Run the virtual clock up to the next event, whatever the mode */
+static inline void sleepmgr_sleep( enum sleepmgr_mode mode )
+{
+   (void)mode;
+   sim_idle();
+}
+
+/************************************************************************/
+/* Clocks                                                               */
+/************************************************************************/
+
+/** @return The main clock frequency */
+#define sysclk_get_main_hz() SIM_CPU_HZ
+
+/** @return The CPU clock frequency */
+#define sysclk_get_cpu_hz() SIM_CPU_HZ
+
+/** Settings of the prescaler A of the system clock, as on the XMEGA */
+#define SYSCLK_PSADIV_1  0x00
+#define SYSCLK_PSADIV_4  0x0C
+#define SYSCLK_PSADIV_16 0x1C
+
+/** Setting of the prescalers B and C which does not divide */
+#define SYSCLK_PSBCDIV_1_1 0x00
+
+/** Divide the clock of the CPU and the peripherals */
+void sysclk_set_prescalers( uint8_t psadiv, uint8_t psbcdiv );
+
+/** Busy wait. The simulated code takes no time */
+#define delay_ms(ms) ((void)(ms))
+
+/** Set the time of the RTC */
+void rtc_set_time( uint32_t time );
+
+/** @return The time of the RTC */
+uint32_t rtc_get_time( void );
+
+/** Called by the RTC interrupt when the alarm is due, with the time */
+typedef void (*rtc_callback_t)( uint32_t time );
+
+/** Set the callback of the alarm */
+void rtc_set_callback( rtc_callback_t callback );
+
+/** Raise the alarm at the start of the given second */
+void rtc_set_alarm( uint32_t time );
+
+/************************************************************************/
+/* Watchdog                                                             */
+/************************************************************************/
+
+/** The simulated code cannot hang unnoticed */
+#define wdt_reset() ((void)0)
+
+/************************************************************************/
+/* Reset                                                                */
+/************************************************************************/
+
+/** Flags of the causes of the reset, as in RST.STATUS */
+typedef uint8_t reset_cause_t;
+
+#define CHIP_RESET_CAUSE_POR    0x01 ///< Power on
+#define CHIP_RESET_CAUSE_EXTRST 0x02 ///< External reset
+#define CHIP_RESET_CAUSE_BOD_IO 0x04 ///< Brownout
+#define CHIP_RESET_CAUSE_WDT    0x08 ///< Watchdog
+#define CHIP_RESET_CAUSE_SOFT   0x20 ///< Software reset
+
+/** @return The causes of the reset. The simulation starts from a power on */
+static inline reset_cause_t reset_cause_get_causes( void )
+{
+   return CHIP_RESET_CAUSE_POR;
+}
+
+/** Nothing to clear */
+static inline void reset_cause_clear_causes( reset_cause_t causes )
+{
+   (void)causes;
+}
+
+/************************************************************************/
+/* EEPROM                                                               */
+/************************************************************************/
+
+/** Size of the EEPROM of the ATxmega64A4U */
+#define EEPROM_SIZE 2048
+
+/** Size of a page of the EEPROM */
+#define EEPROM_PAGE_SIZE 32
+
+/** Address in the EEPROM */
+typedef uint16_t eeprom_addr_t;
+
+/** @return A byte of the EEPROM */
+uint8_t nvm_eeprom_read_byte( eeprom_addr_t addr );
+
+/** Read bytes of the EEPROM */
+void nvm_eeprom_read_buffer( eeprom_addr_t address, void *buf, uint16_t len );
+
+/** Forget the bytes loaded in the page buffer */
+void nvm_eeprom_flush_buffer( void );
+
+/** Load a byte in the page buffer, at its address within the page */
+void nvm_eeprom_load_byte_to_buffer( uint8_t byte_addr, uint8_t value );
+
+/** Erase and write the bytes loaded in the page buffer to a page */
+void nvm_eeprom_atomic_write_page( uint8_t page_addr );
+
+/************************************************************************/
+/* Standard output                                                      */
+/************************************************************************/
+
+/** Strings in program memory are ordinary strings */
+#define PSTR(s) (s)
+
+/** Format from program memory */
+#define snprintf_P snprintf
+
+/** Send formatted text to the UART. Dropped */
+static inline int printf_P( const char *format, ... )
+{
+   (void)format;
+   return 0;
+}
+
+/************************************************************************/
+/* I/O ports                                                            */
+/************************************************************************/
+
+/** Ports referred to by the board configuration */
+enum { PORTA, PORTB, PORTC, PORTD, PORTE, PORTR };
+
+/** Pin number as formed by the ASF */
+#define IOPORT_CREATE_PIN(port, pin) ((port) * 8 + (pin))
+
+#define IOPORT_DIR_INPUT  0x00 ///< Pin is an input
+#define IOPORT_DIR_OUTPUT 0x01 ///< Pin is an output
+#define IOPORT_INIT_LOW   0x00 ///< Output starts low
+#define IOPORT_INIT_HIGH  0x02 ///< Output starts high
+
+/** Set the initial level of an output */
+#define ioport_configure_pin(pin, flags) sim_pin_set((pin), ((flags) & IOPORT_INIT_HIGH) != 0)
+
+/** Ignored */
+#define ioport_set_pin_dir(pin, dir) ((void)(pin), (void)(dir))
+
+/** Set the level of an output */
+#define ioport_set_pin_level(pin, level) sim_pin_set((pin), (level))
+
+/** Set an output high */
+#define ioport_set_pin_high(pin) sim_pin_set((pin), true)
+
+/** Set an output low */
+#define ioport_set_pin_low(pin) sim_pin_set((pin), false)
+
+#define IOPORT_MODE_PULLUP     0x18 ///< Pull-up on the input
+#define IOPORT_SENSE_BOTHEDGES 0x00 ///< Sense both edges
+
+/** The pull-up sets the input high. The other modes are ignored */
+#define ioport_set_pin_mode(pin, mode) \
+   ((mode) == IOPORT_MODE_PULLUP ? sim_pin_set((pin), true) : (void)0)
+
+/** Ignored. The simulator calls the interrupt of the pin on any change */
+#define ioport_set_pin_sense_mode(pin, mode) ((void)(pin), (void)(mode))
+
+/** @return true if the pin is low */
+#define ioport_pin_is_low(pin) (!sim_pin_get(pin))
+
+/** Interrupt registers of a port, kept for the record */
+typedef struct
+{
+   uint8_t INTCTRL;  ///< Level of the interrupts
+   uint8_t INT0MASK; ///< Pins raising the interrupt 0
+} PORT_t;
+
+#define PORT_INT0LVL_MED_gc 0x02 ///< Interrupt 0 at medium level
+
+/** Registers of each port */
+extern PORT_t sim_ports[PORTR + 1];
+
+/** @return The registers of the port of a pin */
+#define arch_ioport_pin_to_base(pin) (&sim_ports[(pin) / 8])
+
+/** @return The mask of a pin in its port */
+#define ioport_pin_to_mask(pin) ((uint8_t)(1 << ((pin) % 8)))
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+#endif /* ndef linsim_asf_h_HAS_ALREADY_BEEN_INCLUDED */
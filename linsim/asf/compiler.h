@@ -0,0 +1,22 @@
+#ifndef linsim_compiler_h_HAS_ALREADY_BEEN_INCLUDED
+#define linsim_compiler_h_HAS_ALREADY_BEEN_INCLUDED
+/**
+ * @addtogroup linsim
+ * @{
+ *****************************************************************************
+ * Stand-in for the ASF compiler abstraction.
+ * Only what the ASF calendar service uses, so it builds for the host as the
+ *  reference of the civil date conversions.
+ *****************************************************************************
+ * @file
+ * Compiler stand-in for the Linux simulator
+ * @author software@arreckx.com
+ */
+
+#include <asf.h>
+
+/** The ASF assertions are not checked */
+#define Assert(expr) ((void)0)
+
+/**@}*/
+#endif /* ndef linsim_compiler_h_HAS_ALREADY_BEEN_INCLUDED */
@@ -0,0 +1,135 @@
+#ifndef linsim_dma_h_HAS_ALREADY_BEEN_INCLUDED
+#define linsim_dma_h_HAS_ALREADY_BEEN_INCLUDED
+/**
+ * @addtogroup linsim
+ * @{
+ *****************************************************************************
+ * Stand-in for the ASF DMA driver.
+ * A block transfer takes the time for the USART it feeds to shift the bytes
+ *  out, then the completion callback is called if its interrupt is enabled.
+ *  The bytes are not copied.
+ *****************************************************************************
+ * @file
+ * DMA stand-in for the Linux simulator
+ * @author software@arreckx.com
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/************************************************************************/
+/* Registers                                                            */
+/************************************************************************/
+
+#define DMA_CH_BURSTLEN_1BYTE_gc     0x00 ///< 1 byte burst
+#define DMA_CH_SINGLE_bm             0x04 ///< Single shot
+#define DMA_CH_SRCRELOAD_BLOCK_gc    0x40 ///< Reload the source per block
+#define DMA_CH_SRCDIR_INC_gc         0x10 ///< Increment the source
+#define DMA_CH_DESTRELOAD_NONE_gc    0x00 ///< Never reload the destination
+#define DMA_CH_DESTDIR_FIXED_gc      0x00 ///< Fixed destination
+#define DMA_CH_TRIGSRC_USARTC1_DRE_gc 0x4E ///< Triggered by the USARTC1 data register
+
+/** Number of DMA channels */
+#define DMA_NUMBER_OF_CHANNELS 4
+
+/************************************************************************/
+/* Driver                                                               */
+/************************************************************************/
+
+/** Channel number */
+typedef uint8_t dma_channel_num_t;
+
+/** Channel status */
+enum dma_channel_status
+{
+   DMA_CH_FREE = 0,
+   DMA_CH_PENDING,
+   DMA_CH_BUSY,
+   DMA_CH_TRANSFER_COMPLETED,
+   DMA_CH_TRANSFER_ERROR,
+};
+
+/** Channel configuration */
+struct dma_channel_config
+{
+   uint8_t ctrla;
+   uint8_t ctrlb;
+   uint8_t addrctrl;
+   uint8_t trigsrc;
+   uint16_t trfcnt;
+   uint8_t repcnt;
+   uint16_t srcaddr16;
+   uint16_t destaddr16;
+};
+
+/** Interrupt levels */
+enum dma_int_level_t
+{
+   DMA_INT_LVL_OFF = 0x00,
+   DMA_INT_LVL_LO  = 0x01,
+   DMA_INT_LVL_MED = 0x02,
+   DMA_INT_LVL_HI  = 0x03,
+};
+
+/** Completion callback */
+typedef void (*dma_callback_t)(enum dma_channel_status status);
+
+/** Enable the controller */
+void dma_enable(void);
+
+/** Configure a channel */
+void dma_channel_write_config(dma_channel_num_t num, struct dma_channel_config *config);
+
+/** Start a block transfer */
+void dma_channel_enable(dma_channel_num_t num);
+
+/** @return true while a block transfer is on-going */
+bool dma_channel_is_busy(dma_channel_num_t num);
+
+/** Set the function called on completion */
+void dma_set_callback(dma_channel_num_t num, dma_callback_t callback);
+
+static inline void dma_channel_set_burst_length(struct dma_channel_config *config, uint8_t burst)
+   { config->ctrla = (config->ctrla & ~0x03) | burst; }
+
+static inline void dma_channel_set_single_shot(struct dma_channel_config *config)
+   { config->ctrla |= DMA_CH_SINGLE_bm; }
+
+static inline void dma_channel_set_interrupt_level(struct dma_channel_config *config, enum dma_int_level_t level)
+   { config->ctrlb = (config->ctrlb & ~0x03) | level; }
+
+static inline void dma_channel_set_src_reload_mode(struct dma_channel_config *config, uint8_t mode)
+   { config->addrctrl = (config->addrctrl & ~0xC0) | mode; }
+
+static inline void dma_channel_set_dest_reload_mode(struct dma_channel_config *config, uint8_t mode)
+   { config->addrctrl = (config->addrctrl & ~0x0C) | mode; }
+
+static inline void dma_channel_set_src_dir_mode(struct dma_channel_config *config, uint8_t mode)
+   { config->addrctrl = (config->addrctrl & ~0x30) | mode; }
+
+static inline void dma_channel_set_dest_dir_mode(struct dma_channel_config *config, uint8_t mode)
+   { config->addrctrl = (config->addrctrl & ~0x03) | mode; }
+
+static inline void dma_channel_set_trigger_source(struct dma_channel_config *config, uint8_t source)
+   { config->trigsrc = source; }
+
+static inline void dma_channel_set_transfer_count(struct dma_channel_config *config, uint16_t count)
+   { config->trfcnt = count; }
+
+static inline void dma_channel_set_source_address(struct dma_channel_config *config, uint16_t address)
+   { config->srcaddr16 = address; }
+
+static inline void dma_channel_set_destination_address(struct dma_channel_config *config, uint16_t address)
+   { config->destaddr16 = address; }
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+#endif /* ndef linsim_dma_h_HAS_ALREADY_BEEN_INCLUDED */
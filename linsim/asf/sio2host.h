@@ -0,0 +1,51 @@
+#ifndef linsim_sio2host_h_HAS_ALREADY_BEEN_INCLUDED
+#define linsim_sio2host_h_HAS_ALREADY_BEEN_INCLUDED
+/**
+ * @addtogroup linsim
+ * @{
+ *****************************************************************************
+ * Stand-in for the ASF serial I/O service, connected to the GPS module.
+ * The bytes sent by the module are queued by the simulator, and become
+ *  available as they would be shifted in at the baud rate. The bytes sent
+ *  to the module are dropped.
+ * The baud rate is derived from the clock of the CPU, as by the USART, so
+ *  a rate set for another clock garbles the bytes received.
+ *****************************************************************************
+ * @file
+ * Serial I/O stand-in for the Linux simulator
+ * @author software@arreckx.com
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usart_spi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Ready the serial port */
+void sio2host_init(void);
+
+/** @return The next byte received, or -1 if none yet */
+int sio2host_getchar_nowait(void);
+
+/** Serial port of the GPS module. The simulator has no register for it */
+#define USART_HOST ((USART_t *)0)
+
+/** Baud rate of the GPS module */
+#define USART_HOST_BAUDRATE 9600
+
+/** Set the baud rate, for the given clock of the CPU */
+bool usart_set_baudrate(USART_t *usart, uint32_t baud, uint32_t cpu_hz);
+
+/** Send a string to the GPS module. Dropped */
+#define puts_P(s) ((void)(s))
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+#endif /* ndef linsim_sio2host_h_HAS_ALREADY_BEEN_INCLUDED */
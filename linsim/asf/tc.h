@@ -0,0 +1,140 @@
+#ifndef linsim_tc_h_HAS_ALREADY_BEEN_INCLUDED
+#define linsim_tc_h_HAS_ALREADY_BEEN_INCLUDED
+/**
+ * @addtogroup linsim
+ * @{
+ *****************************************************************************
+ * Stand-in for the ASF timer/counter driver.
+ * The timer/counters are modelled on the virtual clock. Once a clock source
+ *  is set, a counter overflows every (PER+1) * prescaler CPU cycles, and
+ *  the overflow callback is called if its interrupt is enabled, as on the
+ *  XMEGA.
+ * The count is derived from the time to the next overflow.
+ *****************************************************************************
+ * @file
+ * Timer/counter stand-in for the Linux simulator
+ * @author software@arreckx.com
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/************************************************************************/
+/* Registers                                                            */
+/************************************************************************/
+
+/** Registers of a timer/counter used by the code */
+typedef struct TC0_struct
+{
+   uint8_t CTRLA;     ///< Clock source
+   uint8_t CTRLB;     ///< Waveform generation mode
+   uint8_t INTCTRLA;  ///< Overflow interrupt level
+   uint8_t INTFLAGS;  ///< Overflow pending
+   uint16_t PER;      ///< Period
+} TC0_t;
+
+/** The timer/counters of the ATxmega64A4U */
+extern TC0_t TCC0, TCC1, TCD0, TCD1, TCE0;
+
+#define TC0_OVFINTLVL_gm 0x03 ///< Overflow interrupt level mask
+#define TC0_OVFINTLVL_gp 0    ///< Overflow interrupt level position
+#define TC0_OVFIF_bm     0x01 ///< Overflow interrupt flag
+
+/** Clock sources, as the prescaler divisions */
+typedef enum TC_CLKSEL_enum
+{
+   TC_CLKSEL_OFF_gc     = 0x00,
+   TC_CLKSEL_DIV1_gc    = 0x01,
+   TC_CLKSEL_DIV2_gc    = 0x02,
+   TC_CLKSEL_DIV4_gc    = 0x03,
+   TC_CLKSEL_DIV8_gc    = 0x04,
+   TC_CLKSEL_DIV64_gc   = 0x05,
+   TC_CLKSEL_DIV256_gc  = 0x06,
+   TC_CLKSEL_DIV1024_gc = 0x07,
+} TC_CLKSEL_t;
+
+/************************************************************************/
+/* Driver                                                               */
+/************************************************************************/
+
+/** Interrupt callback */
+typedef void (*tc_callback_t)(void);
+
+/** Waveform generation modes */
+enum tc_wg_mode_t
+{
+   TC_WG_NORMAL = 0x00,
+};
+
+/** Interrupt levels */
+enum TC_INT_LEVEL_t
+{
+   TC_INT_LVL_OFF = 0x00,
+   TC_INT_LVL_LO  = 0x01,
+   TC_INT_LVL_MED = 0x02,
+   TC_INT_LVL_HI  = 0x03,
+};
+
+/** Power the timer/counter up */
+void tc_enable(volatile void *tc);
+
+/** Stop the timer/counter */
+void tc_disable(volatile void *tc);
+
+/** Set the function called on overflow */
+void tc_set_overflow_interrupt_callback(volatile void *tc, tc_callback_t callback);
+
+/** Raise the overflow interrupt of a timer/counter now */
+void sim_tc_overflow(volatile void *tc);
+
+/**
+ * Enable or disable the overflow interrupt. A pending overflow is then handled.
+ * Inline, as the timer service disables the interrupt around each read of
+ *  its count.
+ */
+static inline void tc_set_overflow_interrupt_level(volatile void *tc, enum TC_INT_LEVEL_t level)
+{
+   TC0_t *pTc = (TC0_t *)tc;
+
+   pTc->INTCTRLA = (pTc->INTCTRLA & ~TC0_OVFINTLVL_gm) | (level << TC0_OVFINTLVL_gp);
+
+   if ( level != TC_INT_LVL_OFF && (pTc->INTFLAGS & TC0_OVFIF_bm) )
+   {
+      sim_tc_overflow(tc);
+   }
+}
+
+/** Start the timer/counter from a clock source, or stop it */
+void tc_write_clock_source(volatile void *tc, TC_CLKSEL_t clksel);
+
+/** Set the period, taken into account at the next overflow */
+static inline void tc_write_period(volatile void *tc, uint16_t per_value)
+   { ((TC0_t *)tc)->PER = per_value; }
+
+/** @return The period */
+static inline uint16_t tc_read_period(volatile void *tc)
+   { return ((TC0_t *)tc)->PER; }
+
+/** @return The count of a running timer/counter, or 0 if stopped */
+uint16_t tc_read_count(volatile void *tc);
+
+/** Set the count of a running timer/counter, which moves its next overflow */
+void tc_write_count(volatile void *tc, uint16_t cnt_value);
+
+/** Drop an overflow pending */
+static inline void tc_clear_overflow(volatile void *tc)
+   { ((TC0_t *)tc)->INTFLAGS &= ~TC0_OVFIF_bm; }
+
+/** Set the waveform generation mode */
+static inline void tc_set_wgm(volatile void *tc, enum tc_wg_mode_t wgm)
+   { ((TC0_t *)tc)->CTRLB = (uint8_t)wgm; }
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+#endif /* ndef linsim_tc_h_HAS_ALREADY_BEEN_INCLUDED */
@@ -0,0 +1,102 @@
+#ifndef linsim_twi_h_HAS_ALREADY_BEEN_INCLUDED
+#define linsim_twi_h_HAS_ALREADY_BEEN_INCLUDED
+/**
+ * @addtogroup linsim
+ * @{
+ *****************************************************************************
+ * Stand-in for the TWI master registers of the XMEGA, and the ASF status
+ *  codes its drivers return.
+ * The bus is not modelled. The registers are kept, so the code driving the
+ *  slave sets the status and calls the interrupt of the master.
+ *****************************************************************************
+ * @file
+ * TWI stand-in for the Linux simulator
+ * @author software@arreckx.com
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/************************************************************************/
+/* Status codes                                                         */
+/************************************************************************/
+
+/** Status codes of the ASF used by the drivers */
+enum status_code
+{
+   STATUS_OK             = 0,    ///< Success
+   ERR_IO_ERROR          = -1,   ///< I/O error
+   ERR_TIMEOUT           = -3,   ///< Operation timed out
+   ERR_PROTOCOL          = -5,   ///< Protocol error
+   ERR_BUSY              = -10,  ///< Resource is busy
+   OPERATION_IN_PROGRESS = -128, ///< Operation in progress
+};
+
+/************************************************************************/
+/* Registers                                                            */
+/************************************************************************/
+
+/** Registers of a TWI master */
+typedef struct TWI_MASTER_struct
+{
+   uint8_t CTRLA;  ///< Interrupt level and enables
+   uint8_t CTRLC;  ///< Command
+   uint8_t STATUS; ///< Flags and state of the bus
+   uint8_t BAUD;   ///< Baud rate
+   uint8_t ADDR;   ///< Address sent
+   uint8_t DATA;   ///< Data sent or received
+} TWI_MASTER_t;
+
+/** Registers of a TWI */
+typedef struct TWI_struct
+{
+   TWI_MASTER_t MASTER;
+} TWI_t;
+
+/** The TWI of the sensors */
+extern TWI_t TWIE;
+
+#define TWI_MASTER_INTLVL_MED_gc    0x80 ///< Interrupts at medium level
+#define TWI_MASTER_RIEN_bm          0x20 ///< Read interrupt enable
+#define TWI_MASTER_WIEN_bm          0x10 ///< Write interrupt enable
+#define TWI_MASTER_ENABLE_bm        0x08 ///< Master enable
+#define TWI_MASTER_ACKACT_bm        0x04 ///< Nack the next byte
+#define TWI_MASTER_CMD_RECVTRANS_gc 0x02 ///< Receive the next byte
+#define TWI_MASTER_CMD_STOP_gc      0x03 ///< Stop condition
+#define TWI_MASTER_RIF_bm           0x80 ///< Byte read
+#define TWI_MASTER_WIF_bm           0x40 ///< Byte written
+#define TWI_MASTER_RXACK_bm         0x10 ///< Nack received
+#define TWI_MASTER_ARBLOST_bm       0x08 ///< Arbitration lost
+#define TWI_MASTER_BUSERR_bm        0x04 ///< Bus error
+#define TWI_MASTER_BUSSTATE_IDLE_gc 0x01 ///< Bus idle
+
+/** Value of the baud register for a bus clock, as in the ASF */
+#define TWI_BAUD(F_SYS, F_TWI) ((F_SYS / (2 * F_TWI)) - 5)
+
+/************************************************************************/
+/* Interrupt controller                                                 */
+/************************************************************************/
+
+/** Registers of the interrupt controller */
+typedef struct PMIC_struct
+{
+   uint8_t CTRL; ///< Levels enabled
+} PMIC_t;
+
+/** The interrupt controller, kept for the record */
+extern PMIC_t PMIC;
+
+#define PMIC_MEDLVLEN_bm 0x02 ///< Medium level enabled
+
+/** Ignored. The peripherals are always clocked */
+#define sysclk_enable_peripheral_clock(module) ((void)(module))
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+#endif /* ndef linsim_twi_h_HAS_ALREADY_BEEN_INCLUDED */
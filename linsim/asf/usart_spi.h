@@ -0,0 +1,53 @@
+#ifndef linsim_usart_spi_h_HAS_ALREADY_BEEN_INCLUDED
+#define linsim_usart_spi_h_HAS_ALREADY_BEEN_INCLUDED
+/**
+ * @addtogroup linsim
+ * @{
+ *****************************************************************************
+ * Stand-in for the ASF USART driver in SPI master mode.
+ * Only the baud rate is kept, for the DMA to time its transfers.
+ *****************************************************************************
+ * @file
+ * USART stand-in for the Linux simulator
+ * @author software@arreckx.com
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Registers of a USART used by the code */
+typedef struct USART_struct
+{
+   uint8_t DATA;      ///< Data register, the DMA destination
+   uint8_t CTRLB;     ///< Receiver and transmitter enable
+   uint32_t baudrate; ///< Not a register. Set by usart_init_spi
+} USART_t;
+
+/** The USART feeding the LED drivers */
+extern USART_t USARTC1;
+
+/** Settings of the SPI master mode */
+typedef struct usart_spi_options
+{
+   uint32_t baudrate;
+   uint8_t spimode;
+   uint8_t data_order;
+} usart_spi_options_t;
+
+/** Set the USART as a SPI master */
+static inline void usart_init_spi(USART_t *usart, const usart_spi_options_t *opt)
+   { usart->baudrate = opt->baudrate; }
+
+/** Turn the receiver off */
+static inline void usart_rx_disable(USART_t *usart)
+   { usart->CTRLB &= ~0x10; }
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+#endif /* ndef linsim_usart_spi_h_HAS_ALREADY_BEEN_INCLUDED */
@@ -0,0 +1,728 @@
+/**
+ * @file
+ * Micro-benchmarks of the portable core libraries.
+ * The hot functions of the firmware run in a loop on the host, on top of the
+ *  simulated devices of linsim. Each benchmark runs in batches of operations,
+ *  with any setup between the batches kept out of the time.
+ * @code
+ * linsim-bench [-r rounds] [-t ms] [-f filter]
+ * @endcode
+ * The results are written to stdout as JSON, for trend tracking:
+ * @code
+ * {"clock_overhead_ns": 20, "rounds": 11, "benchmarks": [
+ *   {"name": "timer_arm", "ops": 123456, "ns_per_op": {"min": 12.3,
+ *    "median": 12.9, "max": 14.0}, "allocs_per_op": 0}, ...]}
+ * @endcode
+ * Use the minimum to compare runs: it is the least affected by the host.
+ * Any allocation by the code measured is counted, and should be 0.
+ * @author software@arreckx.com
+ * @internal
+ * @addtogroup linsim
+ * @{
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <time.h>
+#include <unistd.h>
+
+#include <asf.h>
+
+#include "lib/alert.h"
+#include "lib/reactor.h"
+#include "lib/timer.h"
+#include "lib/governor.h"
+#include "lib/tz.h"
+#include "lib/civil.h"
+#include "lib/gps.h"
+#include "lib/filter.hpp"
+#include "driver/fb.h"
+#include "core/topo.h"
+#include "core/measurements.h"
+#include "core/configuration.hpp"
+#include "linsim.h"
+
+extern "C" void rtc_init(void);
+extern "C" void timer_overflow_it(void);
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t size);
+
+// ---------------------------------------------------------------------------
+// Local types
+// ---------------------------------------------------------------------------
+namespace
+{
+   /** A benchmark of a function */
+   struct Benchmark
+   {
+      const char *name;
+      /** Number of operations per batch */
+      uint32_t batch;
+      /** Run a batch of operations. Timed */
+      void (*run)(uint32_t ops);
+      /** Called before each batch. Not timed. Can be null */
+      void (*setup)(void);
+      /** Called after each batch. Not timed. Can be null */
+      void (*teardown)(void);
+   };
+
+   /** Time per operation over the rounds, in ns */
+   struct Result
+   {
+      uint64_t ops;
+      double min;
+      double median;
+      double max;
+      uint64_t allocs;
+   };
+}
+
+// ---------------------------------------------------------------------------
+// Local variables
+// ---------------------------------------------------------------------------
+namespace
+{
+   /** Counts the allocations made through malloc, and new */
+   volatile uint64_t allocations = 0;
+
+   /** Keeps the results from being optimised away */
+   volatile uint32_t sink;
+
+   /** Host time to read the clock, removed from each batch */
+   uint64_t clockOverhead = 0;
+
+   /** Number of timers armed per batch. Below TIMER_MAX_CALLBACK */
+   const uint32_t TIMER_BATCH = 48;
+
+   /** Delay of the timers armed, in ms. Shuffled so the inserts vary */
+   uint16_t timerDelays[TIMER_BATCH];
+
+   /** NMEA sentences fed to the GPS parser */
+   std::string nmea;
+
+   /** UTC times given to the time zone service, over a year */
+   std::vector<uint32_t> timestamps;
+
+   /** UTC times converted to dates, over the range of the ASF calendar */
+   std::vector<uint32_t> civilTimestamps;
+
+   /** Dates converted to UTC times */
+   std::vector<calendar_date> civilDates;
+
+   /** Station positions and routes to look up */
+   std::vector<std::pair<tiny_index_t, route_id_t>> routeLookups;
+
+   /** LEDs and routes to look up */
+   std::vector<std::pair<fb_index_t, route_id_t>> offsetLookups;
+
+   /** Raw readings of the sensors, with some noise and spikes */
+   std::vector<int16_t> readings;
+
+   /** All routes, both ways */
+   const route_id_t ROUTES[] =
+   {
+      A3_A4, A3_A2, A5_A4, A5_A2, A1_A4, A1_A2,
+      A4_A3, A2_A3, A4_A5, A2_A5, A4_A1, A2_A1,
+   };
+}
+
+// ---------------------------------------------------------------------------
+// Allocations
+// ---------------------------------------------------------------------------
+
+extern "C" void *malloc(size_t size)
+{
+   ++allocations;
+   return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+   ++allocations;
+   return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *p, size_t size)
+{
+   ++allocations;
+   return __libc_realloc(p, size);
+}
+
+// ---------------------------------------------------------------------------
+// Private functions
+// ---------------------------------------------------------------------------
+namespace
+{
+   /** @return The host time in ns */
+   inline uint64_t host_ns()
+   {
+      struct timespec ts;
+
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+
+      return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+   }
+
+   /** @return The least time measured between two reads of the clock */
+   uint64_t measure_clock_overhead()
+   {
+      uint64_t least = UINT64_MAX;
+
+      for (int i = 0; i < 1000; ++i)
+      {
+         uint64_t start = host_ns();
+         least = std::min(least, host_ns() - start);
+      }
+
+      return least;
+   }
+
+   /** @return The next number of a fixed pseudo random sequence */
+   uint32_t next_random()
+   {
+      static uint32_t state = 1;
+
+      state = state * 1103515245u + 12345u;
+
+      return state >> 16;
+   }
+
+   /** Append a sentence with its checksum to the NMEA input */
+   void add_sentence(const char *body)
+   {
+      char checksum[8];
+      uint8_t parity = 0;
+
+      for (const char *p = body; *p; ++p)
+      {
+         parity ^= (uint8_t)*p;
+      }
+
+      snprintf(checksum, sizeof(checksum), "*%02X\r\n", parity);
+
+      nmea += '$';
+      nmea += body;
+      nmea += checksum;
+   }
+
+   /** Timer callback which does nothing */
+   void on_timer(timer_instance_t, void *)
+   {
+   }
+
+   /** Let 1s go by for the timer service, and fire all the timers due */
+   void expire_timers()
+   {
+      for (int i = 0; i < 1000; ++i)
+      {
+         timer_overflow_it();
+      }
+
+      for (uint32_t i = 0; i < TIMER_BATCH; ++i)
+      {
+         timer_dispatch();
+      }
+   }
+
+   /** Arm the timers of a batch, all due */
+   void arm_timers_due()
+   {
+      timer_count_t now = timer_get_count();
+
+      for (uint32_t i = 0; i < TIMER_BATCH; ++i)
+      {
+         timer_arm(on_timer, now - timerDelays[i], nullptr);
+      }
+   }
+
+   // -- Benchmarked operations ----------------------------------------------
+
+   /** Arm a timer in a list which fills up */
+   void run_timer_arm(uint32_t ops)
+   {
+      timer_count_t now = timer_get_count();
+
+      for (uint32_t i = 0; i < ops; ++i)
+      {
+         sink = timer_arm(on_timer, now + timerDelays[i], nullptr);
+      }
+   }
+
+   /** Fire the first timer of the list */
+   void run_timer_dispatch(uint32_t ops)
+   {
+      for (uint32_t i = 0; i < ops; ++i)
+      {
+         timer_dispatch();
+      }
+   }
+
+   /** Parse a character of NMEA */
+   void run_gps_encode(uint32_t ops)
+   {
+      static TinyGPS gps;
+      static size_t pos = 0;
+      uint32_t parsed = 0;
+
+      for (uint32_t i = 0; i < ops; ++i)
+      {
+         parsed += gps.encode(nmea[pos]);
+
+         if (++pos == nmea.size())
+         {
+            pos = 0;
+         }
+      }
+
+      sink = parsed;
+   }
+
+   /** Get the local date and time */
+   void run_tz_now(uint32_t ops)
+   {
+      static size_t pos = 0;
+      tz_datetime_t date;
+
+      for (uint32_t i = 0; i < ops; ++i)
+      {
+         sim_rtc_set(timestamps[pos]);
+         sink = tz_now(&date)->hour;
+
+         if (++pos == timestamps.size())
+         {
+            pos = 0;
+         }
+      }
+   }
+
+   /** Convert a UTC time into a date */
+   void run_civil_to_date(uint32_t ops)
+   {
+      static size_t pos = 0;
+      calendar_date date;
+
+      for (uint32_t i = 0; i < ops; ++i)
+      {
+         civil_timestamp_to_date(civilTimestamps[pos], &date);
+         sink = date.date;
+
+         if (++pos == civilTimestamps.size())
+         {
+            pos = 0;
+         }
+      }
+   }
+
+   /** Convert a UTC time into a date with the ASF calendar, for reference */
+   void run_calendar_to_date(uint32_t ops)
+   {
+      static size_t pos = 0;
+      calendar_date date;
+
+      for (uint32_t i = 0; i < ops; ++i)
+      {
+         calendar_timestamp_to_date(civilTimestamps[pos], &date);
+         sink = date.date;
+
+         if (++pos == civilTimestamps.size())
+         {
+            pos = 0;
+         }
+      }
+   }
+
+   /** Convert a date into a UTC time */
+   void run_civil_to_timestamp(uint32_t ops)
+   {
+      static size_t pos = 0;
+
+      for (uint32_t i = 0; i < ops; ++i)
+      {
+         sink = civil_date_to_timestamp(&civilDates[pos]);
+
+         if (++pos == civilDates.size())
+         {
+            pos = 0;
+         }
+      }
+   }
+
+   /** Convert a date into a UTC time with the ASF calendar, for reference */
+   void run_calendar_to_timestamp(uint32_t ops)
+   {
+      static size_t pos = 0;
+
+      for (uint32_t i = 0; i < ops; ++i)
+      {
+         sink = calendar_date_to_timestamp(&civilDates[pos]);
+
+         if (++pos == civilDates.size())
+         {
+            pos = 0;
+         }
+      }
+   }
+
+   /** Get the LED of a station on a route */
+   void run_topo_get_led(uint32_t ops)
+   {
+      static size_t pos = 0;
+
+      for (uint32_t i = 0; i < ops; ++i)
+      {
+         sink = topo_get_led(routeLookups[pos].first, routeLookups[pos].second);
+
+         if (++pos == routeLookups.size())
+         {
+            pos = 0;
+         }
+      }
+   }
+
+   /** Find a LED on a route */
+   void run_topo_get_offset(uint32_t ops)
+   {
+      static size_t pos = 0;
+
+      for (uint32_t i = 0; i < ops; ++i)
+      {
+         sink = topo_get_offset(offsetLookups[pos].first, offsetLookups[pos].second);
+
+         if (++pos == offsetLookups.size())
+         {
+            pos = 0;
+         }
+      }
+   }
+
+   /** Filter a temperature reading, as driver/temperature.cpp */
+   void run_temperature_filter(uint32_t ops)
+   {
+      static lib::MedianFilter<int16_t, 3> spikeFilter;
+      static lib::BoxFilter<int16_t, 16> averageFilter;
+      static size_t pos = 0;
+
+      for (uint32_t i = 0; i < ops; ++i)
+      {
+         sink = averageFilter.push(spikeFilter.push(readings[pos]));
+
+         if (++pos == readings.size())
+         {
+            pos = 0;
+         }
+      }
+   }
+
+   /** Filter a luminosity reading, as driver/lum.cpp */
+   void run_lum_filter(uint32_t ops)
+   {
+      static lib::BoxFilter<uint8_t, 32, uint16_t> averageFilter;
+      static lib::Hysteresis<uint8_t, 14, 18> isBright;
+      static size_t pos = 0;
+
+      for (uint32_t i = 0; i < ops; ++i)
+      {
+         averageFilter.push((uint8_t)readings[pos]);
+         sink = isBright.update(averageFilter.get());
+
+         if (++pos == readings.size())
+         {
+            pos = 0;
+         }
+      }
+   }
+
+   /** Encode the frame for the LED drivers, as each tick of the fb */
+   void run_fb_tick(uint32_t ops)
+   {
+      for (uint32_t i = 0; i < ops; ++i)
+      {
+         sim_tc_overflow(&FB_TIMER_TC);
+      }
+   }
+
+   /** Update each mode of the sequence in turn, as the sequencer renders */
+   void run_mode_update(uint32_t ops)
+   {
+      static uint8_t index = 0;
+
+      for (uint32_t i = 0; i < ops; ++i)
+      {
+         sink = config::short_push_sequence::call<mode::Updater>(index);
+         index = (index + 1) % config::number_of_sequence;
+      }
+   }
+
+   /** Step the metro mode, whose display runs its journey */
+   void run_metro_update(uint32_t ops)
+   {
+      for (uint32_t i = 0; i < ops; ++i)
+      {
+         sink = mode::update<mode::Metro>();
+      }
+   }
+
+   /** Step the demo mode, started again once over */
+   void run_demo_update(uint32_t ops)
+   {
+      for (uint32_t i = 0; i < ops; ++i)
+      {
+         if ((sink = mode::update<mode::Demo>()) == 0)
+         {
+            mode::reset<mode::Demo>();
+         }
+      }
+   }
+
+   /** Benchmarks, in the order run */
+   const Benchmark BENCHMARKS[]
+   {
+      { "timer_arm",          TIMER_BATCH, run_timer_arm,          nullptr,        expire_timers },
+      { "timer_dispatch",     TIMER_BATCH, run_timer_dispatch,     arm_timers_due, nullptr },
+      { "gps_encode",         1024,        run_gps_encode,         nullptr,        nullptr },
+      { "tz_now",             1024,        run_tz_now,             nullptr,        nullptr },
+      { "civil_to_date",      1024,        run_civil_to_date,      nullptr,        nullptr },
+      { "calendar_to_date",   1024,        run_calendar_to_date,   nullptr,        nullptr },
+      { "civil_to_timestamp", 1024,        run_civil_to_timestamp, nullptr,        nullptr },
+      { "calendar_to_timestamp", 1024,     run_calendar_to_timestamp, nullptr,     nullptr },
+      { "topo_get_led",       1024,        run_topo_get_led,       nullptr,        nullptr },
+      { "topo_get_offset",    1024,        run_topo_get_offset,    nullptr,        nullptr },
+      { "temperature_filter", 1024,        run_temperature_filter, nullptr,        nullptr },
+      { "lum_filter",         1024,        run_lum_filter,         nullptr,        nullptr },
+      { "fb_tick",            256,         run_fb_tick,            nullptr,        nullptr },
+      { "mode_update",        1024,        run_mode_update,        nullptr,        nullptr },
+      { "metro_update",       1024,        run_metro_update,       nullptr,        nullptr },
+      { "demo_update",        1024,        run_demo_update,        nullptr,        nullptr },
+   };
+
+   /** Prepare the inputs of the benchmarks, and the services measured */
+   void prepare()
+   {
+      // Timers due in the next second, in any order
+      for (uint32_t i = 0; i < TIMER_BATCH; ++i)
+      {
+         timerDelays[i] = (uint16_t)(next_random() % 1000);
+      }
+
+      // A second of output of the GPS
+      add_sentence("GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W");
+      add_sentence("GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,");
+      add_sentence("GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1");
+      add_sentence("GPGSV,2,1,08,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45");
+
+      // Every 7 hours over a year
+      for (uint32_t t = 0; t < 365u * 24 * 3600; t += 7 * 3600)
+      {
+         timestamps.push_back(TZ_SERVICE_EPOCH + 86400 + t);
+      }
+
+      // Spread over the years of the ASF calendar, at any time of the day
+      for (int i = 0; i < 1024; ++i)
+      {
+         calendar_date date;
+
+         civilTimestamps.push_back(next_random() % 49675u * CIVIL_SECS_PER_DAY + next_random() % 86400u);
+         civil_timestamp_to_date(civilTimestamps.back(), &date);
+         civilDates.push_back(date);
+      }
+
+      // All stations of all routes, and some past the end
+      for (route_id_t route : ROUTES)
+      {
+         for (tiny_index_t i = 0; i < 24; ++i)
+         {
+            routeLookups.emplace_back(i, route);
+         }
+
+         for (fb_index_t led = 0; led < FB_NUMBER_OF_LEDS; ++led)
+         {
+            offsetLookups.emplace_back(led, route);
+         }
+      }
+
+      // 19.6 degrees in 1/16th, with noise and a spike now and then
+      for (int i = 0; i < 1024; ++i)
+      {
+         readings.push_back(
+            (int16_t)(314 + next_random() % 5 + (next_random() % 64 == 0 ? 200 : 0)));
+      }
+
+      // A frame with all statuses and levels
+      for (fb_index_t led = 0; led < FB_NUMBER_OF_LEDS; ++led)
+      {
+         static const uint8_t STATUSES[] =
+         {
+            LED_OFF, LED_ON, LED_FLASH_SLOW, LED_FLASH_MEDIUM, LED_FLASH_FAST, LED_FLASH_VFAST,
+         };
+         fb_led_t l = { STATUSES[led % 6], (uint8_t)(led % 16) };
+
+         fb_current[led] = l;
+      }
+
+      alert_init();
+      governor_init();
+      reactor_init();
+      rtc_init();
+      timer_init();
+      fb_init();
+      measurement_init();
+
+      // The modes render to a working frame, as the sequencer
+      static fb_mem_t workingFrame;
+
+      fb_use(&workingFrame);
+
+      for (uint8_t i = 0; i < config::number_of_sequence; ++i)
+      {
+         config::short_push_sequence::call<mode::Resetter>(i);
+      }
+
+      mode::reset<config::long_push_mode>();
+
+      // Timers can then be armed in the past
+      expire_timers();
+   }
+
+   /** @return The results of a benchmark */
+   Result measure(const Benchmark &bench, int rounds, uint64_t roundNs)
+   {
+      std::vector<double> times;
+      Result result = {};
+
+      // The first round warms up
+      for (int round = -1; round < rounds; ++round)
+      {
+         uint64_t elapsed = 0;
+         uint64_t ops = 0;
+
+         while (elapsed < roundNs)
+         {
+            if (bench.setup)
+            {
+               bench.setup();
+            }
+
+            uint64_t allocs = allocations;
+            uint64_t start = host_ns();
+
+            bench.run(bench.batch);
+
+            uint64_t duration = host_ns() - start;
+
+            allocs = allocations - allocs;
+
+            if (bench.teardown)
+            {
+               bench.teardown();
+            }
+
+            elapsed += duration > clockOverhead ? duration - clockOverhead : 0;
+            ops += bench.batch;
+
+            if (round >= 0)
+            {
+               result.allocs += allocs;
+            }
+         }
+
+         if (round >= 0)
+         {
+            result.ops += ops;
+            times.push_back((double)elapsed / ops);
+         }
+      }
+
+      std::sort(times.begin(), times.end());
+
+      result.min = times.front();
+      result.median = times[times.size() / 2];
+      result.max = times.back();
+
+      return result;
+   }
+
+   /** Print the usage and exit */
+   void usage(const char *name)
+   {
+      fprintf(
+         stderr,
+         "Usage: %s [options]\n"
+         " -r rounds  Number of rounds measured per benchmark. Default 11\n"
+         " -t ms      Host time of each round. Default 20\n"
+         " -f name    Only run the benchmarks whose name contains this\n",
+         name);
+
+      exit(EXIT_FAILURE);
+   }
+}
+
+// ---------------------------------------------------------------------------
+// Entry point
+// ---------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+   int rounds = 11;
+   uint64_t roundNs = 20000000u;
+   const char *filter = "";
+   const char *separator = "";
+   int opt;
+
+   while ((opt = getopt(argc, argv, "r:t:f:")) != -1)
+   {
+      switch (opt)
+      {
+      case 'r':
+         if ((rounds = atoi(optarg)) <= 0)
+         {
+            usage(argv[0]);
+         }
+         break;
+      case 't':
+         roundNs = strtoull(optarg, nullptr, 10) * 1000000u;
+         break;
+      case 'f':
+         filter = optarg;
+         break;
+      default:
+         usage(argv[0]);
+      }
+   }
+
+   prepare();
+   clockOverhead = measure_clock_overhead();
+
+   printf("{\"clock_overhead_ns\": %llu, \"rounds\": %d, \"benchmarks\": [",
+      (unsigned long long)clockOverhead, rounds);
+
+   for (const Benchmark &bench : BENCHMARKS)
+   {
+      if (!strstr(bench.name, filter))
+      {
+         continue;
+      }
+
+      Result result = measure(bench, rounds, roundNs);
+
+      printf(
+         "%s\n  {\"name\": \"%s\", \"ops\": %llu, "
+         "\"ns_per_op\": {\"min\": %.2f, \"median\": %.2f, \"max\": %.2f}, "
+         "\"allocs_per_op\": %g}",
+         separator, bench.name, (unsigned long long)result.ops,
+         result.min, result.median, result.max, (double)result.allocs / result.ops);
+
+      separator = ",";
+   }
+
+   printf("\n]}\n");
+
+   return sim_alert_count() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**@} ---------------------------  End of file  --------------------------- */
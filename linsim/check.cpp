@@ -0,0 +1,1177 @@
+/**
+ * @file
+ * Checks of the behaviour of the portable core libraries.
+ * Each check drives the firmware code on the host, on top of the simulated
+ *  devices of linsim, and tests its results against a reference.
+ * @code
+ * linsim-check [-f filter]
+ * @endcode
+ * Each check reports a line, after its first failures if any:
+ * @code
+ * PASS civil_round_trip
+ *   check.cpp:123: civil_date_to_timestamp(&date) == 0
+ * FAIL civil_invalid_dates
+ * @endcode
+ * The exit status is a failure if any check fails.
+ * @author software@arreckx.com
+ * @internal
+ * @addtogroup linsim
+ * @{
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <asf.h>
+#include <sio2host.h>
+
+#include "lib/alert.h"
+#include "lib/civil.h"
+#include "lib/filter.hpp"
+#include "lib/timer.h"
+#include "lib/governor.h"
+#include "lib/reactor.h"
+#include "lib/delta_ring.h"
+#include "core/history.h"
+#include "core/journal.h"
+#include "core/gps_manager.h"
+#include "driver/key.h"
+#include "driver/twi_queue.h"
+#include "linsim.h"
+#include "logger.h"
+
+extern "C" void rtc_init(void);
+extern "C" void timer_overflow_it(void);
+extern "C" void KEY_PIN_vect(void);
+extern "C" void TWIE_TWIM_vect(void);
+
+// ---------------------------------------------------------------------------
+// Local types
+// ---------------------------------------------------------------------------
+namespace
+{
+   /** A check of a behaviour */
+   struct Check
+   {
+      const char *name;
+      /** Run the check. Reports the failures with #CHECK */
+      void (*run)(void);
+   };
+}
+
+// ---------------------------------------------------------------------------
+// Local variables
+// ---------------------------------------------------------------------------
+namespace
+{
+   /** Number of failures of the check running */
+   uint32_t failures = 0;
+
+   /** Number of failures printed per check, the others are counted only */
+   const uint32_t MAX_FAILURES_SHOWN = 8;
+
+   /** First day out of the range of the ASF calendar, 2106-01-01 */
+   const uint16_t CALENDAR_END_DAY = 49675;
+
+   /** Last day of the range of the civil conversions, 2106-02-07 */
+   const uint16_t CIVIL_LAST_DAY = 49710;
+
+   /** Minutes in a day, as kept by the history */
+   const uint16_t MINUTES_PER_DAY = 1440;
+
+   /** Bytes of the ring of the minutes of the history, by default */
+   const uint16_t HISTORY_MINUTES_BYTES = 540;
+
+   /** Baud rate of the GPS module */
+   const uint32_t GPS_BAUD = 9600;
+
+   /** Sensor readings per minute, as the temperature is sampled when settled */
+   const int READINGS_PER_MINUTE = 15;
+
+   /** Pushes dispatched by the key, by kind */
+   int keyShorts = 0, keyLongs = 0, keyVeryLongs = 0;
+
+   /** Time of the last short push dispatched */
+   sim_time_t keyShortAt = 0;
+
+   /** Clock when the last short push was dispatched */
+   uint32_t keyShortHz = 0;
+
+   /** Timer count when the last short push was dispatched */
+   timer_count_t keyShortCount = 0;
+
+   /** Time of the edge of the key, once the bounces of the release settled */
+   timer_count_t keyEdgeSettled = 0;
+
+   /** Time a release bounces for, long enough to span several ticks */
+   const sim_time_t KEY_RELEASE_BOUNCE = SIM_MILLISECONDS(5);
+
+   /** Threads tracing at once through the tracing library */
+   const int LOG_THREADS = 4;
+
+   /** Traces of each of these threads */
+   const int LOG_TRACES_PER_THREAD = 500;
+
+   /** Time the slave takes to ack a TWI job, past the start of a ms */
+   const sim_time_t TWI_ACK_DELAY = SIM_MILLISECONDS(53) / 10;
+
+   /** Time stamp ticks of the TWI queue per ms of the timer service */
+   const uint32_t TWI_TICKS_PER_MS = 125;
+
+   /** Length of a ms of the timer service, 126 counts of 8us */
+   const sim_time_t TIMER_MS = SIM_MILLISECONDS(1008) / 1000;
+
+   /** Job probing the latency of the TWI queue */
+   twi_job_t twiJob = {};
+
+   /** Latency of each probe, and the clock when it completed */
+   std::vector<uint16_t> twiLatencies;
+   std::vector<uint32_t> twiHz;
+
+   /** Alerts of a storm, raised from the same line */
+   const int ALERT_STORM = 1000;
+
+   /** Line of the alerts of the storm, past the lines of the code */
+   const uint16_t ALERT_STORM_LINE = 60000;
+
+   /** Traces of a storm, limited to a burst of #LOG_STORM_BURST a second */
+   const int LOG_STORM_TRACES = 100;
+
+   /** Traces of a storm let through in a row */
+   const int LOG_STORM_BURST = 3;
+}
+
+/** Report a failure if the condition does not hold */
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+// ---------------------------------------------------------------------------
+// Private functions
+// ---------------------------------------------------------------------------
+namespace
+{
+   /** Count a failure, and print the first ones */
+   void check(bool holds, const char *condition, const char *file, int line)
+   {
+      if (!holds && failures++ < MAX_FAILURES_SHOWN)
+      {
+         printf("  %s:%d: %s\n", file, line, condition);
+      }
+   }
+
+   /** @return A date, with the time */
+   calendar_date make_date(
+      uint16_t year, uint8_t month, uint8_t date,
+      uint8_t hour = 0, uint8_t minute = 0, uint8_t second = 0)
+   {
+      calendar_date d = {};
+
+      d.year = year;
+      d.month = month;
+      d.date = date;
+      d.hour = hour;
+      d.minute = minute;
+      d.second = second;
+
+      return d;
+   }
+
+   /** @return true if both dates are the same, day of the week included */
+   bool same_date(const calendar_date &a, const calendar_date &b)
+   {
+      return
+         a.year == b.year && a.month == b.month && a.date == b.date &&
+         a.hour == b.hour && a.minute == b.minute && a.second == b.second &&
+         a.dayofweek == b.dayofweek;
+   }
+
+   /** @return The next number of a fixed pseudo random sequence */
+   uint32_t next_random()
+   {
+      static uint32_t state = 1;
+
+      state = state * 1103515245u + 12345u;
+
+      return state >> 16;
+   }
+
+   /**
+    * @return A day of a room, a minute per sample, in 10th of degrees.
+    * The air drifts by the given swing around 19 degrees over the day. The
+    *  sensor reads in 1/16th of a degree with some noise and the odd bad
+    *  read, filtered as driver/temperature.cpp.
+    */
+   std::vector<int16_t> room_trace(double swing)
+   {
+      lib::MedianFilter<int16_t, 3> spikeFilter;
+      lib::BoxFilter<int16_t, 16> averageFilter;
+      std::vector<int16_t> trace;
+
+      spikeFilter.fill(19 * 16);
+      averageFilter.fill(19 * 16);
+
+      for (int minute = 0; minute < MINUTES_PER_DAY; ++minute)
+      {
+         double air = 19.0 + swing * sin(2 * M_PI * minute / MINUTES_PER_DAY);
+
+         for (int i = 0; i < READINGS_PER_MINUTE; ++i)
+         {
+            int16_t reading = (int16_t)lround(air * 16) + (int16_t)(next_random() % 5) - 2;
+
+            if (next_random() % 100 == 0)
+            {
+               reading += 100;
+            }
+
+            averageFilter.push(spikeFilter.push(reading));
+         }
+
+         trace.push_back((int16_t)(averageFilter.get() * 10 / 16));
+      }
+
+      return trace;
+   }
+
+   /** @return The bits per sample to code a trace, or 0 if some were dropped */
+   double bits_per_sample(const std::vector<int16_t> &trace)
+   {
+      static uint8_t buffer[HISTORY_MINUTES_BYTES];
+      delta_ring_t ring;
+      delta_ring_iter_t iter;
+      int16_t value;
+      size_t i = 0;
+
+      delta_ring_init(&ring, buffer, sizeof(buffer), MINUTES_PER_DAY);
+
+      for (int16_t sample : trace)
+      {
+         delta_ring_push(&ring, sample);
+      }
+
+      if (delta_ring_count(&ring) != trace.size())
+      {
+         return 0;
+      }
+
+      // The samples read back as pushed
+      delta_ring_iter_init(&iter, &ring);
+
+      while (delta_ring_iter_next(&iter, &value))
+      {
+         CHECK(value == trace[i++]);
+      }
+
+      return (double)ring.used / (trace.size() - 1);
+   }
+
+   /** Let a minute go by for the timer service, and fire the timers due */
+   void run_minute()
+   {
+      for (int i = 0; i < 60000; ++i)
+      {
+         timer_overflow_it();
+      }
+
+      // One callback per dispatch, and only the history is armed
+      timer_dispatch();
+   }
+
+   /**
+    * Let the governor measure a window with no load, so it steps the clock
+    *  down, or up to the full speed if locked.
+    */
+   void run_idle_window()
+   {
+      governor_enter_busy();
+      governor_enter_idle();
+
+      for (int i = 0; i < GOVERNOR_WINDOW; ++i)
+      {
+         timer_overflow_it();
+      }
+
+      governor_enter_busy();
+      governor_enter_idle();
+   }
+
+   /** @return true if the serial port of the GPS runs at its baud rate, within 2% */
+   bool gps_baud_holds()
+   {
+      uint32_t baud = sim_sio2host_baud();
+
+      return baud * 50 >= GPS_BAUD * 49 && baud * 50 <= GPS_BAUD * 51;
+   }
+
+   /** Count a short push */
+   void on_key_short()
+   {
+      ++keyShorts;
+      keyShortAt = sim_now();
+      keyShortHz = sim_cpu_hz();
+      keyShortCount = timer_get_count();
+   }
+
+   /** Count a long push */
+   void on_key_long()
+   {
+      ++keyLongs;
+   }
+
+   /** Count a very long push */
+   void on_key_very_long()
+   {
+      ++keyVeryLongs;
+   }
+
+   /** Set the level of the key pin, and raise its interrupt. Any arg pushes */
+   void on_key_edge(void *push)
+   {
+      sim_pin_set(KEY_PIN, push == nullptr);
+      KEY_PIN_vect();
+   }
+
+   /** Keep the time of the edge of the key */
+   void on_key_settled(void *)
+   {
+      keyEdgeSettled = key_get_edge_time();
+   }
+
+   /**
+    * Push the key, bouncing at first, and on the release if asked.
+    *
+    * @param at When the key is pushed
+    * @param length Time until the key is released
+    * @param bounces Number of times the contact opens in the first ms
+    * @param releaseBounces Number of times the contact closes again within
+    *  #KEY_RELEASE_BOUNCE of the release
+    */
+   void push_key(sim_time_t at, sim_time_t length, int bounces = 0, int releaseBounces = 0)
+   {
+      static int pushed;
+      sim_time_t bounce = SIM_MILLISECONDS(1) / (2 * bounces + 1);
+      sim_time_t releaseBounce = KEY_RELEASE_BOUNCE / (2 * releaseBounces + 1);
+
+      for (int i = 0; i <= 2 * bounces; ++i)
+      {
+         sim_schedule(at + i * bounce, on_key_edge, i % 2 ? nullptr : &pushed);
+      }
+
+      for (int i = 0; i <= 2 * releaseBounces; ++i)
+      {
+         sim_schedule(at + length + i * releaseBounce, on_key_edge, i % 2 ? &pushed : nullptr);
+      }
+   }
+
+   /** Pushes expected by a time */
+   struct KeyPushes
+   {
+      int shorts, longs, veryLongs;
+   };
+
+   /** Check the pushes dispatched so far */
+   void on_key_expect(void *arg)
+   {
+      const KeyPushes *pushes = (const KeyPushes *)arg;
+
+      CHECK(keyShorts == pushes->shorts);
+      CHECK(keyLongs == pushes->longs);
+      CHECK(keyVeryLongs == pushes->veryLongs);
+   }
+
+   /** The slave acks the address of the job on the bus */
+   void on_twi_ack(void *)
+   {
+      TWIE.MASTER.STATUS = TWI_MASTER_WIF_bm;
+      TWIE_TWIM_vect();
+   }
+
+   /** Submit the probe, acked after #TWI_ACK_DELAY */
+   void on_twi_submit(void *)
+   {
+      CHECK(twi_queue_submit(&twiJob));
+      sim_schedule(sim_now() + TWI_ACK_DELAY, on_twi_ack, nullptr);
+   }
+
+   /** Keep the latency of the probe, and let the clock step down after the first */
+   void on_twi_done(twi_job_t *job)
+   {
+      twi_queue_stats_t stats;
+
+      CHECK(job->status == STATUS_OK);
+
+      twi_queue_get_stats(&stats);
+      twiLatencies.push_back(stats.latency_last);
+      twiHz.push_back(sim_cpu_hz());
+
+      if (twiLatencies.size() == 1)
+      {
+         governor_unlock();
+      }
+   }
+
+   /** Stop the simulation */
+   void on_stop(void *)
+   {
+      sim_stop();
+   }
+
+   // -- Checks --------------------------------------------------------------
+
+   /**
+    * Every day of the range converts to a date and back, with a time of the
+    *  day which changes each day, and agrees with the ASF calendar over its
+    *  own range.
+    */
+   void check_civil_round_trip()
+   {
+      for (uint32_t day = 0; day <= CIVIL_LAST_DAY; ++day)
+      {
+         uint32_t secsOfDay = (day * 7919u) % CIVIL_SECS_PER_DAY;
+         uint32_t timestamp = day * CIVIL_SECS_PER_DAY + secsOfDay;
+         calendar_date date;
+
+         // The last day ends at 06:28:15
+         if (timestamp < day * CIVIL_SECS_PER_DAY)
+         {
+            continue;
+         }
+
+         civil_timestamp_to_date(timestamp, &date);
+
+         CHECK(civil_days_from_civil(date.year, date.month, date.date) == day);
+         CHECK(civil_date_to_timestamp(&date) == timestamp);
+
+         if (day < CALENDAR_END_DAY)
+         {
+            calendar_date reference;
+
+            calendar_timestamp_to_date(timestamp, &reference);
+
+            CHECK(same_date(date, reference));
+         }
+      }
+
+      // All the seconds of a day
+      for (uint32_t secsOfDay = 0; secsOfDay < CIVIL_SECS_PER_DAY; ++secsOfDay)
+      {
+         uint32_t timestamp = 17000u * CIVIL_SECS_PER_DAY + secsOfDay;
+         calendar_date date, reference;
+
+         civil_timestamp_to_date(timestamp, &date);
+         calendar_timestamp_to_date(timestamp, &reference);
+
+         CHECK(same_date(date, reference));
+         CHECK(civil_date_to_timestamp(&date) == timestamp);
+      }
+
+      // The last second of the range
+      calendar_date last = make_date(2106, 1, 6, 6, 28, 15);
+
+      CHECK(civil_date_to_timestamp(&last) == UINT32_MAX);
+   }
+
+   /**
+    * The dates which do not exist, or are out of range, convert to 0.
+    * All the days of the months of the range of the ASF calendar are valid
+    *  for both, or none.
+    */
+   void check_civil_invalid_dates()
+   {
+      const calendar_date invalid[] =
+      {
+         make_date(1969, 11, 30, 23, 59, 59),
+         make_date(2023, 1, 28),
+         make_date(2023, 1, 29),
+         make_date(2100, 1, 28),
+         make_date(2023, 3, 30),
+         make_date(2023, 10, 30),
+         make_date(2023, 0, 31),
+         make_date(2023, 12, 0),
+         make_date(2023, 0, 0, 24),
+         make_date(2023, 0, 0, 0, 60),
+         make_date(2023, 0, 0, 0, 0, 60),
+         make_date(2106, 1, 6, 6, 28, 16),
+         make_date(2106, 1, 7),
+         make_date(2106, 2, 0),
+         make_date(2106, 11, 30, 23, 59, 59),
+         make_date(2107, 0, 0),
+      };
+
+      for (const calendar_date &date : invalid)
+      {
+         CHECK(civil_date_to_timestamp(&date) == 0);
+      }
+
+      calendar_date leap = make_date(2024, 1, 28);
+      calendar_date century = make_date(2000, 1, 28);
+
+      CHECK(civil_date_to_timestamp(&leap) != 0);
+      CHECK(civil_date_to_timestamp(&century) != 0);
+
+      for (uint16_t year = 1970; year < 2106; ++year)
+      {
+         for (uint8_t month = 0; month < 12; ++month)
+         {
+            for (uint8_t day = 0; day < 32; ++day)
+            {
+               calendar_date date = make_date(year, month, day, 12);
+
+               CHECK((civil_date_to_timestamp(&date) != 0) == calendar_is_date_valid(&date));
+            }
+         }
+      }
+   }
+
+   /**
+    * The box filter follows a step linearly, and settles on it exactly once
+    *  the window is full of it.
+    */
+   void check_box_step()
+   {
+      lib::BoxFilter<int16_t, 16> filter;
+
+      filter.fill(0);
+
+      for (int16_t i = 1; i <= 16; ++i)
+      {
+         CHECK(filter.push(100) == 100 * i);
+         CHECK(filter.get() == 100 * i / 16);
+      }
+
+      filter.push(100);
+      CHECK(filter.get() == 100);
+
+      // Back down, and to a negative value
+      for (int16_t i = 1; i <= 16; ++i)
+      {
+         filter.push(-50);
+         CHECK(filter.get_sum() == 100 * (16 - i) - 50 * i);
+      }
+
+      CHECK(filter.get() == -50);
+   }
+
+   /**
+    * The exponential average rises without overshoot, by about 2/3 of the
+    *  step in 2^K samples, and settles on the step exactly.
+    */
+   void check_ema_step()
+   {
+      lib::EmaFilter<int16_t, 3> filter;
+      int16_t previous = 0;
+
+      filter.fill(0);
+
+      for (int i = 1; i <= 100; ++i)
+      {
+         int16_t output = filter.push(1000);
+
+         CHECK(output >= previous && output <= 1000);
+         previous = output;
+
+         // 1 - (7/8)^8 is 66%
+         if (i == 8)
+         {
+            CHECK(output >= 600 && output <= 700);
+         }
+      }
+
+      CHECK(filter.get() == 1000);
+
+      // Down to a negative value
+      for (int i = 1; i <= 100; ++i)
+      {
+         int16_t output = filter.push(-1000);
+
+         CHECK(output <= previous && output >= -1000);
+         previous = output;
+      }
+
+      CHECK(filter.get() == -1000);
+   }
+
+   /**
+    * The median follows a step once it holds half the window, and rejects
+    *  the spikes shorter than that.
+    */
+   void check_median_step()
+   {
+      lib::MedianFilter<int16_t, 3> filter3;
+      lib::MedianFilter<int16_t, 5> filter5;
+
+      filter3.fill(0);
+      CHECK(filter3.push(100) == 0);
+      CHECK(filter3.push(100) == 100);
+      CHECK(filter3.push(100) == 100);
+
+      // One spike each way
+      CHECK(filter3.push(500) == 100);
+      CHECK(filter3.push(100) == 100);
+      CHECK(filter3.push(-500) == 100);
+      CHECK(filter3.push(100) == 100);
+
+      filter5.fill(0);
+
+      // Two spikes in a row
+      CHECK(filter5.push(500) == 0);
+      CHECK(filter5.push(500) == 0);
+      CHECK(filter5.push(0) == 0);
+      CHECK(filter5.push(0) == 0);
+
+      // A step, delayed by two samples
+      CHECK(filter5.push(-100) == 0);
+      CHECK(filter5.push(-100) == 0);
+      CHECK(filter5.push(-100) == -100);
+   }
+
+   /**
+    * The comparator of driver/lum.cpp turns bright from 18 and dark below
+    *  14 only, and does not chatter in between.
+    */
+   void check_hysteresis_step()
+   {
+      lib::Hysteresis<uint8_t, 14, 18> isBright;
+
+      CHECK(!isBright.get());
+
+      for (uint8_t level = 0; level < 30; ++level)
+      {
+         CHECK(isBright.update(level) == (level >= 18));
+      }
+
+      for (uint8_t level = 30; level > 0; --level)
+      {
+         CHECK(isBright.update(level) == (level >= 14));
+      }
+
+      // Hovering in the band keeps the output
+      const uint8_t band[] = { 15, 17, 14, 16, 17 };
+
+      for (uint8_t level : band)
+      {
+         CHECK(!isBright.update(level));
+      }
+
+      isBright.reset(14);
+      CHECK(isBright.get());
+
+      for (uint8_t level : band)
+      {
+         CHECK(isBright.update(level));
+      }
+
+      isBright.reset(13);
+      CHECK(!isBright.get());
+   }
+
+   /**
+    * The chain of driver/lum.cpp turns dark the 24th sample after the light
+    *  goes from 40 to 5, when the average of 32 drops below 14, and turns
+    *  bright the 12th sample after it goes back up, when the average
+    *  reaches 18.
+    */
+   void check_lum_step()
+   {
+      lib::BoxFilter<uint8_t, 32, uint16_t> average;
+      lib::Hysteresis<uint8_t, 14, 18> isBright;
+
+      average.fill(40);
+      isBright.reset(average.get());
+
+      for (int i = 1; i <= 32; ++i)
+      {
+         average.push(5);
+         CHECK(isBright.update(average.get()) == (i < 24));
+      }
+
+      for (int i = 1; i <= 32; ++i)
+      {
+         average.push(40);
+         CHECK(isBright.update(average.get()) == (i >= 12));
+      }
+   }
+
+   /**
+    * A day of a room codes in less than 2 bits per minute, against the 16 of
+    *  a sample, and a temperature moving by 1 every minute in 3 bits. Both
+    *  keep the whole day in the ring of the history.
+    */
+   void check_history_compression()
+   {
+      std::vector<int16_t> flicker;
+
+      for (int minute = 0; minute < MINUTES_PER_DAY; ++minute)
+      {
+         flicker.push_back((int16_t)(196 + minute % 2));
+      }
+
+      double steady = bits_per_sample(room_trace(0.5));
+      double swinging = bits_per_sample(room_trace(3.0));
+
+      CHECK(steady > 0 && steady < 2.0);
+      CHECK(swinging > 0 && swinging < 2.0);
+      CHECK(bits_per_sample(flicker) == 3.0);
+   }
+
+   /**
+    * The history keeps a day of minutes of a temperature moving by 1 every
+    *  minute. Moving by 5, it drops the oldest minutes, and the statistics
+    *  of the day tell over how many minutes the average is.
+    */
+   void check_history_loss()
+   {
+      history_stats_t day;
+      int32_t sum = 0;
+
+      timer_init();
+      history_init();
+
+      for (int minute = 0; minute < MINUTES_PER_DAY + 60; ++minute)
+      {
+         sim_measurement_set_temperature((int16_t)(196 + minute % 2));
+         run_minute();
+      }
+
+      CHECK(history_get_day(&day));
+      CHECK(day.minutes == MINUTES_PER_DAY);
+      CHECK(day.min == 196 && day.max == 197 && day.avg == 196);
+
+      for (int minute = 0; minute < MINUTES_PER_DAY; ++minute)
+      {
+         int16_t value = (int16_t)(200 + (minute % 2) * 5);
+
+         sim_measurement_set_temperature(value);
+         run_minute();
+      }
+
+      CHECK(history_get_day(&day));
+      CHECK(day.minutes < MINUTES_PER_DAY);
+
+      // The average is over the newest minutes held
+      for (int minute = MINUTES_PER_DAY - day.minutes; minute < MINUTES_PER_DAY; ++minute)
+      {
+         sum += 200 + (minute % 2) * 5;
+      }
+
+      CHECK(day.avg == sum / day.minutes);
+   }
+
+   /**
+    * An alert raised in a loop, as by the timer service out of slots, is
+    *  journaled once. The next lines are journaled once each, up to
+    *  #JOURNAL_ALERT_LINES. An alert which stops is always journaled.
+    */
+   void check_journal_alert_storm()
+   {
+      uint8_t count = journal_get_count();
+      journal_entry_t entry;
+
+      for (int i = 0; i < ALERT_STORM; ++i)
+      {
+         journal_record_alert(false, ALERT_STORM_LINE);
+      }
+
+      CHECK(journal_get_count() == count + 1);
+      CHECK(journal_read(journal_get_count() - 1, &entry));
+      CHECK(entry.event == journal_alert_e && entry.arg == ALERT_STORM_LINE);
+
+      for (uint16_t line = ALERT_STORM_LINE; line < ALERT_STORM_LINE + 2 * JOURNAL_ALERT_LINES; ++line)
+      {
+         journal_record_alert(false, line);
+      }
+
+      CHECK(journal_get_count() == count + JOURNAL_ALERT_LINES);
+
+      journal_record_alert(true, ALERT_STORM_LINE);
+
+      CHECK(journal_get_count() == count + JOURNAL_ALERT_LINES + 1);
+      CHECK(journal_read(journal_get_count() - 1, &entry));
+      CHECK(entry.event == journal_fatal_e && entry.arg == ALERT_STORM_LINE);
+   }
+
+   /**
+    * The governor steps the clock down then up, and the serial port of the
+    *  GPS keeps its baud rate at each speed. A lock from an interrupt steps
+    *  up as the reactor gets idle.
+    */
+   void check_governor_gps_baud()
+   {
+      governor_init();
+      reactor_init();
+      timer_init();
+      sio2host_init();
+      gps_manager_init();
+
+      // Start a window from now, as the timer ran for the other checks
+      governor_lock();
+      run_idle_window();
+      governor_unlock();
+
+      CHECK(governor_get_hz() == SIM_CPU_HZ);
+      CHECK(gps_baud_holds());
+
+      for (int speed = 1; speed < GOVERNOR_SPEEDS; ++speed)
+      {
+         run_idle_window();
+
+         CHECK(governor_get_hz() == SIM_CPU_HZ >> (speed * 2));
+         CHECK(sim_cpu_hz() == governor_get_hz());
+         CHECK(gps_baud_holds());
+      }
+
+      governor_lock();
+
+      CHECK(sim_cpu_hz() == SIM_CPU_HZ);
+      CHECK(gps_baud_holds());
+
+      governor_unlock();
+      run_idle_window();
+
+      CHECK(sim_cpu_hz() == SIM_CPU_HZ >> 2);
+
+      governor_lock_from_isr();
+
+      CHECK(sim_cpu_hz() == SIM_CPU_HZ >> 2);
+
+      governor_enter_idle();
+
+      CHECK(sim_cpu_hz() == SIM_CPU_HZ);
+      CHECK(gps_baud_holds());
+
+      governor_unlock();
+   }
+
+   /**
+    * The latency of a TWI job is counted in ticks of 8us at full speed, and
+    *  once the governor stepped down to the slowest clock, where the tick of
+    *  the timer service counts twice as many.
+    */
+   void check_twi_queue_latency()
+   {
+      uint32_t expected = TWI_ACK_DELAY * TWI_TICKS_PER_MS / TIMER_MS;
+      twi_queue_stats_t stats;
+      sim_time_t start;
+
+      governor_init();
+      reactor_init();
+      timer_init();
+      twi_queue_init();
+
+      twiJob.chip = 0x48;
+      twiJob.callback = on_twi_done;
+
+      // Idle only, so the tick runs through, and at full speed for the first
+      sleepmgr_lock_mode(SLEEPMGR_IDLE);
+      governor_lock();
+
+      start = sim_now() + SIM_SECONDS(1) + SIM_MILLISECONDS(1) / 3;
+
+      sim_schedule(start, on_twi_submit, nullptr);
+      sim_schedule(start + (GOVERNOR_SPEEDS + 2) * SIM_MILLISECONDS(GOVERNOR_WINDOW), on_twi_submit, nullptr);
+      sim_schedule(start + (GOVERNOR_SPEEDS + 3) * SIM_MILLISECONDS(GOVERNOR_WINDOW), on_stop, nullptr);
+      sim_run(reactor_run);
+
+      sleepmgr_unlock_mode(SLEEPMGR_IDLE);
+
+      CHECK(twiLatencies.size() == 2);
+      CHECK(twiHz.size() == 2);
+
+      if (twiLatencies.size() == 2 && twiHz.size() == 2)
+      {
+         CHECK(twiHz[0] == SIM_CPU_HZ);
+         CHECK(twiHz[1] == SIM_CPU_HZ >> ((GOVERNOR_SPEEDS - 1) * 2));
+
+         for (uint16_t latency : twiLatencies)
+         {
+            CHECK(latency + 2u >= expected && latency <= expected + 2);
+         }
+      }
+
+      twi_queue_get_stats(&stats);
+
+      CHECK(stats.done == 2);
+      CHECK(stats.latency_max + 2u >= expected && stats.latency_max <= expected + 2);
+      CHECK(stats.busy_ticks + 4 >= 2 * expected && stats.busy_ticks <= 2 * expected + 4);
+   }
+
+   /**
+    * The key driver, run by the reactor as on the target, filters a glitch
+    *  and the bounces. A short push is dispatched on its release, at full
+    *  speed, timed from the first edge of the release. A long push is held 0.8 s, a very long one 2.4 s. Idle again,
+    *  the key releases the full speed.
+    */
+   void check_key_pushes()
+   {
+      static const KeyPushes GLITCH = { 0, 0, 0 };
+      static const KeyPushes SHORT = { 1, 0, 0 };
+      static const KeyPushes LONG = { 1, 1, 0 };
+      static const KeyPushes VERY_LONG = { 1, 2, 1 };
+      sim_time_t start;
+
+      alert_init();
+      governor_init();
+      reactor_init();
+      rtc_init();
+      timer_init();
+      key_init(on_key_short, on_key_long, on_key_very_long);
+
+      // The simulation runs once, as stopping it abandons a deep sleep
+      start = sim_now() + SIM_SECONDS(1);
+
+      // Glitch, shorter than the debounce
+      push_key(start, SIM_MILLISECONDS(30));
+      sim_schedule(start + SIM_SECONDS(1), on_key_expect, (void *)&GLITCH);
+
+      // Short push, bouncing on both edges
+      push_key(start + SIM_SECONDS(1), SIM_MILLISECONDS(200), 5, 2);
+      sim_schedule(start + SIM_SECONDS(1) + SIM_MILLISECONDS(300), on_key_settled, nullptr);
+      sim_schedule(start + SIM_SECONDS(2), on_key_expect, (void *)&SHORT);
+
+      // Long push, dispatched while held, and nothing on its release
+      push_key(start + SIM_SECONDS(2), SIM_MILLISECONDS(1500));
+      sim_schedule(start + SIM_SECONDS(2) + SIM_MILLISECONDS(1400), on_key_expect, (void *)&LONG);
+      sim_schedule(start + SIM_SECONDS(5), on_key_expect, (void *)&LONG);
+
+      // Very long push
+      push_key(start + SIM_SECONDS(5), SIM_SECONDS(3));
+      sim_schedule(start + SIM_SECONDS(9), on_key_expect, (void *)&VERY_LONG);
+
+      sim_schedule(start + SIM_SECONDS(14), on_stop, nullptr);
+      sim_run(reactor_run);
+
+      CHECK(keyShortAt - (start + SIM_SECONDS(1) + SIM_MILLISECONDS(200)) < SIM_MILLISECONDS(1));
+      CHECK(keyShortHz == SIM_CPU_HZ);
+      CHECK(keyEdgeSettled == keyShortCount);
+
+      // Idle, the clock stepped down
+      CHECK(sim_cpu_hz() < SIM_CPU_HZ);
+   }
+
+   /** Body of a thread tracing numbered traces */
+   void *log_traces(void *arg)
+   {
+      long thread = (long)arg;
+
+      for (int i = 0; i < LOG_TRACES_PER_THREAD; ++i)
+      {
+         LOG_WARN("check", "thread %ld trace %d", thread, i);
+      }
+
+      return NULL;
+   }
+
+   /**
+    * The traces of several threads, queued without waiting by the POSIX
+    *  backend, are all written once flushed, in the order of each thread.
+    *  Those dropped when the queue is full are reported.
+    */
+   void check_logger_posix()
+   {
+      pthread_t threads[LOG_THREADS];
+      int next[LOG_THREADS] = {};
+      unsigned long dropped = 0;
+      int written = 0;
+      bool inOrder = true;
+      char line[256];
+      FILE *out = tmpfile();
+
+      CHECK(out != NULL);
+
+      if (out == NULL)
+      {
+         return;
+      }
+
+      LOG_INIT_NO_SPLIT_PATTERN();
+      _log_outfile = out;
+
+      for (long thread = 0; thread < LOG_THREADS; ++thread)
+      {
+         CHECK(pthread_create(&threads[thread], NULL, log_traces, (void *)thread) == 0);
+      }
+
+      for (long thread = 0; thread < LOG_THREADS; ++thread)
+      {
+         pthread_join(threads[thread], NULL);
+      }
+
+      LOG_FLUSH();
+      rewind(out);
+
+      while (fgets(line, sizeof(line), out))
+      {
+         const char *text = strstr(line, "} ");
+         unsigned long count;
+         int thread, i;
+
+         if (text == NULL)
+         {
+            continue;
+         }
+
+         if (sscanf(text, "} thread %d trace %d", &thread, &i) == 2)
+         {
+            CHECK(thread >= 0 && thread < LOG_THREADS);
+
+            if (thread >= 0 && thread < LOG_THREADS)
+            {
+               inOrder &= i >= next[thread];
+               next[thread] = i + 1;
+               ++written;
+            }
+         }
+         else if (sscanf(text, "} %lu traces dropped", &count) == 1)
+         {
+            dropped += count;
+         }
+      }
+
+      CHECK(inOrder);
+      CHECK(written > 0);
+      CHECK(written + dropped == (unsigned long)(LOG_THREADS * LOG_TRACES_PER_THREAD));
+
+      LOG_INIT_NO_SPLIT_PATTERN();
+      fclose(out);
+   }
+
+   /**
+    * The traces of a storm dropped by the rate limits are all reported once
+    *  flushed, though no trace comes after them.
+    */
+   void check_logger_rate_flush()
+   {
+      unsigned long dropped = 0;
+      int written = 0;
+      char line[256];
+      FILE *out = tmpfile();
+
+      CHECK(out != NULL);
+
+      if (out == NULL)
+      {
+         return;
+      }
+
+      LOG_INIT_NO_SPLIT_PATTERN();
+      _log_outfile = out;
+      LOG_SETDOMAINRATE("storm", LOG_LEVEL_WARN, 1, LOG_STORM_BURST);
+
+      for (int i = 0; i < LOG_STORM_TRACES; ++i)
+      {
+         LOG_WARN("storm", "trace %d", i);
+      }
+
+      LOG_FLUSH();
+      rewind(out);
+
+      while (fgets(line, sizeof(line), out))
+      {
+         const char *text = strstr(line, "} ");
+         unsigned long count;
+         int i;
+
+         if (text == NULL)
+         {
+            continue;
+         }
+
+         if (sscanf(text, "} trace %d", &i) == 1)
+         {
+            ++written;
+         }
+         else if (sscanf(text, "} %lu traces dropped by the rate limits", &count) == 1)
+         {
+            dropped += count;
+         }
+      }
+
+      CHECK(written >= LOG_STORM_BURST && written <= LOG_STORM_BURST + 1);
+      CHECK(written + dropped == (unsigned long)LOG_STORM_TRACES);
+
+      LOG_INIT_NO_SPLIT_PATTERN();
+      fclose(out);
+   }
+
+   /** Checks, in the order run */
+   const Check CHECKS[]
+   {
+      { "civil_round_trip",    check_civil_round_trip },
+      { "civil_invalid_dates", check_civil_invalid_dates },
+      { "box_step",            check_box_step },
+      { "ema_step",            check_ema_step },
+      { "median_step",         check_median_step },
+      { "hysteresis_step",     check_hysteresis_step },
+      { "lum_step",            check_lum_step },
+      { "history_compression", check_history_compression },
+      { "history_loss",        check_history_loss },
+      { "journal_alert_storm", check_journal_alert_storm },
+      { "governor_gps_baud",   check_governor_gps_baud },
+      { "twi_queue_latency",   check_twi_queue_latency },
+      { "key_pushes",          check_key_pushes },
+      { "logger_posix",        check_logger_posix },
+      { "logger_rate_flush",   check_logger_rate_flush },
+   };
+
+   /** Print the usage and exit */
+   void usage(const char *name)
+   {
+      fprintf(
+         stderr,
+         "Usage: %s [options]\n"
+         " -f name    Only run the checks whose name contains this\n",
+         name);
+
+      exit(EXIT_FAILURE);
+   }
+}
+
+// ---------------------------------------------------------------------------
+// Entry point
+// ---------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+   const char *filter = "";
+   int failed = 0;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "f:")) != -1)
+   {
+      switch (opt)
+      {
+      case 'f':
+         filter = optarg;
+         break;
+      default:
+         usage(argv[0]);
+      }
+   }
+
+   for (const Check &entry : CHECKS)
+   {
+      if (!strstr(entry.name, filter))
+      {
+         continue;
+      }
+
+      failures = 0;
+      entry.run();
+
+      if (failures > MAX_FAILURES_SHOWN)
+      {
+         printf("  and %u more\n", failures - MAX_FAILURES_SHOWN);
+      }
+
+      printf("%s %s\n", failures ? "FAIL" : "PASS", entry.name);
+
+      failed += failures != 0;
+   }
+
+   return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**@} ---------------------------  End of file  --------------------------- */
@@ -0,0 +1,727 @@
+/**
+ * @file
+ * Reads the traces of the frames written by linsim -f.
+ * @code
+ * linsim-fbtrace dump trace
+ * linsim-fbtrace [-s start] [-d duration] [-a speed] render trace gif
+ * linsim-fbtrace diff trace trace
+ * @endcode
+ * dump writes a line per change of the frame, as linsim -o does.
+ * render draws the LEDs at the stations of the Windows simulator, as they
+ *  are seen with their flashing, to an animated GIF.
+ * diff compares two traces frame by frame, and writes the spans of virtual
+ *  time where the frames differ. It exits with 1 if they do.
+ * @author software@arreckx.com
+ * @internal
+ * @addtogroup linsim
+ * @{
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+
+#include "linsim.h"
+
+/** Point as declared by Windows, for the stations */
+struct POINT
+{
+   long x;
+   long y;
+};
+
+#include "../winsim/station_points.h"
+
+// ---------------------------------------------------------------------------
+// Local types
+// ---------------------------------------------------------------------------
+namespace
+{
+   /** State of the LEDs, as status << 4 | level */
+   typedef std::vector<uint8_t> Frame;
+
+   /** Reads the records of a trace one by one */
+   class TraceReader
+   {
+   public:
+      /** Open a trace. Exits if it cannot be read */
+      explicit TraceReader(const char *path);
+
+      ~TraceReader();
+
+      /** @return true if the next change could be read and applied */
+      bool next();
+
+      /** @return The time of the last change */
+      sim_time_t time() const { return m_time; }
+
+      /** @return The frame after the last change */
+      const Frame &frame() const { return m_frame; }
+
+   private:
+      FILE *m_file;
+      sim_time_t m_time;
+      Frame m_frame;
+   };
+
+   /** Writes an animated GIF of frames of a fixed size */
+   class GifWriter
+   {
+   public:
+      /** Create the file. Exits on failure */
+      GifWriter(const char *path, uint16_t width, uint16_t height);
+
+      ~GifWriter();
+
+      /** Add an image, shown for a number of 100th of seconds */
+      void add(const std::vector<uint8_t> &image, uint16_t delay);
+
+   private:
+      /** Write the pixels of a rectangle of the image, LZW compressed */
+      void compress(const std::vector<uint8_t> &image,
+                    uint16_t left, uint16_t top, uint16_t width, uint16_t height);
+
+      /** Write a code of the LZW stream */
+      void write_code(uint16_t code, uint8_t size);
+
+      /** Write the sub-block pending */
+      void flush_block();
+
+      FILE *m_file;
+      uint16_t m_width;
+      uint16_t m_height;
+      std::vector<uint8_t> m_last;
+      uint32_t m_bits;
+      uint8_t m_bitCount;
+      uint8_t m_block[255];
+      uint8_t m_blockLength;
+   };
+}
+
+// ---------------------------------------------------------------------------
+// Local variables
+// ---------------------------------------------------------------------------
+namespace
+{
+   /** Number of bits of a color index */
+   const uint8_t COLOR_BITS = 5;
+
+   /** Colors of the images, as RGB */
+   const uint8_t PALETTE[1 << COLOR_BITS][3]
+   {
+      { 40, 40, 40 },    // Background
+      { 100, 149, 237 }, // Outline of the LEDs
+      { 0, 0, 0 },       // Level 0, or off
+      { 22, 26, 0 },
+      { 44, 51, 0 },
+      { 66, 77, 0 },
+      { 88, 102, 0 },
+      { 111, 128, 0 },
+      { 133, 153, 0 },
+      { 155, 179, 0 },
+      { 177, 204, 0 },
+      { 199, 230, 0 },
+      { 221, 255, 0 },
+      { 224, 255, 26 },
+      { 228, 255, 51 },
+      { 231, 255, 77 },
+      { 235, 255, 102 },
+      { 238, 255, 128 }, // Level 15
+   };
+
+   /** Color of the background */
+   const uint8_t BACKGROUND = 0;
+
+   /** Color of the outline of the LEDs */
+   const uint8_t OUTLINE = 1;
+
+   /** Color of the LEDs off */
+   const uint8_t LEVEL_0 = 2;
+
+   /** Pixels per unit of the station points */
+   const int SCALE = 2;
+
+   /** Radius of a LED, in pixels */
+   const int RADIUS = 7;
+
+   /** Margin around the stations, in pixels */
+   const int MARGIN = 16;
+
+   /**
+    * Period of the flashing counter: 16 steps a second, so the LED flashing
+    *  very fast toggles at 8Hz and the slow one each second.
+    */
+   const sim_time_t FLASH_STEP = SIM_SECONDS(1) / 16;
+
+   /** First station point shown. The first two are not used */
+   const size_t FIRST_STATION = 2;
+}
+
+// ---------------------------------------------------------------------------
+// Private functions
+// ---------------------------------------------------------------------------
+namespace
+{
+   /** Print the usage and exit */
+   void usage(const char *name)
+   {
+      fprintf(
+         stderr,
+         "Usage: %s dump trace\n"
+         "       %s [options] render trace gif\n"
+         "       %s diff trace trace\n"
+         " -s start        Virtual time to render from, as 500ms, 90s, 30m or 24h\n"
+         " -d duration     Virtual time to render. Default 1m\n"
+         " -a speed        Speed of the animation over the virtual time. Default 1\n",
+         name, name, name);
+
+      exit(EXIT_FAILURE);
+   }
+
+   /** @return The virtual time of a duration such as 24h */
+   sim_time_t parse_duration(const char *text)
+   {
+      char *unit;
+      unsigned long long value = strtoull(text, &unit, 10);
+
+      if (strcmp(unit, "h") == 0)
+      {
+         return SIM_SECONDS(value * 3600);
+      }
+      else if (strcmp(unit, "m") == 0)
+      {
+         return SIM_SECONDS(value * 60);
+      }
+      else if (strcmp(unit, "s") == 0)
+      {
+         return SIM_SECONDS(value);
+      }
+
+      return SIM_MILLISECONDS(value);
+   }
+
+   /** @return The color of a LED at a time, with its flashing */
+   uint8_t led_color(uint8_t led, sim_time_t time)
+   {
+      uint8_t status = led >> 4;
+      uint8_t phase = (time / FLASH_STEP) & 0xf;
+
+      if (status == 0xf || (status & phase))
+      {
+         return LEVEL_0 + (led & 0xf);
+      }
+
+      return LEVEL_0;
+   }
+
+   /** @return The 100th of seconds of animation between two virtual times */
+   uint16_t animation_delay(sim_time_t from, sim_time_t to, sim_time_t start, double speed)
+   {
+      uint64_t first = (uint64_t)((from - start) / speed / SIM_MILLISECONDS(10));
+      uint64_t last = (uint64_t)((to - start) / speed / SIM_MILLISECONDS(10));
+
+      return (uint16_t)std::min<uint64_t>(last - first, UINT16_MAX);
+   }
+
+   /** Dump the changes of a trace, as linsim -o */
+   int dump(const char *path)
+   {
+      static const char HEX[] = "0123456789abcdef";
+      TraceReader reader(path);
+
+      while (reader.next())
+      {
+         printf("%llu ", (unsigned long long)(reader.time() / SIM_MILLISECONDS(1)));
+
+         for (uint8_t led : reader.frame())
+         {
+            putchar(HEX[led >> 4]);
+            putchar(HEX[led & 0xf]);
+         }
+
+         putchar('\n');
+      }
+
+      return EXIT_SUCCESS;
+   }
+
+   /** Render the frames of a trace to an animated GIF */
+   int render(const char *path, const char *gif, sim_time_t start, sim_time_t duration, double speed)
+   {
+      TraceReader reader(path);
+      size_t count = sizeof(g_station_points) / sizeof(g_station_points[0]);
+      long left = LONG_MAX;
+      long top = LONG_MAX;
+      long right = 0;
+      long bottom = 0;
+
+      // Frame the stations
+      for (size_t i = FIRST_STATION; i < count; ++i)
+      {
+         left = std::min(left, g_station_points[i].x * SCALE - RADIUS - MARGIN);
+         top = std::min(top, g_station_points[i].y * SCALE - RADIUS - MARGIN);
+         right = std::max(right, g_station_points[i].x * SCALE + RADIUS + MARGIN);
+         bottom = std::max(bottom, g_station_points[i].y * SCALE + RADIUS + MARGIN);
+      }
+
+      long width = right - left;
+      long height = bottom - top;
+
+      // Offsets of the pixels of a LED from its center
+      std::vector<long> disc;
+
+      for (int y = -RADIUS; y <= RADIUS; ++y)
+      {
+         for (int x = -RADIUS; x <= RADIUS; ++x)
+         {
+            if (x * x + y * y <= RADIUS * RADIUS)
+            {
+               disc.push_back(y * width + x);
+            }
+         }
+      }
+
+      GifWriter writer(gif, (uint16_t)width, (uint16_t)height);
+      std::vector<uint8_t> image(width * height, BACKGROUND);
+      std::vector<uint8_t> shown;
+      sim_time_t shownTime = start;
+      bool more = reader.next();
+      Frame frame;
+
+      // Sample the frames on the flashing counter, and merge equal images
+      for (sim_time_t time = start; time <= start + duration; time += FLASH_STEP)
+      {
+         while (more && reader.time() <= time)
+         {
+            frame = reader.frame();
+            more = reader.next();
+         }
+
+         for (size_t i = FIRST_STATION; i < count && i < frame.size(); ++i)
+         {
+            long center =
+               (g_station_points[i].y * SCALE - top) * width + g_station_points[i].x * SCALE - left;
+            uint8_t color = led_color(frame[i], time);
+
+            for (long offset : disc)
+            {
+               image[center + offset] = color;
+            }
+
+            image[center - RADIUS] = OUTLINE;
+            image[center + RADIUS] = OUTLINE;
+            image[center - RADIUS * width] = OUTLINE;
+            image[center + RADIUS * width] = OUTLINE;
+         }
+
+         if (image == shown)
+         {
+            continue;
+         }
+
+         // Images shown for less than a 100th of second are dropped
+         uint16_t delay = animation_delay(shownTime, time, start, speed);
+
+         if (!shown.empty() && delay)
+         {
+            writer.add(shown, delay);
+         }
+
+         shown = image;
+         shownTime = time;
+      }
+
+      writer.add(shown, std::max<uint16_t>(1, animation_delay(shownTime, start + duration, start, speed)));
+
+      return EXIT_SUCCESS;
+   }
+
+   /** Compare two traces frame by frame */
+   int diff(const char *pathA, const char *pathB)
+   {
+      TraceReader a(pathA);
+      TraceReader b(pathB);
+      bool moreA = a.next();
+      bool moreB = b.next();
+      Frame frameA;
+      Frame frameB;
+      sim_time_t since = 0;
+      bool differ = false;
+      unsigned spans = 0;
+
+      while (moreA || moreB)
+      {
+         sim_time_t time = !moreB || (moreA && a.time() <= b.time()) ? a.time() : b.time();
+
+         while (moreA && a.time() == time)
+         {
+            frameA = a.frame();
+            moreA = a.next();
+         }
+
+         while (moreB && b.time() == time)
+         {
+            frameB = b.frame();
+            moreB = b.next();
+         }
+
+         if ((frameA != frameB) == differ)
+         {
+            continue;
+         }
+
+         if (differ)
+         {
+            printf("%llu %llu\n",
+               (unsigned long long)(since / SIM_MILLISECONDS(1)),
+               (unsigned long long)(time / SIM_MILLISECONDS(1)));
+         }
+         else
+         {
+            since = time;
+            ++spans;
+         }
+
+         differ = !differ;
+      }
+
+      if (differ)
+      {
+         printf("%llu end\n", (unsigned long long)(since / SIM_MILLISECONDS(1)));
+      }
+
+      fprintf(stderr, "%u spans differ\n", spans);
+
+      return spans ? EXIT_FAILURE : EXIT_SUCCESS;
+   }
+}
+
+// ---------------------------------------------------------------------------
+// Class implementations
+// ---------------------------------------------------------------------------
+
+TraceReader::TraceReader(const char *path) :
+   m_file(fopen(path, "rb")),
+   m_time(0)
+{
+   char magic[4];
+   int count;
+
+   if (!m_file)
+   {
+      perror(path);
+      exit(EXIT_FAILURE);
+   }
+
+   if (fread(magic, 1, sizeof(magic), m_file) != sizeof(magic) ||
+       memcmp(magic, SIM_FB_TRACE_MAGIC, sizeof(magic)) != 0 ||
+       fgetc(m_file) != SIM_FB_TRACE_VERSION ||
+       (count = fgetc(m_file)) == EOF)
+   {
+      fprintf(stderr, "%s: Not a trace of the frames\n", path);
+      exit(EXIT_FAILURE);
+   }
+
+   m_frame.assign(count, 0);
+}
+
+TraceReader::~TraceReader()
+{
+   fclose(m_file);
+}
+
+bool TraceReader::next()
+{
+   uint64_t delta = 0;
+   int shift = 0;
+   int runs;
+   int c;
+   size_t index = 0;
+
+   do
+   {
+      if ((c = fgetc(m_file)) == EOF || shift > 63)
+      {
+         return false;
+      }
+
+      delta |= (uint64_t)(c & 0x7f) << shift;
+      shift += 7;
+   } while (c & 0x80);
+
+   if ((runs = fgetc(m_file)) == EOF)
+   {
+      return false;
+   }
+
+   while (runs--)
+   {
+      int skipped = fgetc(m_file);
+      int count = fgetc(m_file);
+
+      if (skipped == EOF || count == EOF || index + skipped + count > m_frame.size())
+      {
+         return false;
+      }
+
+      index += skipped;
+
+      if (fread(&m_frame[index], 1, count, m_file) != (size_t)count)
+      {
+         return false;
+      }
+
+      index += count;
+   }
+
+   m_time += delta;
+
+   return true;
+}
+
+GifWriter::GifWriter(const char *path, uint16_t width, uint16_t height) :
+   m_file(fopen(path, "wb")),
+   m_width(width),
+   m_height(height),
+   m_bits(0),
+   m_bitCount(0),
+   m_blockLength(0)
+{
+   static const uint8_t LOOP[] =
+   {
+      0x21, 0xff, 11, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0',
+      3, 1, 0, 0, 0
+   };
+
+   if (!m_file)
+   {
+      perror(path);
+      exit(EXIT_FAILURE);
+   }
+
+   fwrite("GIF89a", 1, 6, m_file);
+   fputc(width & 0xff, m_file);
+   fputc(width >> 8, m_file);
+   fputc(height & 0xff, m_file);
+   fputc(height >> 8, m_file);
+
+   // Global color table, of 8 bits colors
+   fputc(0xf0 | (COLOR_BITS - 1), m_file);
+   fputc(BACKGROUND, m_file);
+   fputc(0, m_file);
+   fwrite(PALETTE, 1, sizeof(PALETTE), m_file);
+
+   // Repeat for ever
+   fwrite(LOOP, 1, sizeof(LOOP), m_file);
+}
+
+GifWriter::~GifWriter()
+{
+   fputc(0x3b, m_file);
+   fclose(m_file);
+}
+
+void GifWriter::add(const std::vector<uint8_t> &image, uint16_t delay)
+{
+   uint16_t left = m_width, top = m_height, right = 0, bottom = 0;
+
+   // Only write the rectangle which changed since the last image
+   for (uint16_t y = 0; y < m_height; ++y)
+   {
+      for (uint16_t x = 0; x < m_width; ++x)
+      {
+         size_t i = (size_t)y * m_width + x;
+
+         if (m_last.empty() || image[i] != m_last[i])
+         {
+            left = std::min(left, x);
+            top = std::min(top, y);
+            right = std::max<uint16_t>(right, x + 1);
+            bottom = std::max<uint16_t>(bottom, y + 1);
+         }
+      }
+   }
+
+   if (right == 0)
+   {
+      left = top = 0;
+      right = bottom = 1;
+   }
+
+   // Graphic control: keep the image, for the delay
+   const uint8_t control[] =
+   {
+      0x21, 0xf9, 4, 0x04, (uint8_t)(delay & 0xff), (uint8_t)(delay >> 8), 0, 0
+   };
+
+   fwrite(control, 1, sizeof(control), m_file);
+
+   const uint8_t descriptor[] =
+   {
+      0x2c,
+      (uint8_t)(left & 0xff), (uint8_t)(left >> 8),
+      (uint8_t)(top & 0xff), (uint8_t)(top >> 8),
+      (uint8_t)((right - left) & 0xff), (uint8_t)((right - left) >> 8),
+      (uint8_t)((bottom - top) & 0xff), (uint8_t)((bottom - top) >> 8),
+      0
+   };
+
+   fwrite(descriptor, 1, sizeof(descriptor), m_file);
+
+   compress(image, left, top, right - left, bottom - top);
+
+   m_last = image;
+}
+
+void GifWriter::compress(const std::vector<uint8_t> &image,
+                         uint16_t left, uint16_t top, uint16_t width, uint16_t height)
+{
+   const uint16_t clear = 1 << COLOR_BITS;
+   const uint16_t end = clear + 1;
+   const uint16_t maxCodes = 4096;
+
+   // Code of a string followed by a color, or 0
+   std::vector<uint16_t> next(maxCodes << COLOR_BITS, 0);
+   uint16_t lastCode = end;
+   uint8_t size = COLOR_BITS + 1;
+   int code = -1;
+
+   fputc(COLOR_BITS, m_file);
+   write_code(clear, size);
+
+   for (uint16_t y = top; y < top + height; ++y)
+   {
+      for (uint16_t x = left; x < left + width; ++x)
+      {
+         uint8_t color = image[(size_t)y * m_width + x];
+
+         if (code < 0)
+         {
+            code = color;
+         }
+         else if (next[(code << COLOR_BITS) + color])
+         {
+            code = next[(code << COLOR_BITS) + color];
+         }
+         else
+         {
+            write_code(code, size);
+            next[(code << COLOR_BITS) + color] = ++lastCode;
+
+            if (lastCode >= (1u << size))
+            {
+               ++size;
+            }
+
+            // The table is full: start again
+            if (lastCode == maxCodes - 1)
+            {
+               write_code(clear, size);
+               std::fill(next.begin(), next.end(), 0);
+               size = COLOR_BITS + 1;
+               lastCode = end;
+            }
+
+            code = color;
+         }
+      }
+   }
+
+   write_code(code, size);
+   write_code(end, size);
+
+   if (m_bitCount)
+   {
+      m_block[m_blockLength++] = m_bits & 0xff;
+      m_bits = 0;
+      m_bitCount = 0;
+   }
+
+   flush_block();
+   fputc(0, m_file);
+}
+
+void GifWriter::write_code(uint16_t code, uint8_t size)
+{
+   m_bits |= (uint32_t)code << m_bitCount;
+   m_bitCount += size;
+
+   while (m_bitCount >= 8)
+   {
+      m_block[m_blockLength++] = m_bits & 0xff;
+      m_bits >>= 8;
+      m_bitCount -= 8;
+
+      if (m_blockLength == sizeof(m_block))
+      {
+         flush_block();
+      }
+   }
+}
+
+void GifWriter::flush_block()
+{
+   if (m_blockLength)
+   {
+      fputc(m_blockLength, m_file);
+      fwrite(m_block, 1, m_blockLength, m_file);
+      m_blockLength = 0;
+   }
+}
+
+// ---------------------------------------------------------------------------
+// Entry point
+// ---------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+   sim_time_t start = 0;
+   sim_time_t duration = SIM_SECONDS(60);
+   double speed = 1;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "s:d:a:")) != -1)
+   {
+      switch (opt)
+      {
+      case 's':
+         start = parse_duration(optarg);
+         break;
+      case 'd':
+         duration = parse_duration(optarg);
+         break;
+      case 'a':
+         if ((speed = atof(optarg)) <= 0)
+         {
+            usage(argv[0]);
+         }
+         break;
+      default:
+         usage(argv[0]);
+      }
+   }
+
+   int args = argc - optind;
+   const char *command = args > 0 ? argv[optind] : "";
+
+   if (strcmp(command, "dump") == 0 && args == 2)
+   {
+      return dump(argv[optind + 1]);
+   }
+   else if (strcmp(command, "render") == 0 && args == 3)
+   {
+      return render(argv[optind + 1], argv[optind + 2], start, duration, speed);
+   }
+   else if (strcmp(command, "diff") == 0 && args == 3)
+   {
+      return diff(argv[optind + 1], argv[optind + 2]);
+   }
+
+   usage(argv[0]);
+}
+
+/**@} ---------------------------  End of file  --------------------------- */
@@ -0,0 +1,56 @@
+/**
+ * @file
+ * Alerts of the Linux simulator. Reported on stderr with the virtual time.
+ *  An alert which stops aborts the simulation.
+ * @author software@arreckx.com
+ * @internal
+ * @addtogroup linsim
+ * @{
+ */
+
+#include <stdlib.h>
+
+#include "lib/alert.h"
+#include "core/journal.h"
+#include "linsim.h"
+
+/************************************************************************/
+/* Local variables                                                      */
+/************************************************************************/
+
+/** Number of alerts raised which did not stop */
+static uint32_t _sim_alert_count = 0;
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/** Ready the alert stack */
+void alert_init( void )
+{
+}
+
+/** Report and journal an alert, and abort if required */
+void alert_record( bool doAbort, int line, const char *file )
+{
+   journal_record_alert( doAbort, line );
+
+   fprintf(
+      stderr, "ALERT: %s, line %d at %llu ms\n",
+      file, line, (unsigned long long)(sim_now() / SIM_MILLISECONDS(1)) );
+
+   if ( doAbort )
+   {
+      abort();
+   }
+
+   ++_sim_alert_count;
+}
+
+/** @return The number of alerts raised which did not stop */
+uint32_t sim_alert_count( void )
+{
+   return _sim_alert_count;
+}
+
+/**@} ---------------------------  End of file  --------------------------- */
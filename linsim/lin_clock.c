@@ -0,0 +1,303 @@
+/**
+ * @file
+ * Virtual clock of the Linux simulator.
+ * The pending events are kept in a binary heap ordered by time, then by
+ *  order of scheduling so the events due together always run in the same
+ *  order.
+ * The clock runs as fast as the host allows, or can be paced to follow
+ *  the host clock at a given speed.
+ * @author software@arreckx.com
+ * @internal
+ * @addtogroup linsim
+ * @{
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <setjmp.h>
+#include <errno.h>
+#include <time.h>
+
+#include <asf.h>
+
+#include "lib/alert.h"
+
+/************************************************************************/
+/* Local types                                                          */
+/************************************************************************/
+
+/** An event pending */
+typedef struct
+{
+   sim_time_t at;
+   uint32_t order;
+   sim_handler_t handler;
+   void *arg;
+} _sim_event_t;
+
+/************************************************************************/
+/* Local variables                                                      */
+/************************************************************************/
+
+/** Time on the virtual clock */
+static sim_time_t _sim_now = 0;
+
+/** Events pending. The first one is due first */
+static _sim_event_t _sim_events[SIM_MAX_EVENTS];
+
+/** Number of events pending */
+static uint_fast8_t _sim_event_count = 0;
+
+/** Number of events scheduled so far */
+static uint32_t _sim_event_order = 0;
+
+/** Where to return when the simulation stops */
+static jmp_buf _sim_stop_point;
+
+/** Virtual ns per host ns, or 0 to run at full speed */
+static double _sim_pace_speed = 0;
+
+/** Host time the pace was set at */
+static struct timespec _sim_pace_origin;
+
+/** Virtual time the pace was set at */
+static sim_time_t _sim_pace_now = 0;
+
+/** The clock of the CPU is divided by 1 << shift */
+static uint8_t _sim_cpu_shift = 0;
+
+/************************************************************************/
+/* Private helpers                                                      */
+/************************************************************************/
+
+/** @return true if the event a is due before the event b */
+static inline bool _sim_is_before( const _sim_event_t *a, const _sim_event_t *b )
+{
+   return a->at < b->at || (a->at == b->at && a->order < b->order);
+}
+
+/** Swap two events */
+static inline void _sim_swap( _sim_event_t *a, _sim_event_t *b )
+{
+   _sim_event_t t = *a;
+   *a = *b;
+   *b = t;
+}
+
+/** Move an event up the heap to its place */
+static void _sim_sift_up( uint_fast8_t i )
+{
+   while ( i > 0 && _sim_is_before(&_sim_events[i], &_sim_events[(i - 1) / 2]) )
+   {
+      _sim_swap( &_sim_events[i], &_sim_events[(i - 1) / 2] );
+      i = (i - 1) / 2;
+   }
+}
+
+/** Remove an event. The first one is at 0 */
+static void _sim_remove( uint_fast8_t i )
+{
+   if ( i == --_sim_event_count )
+   {
+      return;
+   }
+
+   _sim_events[i] = _sim_events[_sim_event_count];
+   _sim_sift_up( i );
+
+   for (;;)
+   {
+      uint_fast8_t first = i;
+      uint_fast8_t left = 2 * i + 1;
+      uint_fast8_t right = left + 1;
+
+      if ( left < _sim_event_count && _sim_is_before(&_sim_events[left], &_sim_events[first]) )
+      {
+         first = left;
+      }
+
+      if ( right < _sim_event_count && _sim_is_before(&_sim_events[right], &_sim_events[first]) )
+      {
+         first = right;
+      }
+
+      if ( first == i )
+      {
+         break;
+      }
+
+      _sim_swap( &_sim_events[i], &_sim_events[first] );
+      i = first;
+   }
+}
+
+/** Wait for the host clock to catch up with the virtual time */
+static void _sim_pace_wait( sim_time_t at )
+{
+   uint64_t host = (uint64_t)((at - _sim_pace_now) / _sim_pace_speed);
+   struct timespec until = {
+      _sim_pace_origin.tv_sec + (time_t)(host / 1000000000u),
+      _sim_pace_origin.tv_nsec + (long)(host % 1000000000u),
+   };
+
+   if ( until.tv_nsec >= 1000000000 )
+   {
+      until.tv_nsec -= 1000000000;
+      ++until.tv_sec;
+   }
+
+   while ( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR )
+   {
+      // Interrupted by a signal
+   }
+}
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/** Number of locks of each sleep mode, for the sleep manager of asf.h */
+uint8_t sleepmgr_locks[SLEEPMGR_NR_OF_MODES];
+
+/** @return The time on the virtual clock */
+sim_time_t sim_now( void )
+{
+   return _sim_now;
+}
+
+/** @return The clock of the CPU and the peripherals, as divided by the code */
+uint32_t sim_cpu_hz( void )
+{
+   return SIM_CPU_HZ >> _sim_cpu_shift;
+}
+
+/**
+ * Divide the clock of the CPU and the peripherals, as the prescaler A of
+ *  the XMEGA. The divisions by 1, 2, 4, 8 and 16 are encoded in order.
+ *
+ * @param psadiv  Setting of the prescaler A
+ * @param psbcdiv Setting of the prescalers B and C. Must not divide
+ */
+void sysclk_set_prescalers( uint8_t psadiv, uint8_t psbcdiv )
+{
+   static const uint8_t shifts[] = { 0, 1, 0, 2, 0, 3, 0, 4 };
+   uint32_t from_hz = sim_cpu_hz();
+
+   alert_and_stop_if( psbcdiv != SYSCLK_PSBCDIV_1_1 || (psadiv >> 2) >= sizeof(shifts) );
+
+   _sim_cpu_shift = shifts[psadiv >> 2];
+   sim_tc_clock( from_hz );
+   sim_profile_clock( _sim_cpu_shift );
+}
+
+/**
+ * Call a handler at the given virtual time.
+ * An event in the past is handled at the next sleep.
+ *
+ * @param at      When to call the handler
+ * @param handler Function to call
+ * @param arg     Passed to the handler
+ */
+void sim_schedule( sim_time_t at, sim_handler_t handler, void *arg )
+{
+   uint_fast8_t i = _sim_event_count;
+   _sim_event_t event = { at, _sim_event_order++, handler, arg };
+
+   alert_and_stop_if( _sim_event_count == SIM_MAX_EVENTS );
+
+   _sim_events[_sim_event_count++] = event;
+   _sim_sift_up( i );
+}
+
+/**
+ * Drop the events pending with the given handler and argument.
+ *
+ * @param handler Function the events call
+ * @param arg     Argument of the events
+ */
+void sim_cancel( sim_handler_t handler, void *arg )
+{
+   uint_fast8_t i = 0;
+
+   while ( i < _sim_event_count )
+   {
+      if ( _sim_events[i].handler == handler && _sim_events[i].arg == arg )
+      {
+         // The last event takes the place, and is checked in turn
+         _sim_remove( i );
+      }
+      else
+      {
+         ++i;
+      }
+   }
+}
+
+/**
+ * Sleep the CPU.
+ * The clock jumps to the next event, which is handled. With no event left,
+ *  nothing can wake the CPU up and the simulation stops.
+ */
+void sim_idle( void )
+{
+   _sim_event_t event;
+
+   if ( _sim_event_count == 0 )
+   {
+      sim_stop();
+   }
+
+   event = _sim_events[0];
+   _sim_remove( 0 );
+
+   sim_profile_sleep();
+
+   if ( event.at > _sim_now )
+   {
+      if ( _sim_pace_speed > 0 )
+      {
+         _sim_pace_wait( event.at );
+      }
+
+      _sim_now = event.at;
+   }
+
+   sim_profile_wake();
+   event.handler( event.arg );
+   sim_profile_resume();
+}
+
+/**
+ * Run the main loop of the simulated code until the simulation stops.
+ * The loop is abandoned where it is when stopped.
+ *
+ * @param loop The main loop, which is not expected to return
+ */
+void sim_run( void (*loop)(void) )
+{
+   if ( setjmp(_sim_stop_point) == 0 )
+   {
+      loop();
+   }
+}
+
+/**
+ * Let the virtual clock follow the host clock from now.
+ *
+ * @param speed Virtual time for a unit of host time, such as 1 for real
+ *  time, or 0 to run as fast as possible
+ */
+void sim_pace( double speed )
+{
+   _sim_pace_speed = speed;
+   _sim_pace_now = _sim_now;
+   clock_gettime( CLOCK_MONOTONIC, &_sim_pace_origin );
+}
+
+/** Stop the simulation and return from #sim_run */
+void sim_stop( void )
+{
+   longjmp( _sim_stop_point, 1 );
+}
+
+/**@} ---------------------------  End of file  --------------------------- */
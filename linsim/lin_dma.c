@@ -0,0 +1,140 @@
+/**
+ * @file
+ * DMA controller of the Linux simulator.
+ * A block transfer to the USART in SPI mode completes once its bytes are
+ *  shifted out at the baud rate, then the completion interrupt is raised.
+ *  The bytes are not copied.
+ * @author software@arreckx.com
+ * @internal
+ * @addtogroup linsim
+ * @{
+ */
+
+#include <stddef.h>
+
+#include "dma.h"
+#include "usart_spi.h"
+#include "linsim.h"
+
+/************************************************************************/
+/* Local types                                                          */
+/************************************************************************/
+
+/** State of a channel */
+typedef struct
+{
+   struct dma_channel_config config;
+   dma_callback_t callback;
+   /** Profiled as, once the callback is set */
+   sim_isr_id_t isr;
+   bool busy;
+} _sim_dma_channel_t;
+
+/************************************************************************/
+/* Local variables                                                      */
+/************************************************************************/
+
+USART_t USARTC1;
+
+/** State of each channel */
+static _sim_dma_channel_t _sim_dma_channels[DMA_NUMBER_OF_CHANNELS];
+
+/** Name of each channel in the profile */
+static const char *const _sim_dma_names[DMA_NUMBER_OF_CHANNELS] = {
+   "DMA0", "DMA1", "DMA2", "DMA3"
+};
+
+/************************************************************************/
+/* Private helpers                                                      */
+/************************************************************************/
+
+/** @return The time for the USART to shift a number of bytes out */
+static sim_time_t _sim_dma_duration( const USART_t *usart, uint16_t count )
+{
+   if ( usart->baudrate == 0 )
+   {
+      return 0;
+   }
+
+   return (sim_time_t)count * 8 * SIM_SECONDS(1) / usart->baudrate;
+}
+
+/** Event handler of the end of a block transfer */
+static void _sim_dma_on_complete( void *arg )
+{
+   _sim_dma_channel_t *pChannel = (_sim_dma_channel_t *)arg;
+
+   pChannel->busy = false;
+
+   if ( (pChannel->config.ctrlb & 0x03) != DMA_INT_LVL_OFF && pChannel->callback )
+   {
+      sim_profile_isr_enter( pChannel->isr );
+      pChannel->callback( DMA_CH_TRANSFER_COMPLETED );
+      sim_profile_isr_exit( pChannel->isr );
+   }
+}
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/** Enable the controller */
+void dma_enable( void )
+{
+}
+
+/** Configure a channel */
+void dma_channel_write_config( dma_channel_num_t num, struct dma_channel_config *config )
+{
+   _sim_dma_channels[num].config = *config;
+}
+
+/**
+ * Start a block transfer.
+ * Only the transfers triggered by USARTC1 are timed. Others complete at
+ *  the next sleep.
+ */
+void dma_channel_enable( dma_channel_num_t num )
+{
+   _sim_dma_channel_t *pChannel = &_sim_dma_channels[num];
+   sim_time_t duration = 0;
+
+   if ( pChannel->busy )
+   {
+      return;
+   }
+
+   if ( pChannel->config.trigsrc == DMA_CH_TRIGSRC_USARTC1_DRE_gc )
+   {
+      duration = _sim_dma_duration( &USARTC1, pChannel->config.trfcnt );
+   }
+
+   pChannel->busy = true;
+   sim_schedule( sim_now() + duration, _sim_dma_on_complete, pChannel );
+}
+
+/**
+ * A CPU polling a transfer on-going lets the clock run to the next event,
+ *  so a busy wait ends once the transfer completes. The wait is profiled
+ *  as a sleep.
+ *
+ * @return true while a block transfer is on-going
+ */
+bool dma_channel_is_busy( dma_channel_num_t num )
+{
+   if ( _sim_dma_channels[num].busy )
+   {
+      sim_idle();
+   }
+
+   return _sim_dma_channels[num].busy;
+}
+
+/** Set the function called on completion */
+void dma_set_callback( dma_channel_num_t num, dma_callback_t callback )
+{
+   _sim_dma_channels[num].callback = callback;
+   _sim_dma_channels[num].isr = sim_profile_isr( _sim_dma_names[num] );
+}
+
+/**@} ---------------------------  End of file  --------------------------- */
@@ -0,0 +1,275 @@
+/**
+ * @file
+ * Frame buffer of the Linux simulator.
+ * Nothing is displayed. Each frame committed is folded into a digest, and
+ *  written to a file if requested, one line per commit:
+ * @code
+ * <virtual time in ms> <status><level> x 48, in hex
+ * @endcode
+ * Two runs committing the same frames at the same times have the same
+ *  digest, and their files compare with diff.
+ * The changes of the frames can also be written to a binary trace, small
+ *  and cheap enough to be left on. It starts with "PLDF", a version byte
+ *  and the number of LEDs, followed by one record per commit changing the
+ *  frame, from a frame all off at time 0:
+ * @code
+ * <time since the previous record in ns, LEB128> <number of runs>
+ *    <LEDs skipped> <count> <status << 4 | level> x count, per run
+ * @endcode
+ * linsim-fbtrace dumps, renders and compares the traces.
+ * With SIM_FB_DRIVER defined, the driver of the target is linked in, and
+ *  only the commit hook is provided here.
+ * @author software@arreckx.com
+ * @internal
+ * @addtogroup linsim
+ * @{
+ */
+
+#include <string.h>
+
+#include "driver/fb.h"
+#include "linsim.h"
+
+/************************************************************************/
+/* Local variables                                                      */
+/************************************************************************/
+
+#ifndef SIM_FB_DRIVER
+fb_mem_t fb_current;
+fb_mem_t *fb_live;
+#endif
+
+/** Last frame committed */
+static fb_mem_t _sim_fb_last;
+
+/** Where to write the frames, if anywhere */
+static FILE *_sim_fb_file = NULL;
+
+/** Where to write the changes of the frames, if anywhere */
+static FILE *_sim_fb_trace_file = NULL;
+
+/** Time of the last record of the trace */
+static sim_time_t _sim_fb_trace_time = 0;
+
+/** Frames committed so far */
+static sim_fb_stats_t _sim_fb_stats = { 0, 0, 2166136261u };
+
+#ifndef SIM_FB_DRIVER
+/** True if the next frame committed is timed */
+static bool _sim_fb_latency_armed = false;
+
+/** Time of the input the next frame committed is timed from */
+static timer_count_t _sim_fb_latency_since = 0;
+
+/** Times from the inputs to their frames so far */
+static fb_latency_stats_t _sim_fb_latency;
+#endif
+
+/************************************************************************/
+/* Private helpers                                                      */
+/************************************************************************/
+
+/** Fold bytes into the digest (FNV-1a) */
+static void _sim_fb_hash( const void *p, size_t length )
+{
+   const uint8_t *pByte = (const uint8_t *)p;
+
+   while ( length-- )
+   {
+      _sim_fb_stats.digest = (_sim_fb_stats.digest ^ *pByte++) * 16777619u;
+   }
+}
+
+/** @return The number of LEDs from an index which changed, merging short gaps */
+static fb_index_t _sim_fb_run( const fb_mem_t from, const fb_mem_t to, fb_index_t index )
+{
+   fb_index_t end = index;
+   fb_index_t i;
+
+   for ( i=index; i<FB_NUMBER_OF_LEDS && i<end + 3; ++i )
+   {
+      // A gap of up to 2 LEDs costs no more than a new run
+      if ( memcmp(&from[i], &to[i], sizeof(fb_led_t)) != 0 )
+      {
+         end = i + 1;
+      }
+   }
+
+   return end - index;
+}
+
+/** Write the changes from a frame to another to the trace */
+static void _sim_fb_trace_write( const fb_mem_t from, const fb_mem_t to )
+{
+   uint8_t record[2 * FB_NUMBER_OF_LEDS + FB_NUMBER_OF_LEDS + 1];
+   uint8_t *pRecord = record + 1;
+   uint64_t delta = sim_now() - _sim_fb_trace_time;
+   fb_index_t skipped = 0;
+   fb_index_t i = 0;
+   fb_index_t count;
+
+   record[0] = 0;
+
+   while ( i < FB_NUMBER_OF_LEDS )
+   {
+      if ( memcmp(&from[i], &to[i], sizeof(fb_led_t)) == 0 )
+      {
+         ++skipped;
+         ++i;
+         continue;
+      }
+
+      count = _sim_fb_run( from, to, i );
+
+      ++record[0];
+      *pRecord++ = skipped;
+      *pRecord++ = count;
+
+      for ( ; count; --count, ++i )
+      {
+         *pRecord++ = to[i].status << 4 | to[i].level;
+      }
+
+      skipped = 0;
+   }
+
+   if ( record[0] == 0 )
+   {
+      return;
+   }
+
+   _sim_fb_trace_time = sim_now();
+
+   do
+   {
+      fputc( (delta & 0x7f) | (delta > 0x7f ? 0x80 : 0), _sim_fb_trace_file );
+      delta >>= 7;
+   } while ( delta );
+
+   fwrite( record, 1, pRecord - record, _sim_fb_trace_file );
+}
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+#ifndef SIM_FB_DRIVER
+/** Initialise the framebuffer API */
+void fb_init( void )
+{
+   memset( (void *)fb_current, 0, sizeof(fb_current) );
+   memset( (void *)_sim_fb_last, 0, sizeof(_sim_fb_last) );
+}
+
+/** Nothing to refresh. A frame committed is shown at once */
+void fb_refresh( void )
+{
+   timer_count_t ms;
+
+   if ( _sim_fb_latency_armed )
+   {
+      _sim_fb_latency_armed = false;
+      ms = timer_time_lapsed_since( _sim_fb_latency_since );
+
+      ++_sim_fb_latency.count;
+      _sim_fb_latency.last_ms = (uint16_t)ms;
+      _sim_fb_latency.total_ms += ms;
+
+      if ( ms > _sim_fb_latency.worst_ms )
+      {
+         _sim_fb_latency.worst_ms = (uint16_t)ms;
+      }
+   }
+}
+
+/** Time the next frame committed from an input */
+void fb_time_next_latch( timer_count_t since )
+{
+   if ( ! _sim_fb_latency_armed )
+   {
+      _sim_fb_latency_armed = true;
+      _sim_fb_latency_since = since;
+   }
+}
+
+/** Get the times from the inputs to their frames so far */
+void fb_get_latency_stats( fb_latency_stats_t *pStats )
+{
+   *pStats = _sim_fb_latency;
+}
+#endif
+
+/** Record the frame just committed */
+void fb_on_commit( void )
+{
+   uint64_t ms = sim_now() / SIM_MILLISECONDS(1);
+   fb_index_t i;
+
+   ++_sim_fb_stats.commits;
+
+   if ( memcmp(_sim_fb_last, fb_current, sizeof(fb_current)) != 0 )
+   {
+      ++_sim_fb_stats.changes;
+
+      if ( _sim_fb_trace_file )
+      {
+         _sim_fb_trace_write( _sim_fb_last, fb_current );
+      }
+
+      memcpy( _sim_fb_last, fb_current, sizeof(fb_current) );
+   }
+
+   _sim_fb_hash( &ms, sizeof(ms) );
+   _sim_fb_hash( fb_current, sizeof(fb_current) );
+
+   if ( _sim_fb_file )
+   {
+      static const char HEX[] = "0123456789abcdef";
+      char line[2 * FB_NUMBER_OF_LEDS + 2];
+
+      for ( i=0; i<FB_NUMBER_OF_LEDS; ++i )
+      {
+         line[2 * i]     = HEX[fb_current[i].status];
+         line[2 * i + 1] = HEX[fb_current[i].level];
+      }
+
+      line[2 * FB_NUMBER_OF_LEDS]     = '\n';
+      line[2 * FB_NUMBER_OF_LEDS + 1] = '\0';
+
+      fprintf( _sim_fb_file, "%llu %s", (unsigned long long)ms, line );
+   }
+}
+
+/** Write each frame committed to a file, or stop if 0 */
+void sim_fb_record( FILE *f )
+{
+   _sim_fb_file = f;
+}
+
+/**
+ * Write the changes of the frames committed to a binary trace, from now on.
+ *
+ * @param f The file, opened for writing in binary
+ */
+void sim_fb_trace( FILE *f )
+{
+   static const fb_mem_t off;
+
+   _sim_fb_trace_file = f;
+   _sim_fb_trace_time = 0;
+
+   fwrite( SIM_FB_TRACE_MAGIC, 1, 4, f );
+   fputc( SIM_FB_TRACE_VERSION, f );
+   fputc( FB_NUMBER_OF_LEDS, f );
+
+   // The trace starts all off
+   _sim_fb_trace_write( off, _sim_fb_last );
+}
+
+/** Get the frames committed so far */
+void sim_fb_get_stats( sim_fb_stats_t *pStats )
+{
+   *pStats = _sim_fb_stats;
+}
+
+/**@} ---------------------------  End of file  --------------------------- */
@@ -0,0 +1,470 @@
+/**
+ * @file
+ * Inputs of the Linux simulator, recorded and replayed.
+ * All the inputs of the firmware go through #sim_input and #sim_input_gps:
+ *  the key, the measurements, the RTC, the bytes of the GPS and its 1PPS.
+ *  Each input applied can be recorded to a trace, and a trace replayed
+ *  feeds the inputs back at the same virtual times. The run is then
+ *  reproduced exactly.
+ * The trace is binary. It starts with "PLDI" and a version byte, followed
+ *  by one record per input:
+ * @code
+ * <type> <time since the previous input in ns, LEB128> <payload>
+ * @endcode
+ * The payload of the key is a byte, 1 for a long push. The temperature is
+ *  an int16 in 10th of degrees, the luminosity a byte in %, and the RTC an
+ *  uint32 timestamp, all little endian. The GPS bytes are prefixed by their
+ *  count, and the 1PPS has none.
+ * A file of NMEA sentences can also be fed as the GPS module would send
+ *  them: a burst every second, from the RMC sentence, after the 1PPS.
+ * @author software@arreckx.com
+ * @internal
+ * @addtogroup linsim
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <asf.h>
+
+#include "lib/alert.h"
+#include "lib/timer.h"
+#include "driver/key.h"
+#include "core/sequencer.h"
+
+/************************************************************************/
+/* Local defines                                                        */
+/************************************************************************/
+
+/** Start of a trace */
+#define _SIM_INPUT_MAGIC "PLDI"
+
+/** Version of the trace format */
+#define _SIM_INPUT_VERSION 1
+
+/** Width of the 1PPS pulse */
+#define _SIM_INPUT_PPS_WIDTH SIM_MILLISECONDS(100)
+
+/** Delay from the 1PPS to the first byte of the burst */
+#define _SIM_INPUT_NMEA_DELAY SIM_MILLISECONDS(50)
+
+/************************************************************************/
+/* Local types                                                          */
+/************************************************************************/
+
+/** An input applied later */
+typedef struct
+{
+   sim_input_type_t type;
+   int32_t value;
+   uint8_t length;
+   uint8_t data[SIM_INPUT_MAX_LENGTH];
+} _sim_input_t;
+
+/************************************************************************/
+/* Local variables                                                      */
+/************************************************************************/
+
+/** Trace recorded, if any */
+static FILE *_sim_input_record_file = NULL;
+
+/** Time of the last input recorded */
+static sim_time_t _sim_input_record_time = 0;
+
+/** Trace replayed, if any */
+static FILE *_sim_input_replay_file = NULL;
+
+/** Time of the last input replayed */
+static sim_time_t _sim_input_replay_time = 0;
+
+/** Next input of the trace replayed */
+static _sim_input_t _sim_input_replay_next;
+
+/** NMEA sentences fed, if any */
+static FILE *_sim_input_nmea_file = NULL;
+
+/** First sentence of the next burst of NMEA */
+static char _sim_input_nmea_line[SIM_INPUT_MAX_LENGTH];
+
+/** Time of the last push on the key, as the timer count */
+static timer_count_t _sim_input_key_time = 0;
+
+/************************************************************************/
+/* Private helpers                                                      */
+/************************************************************************/
+
+/** @return The number of payload bytes of a fixed size input */
+static uint8_t _sim_input_size( sim_input_type_t type )
+{
+   switch ( type )
+   {
+   case SIM_INPUT_KEY:         return 1;
+   case SIM_INPUT_TEMPERATURE: return 2;
+   case SIM_INPUT_LUMINOSITY:  return 1;
+   case SIM_INPUT_RTC:         return 4;
+   default:                    return 0;
+   }
+}
+
+/** Write an input to the trace recorded */
+static void _sim_input_write( sim_input_type_t type, int32_t value, const uint8_t *pData, uint8_t length )
+{
+   uint64_t delta = sim_now() - _sim_input_record_time;
+   uint8_t i;
+
+   _sim_input_record_time = sim_now();
+
+   fputc( type, _sim_input_record_file );
+
+   do
+   {
+      fputc( (delta & 0x7f) | (delta > 0x7f ? 0x80 : 0), _sim_input_record_file );
+      delta >>= 7;
+   } while ( delta );
+
+   for ( i=0; i<_sim_input_size(type); ++i )
+   {
+      fputc( (uint8_t)((uint32_t)value >> (8 * i)), _sim_input_record_file );
+   }
+
+   if ( type == SIM_INPUT_GPS )
+   {
+      fputc( length, _sim_input_record_file );
+      fwrite( pData, 1, length, _sim_input_record_file );
+   }
+}
+
+/** @return true if the next input of the trace replayed could be read */
+static bool _sim_input_read( FILE *f, _sim_input_t *pInput )
+{
+   uint64_t delta = 0;
+   int type = fgetc( f );
+   int shift = 0;
+   int c;
+   uint8_t i;
+
+   if ( type < SIM_INPUT_KEY || type > SIM_INPUT_PPS )
+   {
+      return false;
+   }
+
+   pInput->type = (sim_input_type_t)type;
+
+   do
+   {
+      if ( (c = fgetc(f)) == EOF || shift > 63 )
+      {
+         return false;
+      }
+
+      delta |= (uint64_t)(c & 0x7f) << shift;
+      shift += 7;
+   } while ( c & 0x80 );
+
+   _sim_input_replay_time += delta;
+
+   pInput->value = 0;
+
+   for ( i=0; i<_sim_input_size(pInput->type); ++i )
+   {
+      if ( (c = fgetc(f)) == EOF )
+      {
+         return false;
+      }
+
+      pInput->value |= (uint32_t)c << (8 * i);
+   }
+
+   // Sign extend the temperature
+   if ( pInput->type == SIM_INPUT_TEMPERATURE )
+   {
+      pInput->value = (int16_t)pInput->value;
+   }
+
+   pInput->length = 0;
+
+   if ( pInput->type == SIM_INPUT_GPS )
+   {
+      if ( (c = fgetc(f)) == EOF )
+      {
+         return false;
+      }
+
+      pInput->length = (uint8_t)c;
+
+      if ( fread(pInput->data, 1, pInput->length, f) != pInput->length )
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+/** Apply an input */
+static void _sim_input_apply( const _sim_input_t *pInput )
+{
+   if ( pInput->type == SIM_INPUT_GPS )
+   {
+      sim_input_gps( pInput->data, pInput->length );
+   }
+   else
+   {
+      sim_input( pInput->type, pInput->value );
+   }
+}
+
+/** Event handler of an input scheduled */
+static void _sim_input_on_due( void *arg )
+{
+   _sim_input_apply( (_sim_input_t *)arg );
+   free( arg );
+}
+
+/** Event handler of the falling edge of the 1PPS */
+static void _sim_input_on_pps_end( void *arg )
+{
+   (void)arg;
+   sim_pin_set( GPS_1PPS_SIGNAL, false );
+}
+
+/** Apply the inputs of the trace due now, and schedule the next one */
+static void _sim_input_replay( void *arg )
+{
+   (void)arg;
+
+   do
+   {
+      if ( _sim_input_replay_time > sim_now() )
+      {
+         sim_schedule( _sim_input_replay_time, _sim_input_replay, NULL );
+         return;
+      }
+
+      _sim_input_apply( &_sim_input_replay_next );
+   } while ( _sim_input_read(_sim_input_replay_file, &_sim_input_replay_next) );
+
+   _sim_input_replay_file = NULL;
+}
+
+/** @return true if a line of NMEA is the RMC sentence starting a burst */
+static bool _sim_input_nmea_is_first( const char *line )
+{
+   return line[0] == '$' && strncmp( line + 3, "RMC", 3 ) == 0;
+}
+
+/** @return true if a line of NMEA could be read, without its end of line */
+static bool _sim_input_nmea_read( char *line )
+{
+   // Leave room for the CR LF
+   if ( ! fgets(line, SIM_INPUT_MAX_LENGTH - 2, _sim_input_nmea_file) )
+   {
+      return false;
+   }
+
+   line[strcspn(line, "\r\n")] = '\0';
+
+   return true;
+}
+
+/** Send a line of NMEA as the GPS module does */
+static void _sim_input_nmea_send( char *line )
+{
+   strcat( line, "\r\n" );
+   sim_input_gps( (const uint8_t *)line, (uint8_t)strlen(line) );
+}
+
+/**
+ * Called at the 1PPS with no argument, and again with the first line of
+ *  the burst to send the NMEA of the second.
+ */
+static void _sim_input_nmea_second( void *arg )
+{
+   char line[SIM_INPUT_MAX_LENGTH];
+
+   if ( arg == NULL )
+   {
+      sim_input( SIM_INPUT_PPS, 0 );
+      sim_schedule( sim_now() + _SIM_INPUT_NMEA_DELAY, _sim_input_nmea_second, _sim_input_nmea_line );
+      return;
+   }
+
+   _sim_input_nmea_send( _sim_input_nmea_line );
+
+   while ( _sim_input_nmea_read(line) )
+   {
+      if ( _sim_input_nmea_is_first(line) )
+      {
+         strcpy( _sim_input_nmea_line, line );
+         sim_schedule(
+            sim_now() - _SIM_INPUT_NMEA_DELAY + SIM_SECONDS(1), _sim_input_nmea_second, NULL );
+         return;
+      }
+
+      _sim_input_nmea_send( line );
+   }
+
+   _sim_input_nmea_file = NULL;
+}
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/**
+ * Apply an input now, and record it.
+ *
+ * @param type  Type of the input. Not the GPS bytes
+ * @param value The temperature, luminosity or time. 1 for a long push
+ */
+void sim_input( sim_input_type_t type, int32_t value )
+{
+   if ( _sim_input_record_file )
+   {
+      _sim_input_write( type, value, NULL, 0 );
+   }
+
+   switch ( type )
+   {
+   case SIM_INPUT_KEY:
+      // The push is dispatched on its edge, as for a release on the target
+      _sim_input_key_time = timer_get_count();
+
+      if ( value )
+      {
+         sequencer_switch_long();
+      }
+      else
+      {
+         sequencer_switch_short();
+      }
+      break;
+   case SIM_INPUT_TEMPERATURE:
+      sim_measurement_set_temperature( (int16_t)value );
+      break;
+   case SIM_INPUT_LUMINOSITY:
+      sim_measurement_set_luminosity( (uint8_t)value );
+      break;
+   case SIM_INPUT_RTC:
+      sim_rtc_set( (uint32_t)value );
+      break;
+   case SIM_INPUT_PPS:
+      sim_pin_set( GPS_1PPS_SIGNAL, true );
+      sim_schedule( sim_now() + _SIM_INPUT_PPS_WIDTH, _sim_input_on_pps_end, NULL );
+      break;
+   default:
+      alert();
+   }
+}
+
+/**
+ * Send bytes from the GPS module now, and record them.
+ *
+ * @param pData  The bytes
+ * @param length Number of bytes
+ */
+void sim_input_gps( const uint8_t *pData, uint8_t length )
+{
+   if ( _sim_input_record_file )
+   {
+      _sim_input_write( SIM_INPUT_GPS, 0, pData, length );
+   }
+
+   sim_sio2host_receive( pData, length );
+}
+
+/**
+ * Apply an input at a later time.
+ *
+ * @param at    Virtual time of the input
+ * @param type  Type of the input. Not the GPS bytes
+ * @param value As for #sim_input
+ */
+void sim_input_at( sim_time_t at, sim_input_type_t type, int32_t value )
+{
+   _sim_input_t *pInput = (_sim_input_t *)malloc( sizeof(_sim_input_t) );
+
+   pInput->type = type;
+   pInput->value = value;
+   pInput->length = 0;
+
+   sim_schedule( at, _sim_input_on_due, pInput );
+}
+
+/**
+ * Record the inputs applied from now to a trace.
+ *
+ * @param f The file, opened for writing in binary
+ */
+void sim_input_record( FILE *f )
+{
+   _sim_input_record_file = f;
+   _sim_input_record_time = sim_now();
+
+   fwrite( _SIM_INPUT_MAGIC, 1, strlen(_SIM_INPUT_MAGIC), f );
+   fputc( _SIM_INPUT_VERSION, f );
+}
+
+/**
+ * Replay the inputs of a trace recorded from the same time as now.
+ * The inputs due now are applied at once.
+ *
+ * @param f The file, opened for reading in binary
+ * @return false if the file is not a trace
+ */
+bool sim_input_replay( FILE *f )
+{
+   char header[sizeof(_SIM_INPUT_MAGIC)];
+
+   if ( fread(header, 1, sizeof(header), f) != sizeof(header)
+      || memcmp(header, _SIM_INPUT_MAGIC, strlen(_SIM_INPUT_MAGIC)) != 0
+      || header[strlen(_SIM_INPUT_MAGIC)] != _SIM_INPUT_VERSION )
+   {
+      return false;
+   }
+
+   _sim_input_replay_file = f;
+   _sim_input_replay_time = sim_now();
+
+   if ( _sim_input_read(f, &_sim_input_replay_next) )
+   {
+      _sim_input_replay( NULL );
+   }
+
+   return true;
+}
+
+/**
+ * Feed NMEA sentences, one per line, as the GPS module sends them.
+ * Each RMC sentence starts the burst of a new second.
+ *
+ * @param f The file, opened for reading
+ * @param at Virtual time of the first 1PPS
+ * @return false if the file has no RMC sentence
+ */
+bool sim_input_feed_nmea( FILE *f, sim_time_t at )
+{
+   _sim_input_nmea_file = f;
+
+   while ( _sim_input_nmea_read(_sim_input_nmea_line) )
+   {
+      if ( _sim_input_nmea_is_first(_sim_input_nmea_line) )
+      {
+         sim_schedule( at, _sim_input_nmea_second, NULL );
+         return true;
+      }
+   }
+
+   _sim_input_nmea_file = NULL;
+
+   return false;
+}
+
+/** @return The time of the last push on the key, as the timer count */
+timer_count_t key_get_edge_time( void )
+{
+   return _sim_input_key_time;
+}
+
+/**@} ---------------------------  End of file  --------------------------- */
@@ -0,0 +1,155 @@
+/**
+ * @file
+ * Pins of the Linux simulator.
+ * The level of each pin is kept, and the interrupt registers of the ports. The changes of the debug pins named in the
+ *  board configuration can be written to a VCD file, to read with any
+ *  waveform viewer.
+ * The changes are timed with #sim_profile_now, so the code between two
+ *  changes takes time when profiling.
+ * @author software@arreckx.com
+ * @internal
+ * @addtogroup linsim
+ * @{
+ */
+
+#include <asf.h>
+
+/************************************************************************/
+/* Local types                                                          */
+/************************************************************************/
+
+/** A pin traced */
+typedef struct
+{
+   uint8_t pin;
+   const char *name;
+} _sim_pin_name_t;
+
+/************************************************************************/
+/* Local variables                                                      */
+/************************************************************************/
+
+/** Pins traced, as configured for the board */
+static const _sim_pin_name_t _sim_pin_names[] = {
+#ifdef DEBUG_REACTOR_IDLE
+   { DEBUG_REACTOR_IDLE, "reactor_idle" },
+#endif
+#ifdef DEBUG_REACTOR_BUSY
+   { DEBUG_REACTOR_BUSY, "reactor_busy" },
+#endif
+#ifdef DEBUG_FB
+   { DEBUG_FB, "fb" },
+#endif
+#ifdef HC595_LATCH
+   { HC595_LATCH, "hc595_latch" },
+#endif
+#ifdef ALERT_OUTPUT_PIN
+   { ALERT_OUTPUT_PIN, "alert" },
+#endif
+#ifdef GPS_1PPS_SIGNAL
+   { GPS_1PPS_SIGNAL, "gps_1pps" },
+#endif
+};
+
+/** Number of pins traced */
+#define _SIM_PINS_TRACED (sizeof(_sim_pin_names) / sizeof(_sim_pin_names[0]))
+
+/** Level of each pin */
+static bool _sim_pin_levels[SIM_NUMBER_OF_PINS];
+
+/** Registers of each port */
+PORT_t sim_ports[PORTR + 1];
+
+/** VCD file written, if any */
+static FILE *_sim_pin_vcd = NULL;
+
+/** Time of the last change written */
+static sim_time_t _sim_pin_vcd_time = 0;
+
+/************************************************************************/
+/* Private helpers                                                      */
+/************************************************************************/
+
+/** @return The VCD identifier of a traced pin */
+static inline char _sim_pin_id( size_t index )
+{
+   return (char)('!' + index);
+}
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/** Set the level of a pin */
+void sim_pin_set( uint8_t pin, bool level )
+{
+   size_t i;
+
+   if ( _sim_pin_levels[pin] == level )
+   {
+      return;
+   }
+
+   _sim_pin_levels[pin] = level;
+
+   if ( ! _sim_pin_vcd )
+   {
+      return;
+   }
+
+   for ( i=0; i<_SIM_PINS_TRACED; ++i )
+   {
+      if ( _sim_pin_names[i].pin == pin )
+      {
+         sim_time_t now = sim_profile_now();
+
+         // Several pins can share a test point
+         if ( now != _sim_pin_vcd_time )
+         {
+            _sim_pin_vcd_time = now;
+            fprintf( _sim_pin_vcd, "#%llu\n", (unsigned long long)now );
+         }
+
+         fprintf( _sim_pin_vcd, "%d%c\n", level ? 1 : 0, _sim_pin_id(i) );
+      }
+   }
+}
+
+/** @return The level of a pin */
+bool sim_pin_get( uint8_t pin )
+{
+   return _sim_pin_levels[pin];
+}
+
+/**
+ * Write the changes of the debug pins to a VCD file, from now on.
+ * The time unit is the ns.
+ *
+ * @param f The file, opened for writing
+ */
+void sim_pin_trace( FILE *f )
+{
+   size_t i;
+
+   _sim_pin_vcd = f;
+   _sim_pin_vcd_time = sim_profile_now();
+
+   fprintf( f, "$timescale 1ns $end\n$scope module pld $end\n" );
+
+   for ( i=0; i<_SIM_PINS_TRACED; ++i )
+   {
+      fprintf( f, "$var wire 1 %c %s $end\n", _sim_pin_id(i), _sim_pin_names[i].name );
+   }
+
+   fprintf( f, "$upscope $end\n$enddefinitions $end\n#%llu\n$dumpvars\n",
+      (unsigned long long)_sim_pin_vcd_time );
+
+   for ( i=0; i<_SIM_PINS_TRACED; ++i )
+   {
+      fprintf( f, "%d%c\n", _sim_pin_levels[_sim_pin_names[i].pin] ? 1 : 0, _sim_pin_id(i) );
+   }
+
+   fprintf( f, "$end\n" );
+}
+
+/**@} ---------------------------  End of file  --------------------------- */
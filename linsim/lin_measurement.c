@@ -0,0 +1,81 @@
+/**
+ * @file
+ * Measurements of the Linux simulator. The values are set by the
+ *  simulator and do not change by themselves.
+ * As the measurements of the target, the frame buffer refreshes when the
+ *  room turns dark or bright.
+ * @author software@arreckx.com
+ * @internal
+ * @addtogroup linsim
+ * @{
+ */
+
+#include "core/boot.h"
+#include "core/measurements.h"
+#include "driver/fb.h"
+#include "linsim.h"
+
+/************************************************************************/
+/* Local variables                                                      */
+/************************************************************************/
+
+/** Temperature in 10th of degrees */
+static int16_t _sim_temperature = 196;
+
+/** Luminosity in % */
+static uint8_t _sim_luminosity = 13;
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/** Initialise the analog measurement. The values are known at once */
+void measurement_init( void )
+{
+   boot_stage_done( boot_sensors_e );
+}
+
+/** @return The current temperature in 10th degrees */
+int16_t measurement_get_temperature( void )
+{
+   return _sim_temperature;
+}
+
+/** @return The current luminosity in % */
+uint8_t measurement_get_luminosity( void )
+{
+   return _sim_luminosity;
+}
+
+/** @return true if the ambient light is dark */
+bool measurement_luminosity_is_dark( void )
+{
+   return _sim_luminosity == 0;
+}
+
+/** @return true, as the values are set by the simulator */
+bool measurement_is_valid( void )
+{
+   return true;
+}
+
+/** Set the temperature returned by the measurements, in 10th of degrees */
+void sim_measurement_set_temperature( int16_t temperature )
+{
+   _sim_temperature = temperature;
+}
+
+/** Set the luminosity returned by the measurements, in % */
+void sim_measurement_set_luminosity( uint8_t luminosity )
+{
+   bool wasDark = measurement_luminosity_is_dark();
+
+   _sim_luminosity = luminosity;
+
+   if ( measurement_luminosity_is_dark() != wasDark )
+   {
+      fb_refresh();
+   }
+}
+
+/**@} ---------------------------  End of file  --------------------------- */
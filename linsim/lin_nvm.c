@@ -0,0 +1,97 @@
+/**
+ * @file
+ * EEPROM of the Linux simulator.
+ * The EEPROM starts erased and is kept in memory for the run. As on the
+ *  XMEGA, an erase and write of a page only affects the bytes loaded in the
+ *  page buffer. The writes complete at once.
+ * @author software@arreckx.com
+ * @internal
+ * @addtogroup linsim
+ * @{
+ */
+
+#include <string.h>
+
+#include "asf.h"
+
+/************************************************************************/
+/* Local variables                                                      */
+/************************************************************************/
+
+/** Content of the EEPROM */
+static uint8_t _sim_eeprom[EEPROM_SIZE];
+
+/** True once the EEPROM is erased */
+static bool _sim_eeprom_is_ready = false;
+
+/** Page buffer */
+static uint8_t _sim_eeprom_buffer[EEPROM_PAGE_SIZE];
+
+/** True for each byte loaded in the page buffer */
+static bool _sim_eeprom_is_loaded[EEPROM_PAGE_SIZE];
+
+/************************************************************************/
+/* Local functions                                                      */
+/************************************************************************/
+
+/** Erase the EEPROM on first access */
+static void _sim_eeprom_ready( void )
+{
+   if ( ! _sim_eeprom_is_ready )
+   {
+      memset( _sim_eeprom, 0xFF, sizeof(_sim_eeprom) );
+      _sim_eeprom_is_ready = true;
+   }
+}
+
+/************************************************************************/
+/* Simulated API                                                        */
+/************************************************************************/
+
+uint8_t nvm_eeprom_read_byte( eeprom_addr_t addr )
+{
+   _sim_eeprom_ready();
+
+   return _sim_eeprom[addr % EEPROM_SIZE];
+}
+
+void nvm_eeprom_read_buffer( eeprom_addr_t address, void *buf, uint16_t len )
+{
+   uint16_t i;
+
+   for ( i=0; i<len; ++i )
+   {
+      ((uint8_t *)buf)[i] = nvm_eeprom_read_byte( address + i );
+   }
+}
+
+void nvm_eeprom_flush_buffer( void )
+{
+   memset( _sim_eeprom_is_loaded, 0, sizeof(_sim_eeprom_is_loaded) );
+}
+
+void nvm_eeprom_load_byte_to_buffer( uint8_t byte_addr, uint8_t value )
+{
+   _sim_eeprom_buffer[byte_addr % EEPROM_PAGE_SIZE] = value;
+   _sim_eeprom_is_loaded[byte_addr % EEPROM_PAGE_SIZE] = true;
+}
+
+void nvm_eeprom_atomic_write_page( uint8_t page_addr )
+{
+   uint16_t address = (page_addr * EEPROM_PAGE_SIZE) % EEPROM_SIZE;
+   uint8_t i;
+
+   _sim_eeprom_ready();
+
+   for ( i=0; i<EEPROM_PAGE_SIZE; ++i )
+   {
+      if ( _sim_eeprom_is_loaded[i] )
+      {
+         _sim_eeprom[address + i] = _sim_eeprom_buffer[i];
+      }
+   }
+
+   nvm_eeprom_flush_buffer();
+}
+
+/**@} ---------------------------  End of file  --------------------------- */
@@ -0,0 +1,398 @@
+/**
+ * @file
+ * Profiler of the Linux simulator.
+ * The simulated code runs in zero virtual time. While profiling, the time
+ *  the host spends in each interrupt handler, and in the reactor between
+ *  two sleeps, is measured and scaled by a ratio to estimate the time on the
+ *  target.
+ * From those, the report gives for each interrupt source its rate, mean and
+ *  worst time, and duty cycle, and how long the CPU sleeps.
+ * The host may be preempted at any time, which makes the worst times
+ *  meaningless. The times of each source are therefore kept in a histogram,
+ *  and the worst is given along percentiles which are not affected.
+ * The current drawn by the CPU is estimated from the time it sleeps, and
+ *  scales with its clock. The code takes longer as the clock is divided.
+ * The counts only depend on the run. The times depend on the host: compare
+ *  reports from the same host.
+ * @author software@arreckx.com
+ * @internal
+ * @addtogroup linsim
+ * @{
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "linsim.h"
+
+/************************************************************************/
+/* Local defines                                                        */
+/************************************************************************/
+
+/** Host ns per bucket of the histograms */
+#define _SIM_PROFILE_BUCKET_NS 4
+
+/** Number of buckets. The last one holds all longer times */
+#define _SIM_PROFILE_BUCKETS 4096
+
+/** Number of divisions of the CPU clock told apart, as powers of 2 */
+#define _SIM_PROFILE_SHIFTS 5
+
+/**
+ * @def SIM_ACTIVE_UA
+ * Current drawn by the CPU running at 32MHz, in uA, as typical on the
+ *  datasheet of the ATxmega64A4U
+ */
+#ifndef SIM_ACTIVE_UA
+#  define SIM_ACTIVE_UA 10000
+#endif
+
+/**
+ * @def SIM_IDLE_UA
+ * Current drawn by the CPU in idle sleep at 32MHz, in uA. Both currents
+ *  are taken proportional to the clock
+ */
+#ifndef SIM_IDLE_UA
+#  define SIM_IDLE_UA 4000
+#endif
+
+/************************************************************************/
+/* Local types                                                          */
+/************************************************************************/
+
+/** Times of an interrupt source, in host ns */
+typedef struct
+{
+   const char *name;
+   uint64_t calls;
+   uint64_t total;
+   uint64_t worst;
+   uint64_t entry;
+   uint32_t histogram[_SIM_PROFILE_BUCKETS];
+} _sim_profile_isr_t;
+
+/************************************************************************/
+/* Local variables                                                      */
+/************************************************************************/
+
+/** Target ns per host ns, or 0 if not profiling */
+static uint32_t _sim_profile_ratio = 0;
+
+/** Virtual time profiling started at */
+static sim_time_t _sim_profile_start = 0;
+
+/** Interrupt sources */
+static _sim_profile_isr_t _sim_profile_isrs[SIM_MAX_ISRS];
+
+/** Number of interrupt sources */
+static uint_fast8_t _sim_profile_isr_count = 0;
+
+/** Host time of the last wake up */
+static uint64_t _sim_profile_wake_time = 0;
+
+/** Host time the reactor got the CPU back */
+static uint64_t _sim_profile_resume_time = 0;
+
+/** Host time spent in the reactor */
+static uint64_t _sim_profile_busy = 0;
+
+/** Last time given by #sim_profile_now */
+static sim_time_t _sim_profile_last = 0;
+
+/** Host time to read the host clock, removed from the measures */
+static uint64_t _sim_profile_overhead = 0;
+
+/** The CPU clock is divided by 1 << shift */
+static uint8_t _sim_profile_shift = 0;
+
+/** Virtual time the CPU clock last changed at */
+static sim_time_t _sim_profile_shift_since = 0;
+
+/** Virtual time spent at each division of the clock, up to the last change */
+static sim_time_t _sim_profile_shift_time[_SIM_PROFILE_SHIFTS];
+
+/** Host time the CPU was busy at each division of the clock, scaled to it */
+static uint64_t _sim_profile_shift_busy[_SIM_PROFILE_SHIFTS];
+
+/************************************************************************/
+/* Private helpers                                                      */
+/************************************************************************/
+
+/** @return The host time in ns */
+static inline uint64_t _sim_profile_host_ns( void )
+{
+   struct timespec ts;
+
+   clock_gettime( CLOCK_MONOTONIC, &ts );
+
+   return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/** @return The least time measured between two reads of the host clock */
+static uint64_t _sim_profile_measure_overhead( void )
+{
+   uint64_t least = UINT64_MAX;
+   int i;
+
+   for ( i=0; i<1000; ++i )
+   {
+      uint64_t start = _sim_profile_host_ns();
+      uint64_t duration = _sim_profile_host_ns() - start;
+
+      if ( duration < least )
+      {
+         least = duration;
+      }
+   }
+
+   return least;
+}
+
+/** @return The time under which a fraction of the calls of a source return */
+static uint64_t _sim_profile_percentile( const _sim_profile_isr_t *pIsr, double fraction )
+{
+   uint64_t count = 0;
+   uint64_t target = (uint64_t)(pIsr->calls * fraction);
+   int bucket;
+
+   for ( bucket=0; bucket<_SIM_PROFILE_BUCKETS - 1; ++bucket )
+   {
+      count += pIsr->histogram[bucket];
+
+      if ( count > target )
+      {
+         break;
+      }
+   }
+
+   return (uint64_t)(bucket + 1) * _SIM_PROFILE_BUCKET_NS;
+}
+
+/** @return A percentage of the virtual time profiled */
+static double _sim_profile_percent( uint64_t host_ns )
+{
+   sim_time_t elapsed = sim_now() - _sim_profile_start;
+
+   return elapsed ? 100.0 * host_ns * _sim_profile_ratio / elapsed : 0.0;
+}
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/**
+ * Start profiling from now.
+ *
+ * @param ratio Time on the target for a ns on the host
+ */
+void sim_profile_start( uint32_t ratio )
+{
+   _sim_profile_overhead = _sim_profile_measure_overhead();
+   _sim_profile_ratio = ratio;
+   _sim_profile_start = sim_now();
+   _sim_profile_last = sim_now();
+   _sim_profile_wake_time = _sim_profile_host_ns();
+   _sim_profile_resume_time = _sim_profile_wake_time;
+   _sim_profile_shift_since = sim_now();
+   memset( _sim_profile_shift_time, 0, sizeof(_sim_profile_shift_time) );
+}
+
+/**
+ * Register an interrupt source. Can be called before profiling starts.
+ *
+ * @param name Name used in the report. Must remain valid
+ * @return The identifier to pass when the handler is called
+ */
+sim_isr_id_t sim_profile_isr( const char *name )
+{
+   sim_isr_id_t id;
+
+   for ( id=0; id<_sim_profile_isr_count; ++id )
+   {
+      if ( strcmp(_sim_profile_isrs[id].name, name) == 0 )
+      {
+         return id;
+      }
+   }
+
+   if ( _sim_profile_isr_count == SIM_MAX_ISRS )
+   {
+      return SIM_NO_ISR;
+   }
+
+   _sim_profile_isrs[_sim_profile_isr_count].name = name;
+
+   return _sim_profile_isr_count++;
+}
+
+/** An interrupt handler is called */
+void sim_profile_isr_enter( sim_isr_id_t id )
+{
+   if ( _sim_profile_ratio && id != SIM_NO_ISR )
+   {
+      _sim_profile_isrs[id].entry = _sim_profile_host_ns();
+   }
+}
+
+/** An interrupt handler returned */
+void sim_profile_isr_exit( sim_isr_id_t id )
+{
+   if ( _sim_profile_ratio && id != SIM_NO_ISR )
+   {
+      _sim_profile_isr_t *pIsr = &_sim_profile_isrs[id];
+      uint64_t duration = _sim_profile_host_ns() - pIsr->entry;
+      uint64_t bucket;
+
+      duration = duration > _sim_profile_overhead ? duration - _sim_profile_overhead : 0;
+      duration <<= _sim_profile_shift;
+      bucket = duration / _SIM_PROFILE_BUCKET_NS;
+
+      _sim_profile_shift_busy[_sim_profile_shift] += duration;
+
+      ++pIsr->calls;
+      pIsr->total += duration;
+      ++pIsr->histogram[bucket < _SIM_PROFILE_BUCKETS ? bucket : _SIM_PROFILE_BUCKETS - 1];
+
+      if ( duration > pIsr->worst )
+      {
+         pIsr->worst = duration;
+      }
+   }
+}
+
+/** The CPU goes to sleep until the next event */
+void sim_profile_sleep( void )
+{
+   if ( _sim_profile_ratio )
+   {
+      uint64_t busy = _sim_profile_host_ns() - _sim_profile_resume_time;
+
+      busy = busy > _sim_profile_overhead ? (busy - _sim_profile_overhead) << _sim_profile_shift : 0;
+      _sim_profile_busy += busy;
+      _sim_profile_shift_busy[_sim_profile_shift] += busy;
+   }
+}
+
+/** The CPU wakes up for an event. The virtual clock has moved */
+void sim_profile_wake( void )
+{
+   if ( _sim_profile_ratio )
+   {
+      _sim_profile_wake_time = _sim_profile_host_ns();
+   }
+}
+
+/** The event is handled. The reactor gets the CPU back */
+void sim_profile_resume( void )
+{
+   if ( _sim_profile_ratio )
+   {
+      _sim_profile_resume_time = _sim_profile_host_ns();
+   }
+}
+
+/**
+ * @return The time the code would have taken on the target since the last
+ *  wake up if profiling, else 0
+ */
+sim_time_t sim_profile_elapsed( void )
+{
+   if ( _sim_profile_ratio )
+   {
+      return ((_sim_profile_host_ns() - _sim_profile_wake_time) * _sim_profile_ratio) << _sim_profile_shift;
+   }
+
+   return 0;
+}
+
+/**
+ * @return The virtual time, plus the time the code would have taken on the
+ *  target since the last wake up if profiling. Never goes back.
+ */
+sim_time_t sim_profile_now( void )
+{
+   sim_time_t now = sim_now() + sim_profile_elapsed();
+
+   if ( now < _sim_profile_last )
+   {
+      now = _sim_profile_last;
+   }
+
+   _sim_profile_last = now;
+
+   return now;
+}
+
+/**
+ * The clock of the CPU changes. Called whether profiling or not.
+ *
+ * @param shift The clock is now divided by 1 << shift
+ */
+void sim_profile_clock( uint8_t shift )
+{
+   _sim_profile_shift_time[_sim_profile_shift] += sim_now() - _sim_profile_shift_since;
+   _sim_profile_shift_since = sim_now();
+   _sim_profile_shift = shift < _SIM_PROFILE_SHIFTS ? shift : _SIM_PROFILE_SHIFTS - 1;
+}
+
+/**
+ * Write the report, one value per line as 'key value'.
+ * The times are estimated for the target in ns.
+ *
+ * @param f File to write to
+ */
+void sim_profile_report( FILE *f )
+{
+   sim_time_t elapsed = sim_now() - _sim_profile_start;
+   uint64_t cpu = _sim_profile_busy;
+   double charge = 0;
+   sim_isr_id_t id;
+   uint8_t shift;
+
+   sim_profile_clock( _sim_profile_shift );
+
+   fprintf( f, "virtual_ms %llu\n", (unsigned long long)(elapsed / SIM_MILLISECONDS(1)) );
+   fprintf( f, "ratio %lu\n", (unsigned long)_sim_profile_ratio );
+
+   for ( id=0; id<_sim_profile_isr_count; ++id )
+   {
+      const _sim_profile_isr_t *pIsr = &_sim_profile_isrs[id];
+
+      if ( pIsr->calls == 0 )
+      {
+         continue;
+      }
+
+      cpu += pIsr->total;
+
+      fprintf( f, "isr.%s.calls %llu\n", pIsr->name, (unsigned long long)pIsr->calls );
+      fprintf( f, "isr.%s.rate_hz %.1f\n", pIsr->name,
+         elapsed ? (double)pIsr->calls * SIM_SECONDS(1) / elapsed : 0.0 );
+      fprintf( f, "isr.%s.mean_ns %llu\n", pIsr->name,
+         (unsigned long long)(pIsr->total * _sim_profile_ratio / pIsr->calls) );
+      fprintf( f, "isr.%s.p50_ns %llu\n", pIsr->name,
+         (unsigned long long)(_sim_profile_percentile(pIsr, 0.5) * _sim_profile_ratio) );
+      fprintf( f, "isr.%s.p99_ns %llu\n", pIsr->name,
+         (unsigned long long)(_sim_profile_percentile(pIsr, 0.99) * _sim_profile_ratio) );
+      fprintf( f, "isr.%s.p999_ns %llu\n", pIsr->name,
+         (unsigned long long)(_sim_profile_percentile(pIsr, 0.999) * _sim_profile_ratio) );
+      fprintf( f, "isr.%s.worst_ns %llu\n", pIsr->name,
+         (unsigned long long)(pIsr->worst * _sim_profile_ratio) );
+      fprintf( f, "isr.%s.duty_pct %.3f\n", pIsr->name, _sim_profile_percent(pIsr->total) );
+   }
+
+   fprintf( f, "reactor.busy_pct %.3f\n", _sim_profile_percent(_sim_profile_busy) );
+   fprintf( f, "cpu.idle_pct %.3f\n", 100.0 - _sim_profile_percent(cpu) );
+
+   // Charge in uA.ns drawn at each division of the clock
+   for ( shift=0; shift<_SIM_PROFILE_SHIFTS; ++shift )
+   {
+      charge += ((double)SIM_IDLE_UA * _sim_profile_shift_time[shift]
+         + (double)(SIM_ACTIVE_UA - SIM_IDLE_UA) * _sim_profile_shift_busy[shift] * _sim_profile_ratio)
+         / (1u << shift);
+   }
+
+   fprintf( f, "cpu.current_ma %.2f\n", elapsed ? charge / elapsed / 1000.0 : 0.0 );
+}
+
+/**@} ---------------------------  End of file  --------------------------- */
@@ -0,0 +1,106 @@
+/**
+ * @file
+ * RTC of the Linux simulator. The time runs on the virtual clock from the
+ *  last time it was set.
+ * The alarm is an event at the start of its second, scheduled again each
+ *  time the alarm or the time is set.
+ * @author software@arreckx.com
+ * @internal
+ * @addtogroup linsim
+ * @{
+ */
+
+#include <asf.h>
+
+/************************************************************************/
+/* Local variables                                                      */
+/************************************************************************/
+
+/** Time of the RTC when last set */
+static uint32_t _sim_rtc_time = 0;
+
+/** Virtual time the RTC was last set at */
+static sim_time_t _sim_rtc_origin = 0;
+
+/** Second of the alarm */
+static uint32_t _sim_rtc_alarm = 0;
+
+/** Called when the alarm is due, or 0 */
+static rtc_callback_t _sim_rtc_callback = 0;
+
+/** Interrupt source of the alarm, for the profiler */
+static sim_isr_id_t _sim_rtc_isr = SIM_NO_ISR;
+
+/************************************************************************/
+/* Private helpers                                                      */
+/************************************************************************/
+
+/** Event handler of the alarm */
+static void _sim_rtc_on_alarm( void *arg )
+{
+   if ( _sim_rtc_callback )
+   {
+      sim_profile_isr_enter( _sim_rtc_isr );
+      _sim_rtc_callback( _sim_rtc_alarm );
+      sim_profile_isr_exit( _sim_rtc_isr );
+   }
+}
+
+/** Schedule the alarm, if still to come */
+static void _sim_rtc_schedule( void )
+{
+   sim_cancel( _sim_rtc_on_alarm, NULL );
+
+   if ( _sim_rtc_alarm > rtc_get_time() )
+   {
+      sim_schedule(
+         _sim_rtc_origin + SIM_SECONDS(_sim_rtc_alarm - _sim_rtc_time),
+         _sim_rtc_on_alarm,
+         NULL );
+   }
+}
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/** Ready the RTC. The time is kept */
+void rtc_init( void )
+{
+   _sim_rtc_isr = sim_profile_isr( "RTC" );
+}
+
+/** @return The UTC time in seconds since the epoch */
+uint32_t rtc_get_time( void )
+{
+   return _sim_rtc_time + (uint32_t)((sim_now() - _sim_rtc_origin) / SIM_SECONDS(1));
+}
+
+/** Set the time of the RTC now, as the GPS manager does */
+void rtc_set_time( uint32_t time )
+{
+   _sim_rtc_time = time;
+   _sim_rtc_origin = sim_now();
+   _sim_rtc_schedule();
+}
+
+/** Set the callback of the alarm */
+void rtc_set_callback( rtc_callback_t callback )
+{
+   _sim_rtc_callback = callback;
+}
+
+/** Raise the alarm at the start of the given second */
+void rtc_set_alarm( uint32_t time )
+{
+   _sim_rtc_alarm = time;
+   _sim_rtc_schedule();
+}
+
+/** Set the time of the RTC now */
+void sim_rtc_set( uint32_t timestamp )
+{
+   rtc_set_time( timestamp );
+}
+
+/**@} ---------------------------  End of file  --------------------------- */
@@ -0,0 +1,167 @@
+/**
+ * @file
+ * Serial port of the Linux simulator, receiving from the GPS module.
+ * The bytes received are queued with the time they are shifted in, one
+ *  after the other at the baud rate. The code only gets a byte once its
+ *  time has come. A byte which does not fit is lost, as an overrun.
+ * The port counts clocks of the CPU per bit, as the USART. If the clock
+ *  changes and the code does not set the baud rate for the new clock, the
+ *  bytes are received with framing errors, and lost.
+ * @author software@arreckx.com
+ * @internal
+ * @addtogroup linsim
+ * @{
+ */
+
+#include <sio2host.h>
+
+#include "linsim.h"
+
+/************************************************************************/
+/* Local defines                                                        */
+/************************************************************************/
+
+/** Baud rate of the GPS module */
+#define _SIM_SIO2HOST_BAUD 9600
+
+/** Time to shift a byte in: 10 bits at the baud rate of the module */
+#define _SIM_SIO2HOST_BYTE_TIME (SIM_SECONDS(10) / _SIM_SIO2HOST_BAUD)
+
+/** Error of the baud rate, in %, above which the bytes are garbled */
+#define _SIM_SIO2HOST_BAUD_TOLERANCE 2
+
+/** Number of bytes which can be queued. A power of 2 */
+#define _SIM_SIO2HOST_QUEUE_SIZE 1024
+
+/************************************************************************/
+/* Local variables                                                      */
+/************************************************************************/
+
+/** Bytes received */
+static uint8_t _sim_sio2host_bytes[_SIM_SIO2HOST_QUEUE_SIZE];
+
+/** Time each byte is received */
+static sim_time_t _sim_sio2host_times[_SIM_SIO2HOST_QUEUE_SIZE];
+
+/** Position of the next byte to read */
+static uint16_t _sim_sio2host_head = 0;
+
+/** Position of the next byte to queue */
+static uint16_t _sim_sio2host_tail = 0;
+
+/** Time the last byte queued is received */
+static sim_time_t _sim_sio2host_last = 0;
+
+/** Number of bytes lost */
+static uint32_t _sim_sio2host_overruns = 0;
+
+/** Clocks of the CPU per bit, as set by the code */
+static uint32_t _sim_sio2host_clocks_per_bit = SIM_CPU_HZ / _SIM_SIO2HOST_BAUD;
+
+/** Number of bytes garbled */
+static uint32_t _sim_sio2host_framing_errors = 0;
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/** Ready the serial port */
+void sio2host_init( void )
+{
+}
+
+/** @return The next byte received, or -1 if none yet */
+int sio2host_getchar_nowait( void )
+{
+   uint32_t baud = sim_sio2host_baud();
+   uint8_t c;
+
+   for (;;)
+   {
+      if ( _sim_sio2host_head == _sim_sio2host_tail
+         || _sim_sio2host_times[_sim_sio2host_head] > sim_now() )
+      {
+         return -1;
+      }
+
+      c = _sim_sio2host_bytes[_sim_sio2host_head];
+      _sim_sio2host_head = (_sim_sio2host_head + 1) & (_SIM_SIO2HOST_QUEUE_SIZE - 1);
+
+      if ( baud * 100 >= _SIM_SIO2HOST_BAUD * (100 - _SIM_SIO2HOST_BAUD_TOLERANCE)
+         && baud * 100 <= _SIM_SIO2HOST_BAUD * (100 + _SIM_SIO2HOST_BAUD_TOLERANCE) )
+      {
+         return c;
+      }
+
+      ++_sim_sio2host_framing_errors;
+   }
+}
+
+/**
+ * Set the baud rate, for the given clock of the CPU.
+ *
+ * @param usart  The port. Only the one of the GPS module is simulated
+ * @param baud   The baud rate
+ * @param cpu_hz The clock of the CPU the rate is set for
+ * @return true
+ */
+bool usart_set_baudrate( USART_t *usart, uint32_t baud, uint32_t cpu_hz )
+{
+   (void)usart;
+
+   _sim_sio2host_clocks_per_bit = cpu_hz / baud;
+
+   return true;
+}
+
+/**
+ * Receive bytes from now, after those still being received.
+ *
+ * @param pData  The bytes
+ * @param length Number of bytes
+ */
+void sim_sio2host_receive( const uint8_t *pData, uint16_t length )
+{
+   if ( _sim_sio2host_last < sim_now() )
+   {
+      _sim_sio2host_last = sim_now();
+   }
+
+   while ( length-- )
+   {
+      uint8_t c = *pData++;
+      uint16_t next = (_sim_sio2host_tail + 1) & (_SIM_SIO2HOST_QUEUE_SIZE - 1);
+
+      _sim_sio2host_last += _SIM_SIO2HOST_BYTE_TIME;
+
+      if ( next == _sim_sio2host_head )
+      {
+         ++_sim_sio2host_overruns;
+         continue;
+      }
+
+      _sim_sio2host_bytes[_sim_sio2host_tail] = c;
+      _sim_sio2host_times[_sim_sio2host_tail] = _sim_sio2host_last;
+      _sim_sio2host_tail = next;
+   }
+}
+
+/** @return The number of bytes lost so far */
+uint32_t sim_sio2host_overruns( void )
+{
+   return _sim_sio2host_overruns;
+}
+
+/** @return The baud rate the serial port runs at, from the clock of the CPU */
+uint32_t sim_sio2host_baud( void )
+{
+   return sim_cpu_hz() / _sim_sio2host_clocks_per_bit;
+}
+
+/** @return The number of bytes garbled by a wrong baud rate so far */
+uint32_t sim_sio2host_framing_errors( void )
+{
+   return _sim_sio2host_framing_errors;
+}
+
+/**@} ---------------------------  End of file  --------------------------- */
@@ -0,0 +1,280 @@
+/**
+ * @file
+ * Timer/counters of the Linux simulator.
+ * Each running timer/counter has its next overflow scheduled on the virtual
+ *  clock. The overflows follow each other exactly, so the timer service
+ *  keeps the same pace as on the target over any length of simulation.
+ * @author software@arreckx.com
+ * @internal
+ * @addtogroup linsim
+ * @{
+ */
+
+#include <stddef.h>
+
+#include "tc.h"
+#include "linsim.h"
+
+/************************************************************************/
+/* Local types                                                          */
+/************************************************************************/
+
+/** State of a timer/counter kept along its registers */
+typedef struct
+{
+   TC0_t *tc;
+   const char *name;
+   tc_callback_t overflow;
+   /** Profiled as, once the callback is set */
+   sim_isr_id_t isr;
+   /** Time of the next overflow, or 0 if stopped */
+   sim_time_t due;
+   /** Time between 2 overflows, for the period, clock source and CPU clock */
+   sim_time_t period;
+   uint16_t period_per;
+   uint8_t period_clksel;
+   uint32_t period_hz;
+} _sim_tc_t;
+
+/************************************************************************/
+/* Local variables                                                      */
+/************************************************************************/
+
+TC0_t TCC0, TCC1, TCD0, TCD1, TCE0;
+
+/** State of each timer/counter */
+static _sim_tc_t _sim_tcs[] = {
+   { &TCC0, "TCC0" }, { &TCC1, "TCC1" }, { &TCD0, "TCD0" }, { &TCD1, "TCD1" }, { &TCE0, "TCE0" },
+};
+
+/** Prescaler division of each clock source */
+static const uint16_t _sim_tc_division[] = { 0, 1, 2, 4, 8, 64, 256, 1024 };
+
+/************************************************************************/
+/* Private helpers                                                      */
+/************************************************************************/
+
+/** @return The state of a timer/counter */
+static _sim_tc_t *_sim_tc_of( volatile void *tc )
+{
+   size_t i;
+
+   for ( i=0; i<sizeof(_sim_tcs)/sizeof(_sim_tcs[0]); ++i )
+   {
+      if ( (volatile void *)_sim_tcs[i].tc == tc )
+      {
+         return &_sim_tcs[i];
+      }
+   }
+
+   return NULL;
+}
+
+/**
+ * @return The time between 2 overflows as currently configured. Computed
+ *  again only once the configuration changes, as read at each tick.
+ */
+static sim_time_t _sim_tc_period( _sim_tc_t *pTc )
+{
+   const TC0_t *tc = pTc->tc;
+   uint32_t hz = sim_cpu_hz();
+
+   if ( pTc->period_per != tc->PER
+      || pTc->period_clksel != tc->CTRLA
+      || pTc->period_hz != hz )
+   {
+      uint64_t cycles = ((uint64_t)tc->PER + 1) * _sim_tc_division[tc->CTRLA & 0x07];
+
+      pTc->period = cycles * SIM_SECONDS(1) / hz;
+      pTc->period_per = tc->PER;
+      pTc->period_clksel = tc->CTRLA;
+      pTc->period_hz = hz;
+   }
+
+   return pTc->period;
+}
+
+/** @return The time of a count, in divisions of the full CPU clock */
+static uint32_t _sim_tc_count_time( const TC0_t *tc, uint32_t cpu_hz )
+{
+   return (uint32_t)_sim_tc_division[tc->CTRLA & 0x07] * (SIM_CPU_HZ / cpu_hz);
+}
+
+/** Raise the overflow interrupt, or leave it pending if disabled */
+static void _sim_tc_raise( _sim_tc_t *pTc )
+{
+   if ( (pTc->tc->INTCTRLA & TC0_OVFINTLVL_gm) && pTc->overflow )
+   {
+      pTc->tc->INTFLAGS &= ~TC0_OVFIF_bm;
+
+      sim_profile_isr_enter( pTc->isr );
+      pTc->overflow();
+      sim_profile_isr_exit( pTc->isr );
+   }
+   else
+   {
+      pTc->tc->INTFLAGS |= TC0_OVFIF_bm;
+   }
+}
+
+/** Event handler of an overflow */
+static void _sim_tc_on_overflow( void *arg )
+{
+   _sim_tc_t *pTc = (_sim_tc_t *)arg;
+
+   pTc->due += _sim_tc_period( pTc );
+   sim_schedule( pTc->due, _sim_tc_on_overflow, pTc );
+
+   _sim_tc_raise( pTc );
+}
+
+/**
+ * Move the next overflow of a running timer/counter as the rate of its
+ *  count changes. The count is kept, as on the target.
+ *
+ * @param pTc  The timer/counter
+ * @param from Time of a count before the change, from #_sim_tc_count_time
+ */
+static void _sim_tc_rescale( _sim_tc_t *pTc, uint32_t from )
+{
+   uint32_t to = _sim_tc_count_time( pTc->tc, sim_cpu_hz() );
+
+   if ( pTc->due == 0 || to == from || pTc->due <= sim_now() )
+   {
+      return;
+   }
+
+   sim_cancel( _sim_tc_on_overflow, pTc );
+   pTc->due = sim_now() + (pTc->due - sim_now()) * to / from;
+   sim_schedule( pTc->due, _sim_tc_on_overflow, pTc );
+}
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/** Power the timer/counter up */
+void tc_enable( volatile void *tc )
+{
+   (void)tc;
+}
+
+/** Stop the timer/counter */
+void tc_disable( volatile void *tc )
+{
+   tc_write_clock_source( tc, TC_CLKSEL_OFF_gc );
+}
+
+/** Set the function called on overflow */
+void tc_set_overflow_interrupt_callback( volatile void *tc, tc_callback_t callback )
+{
+   _sim_tc_t *pTc = _sim_tc_of(tc);
+
+   pTc->overflow = callback;
+   pTc->isr = sim_profile_isr( pTc->name );
+}
+
+/**
+ * Raise the overflow interrupt of a timer/counter now, out of its schedule.
+ * Used to call the interrupt handler directly, as the benchmarks do, and
+ *  for an overflow left pending once its interrupt is enabled.
+ */
+void sim_tc_overflow( volatile void *tc )
+{
+   _sim_tc_raise( _sim_tc_of(tc) );
+}
+
+/** Start the timer/counter from a clock source, or stop it */
+void tc_write_clock_source( volatile void *tc, TC_CLKSEL_t clksel )
+{
+   _sim_tc_t *pTc = _sim_tc_of(tc);
+   uint32_t from = _sim_tc_count_time( pTc->tc, sim_cpu_hz() );
+
+   // A running timer/counter keeps counting from its count
+   if ( pTc->due != 0 && clksel != TC_CLKSEL_OFF_gc )
+   {
+      pTc->tc->CTRLA = (uint8_t)clksel;
+      _sim_tc_rescale( pTc, from );
+
+      return;
+   }
+
+   pTc->tc->CTRLA = (uint8_t)clksel;
+   pTc->due = 0;
+
+   // The overflow pending does not wake the CPU up
+   sim_cancel( _sim_tc_on_overflow, pTc );
+
+   if ( clksel != TC_CLKSEL_OFF_gc )
+   {
+      pTc->due = sim_now() + _sim_tc_period( pTc );
+      sim_schedule( pTc->due, _sim_tc_on_overflow, pTc );
+   }
+}
+
+/**
+ * The clock of the CPU and the peripherals changed. The timer/counters keep
+ *  their count, which goes at the new rate.
+ *
+ * @param from_hz The clock before the change
+ */
+void sim_tc_clock( uint32_t from_hz )
+{
+   size_t i;
+
+   for ( i=0; i<sizeof(_sim_tcs)/sizeof(_sim_tcs[0]); ++i )
+   {
+      _sim_tc_rescale( &_sim_tcs[i], _sim_tc_count_time( _sim_tcs[i].tc, from_hz ) );
+   }
+}
+
+/** @return The count of a running timer/counter, or 0 if stopped */
+uint16_t tc_read_count( volatile void *tc )
+{
+   _sim_tc_t *pTc = _sim_tc_of(tc);
+   sim_time_t period, now;
+   uint64_t count;
+
+   if ( pTc->due == 0 )
+   {
+      return 0;
+   }
+
+   // Counts on while the code runs if profiling
+   period = _sim_tc_period( pTc );
+   now = sim_now() + sim_profile_elapsed();
+
+   if ( now >= pTc->due )
+   {
+      return pTc->tc->PER;
+   }
+
+   // Right at the overflow, as each tick wakes the reactor up
+   if ( pTc->due - now == period )
+   {
+      return 0;
+   }
+
+   count = (period - (pTc->due - now)) * ((uint64_t)pTc->tc->PER + 1) / period;
+
+   // The overflow due now is not handled yet
+   return (uint16_t)(count > pTc->tc->PER ? pTc->tc->PER : count);
+}
+
+/** Set the count of a running timer/counter, which moves its next overflow */
+void tc_write_count( volatile void *tc, uint16_t cnt_value )
+{
+   _sim_tc_t *pTc = _sim_tc_of(tc);
+   uint64_t top = (uint64_t)pTc->tc->PER + 1;
+
+   if ( pTc->due == 0 || cnt_value >= top )
+   {
+      return;
+   }
+
+   sim_cancel( _sim_tc_on_overflow, pTc );
+   pTc->due = sim_now() + _sim_tc_period( pTc ) * (top - cnt_value) / top;
+   sim_schedule( pTc->due, _sim_tc_on_overflow, pTc );
+}
+
+/**@} ---------------------------  End of file  --------------------------- */
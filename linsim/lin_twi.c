@@ -0,0 +1,25 @@
+/**
+ * @file
+ * TWI of the Linux simulator.
+ * Only the registers are kept. The bus and its slaves are not modelled, as
+ *  linsim stands in for the sensors at the measurement level. The checks
+ *  play the slave by setting the status and calling the interrupt.
+ * @author software@arreckx.com
+ * @internal
+ * @addtogroup linsim
+ * @{
+ */
+
+#include "twi.h"
+
+/************************************************************************/
+/* Local variables                                                      */
+/************************************************************************/
+
+/** Registers of the TWI of the sensors */
+TWI_t TWIE;
+
+/** Registers of the interrupt controller */
+PMIC_t PMIC;
+
+/**@} ---------------------------  End of file  --------------------------- */
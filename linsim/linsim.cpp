@@ -0,0 +1,574 @@
+/**
+ * @file
+ * Entry point of the Linux simulator.
+ * The services are initialised as by the main of the target, then the
+ *  reactor runs on the virtual clock for the requested time.
+ * @code
+ * linsim [-m mode] [-d duration] [-s start] [-o frames] [-f trace] [-k key@ms]...
+ *        [-t temperature] [-l luminosity] [-g nmea] [-r seed]
+ *        [-w trace] [-i trace] [-a speed]
+ *        [-p report] [-x ratio] [-v vcd]
+ * @endcode
+ * The summary printed at the end, but for the wall time, only depends on
+ *  the options.
+ * The inputs given by the options are recorded with -w. A trace replayed
+ *  with -i then gives the same run, and replaces the options giving inputs.
+ * The frames traced with -f are dumped, rendered and compared with
+ *  linsim-fbtrace.
+ * linsim-prof is built with the frame buffer driver of the target, to
+ *  profile its interrupts.
+ * @author software@arreckx.com
+ * @internal
+ * @addtogroup linsim
+ * @{
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <unistd.h>
+
+#include "lib/alert.h"
+#include "lib/reactor.h"
+#include "lib/timer.h"
+#include "lib/governor.h"
+#include "lib/civil.h"
+#include "lib/cpp.h"
+#include "driver/fb.h"
+#include "core/boot.h"
+#include "core/journal.h"
+#include "core/measurements.h"
+#include "core/history.h"
+#include "core/sequencer.h"
+#include "core/gps_manager.h"
+#include "linsim.h"
+
+extern "C" void rtc_init(void);
+extern "C" void sio2host_init(void);
+
+// ---------------------------------------------------------------------------
+// Local types
+// ---------------------------------------------------------------------------
+namespace
+{
+   /** A mode and how to reach it from the boot */
+   struct ModeEntry
+   {
+      const char *name;
+      /** Number of short pushes. -1 for a long push */
+      int pushes;
+   };
+}
+
+// ---------------------------------------------------------------------------
+// Local variables
+// ---------------------------------------------------------------------------
+namespace
+{
+   /**
+    * Modes which can be selected at start.
+    * Follows the short push sequence of core/configuration.hpp.
+    */
+   const ModeEntry MODES[]
+   {
+      { "boot",        0 },
+      { "metro",       1 },
+      { "temperature", 2 },
+      { "trend",       3 },
+      { "pharmacy",    4 },
+      { "demo",        -1 },
+   };
+
+   /** Start time if not given. Valid for the time zone service */
+   const char DEFAULT_START[] = "2016-01-01T00:00:00";
+
+   /**
+    * Time on the target for a ns on the host, if not given.
+    * Calibrated on a PC so the fb tick takes the 60us measured on the target
+    *  (256Hz refresh for 50% of the CPU).
+    */
+   const uint32_t DEFAULT_RATIO = 750;
+
+   /** Jobs of the boot, as the main of the target */
+   const boot_job_t BOOT_JOBS[]
+   {
+      { boot_sensors_e, &measurement_init, 0 },
+      { boot_gps_e,     &gps_manager_init, 0 },
+      { boot_history_e, &history_init,     BOOT_AFTER(boot_sensors_e) },
+      { boot_clock_e,   nullptr,           BOOT_AFTER(boot_gps_e) },
+      { boot_journal_e, &journal_dump,     BOOT_AFTER(boot_gps_e) },
+   };
+}
+
+// ---------------------------------------------------------------------------
+// Private functions
+// ---------------------------------------------------------------------------
+namespace
+{
+   /** Print the usage and exit */
+   void usage(const char *name)
+   {
+      fprintf(
+         stderr,
+         "Usage: %s [options]\n"
+         " -m mode         Mode to show: boot, metro, temperature, trend, pharmacy\n"
+         "                  or demo. Default is to boot\n"
+         " -d duration     Virtual time to run, as 500ms, 90s, 30m or 24h. Default 1h\n"
+         " -s start        UTC time of the RTC at start, as %s\n"
+         " -o file         Write each frame committed to the file, - for stdout\n"
+         " -f file         Trace the changes of the frames to the file, in binary\n"
+         " -k s@ms, l@ms   Short or long push on the key at the given virtual time\n"
+         " -t temperature  Temperature in 10th of degrees. Default 196\n"
+         " -l luminosity   Luminosity in %%. 0 is dark. Default 13\n"
+         " -g file         NMEA sentences sent by the GPS, one per line, from 1s\n"
+         " -r seed         Seed of the random numbers. Default 1\n"
+         " -w file         Record the inputs to a trace\n"
+         " -i file         Replay the inputs of a trace, in place of the options\n"
+         " -a speed        Follow the real time at the given speed, as 1 or 60\n"
+         " -p file         Profile the run and write the report to the file\n"
+         " -x ratio        Time on the target for a ns on the host. Default %lu\n"
+         " -v file         Trace the debug pins to a VCD file\n",
+         name, DEFAULT_START, (unsigned long)DEFAULT_RATIO);
+
+      exit(EXIT_FAILURE);
+   }
+
+   /** @return A file opened for writing, - for stdout. Exits on failure */
+   FILE *open_output(const char *path)
+   {
+      FILE *f = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+
+      if (!f)
+      {
+         perror(path);
+         exit(EXIT_FAILURE);
+      }
+
+      return f;
+   }
+
+   /** @return A file opened for reading. Exits on failure */
+   FILE *open_input(const char *path)
+   {
+      FILE *f = fopen(path, "rb");
+
+      if (!f)
+      {
+         perror(path);
+         exit(EXIT_FAILURE);
+      }
+
+      return f;
+   }
+
+   /** Close a file opened by #open_output */
+   void close_output(FILE *f)
+   {
+      if (f && f != stdout)
+      {
+         fclose(f);
+      }
+   }
+
+   /** @return The virtual time of a duration such as 24h, or 0 if invalid */
+   sim_time_t parse_duration(const char *text)
+   {
+      char *unit;
+      unsigned long long value = strtoull(text, &unit, 10);
+
+      if (strcmp(unit, "h") == 0)
+      {
+         return SIM_SECONDS(value * 3600);
+      }
+      else if (strcmp(unit, "m") == 0)
+      {
+         return SIM_SECONDS(value * 60);
+      }
+      else if (strcmp(unit, "s") == 0)
+      {
+         return SIM_SECONDS(value);
+      }
+      else if (strcmp(unit, "ms") == 0 || *unit == '\0')
+      {
+         return SIM_MILLISECONDS(value);
+      }
+
+      return 0;
+   }
+
+   /** @return true if a UTC time as 2016-01-01T00:00:00 is read */
+   bool parse_start(const char *text, uint32_t *pTimestamp)
+   {
+      unsigned year, month, date, hour, minute, second;
+      calendar_date start;
+
+      if (sscanf(text, "%4u-%2u-%2uT%2u:%2u:%2u",
+            &year, &month, &date, &hour, &minute, &second) != 6 ||
+          month < 1 || month > 12 || date < 1 || date > 31 ||
+          hour > 23 || minute > 59 || second > 59)
+      {
+         return false;
+      }
+
+      start.year = year;
+      start.month = month - 1;
+      start.date = date - 1;
+      start.hour = hour;
+      start.minute = minute;
+      start.second = second;
+
+      *pTimestamp = civil_date_to_timestamp(&start);
+
+      return true;
+   }
+
+   /** Write the residency of the reactor in each sleep mode */
+   void report_sleep(FILE *f)
+   {
+      static const char *const NAMES[REACTOR_SLEEP_MODES]
+      {
+         "idle", "estdby", "psave", "stdby", "pdown"
+      };
+      reactor_sleep_stats_t stats;
+
+      reactor_get_sleep_stats(&stats);
+
+      for (int i = 0; i < REACTOR_SLEEP_MODES; ++i)
+      {
+         fprintf(f, "sleep.%s.sleeps %lu\n", NAMES[i], (unsigned long)stats.sleeps[i]);
+         fprintf(f, "sleep.%s.ms %lu\n", NAMES[i], (unsigned long)stats.ms[i]);
+      }
+   }
+
+   /** Write the changes of the clock made by the governor */
+   void report_governor(FILE *f)
+   {
+      governor_stats_t stats;
+
+      governor_get_stats(&stats);
+
+      fprintf(f, "governor.changes %lu\n", (unsigned long)stats.changes);
+      fprintf(f, "governor.worst_us %u\n", (unsigned)stats.worst_us);
+
+      for (int i = 0; i < GOVERNOR_SPEEDS; ++i)
+      {
+         fprintf(f, "governor.%lumhz.ms %lu\n",
+            (unsigned long)(SIM_CPU_HZ / 1000000 >> (i * 2)), (unsigned long)stats.ms[i]);
+      }
+   }
+
+   /** Write the times from the pushes on the key to the latch of their frame */
+   void report_latency(FILE *f)
+   {
+      fb_latency_stats_t stats;
+
+      fb_get_latency_stats(&stats);
+
+      fprintf(f, "latency.pushes %u\n", (unsigned)stats.count);
+      fprintf(f, "latency.last_ms %u\n", (unsigned)stats.last_ms);
+      fprintf(f, "latency.mean_ms %.1f\n", stats.count ? (double)stats.total_ms / stats.count : 0.0);
+      fprintf(f, "latency.worst_ms %u\n", (unsigned)stats.worst_ms);
+   }
+
+   /** Write the times each stage of the boot started and completed at, or - */
+   void report_boot(FILE *f)
+   {
+      static const char *const NAMES[BOOT_STAGES]
+      {
+         "frame", "sensors", "history", "gps", "clock", "journal"
+      };
+      boot_timeline_t timeline;
+
+      boot_get_timeline(&timeline);
+
+      for (int i = 0; i < BOOT_STAGES; ++i)
+      {
+         const boot_record_t &record = timeline.stages[i];
+
+         if (record.start == BOOT_PENDING)
+         {
+            fprintf(f, "boot.%s.start_ms -\n", NAMES[i]);
+         }
+         else
+         {
+            fprintf(f, "boot.%s.start_ms %lu\n", NAMES[i], (unsigned long)record.start);
+         }
+
+         if (record.done == BOOT_PENDING)
+         {
+            fprintf(f, "boot.%s.done_ms -\n", NAMES[i]);
+         }
+         else
+         {
+            fprintf(f, "boot.%s.done_ms %lu\n", NAMES[i], (unsigned long)record.done);
+         }
+      }
+   }
+
+   /** Write the number of entries of the journal, and the newest ones */
+   void report_journal(FILE *f)
+   {
+      uint8_t count = journal_get_count();
+      journal_entry_t entry;
+
+      fprintf(f, "journal.entries %u\n", (unsigned)count);
+
+      for (uint8_t i = count > JOURNAL_DUMP_ENTRIES ? count - JOURNAL_DUMP_ENTRIES : 0; i < count; ++i)
+      {
+         if (journal_read(i, &entry))
+         {
+            fprintf(
+               f, "journal.%u %u %u %lu\n",
+               (unsigned)entry.seq, (unsigned)entry.event, (unsigned)entry.arg,
+               (unsigned long)entry.time);
+         }
+      }
+   }
+
+   /** Event handler of the end of the run */
+   void on_end(void *)
+   {
+      sim_stop();
+   }
+}
+
+// ---------------------------------------------------------------------------
+// Entry point
+// ---------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+   const ModeEntry *pMode = nullptr;
+   sim_time_t duration = SIM_SECONDS(3600);
+   uint32_t start = 0;
+   int16_t temperature = 196;
+   uint8_t luminosity = 13;
+   std::vector<std::pair<sim_time_t, bool>> keys;
+   double speed = 0;
+   FILE *nmea = nullptr;
+   FILE *record = nullptr;
+   FILE *replay = nullptr;
+   FILE *frames = nullptr;
+   FILE *trace = nullptr;
+   FILE *report = nullptr;
+   FILE *vcd = nullptr;
+   uint32_t ratio = DEFAULT_RATIO;
+   unsigned seed = 1;
+   int opt;
+
+   parse_start(DEFAULT_START, &start);
+
+   while ((opt = getopt(argc, argv, "m:d:s:o:f:k:t:l:g:r:w:i:a:p:x:v:")) != -1)
+   {
+      switch (opt)
+      {
+      case 'm':
+         for (const ModeEntry &entry : MODES)
+         {
+            if (strcmp(entry.name, optarg) == 0)
+            {
+               pMode = &entry;
+            }
+         }
+
+         if (!pMode)
+         {
+            usage(argv[0]);
+         }
+         break;
+      case 'd':
+         if ((duration = parse_duration(optarg)) == 0)
+         {
+            usage(argv[0]);
+         }
+         break;
+      case 's':
+         if (!parse_start(optarg, &start))
+         {
+            usage(argv[0]);
+         }
+         break;
+      case 'o':
+         frames = open_output(optarg);
+         break;
+      case 'f':
+         trace = open_output(optarg);
+         break;
+      case 'k':
+         if ((optarg[0] != 's' && optarg[0] != 'l') || optarg[1] != '@')
+         {
+            usage(argv[0]);
+         }
+
+         keys.emplace_back(parse_duration(optarg + 2), optarg[0] == 'l');
+         break;
+      case 't':
+         temperature = (int16_t)atoi(optarg);
+         break;
+      case 'l':
+         luminosity = (uint8_t)atoi(optarg);
+         break;
+      case 'g':
+         nmea = open_input(optarg);
+         break;
+      case 'r':
+         seed = (unsigned)strtoul(optarg, nullptr, 0);
+         break;
+      case 'w':
+         record = open_output(optarg);
+         break;
+      case 'i':
+         replay = open_input(optarg);
+         break;
+      case 'a':
+         speed = atof(optarg);
+         break;
+      case 'p':
+         report = open_output(optarg);
+         break;
+      case 'x':
+         if ((ratio = (uint32_t)strtoul(optarg, nullptr, 0)) == 0)
+         {
+            usage(argv[0]);
+         }
+         break;
+      case 'v':
+         vcd = open_output(optarg);
+         break;
+      default:
+         usage(argv[0]);
+      }
+   }
+
+   srand(seed);
+   sim_fb_record(frames);
+
+   if (trace)
+   {
+      sim_fb_trace(trace);
+   }
+
+   if (vcd)
+   {
+      sim_pin_trace(vcd);
+   }
+
+   //
+   // Initialize the services simulated as the target does
+   //
+   alert_init();       // Allow alerts
+   governor_init();    // Run at full speed until the load is known
+   reactor_init();     // Prepare the reactor
+   rtc_init();         // Ready the RTC
+   journal_init();     // Record the cause of the reset
+   sio2host_init();    // Initialize the serial I/O library
+   timer_init();       // Ready the timer API
+   boot_init();        // Time the boot from here
+   fb_init();          // Ready the frame buffer API
+
+   // Show the first frame now
+   sequencer_init();
+
+   // Start the other services from the reactor
+   boot_run(BOOT_JOBS, COUNTOF(BOOT_JOBS));
+
+   //
+   // Apply the inputs from the start, or replay them
+   //
+   if (record)
+   {
+      sim_input_record(record);
+   }
+
+   if (replay)
+   {
+      if (!sim_input_replay(replay))
+      {
+         fprintf(stderr, "Not a trace of inputs\n");
+         return EXIT_FAILURE;
+      }
+   }
+   else
+   {
+      sim_input(SIM_INPUT_RTC, start);
+      sim_input(SIM_INPUT_TEMPERATURE, temperature);
+      sim_input(SIM_INPUT_LUMINOSITY, luminosity);
+
+      // Push the key to reach the mode
+      for (int i = 0; pMode && i < abs(pMode->pushes); ++i)
+      {
+         sim_input(SIM_INPUT_KEY, pMode->pushes < 0);
+      }
+
+      for (const auto &key : keys)
+      {
+         sim_input_at(key.first, SIM_INPUT_KEY, key.second);
+      }
+
+      if (nmea && !sim_input_feed_nmea(nmea, SIM_SECONDS(1)))
+      {
+         fprintf(stderr, "No RMC sentence to feed\n");
+         return EXIT_FAILURE;
+      }
+   }
+
+   sim_schedule(duration, on_end, nullptr);
+
+   if (speed > 0)
+   {
+      sim_pace(speed);
+   }
+
+   //
+   // Let the reactor run on the virtual clock
+   //
+   auto wallStart = std::chrono::steady_clock::now();
+
+   if (report)
+   {
+      sim_profile_start(ratio);
+   }
+
+   sim_run(reactor_run);
+
+   std::chrono::duration<double> wall = std::chrono::steady_clock::now() - wallStart;
+
+   if (report)
+   {
+      sim_profile_report(report);
+      report_sleep(report);
+      report_governor(report);
+      report_latency(report);
+      report_boot(report);
+      report_journal(report);
+   }
+
+   close_output(frames);
+   close_output(trace);
+   close_output(report);
+   close_output(vcd);
+   close_output(record);
+
+   //
+   // Summarize
+   //
+   sim_fb_stats_t stats;
+   double simulated = (double)sim_now() / SIM_SECONDS(1);
+
+   sim_fb_get_stats(&stats);
+
+   fprintf(stderr, "simulated %.3f s\n", simulated);
+   fprintf(stderr, "commits   %lu\n", (unsigned long)stats.commits);
+   fprintf(stderr, "changes   %lu\n", (unsigned long)stats.changes);
+   fprintf(stderr, "digest    %08lx\n", (unsigned long)stats.digest);
+   fprintf(stderr, "alerts    %lu\n", (unsigned long)sim_alert_count());
+   fprintf(stderr, "gps lost  %lu\n", (unsigned long)sim_sio2host_overruns());
+   fprintf(stderr, "gps bad   %lu\n", (unsigned long)sim_sio2host_framing_errors());
+   fprintf(stderr, "wall      %.3f s (x%.0f)\n", wall.count(), simulated / wall.count());
+
+   return EXIT_SUCCESS;
+}
+
+/**@} ---------------------------  End of file  --------------------------- */
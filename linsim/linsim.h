@@ -0,0 +1,247 @@
+#ifndef linsim_h_HAS_ALREADY_BEEN_INCLUDED
+#define linsim_h_HAS_ALREADY_BEEN_INCLUDED
+/**
+ * @addtogroup linsim
+ * @{
+ *****************************************************************************
+ * Headless simulator for Linux.
+ * The simulator runs the core and lib code on a virtual clock, in a single
+ *  thread. Time only moves while the reactor sleeps: the virtual clock then
+ *  jumps to the next event, such as a timer overflow, and the event is
+ *  handled as the interrupt would be.
+ * The code therefore runs in zero virtual time, and a run only depends on
+ *  its settings. A day of display is simulated in seconds.
+ * The run time follows the 1 ms tick of the timer service, each an event.
+ *  A day of a mode keeping the tick, such as Pharmacy or Metro, wakes the
+ *  reactor up 86 million times, and each wake up runs the sleep manager,
+ *  the governor and the debug pins as on the target. It takes about 8 s.
+ *****************************************************************************
+ * @file
+ * Virtual clock and hooks of the Linux simulator
+ * @author software@arreckx.com
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/************************************************************************/
+/* Virtual clock                                                        */
+/************************************************************************/
+
+/** Time on the virtual clock, in ns from the start of the simulation */
+typedef uint64_t sim_time_t;
+
+/** Virtual time in the given number of milliseconds */
+#define SIM_MILLISECONDS(x) ((sim_time_t)(x) * 1000000u)
+
+/** Virtual time in the given number of seconds */
+#define SIM_SECONDS(x) ((sim_time_t)(x) * 1000000000u)
+
+/** CPU clock of the target, undivided */
+#define SIM_CPU_HZ 32000000u
+
+/** @return The clock of the CPU and the peripherals, as divided by the code */
+uint32_t sim_cpu_hz( void );
+
+/** Called when an event is due */
+typedef void (*sim_handler_t)( void *arg );
+
+/**
+ * @def SIM_MAX_EVENTS
+ * Maximum number of events pending at once
+ */
+#ifndef SIM_MAX_EVENTS
+#  define SIM_MAX_EVENTS 32
+#endif
+
+/** @return The time on the virtual clock */
+sim_time_t sim_now( void );
+
+/** Call a handler at the given virtual time. Events due together run in order */
+void sim_schedule( sim_time_t at, sim_handler_t handler, void *arg );
+
+/** Drop the events pending with the given handler and argument */
+void sim_cancel( sim_handler_t handler, void *arg );
+
+/** Sleep the CPU: run the clock up to the next event and handle it */
+void sim_idle( void );
+
+/** Run the main loop until #sim_stop is called */
+void sim_run( void (*loop)(void) );
+
+/** Let the virtual clock run at a speed over the host clock, or 0 for full speed */
+void sim_pace( double speed );
+
+/** Stop the simulation. Called from an event handler */
+void sim_stop( void );
+
+/************************************************************************/
+/* Simulated devices                                                    */
+/************************************************************************/
+
+/** Number of I/O pins, 8 per port */
+#define SIM_NUMBER_OF_PINS 48
+
+/** Set the level of a pin */
+void sim_pin_set( uint8_t pin, bool level );
+
+/** @return The level of a pin */
+bool sim_pin_get( uint8_t pin );
+
+/** Write the changes of the debug pins to a VCD file, from now on */
+void sim_pin_trace( FILE *f );
+
+/** Raise the overflow interrupt of a timer/counter now */
+void sim_tc_overflow( volatile void *tc );
+
+/** The clock of the CPU changed from the given one */
+void sim_tc_clock( uint32_t from_hz );
+
+/** Set the time of the RTC now */
+void sim_rtc_set( uint32_t timestamp );
+
+/** Receive bytes from the GPS module, after those still being received */
+void sim_sio2host_receive( const uint8_t *pData, uint16_t length );
+
+/** @return The number of bytes from the GPS module lost so far */
+uint32_t sim_sio2host_overruns( void );
+
+/** @return The baud rate the serial port runs at, from the clock of the CPU */
+uint32_t sim_sio2host_baud( void );
+
+/** @return The number of bytes from the GPS module garbled by a wrong baud rate */
+uint32_t sim_sio2host_framing_errors( void );
+
+/** Set the temperature returned by the measurements, in 10th of degrees */
+void sim_measurement_set_temperature( int16_t temperature );
+
+/** Set the luminosity returned by the measurements, in % */
+void sim_measurement_set_luminosity( uint8_t luminosity );
+
+/** Write each frame committed to a file, or stop if 0 */
+void sim_fb_record( FILE *f );
+
+/** Start of a trace of the frames */
+#define SIM_FB_TRACE_MAGIC "PLDF"
+
+/** Version of the format of the traces of the frames */
+#define SIM_FB_TRACE_VERSION 1
+
+/** Write the changes of the frames committed to a binary trace, from now on */
+void sim_fb_trace( FILE *f );
+
+/** Frames committed so far */
+typedef struct
+{
+   /** Number of commits */
+   uint32_t commits;
+   /** Number of commits which changed the frame */
+   uint32_t changes;
+   /** Hash of the commit times and frames */
+   uint32_t digest;
+} sim_fb_stats_t;
+
+/** Get the frames committed so far */
+void sim_fb_get_stats( sim_fb_stats_t *pStats );
+
+/** @return The number of alerts raised which did not stop */
+uint32_t sim_alert_count( void );
+
+/************************************************************************/
+/* Inputs                                                               */
+/************************************************************************/
+
+/** Inputs of the firmware, as recorded */
+typedef enum
+{
+   SIM_INPUT_KEY = 1,     ///< Push on the key. 1 for a long push
+   SIM_INPUT_TEMPERATURE, ///< Temperature measured, in 10th of degrees
+   SIM_INPUT_LUMINOSITY,  ///< Luminosity measured, in %
+   SIM_INPUT_RTC,         ///< Time the RTC is set to
+   SIM_INPUT_GPS,         ///< Bytes sent by the GPS module
+   SIM_INPUT_PPS,         ///< Rising edge of the 1PPS of the GPS module
+} sim_input_type_t;
+
+/** Maximum number of bytes of a GPS input */
+#define SIM_INPUT_MAX_LENGTH 255
+
+/** Apply an input now, and record it */
+void sim_input( sim_input_type_t type, int32_t value );
+
+/** Send bytes from the GPS module now, and record them */
+void sim_input_gps( const uint8_t *pData, uint8_t length );
+
+/** Apply an input at a later time */
+void sim_input_at( sim_time_t at, sim_input_type_t type, int32_t value );
+
+/** Record the inputs applied from now to a trace */
+void sim_input_record( FILE *f );
+
+/** Replay the inputs of a trace */
+bool sim_input_replay( FILE *f );
+
+/** Feed NMEA sentences as the GPS module sends them, from a 1PPS at the given time */
+bool sim_input_feed_nmea( FILE *f, sim_time_t at );
+
+/************************************************************************/
+/* Profiling                                                            */
+/************************************************************************/
+
+/** Identifies an interrupt source to the profiler */
+typedef int8_t sim_isr_id_t;
+
+/** The profiler cannot tell the interrupt source */
+#define SIM_NO_ISR ((sim_isr_id_t)-1)
+
+/**
+ * @def SIM_MAX_ISRS
+ * Maximum number of interrupt sources profiled
+ */
+#ifndef SIM_MAX_ISRS
+#  define SIM_MAX_ISRS 8
+#endif
+
+/** Start profiling, with the time on the target for a ns on the host */
+void sim_profile_start( uint32_t ratio );
+
+/** Register an interrupt source by name */
+sim_isr_id_t sim_profile_isr( const char *name );
+
+/** An interrupt handler is called */
+void sim_profile_isr_enter( sim_isr_id_t id );
+
+/** An interrupt handler returned */
+void sim_profile_isr_exit( sim_isr_id_t id );
+
+/** The CPU goes to sleep until the next event */
+void sim_profile_sleep( void );
+
+/** The CPU wakes up for an event */
+void sim_profile_wake( void );
+
+/** The event is handled */
+void sim_profile_resume( void );
+
+/** The clock of the CPU is now divided by 1 << shift */
+void sim_profile_clock( uint8_t shift );
+
+/** @return The estimated time spent since the wake up */
+sim_time_t sim_profile_elapsed( void );
+
+/** @return The virtual time, plus the estimated time spent since the wake up */
+sim_time_t sim_profile_now( void );
+
+/** Write the profile report */
+void sim_profile_report( FILE *f );
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+#endif /* ndef linsim_h_HAS_ALREADY_BEEN_INCLUDED */
@@ -0,0 +1,27 @@
+#!/bin/sh
+#
+# Profile the interrupts and the reactor of each display mode
+# Runs linsim-prof for each mode, in a bright then a dark room, and writes
+#  one 'mode.key value' or 'mode.dark.key value' per line, sorted, to compare
+#  across commits with diff or any script:
+#
+#  ./profile.sh [duration] [ratio] > profile.txt
+#
+# The counts and rates only depend on the code. The times are estimated
+#  from the host: only compare reports made on the same host.
+#
+
+DURATION=${1:-60s}
+RATIO=${2:-750}
+PROF=$(dirname "$0")/linsim-prof
+
+if [ ! -x "$PROF" ]; then
+   echo "$PROF is missing. Run make linsim-prof" >&2
+   exit 1
+fi
+
+for MODE in metro temperature trend pharmacy demo
+do
+   "$PROF" -m $MODE -d $DURATION -x $RATIO -p - 2>/dev/null | sed "s/^/$MODE./"
+   "$PROF" -m $MODE -l 0 -d $DURATION -x $RATIO -p - 2>/dev/null | sed "s/^/$MODE.dark./"
+done | sort
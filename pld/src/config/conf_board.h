@@ -83,21 +83,21 @@
 #define DEBUG_FB           TP9
 
 /************************************************************************/
-/* Texas Tmp100 temperature sensor                                      */
+/* Sensors i2c bus                                                      */
 /************************************************************************/
 
-/** TWI device used to communicate with the tmp100 */
-#define TMP100_TWI TWIE
+/** TWI device shared by the tmp100 and the max1036 */
+#define TWI_QUEUE_TWI TWIE
 
-/** Device i2c address, with pin ADD1 tied to ground and ADD2 left floating */
-#define TMP100_I2C_ADDR 0b1001001
+/** Interrupt vector of the TWI device */
+#define TWI_QUEUE_TWIM_vect TWIE_TWIM_vect
 
 /************************************************************************/
-/* MAX1036 i2c ADC                                                      */
+/* Texas Tmp100 temperature sensor                                      */
 /************************************************************************/
 
-/** TWI device used to communicate with the tmp100 */
-#define MAX1036_TWI TWIE
+/** Device i2c address, with pin ADD1 tied to ground and ADD2 left floating */
+#define TMP100_I2C_ADDR 0b1001001
 
 /************************************************************************/
 /* Key configuration                                                    */
@@ -106,8 +106,8 @@
 /** Pin connected to the push-button */
 #define KEY_PIN      IOPORT_CREATE_PIN(PORTC, 3)
 
-/** Timer to use to sequence the key sampling */
-#define KEY_TIMER_TC TCD0
+/** Pin change interrupt of the push-button, which starts the key sampling */
+#define KEY_PIN_vect PORTC_INT0_vect
 
 /************************************************************************/
 /* GPS configuration                                                    */
@@ -0,0 +1,138 @@
+/**
+ * @addtogroup service
+ * @{
+ * @addtogroup boot
+ * @{
+ *****************************************************************************
+ * Implementation of the staged boot.
+ * The jobs are started one per dispatch of the reactor, in the order given,
+ *  as soon as the stages they wait for are done. A stage done notifies the
+ *  reactor again, so the jobs waiting for it start at once.
+ *****************************************************************************
+ * @file
+ * Implementation of the staged boot API
+ * @author software@arreckx.com
+ * @internal
+ */
+#include <stddef.h>
+
+#include "lib/alert.h"
+#include "lib/reactor.h"
+
+#include "core/boot.h"
+
+/** Maximum number of jobs, one bit each */
+#define _BOOT_MAX_JOBS 8
+
+/** Jobs to run */
+static const boot_job_t *_boot_jobs = NULL;
+
+/** Number of jobs */
+static uint8_t _boot_job_count = 0;
+
+/** Jobs started so far, one bit each */
+static uint8_t _boot_started = 0;
+
+/** Stages done so far, as a mask of #BOOT_AFTER */
+static uint8_t _boot_done = 0;
+
+/** Times of the stages */
+static boot_timeline_t _boot_timeline;
+
+/** Reactor handle */
+static reactor_handle_t _boot_reactor_handle = 0;
+
+/** Start the next job whose stages are done, and come back for the others */
+static void _boot_dispatch(void)
+{
+   uint8_t i;
+
+   for ( i=0; i<_boot_job_count; ++i )
+   {
+      const boot_job_t *pJob = &_boot_jobs[i];
+
+      if ( (_boot_started & (1 << i)) || (pJob->after & _boot_done) != pJob->after )
+      {
+         continue;
+      }
+
+      _boot_started |= 1 << i;
+      _boot_timeline.stages[pJob->stage].start = timer_get_count();
+
+      if ( pJob->start )
+      {
+         pJob->start();
+      }
+
+      reactor_notify(_boot_reactor_handle);
+
+      return;
+   }
+}
+
+/** Start the timeline. Called once the timer service is up */
+void boot_init(void)
+{
+   uint8_t i;
+
+   for ( i=0; i<BOOT_STAGES; ++i )
+   {
+      _boot_timeline.stages[i].start = BOOT_PENDING;
+      _boot_timeline.stages[i].done = BOOT_PENDING;
+   }
+
+   // The first frame is on its way from now
+   _boot_timeline.stages[boot_frame_e].start = timer_get_count();
+
+   _boot_reactor_handle = reactor_register(&_boot_dispatch);
+}
+
+/**
+ * Run the jobs from the reactor. A job starts once all the stages it waits
+ *  for are done, and the jobs ready at the same time start in order.
+ *
+ * @param pJobs The jobs, which must stay valid
+ * @param count Number of jobs
+ */
+void boot_run(const boot_job_t *pJobs, uint8_t count)
+{
+   alert_and_stop_if( count > _BOOT_MAX_JOBS );
+
+   _boot_jobs = pJobs;
+   _boot_job_count = count;
+
+   reactor_notify(_boot_reactor_handle);
+}
+
+/**
+ * Mark a stage done, and start the jobs waiting for it.
+ * Only the first call is recorded, so a service can call it each time it
+ *  reaches the stage. Called from the reactor.
+ *
+ * @param stage The stage done
+ */
+void boot_stage_done(boot_stage_t stage)
+{
+   if ( _boot_done & BOOT_AFTER(stage) )
+   {
+      return;
+   }
+
+   _boot_done |= BOOT_AFTER(stage);
+   _boot_timeline.stages[stage].done = timer_get_count();
+
+   reactor_notify(_boot_reactor_handle);
+}
+
+/**
+ * Copy the times of the stages so far.
+ *
+ * @param pTimeline Where to copy the times
+ */
+void boot_get_timeline( boot_timeline_t *pTimeline )
+{
+   *pTimeline = _boot_timeline;
+}
+
+/**@}*/
+/**@} ---------------------------  End of file  --------------------------- */
@@ -0,0 +1,110 @@
+#ifndef boot_h_HAS_ALREADY_BEEN_INCLUDED
+#define boot_h_HAS_ALREADY_BEEN_INCLUDED
+/**
+ * @addtogroup service
+ * @{
+ * @addtogroup boot
+ * @{
+ *****************************************************************************
+ * Staged boot.
+ * The main brings up the frame buffer, the key and the sequencer, so the
+ *  first frame shows at once. The slower services are then started as jobs
+ *  of the reactor, each one as soon as the stages it depends on are done,
+ *  so the display and the key are served in between.
+ * Each stage keeps the time it started and completed at, from the start of
+ *  the timer service. The timeline is read with #boot_get_timeline, from
+ *  the debugger on the target and in the report of the simulator.
+ * \n
+ * Example:
+ * @code
+ * static const boot_job_t jobs[] = {
+ *    { boot_sensors_e, &measurement_init, 0 },
+ *    { boot_history_e, &history_init, BOOT_AFTER(boot_sensors_e) },
+ * };
+ *
+ * boot_run( jobs, COUNTOF(jobs) );
+ * @endcode
+ *****************************************************************************
+ * @file
+ * Staged boot API
+ * @author software@arreckx.com
+ */
+
+#include <stdint.h>
+
+#include "lib/timer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Stages of the boot */
+typedef enum
+{
+   /** The sequencer commits its first frame */
+   boot_frame_e = 0,
+   /** The light and the temperature are read once */
+   boot_sensors_e,
+   /** The temperature history is restored */
+   boot_history_e,
+   /** The GPS is out of reset */
+   boot_gps_e,
+   /** The RTC is set from the first GPS fix */
+   boot_clock_e,
+   /** The newest entries of the journal are dumped */
+   boot_journal_e,
+   /** Number of stages */
+   BOOT_STAGES
+} boot_stage_t;
+
+/** Mask of the stages to wait for, from a stage */
+#define BOOT_AFTER(stage) (1 << (stage))
+
+/** Time of a stage not reached yet */
+#define BOOT_PENDING TIMER_NEVER
+
+/** A job of the boot */
+typedef struct
+{
+   /** Stage started by the job. The service marks it done */
+   boot_stage_t stage;
+   /** Starts the service from the reactor. Can be NULL to wait only */
+   void (*start)(void);
+   /** Stages to complete first, as a mask of #BOOT_AFTER */
+   uint8_t after;
+} boot_job_t;
+
+/** Times of a stage, in ms from the start of the timer service */
+typedef struct
+{
+   /** Time the stage started, or #BOOT_PENDING */
+   timer_count_t start;
+   /** Time the stage completed, or #BOOT_PENDING */
+   timer_count_t done;
+} boot_record_t;
+
+/** Times of all the stages */
+typedef struct
+{
+   boot_record_t stages[BOOT_STAGES];
+} boot_timeline_t;
+
+/** Start the timeline. Called once the timer service is up */
+void boot_init(void);
+
+/** Run the jobs from the reactor, each once its stages are done */
+void boot_run(const boot_job_t *pJobs, uint8_t count);
+
+/** Mark a stage done. Only the first call is recorded */
+void boot_stage_done(boot_stage_t stage);
+
+/** Get the times of the stages so far */
+void boot_get_timeline( boot_timeline_t *pTimeline );
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+/** @} */
+#endif /* ndef boot_h_HAS_ALREADY_BEEN_INCLUDED */
@@ -5,6 +5,7 @@
  * @{
  *****************************************************************************
  * Configure the various modes of the display here.
+ * The modes are listed as types, so the sequencer calls each one directly.
  *****************************************************************************
  * @file
  * Implementation of the configuration of the sequencer
@@ -13,7 +14,7 @@
  */
 
 #include "core/mode/mode.hpp"
-#include "lib/cpp.h"
+#include "lib/singleton.hpp"
 
 using namespace mode;
 
@@ -29,6 +30,7 @@ namespace mode
    class Metro;
    class Boot;
    class Temperature;
+   class Trend;
    class Pharmacy;
 }
 
@@ -36,30 +38,31 @@ namespace mode
 namespace config
 {
    /** Defines the list of modes selected by a short push on the switch */
-   IMode *short_push_sequence[]
-   {
+   typedef lib::Registry
+   <
       //
       // ADD OR SET MODES ORDER HERE
       // THE FIRST IN THE LIST WILL START IMMEDIATLY
       //
-      get_mode_ptr<Boot>(),
-      get_mode_ptr<Metro>(),
-      get_mode_ptr<Temperature>(),
-      get_mode_ptr<Pharmacy>(),
-   };
+      Boot,
+      Metro,
+      Temperature,
+      Trend,
+      Pharmacy
+   > short_push_sequence;
 
    /** @return The number of modes in the short push sequence */
-   constexpr size_t number_of_sequence = countof(short_push_sequence);
+   constexpr uint8_t number_of_sequence = short_push_sequence::count;
 
    /**
-    * @param long_push_mode
+    * @typedef long_push_mode
     * Defines the mode to enter upon a long push on the select switch 
     */
 
    //
    // SET THE LONG PUSH MODE HERE
    //
-   IMode *long_push_mode = get_mode_ptr<Demo>();
+   typedef Demo long_push_mode;
 }
 
 /**@}*/
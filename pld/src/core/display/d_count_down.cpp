@@ -16,7 +16,6 @@
 
 #include "driver/fb.h"
 #include "core/topo.h"
-#include "lib/singleton.hpp"
 #include "display.hpp"
 
 // ---------------------------------------------------------------------------
@@ -43,16 +42,16 @@ namespace
 // ---------------------------------------------------------------------------
 namespace display
 {
-   class CountDown : public lib::Singleton<IDisplay<>, CountDown>
+   class CountDown : public IDisplay<>
    {
       // Data members section
    public:
-      void reset() override
+      void reset()
       {
          // Add reset code here
       }
 
-      timer_count_t display(void *arg) override
+      timer_count_t display(void *arg)
       {
          timer_count_t period = TIMER_SECONDS(2);
 
@@ -65,8 +64,8 @@ namespace display
    };
 }
 
-/** Reserve static space for the singleton instance */
-ALLOCATE_INSTANCE(display::CountDown);
+/** Reach the display from the scratch of the displays */
+ALLOCATE_DISPLAY(display::CountDown, void *);
 
 /**@}*/
 /**@}*/
@@ -16,7 +16,6 @@
 
 #include "driver/fb.h"
 #include "core/topo.h"
-#include "lib/singleton.hpp"
 
 #include "display.hpp"
 
@@ -38,7 +37,7 @@ namespace
 // ---------------------------------------------------------------------------
 namespace display
 {
-   class Fade : public lib::Singleton<IDisplay<>, Fade>
+   class Fade : public IDisplay<>
    {
       /** On-going level */
       uint8_t level = 0;
@@ -46,7 +45,7 @@ namespace display
       /** Current stage (SM) */
       enum { brightning_e, dimming_e, pausing_e } _stage = brightning_e;
    public:
-      void reset() override
+      void reset()
       {
          // Start from 0
          level = 0;
@@ -55,7 +54,7 @@ namespace display
          _stage = brightning_e;
       }
       
-      timer_count_t display(void *arg) override
+      timer_count_t display(void *arg)
       {
          tiny_index_t i;
          timer_count_t period = TIME_FADE_NEXT_CHANGE;
@@ -117,8 +116,8 @@ namespace display
    };
 }
 
-/** Reserve static space for the singleton instance */
-ALLOCATE_INSTANCE(display::Fade);
+/** Reach the display from the scratch of the displays */
+ALLOCATE_DISPLAY(display::Fade, void *);
 
 /**@}*/
 /**@}*/
@@ -18,7 +18,6 @@
 
 #include "driver/fb.h"
 #include "core/topo.h"
-#include "lib/singleton.hpp"
 #include "display.hpp"
 
 // ---------------------------------------------------------------------------
@@ -51,16 +50,16 @@ namespace
 // ---------------------------------------------------------------------------
 namespace display
 {
-   class Fireworks : public lib::Singleton<IDisplay<>, Fireworks>
+   class Fireworks : public IDisplay<>
    {
       // Data members section
    public:
-      void reset() override
+      void reset()
       {
          // Add reset code here
       }
 
-      timer_count_t display(void *arg) override
+      timer_count_t display(void *arg)
       {
          timer_count_t period = TIMER_SECONDS(2);
 
@@ -73,8 +72,8 @@ namespace display
    };
 }
 
-/** Reserve static space for the singleton instance */
-ALLOCATE_INSTANCE(display::Fireworks);
+/** Reach the display from the scratch of the displays */
+ALLOCATE_DISPLAY(display::Fireworks, void *);
 
 /**@}*/
 /**@}*/
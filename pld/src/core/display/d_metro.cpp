@@ -16,9 +16,8 @@
 #include <stdlib.h>
 
 #include "driver/fb.h"
-#include "lib/alert.h"
+#include "lib/coroutine.hpp"
 #include "core/topo.h"
-#include "lib/singleton.hpp"
 
 #include "display.hpp"
 
@@ -45,7 +44,7 @@ namespace
 // ---------------------------------------------------------------------------
 namespace display
 {
-   class Metro : public lib::Singleton<IDisplay<>, Metro>
+   class Metro : public IDisplay<>, public lib::Coroutine
    {
       //
       // Private types
@@ -57,13 +56,6 @@ namespace display
          inter_station=0,
          wait_in_station=1
       };
-     
-	   enum class State : uint8_t
-      {
-   	   start_route,
-   	   handle_train_move,
-   	   handle_train_stop,
-	   };
       
       //
       // Data members
@@ -75,9 +67,6 @@ namespace display
       /** Index of the station within a route */
       fb_index_t station_index = 0;
       
-      /** Current state of the train within this mode */#
-      State state;
-      
       //
       // Private helpers
       //
@@ -136,104 +125,66 @@ namespace display
 
          return route;
       }
-      
-      /** 
-       * Train powers up 
-       * Turn on all LEDs of the current route
-       */
-      void start_route()
-      {
-         // Start from 0
-         station_index = 0;
-         route_id_t route = show_remaining_station();
-	
-	      // Flash current station
-	      fb_set( topo_get_led(0, route), LED_FLASH_MEDIUM, LED_LEVEL_FULL);
-      }
 
-      /** 
-       * Handle a train moving away from the station
-       * @return true if the terminus is reached
+   //
+   // Interface implementation
+   //
+   public:
+      /**
+       * Run the train along the journey, one move per step.
+       * The frame is cleared before each step, so each step shows the
+       *  remaining part of the route again.
        */
-      bool handle_train_move()
+      timer_count_t display(void *arg)
       {
-         bool retval = false;
-         route_id_t route = show_remaining_station();
-	
-	      // We've reached the terminus
-	      if ( topo_get_led(++station_index, route) == TOPO_OUT_OF_RANGE )
-	      {
+         route_id_t route;
+
+         CO_BEGIN;
+
+         for (;;)
+         {
+            // Train powers up at the first station of the route
             station_index = 0;
-            route_id_t route = journey[++route_index];
-      
-            if ( route == INVALID_ROUTE )
+            route = show_remaining_station();
+            fb_set( topo_get_led(0, route), LED_FLASH_MEDIUM, LED_LEVEL_FULL );
+            CO_DELAY( random_delay(wait_in_station) );
+
+            for (;;)
             {
-			      route_index = 0;
-		      }
-      
-            retval = true;
-	      }
-   
-         return retval;
-      }
+               // Train moves away from the station, up to the terminus
+               route = show_remaining_station();
 
-      void handle_train_stop()
-      {
-         route_id_t route = show_remaining_station();
-      
-	      // Flash current station
-	      fb_set( topo_get_led(station_index, route), LED_FLASH_MEDIUM, LED_LEVEL_FULL);
-      }
+               if ( topo_get_led(++station_index, route) == TOPO_OUT_OF_RANGE )
+               {
+                  break;
+               }
 
-   //
-   // Interface implementation
-   //
-   public:
-      /** Constructor */
-      Metro() : state(State::start_route)
-      {}
+               CO_DELAY( random_delay(inter_station) );
 
-      timer_count_t display(void *arg) override
-      {
-         timer_count_t randon_delay = 0;
-   
-	      switch ( state )
-	      {
-	      case State::start_route:
-		      start_route();
-            randon_delay = random_delay(DelayRangeType::wait_in_station);
-            state = State::handle_train_move;
-		      break;
-	      case State::handle_train_move:
-            if ( handle_train_move() )
-            {
-               randon_delay = random_delay(DelayRangeType::wait_in_station) * 4;
-               // Start a route and return 0
-               state = State::start_route;
+               // Train stops, and flashes the station
+               route = show_remaining_station();
+               fb_set( topo_get_led(station_index, route), LED_FLASH_MEDIUM, LED_LEVEL_FULL );
+               CO_DELAY( random_delay(wait_in_station) );
             }
-            else
+
+            // Terminus reached. Wait longer, and take the next route
+            station_index = 0;
+
+            if ( journey[++route_index] == INVALID_ROUTE )
             {
-               randon_delay = random_delay(DelayRangeType::inter_station);
-               state = State::handle_train_stop;
+               route_index = 0;
             }
-            break;
-	      case State::handle_train_stop:
-   	      handle_train_stop();
-            randon_delay = random_delay(DelayRangeType::wait_in_station);
-            state = State::handle_train_move;
-	         break;
-         default:
-            // Unexpected!
-            alert_and_stop();
-	      }
-      
-         return randon_delay;
+
+            CO_DELAY( random_delay(wait_in_station) * 4 );
+         }
+
+         CO_END;
       }
    };
 } // End of namespace 'display'
 
-/** Reserve static space for the singleton instance */
-ALLOCATE_INSTANCE(display::Metro);
+/** Reach the display from the scratch of the displays */
+ALLOCATE_DISPLAY(display::Metro, void *);
 
 /**@} metro */
 /**@} mode */
@@ -15,7 +15,6 @@
  */
 #include "core/topo.h"
 #include "driver/fb.h"
-#include "lib/singleton.hpp"
 #include "display.hpp"
 
 // ---------------------------------------------------------------------------
@@ -43,7 +42,7 @@ namespace
 
 namespace display
 {
-   class Snake : public lib::Singleton<IDisplay<>, Snake>
+   class Snake : public IDisplay<>
    {
       /** Index of the currently operating route */
       tiny_index_t route_index = 0;
@@ -62,7 +61,7 @@ namespace display
       fb_index_t chaser[CHASER_COUNT] = { 0 };
    
    public:
-      void reset() override
+      void reset()
       {
          // Start from 0
          route_index = station_index = 0;
@@ -75,7 +74,7 @@ namespace display
          fb_clear();
       }
       
-      timer_count_t display(void *arg) override
+      timer_count_t display(void *arg)
       {
          timer_count_t retval = chaser_period;
          fb_use(&our_fb);
@@ -159,8 +158,8 @@ namespace display
    };
 }
 
-/** Reserve static space for the singleton instance */
-ALLOCATE_INSTANCE(display::Snake);
+/** Reach the display from the scratch of the displays */
+ALLOCATE_DISPLAY(display::Snake, void *);
 
 /**@} snake*/
 /**@} core */
@@ -17,7 +17,6 @@
 #include "driver/fb.h"
 
 #include "lib/alert.h"
-#include "lib/singleton.hpp"
 
 #include "core/topo.h"
 #include "core/sequencer.h"
@@ -57,7 +56,7 @@ namespace
 // ---------------------------------------------------------------------------
 namespace display
 {
-   class Temperature : public lib::Singleton<IDisplay<int16_t>, Temperature>
+   class Temperature : public IDisplay<int16_t>
    {
       /** Offset on route where 19C is reached */
       tiny_index_t ref_station_offset;
@@ -71,7 +70,7 @@ namespace display
          tenth_station_offset(topo_get_offset(TENTH_STATION, TENTH_ROUTE))
       {}
          
-      virtual timer_count_t display( int16_t temp )
+      timer_count_t display( int16_t temp )
       {
          register tiny_index_t i;
    
@@ -146,8 +145,8 @@ namespace display
    };
 }
 
-/** Reserve static space for the singleton instance */
-ALLOCATE_INSTANCE(display::Temperature);
+/** Reach the display from the scratch of the displays */
+ALLOCATE_DISPLAY(display::Temperature, int16_t);
 
 /**@} temperature */
 /**@} mode */
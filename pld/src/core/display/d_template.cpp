@@ -21,7 +21,6 @@
 
 #include "driver/fb.h"
 #include "core/topo.h"
-#include "lib/singleton.hpp"
 #include "display.hpp"
 
 // ---------------------------------------------------------------------------
@@ -48,16 +47,16 @@ namespace
 // ---------------------------------------------------------------------------
 namespace display
 {
-   class @name@ : public lib::Singleton<IDisplay<>, @name@>
+   class @name@ : public IDisplay<>
    {
       // Data members section
    public:
-      void reset() override
+      void reset()
       {
          // Add reset code here
       }
 
-      timer_count_t display(void *arg) override
+      timer_count_t display(void *arg)
       {
          timer_count_t period = TIMER_SECONDS(2);
 
@@ -70,8 +69,8 @@ namespace display
    };
 }
 
-/** Reserve static space for the singleton instance */
-ALLOCATE_INSTANCE(display::@name@);
+/** Reach the display from the scratch of the displays */
+ALLOCATE_DISPLAY(display::@name@, void *);
 
 /**@}*/
 /**@}*/
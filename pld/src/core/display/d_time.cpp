@@ -16,7 +16,6 @@
 
 #include "driver/fb.h"
 #include "lib/tz.h"
-#include "lib/singleton.hpp"
 #include "core/topo.h"
 #include "display.hpp"
 
@@ -54,7 +53,7 @@ namespace
 // ---------------------------------------------------------------------------
 namespace display
 {
-   class Time : public lib::Singleton<IDisplay<tz_datetime_t *>, Time>
+   class Time : public IDisplay<tz_datetime_t *>
    {
       /** Offset for the tenth of a minute position */
       tiny_index_t tenth_offset;
@@ -131,7 +130,7 @@ namespace display
          }
       }
       
-      timer_count_t display(tz_datetime_t *pDate) override
+      timer_count_t display(tz_datetime_t *pDate)
       {
          showTimeMode();
          showHours(pDate->hour);
@@ -142,8 +141,8 @@ namespace display
    };
 }
 
-/** Reserve static space for the singleton instance */
-ALLOCATE_INSTANCE(display::Time);
+/** Reach the display from the scratch of the displays */
+ALLOCATE_DISPLAY(display::Time, tz_datetime_t *);
 
  /**@}*/
  /**@}*/
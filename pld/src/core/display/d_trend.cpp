@@ -0,0 +1,83 @@
+/**
+ * @addtogroup core
+ * @{
+ * @addtogroup display
+ * @{
+ * @addtogroup trend
+ * @{
+ *****************************************************************************
+ * Draws the hourly temperature trend along a route, the oldest hour on the
+ *  first station. The brighter the station, the warmer the hour.
+ * The current hour flashes.
+ *****************************************************************************
+ * @file
+ * Implementation of the temperature trend display
+ * @author software@arreckx.com
+ * @internal
+ */
+
+#include "driver/fb.h"
+
+#include "core/topo.h"
+#include "core/history.h"
+
+#include "display.hpp"
+
+// ---------------------------------------------------------------------------
+// Local constants
+// ---------------------------------------------------------------------------
+namespace
+{
+   /** Route used to show the trend */
+   const route_id_t TREND_ROUTE(A3_A4);
+
+   /** Led used to indicate the trend mode */
+   const fb_index_t MODE_LED(POISSY);
+}
+
+// ---------------------------------------------------------------------------
+// Class definition
+// ---------------------------------------------------------------------------
+namespace display
+{
+   class Trend : public IDisplay<const history_trend_t *>
+   {
+   public:
+      timer_count_t display( const history_trend_t *pTrend )
+      {
+         int16_t span = pTrend->max - pTrend->min;
+
+         // Turn on led to indicate trend mode
+         fb_set(MODE_LED, LED_FLASH_SLOW, LED_LEVEL_LOW);
+
+         for (tiny_index_t i=0; i<pTrend->count; ++i)
+         {
+            fb_index_t station = topo_get_led(i, TREND_ROUTE);
+            uint8_t level = LED_LEVEL_MED;
+
+            if ( station == TOPO_OUT_OF_RANGE )
+            {
+               continue;
+            }
+
+            // Scale from the coldest to the warmest hour
+            if ( span > 0 )
+            {
+               level = LED_LEVEL_LOW +
+                  (int32_t)(pTrend->points[i] - pTrend->min) * (LED_LEVEL_FULL - LED_LEVEL_LOW) / span;
+            }
+
+            fb_set(station, (i == pTrend->count-1) ? LED_FLASH_SLOW : LED_ON, level);
+         }
+
+         return 0;
+      }
+   };
+}
+
+/** Reach the display from the scratch of the displays */
+ALLOCATE_DISPLAY(display::Trend, const history_trend_t *);
+
+/**@} trend */
+/**@} display */
+/**@} ---------------------------  End of file  --------------------------- */
@@ -15,7 +15,6 @@
  */
 
 #include "driver/fb.h"
-#include "lib/singleton.hpp"
 #include "core/topo.h"
 #include "display.hpp"
 
@@ -46,18 +45,18 @@ namespace
 // ---------------------------------------------------------------------------
 namespace display
 {
-   class WaitForValidClock : public lib::Singleton<IDisplay<>, WaitForValidClock>
+   class WaitForValidClock : public IDisplay<>
    {
       /** Current station led for displaying no reliable clock is found */
       fb_index_t waiting_for_clock_current_led = 0;
    
    public:
-      void reset() override
+      void reset()
       {
          waiting_for_clock_current_led = _TIME_MORNING_STATION;
       }
       
-      timer_count_t display( void * arg ) override
+      timer_count_t display( void * arg )
       {
          // Turn on led to indicate time mode
          fb_set(_TIME_MODE_LED, LED_FLASH_FAST, LED_LEVEL_LOW);
@@ -85,8 +84,8 @@ namespace display
    };
 }
 
-/** Reserve static space for the singleton instance */
-ALLOCATE_INSTANCE(display::WaitForValidClock);
+/** Reach the display from the scratch of the displays */
+ALLOCATE_DISPLAY(display::WaitForValidClock, void *);
 
 /**@}*/
 /**@}*/
@@ -18,12 +18,75 @@
  * @author gax
  */
 
+#include "driver/fb.h"
 #include "lib/timer.h"
+#include "lib/scratch.hpp"
+#include "lib/singleton.hpp"
+
+/**
+ * @def DISPLAY_SCRATCH_SIZE
+ * Size of the scratch the displays share, in bytes. Fits the largest, the
+ *  snake with its own frame. Each display checks it fits at build time
+ */
+#ifndef DISPLAY_SCRATCH_SIZE
+#  define DISPLAY_SCRATCH_SIZE (sizeof(fb_mem_t) + 18)
+#endif
 
 namespace display
 {
+   //
+   // ADD DISPLAY TYPES HERE
+   //
+   class CountDown;
+   class Fade;
+   class Fireworks;
+   class Metro;
+   class Snake;
+   class Temperature;
+   class Time;
+   class Trend;
+   class WaitForValidClock;
+
+   /** All the displays, which share the scratch */
+   typedef lib::Registry
+   <
+      CountDown, Fade, Fireworks, Metro, Snake, Temperature, Time, Trend, WaitForValidClock
+   > displays;
+
+   /**
+    * Storage of the display in use. Only one is in use at once, so they all
+    *  share it rather than each keeping its state at all times.
+    */
+   typedef lib::Scratch<displays, DISPLAY_SCRATCH_SIZE> scratch;
+
+   /**
+    * @return The display D. If another display is in the scratch, D takes
+    *  its place and starts from a reset.
+    * @tparam D Class of the display
+    */
+   template <class D> D &take()
+   {
+      if ( ! scratch::holds<D>() )
+      {
+         scratch::construct<D>().reset();
+      }
+
+      return scratch::get<D>();
+   }
+
    /** 
-    * Interface for a display class
+    * Base of a display class.
+    * A display defines a public method to put the data on the display, with
+    *  optionally the data as a parameter:
+    * @code
+    * timer_count_t display(P);
+    * @endcode
+    * The other units reach it through #display::reset and #display::show,
+    *  which #ALLOCATE_DISPLAY specializes for it. The methods are called
+    *  directly, so they hide the ones of the base.
+    * The display lives in the #scratch whilst in use. It is constructed and
+    *  reset each time it is shown after another display, and must not need
+    *  a destructor.
     * @tparam P Type of data to be displayed. Defaults to void*.
     */
    template <typename P=void*> struct IDisplay
@@ -31,16 +94,59 @@ namespace display
       /** 
        * Called to reset the display internal state machine
        */
-      virtual void reset() {};
-         
-      /**
-       * Called to put the data on the display, with optionally the data
-       *  as a parameter.
-       */
-      virtual timer_count_t display(P) = 0;
+      void reset() {};
+   };
+
+   /**
+    * Reset the display D. Provided by #ALLOCATE_DISPLAY
+    * @tparam D Class of the display
+    */
+   template <class D> void reset();
+
+   /**
+    * Put the data on the display D. Provided by #ALLOCATE_DISPLAY
+    * @tparam D Class of the display
+    * @tparam P Type of data of the display
+    * @param arg The data
+    * @return Time until the next update, or 0 once done
+    */
+   template <class D, typename P=void*> timer_count_t show(P arg=P());
+
+   /** Operation of a #lib::Registry of displays, which resets the display */
+   struct Resetter
+   {
+      typedef void result_type;
+      template <class D> static void apply() { reset<D>(); }
+   };
+
+   /** Operation of a #lib::Registry of displays, which shows the display */
+   struct Displayer
+   {
+      typedef timer_count_t result_type;
+      template <class D> static timer_count_t apply() { return show<D>(); }
    };
 }
 
+/**
+ * Let the other units reset and show the display D, from the scratch.
+ * @warning This macro must be invoked outside of any namespace.
+ * @tparam D Name of the class of the display.
+ * @tparam P Type of data of the display.
+ */
+#define ALLOCATE_DISPLAY(D, P) \
+   namespace display { \
+      template<> void reset<D>() { \
+         if ( scratch::holds<D>() ) { \
+            scratch::get<D>().reset(); \
+         } else { \
+            take<D>(); \
+         } \
+      } \
+      template<> timer_count_t show<D, P>(P arg) { \
+         return take<D>().display(arg); \
+      } \
+   }
+
 /**@}*/
 /**@}*/
 #endif /* ndef core_display_display_h_HAS_ALREADY_BEEN_INCLUDED */
\ No newline at end of file
@@ -32,6 +32,9 @@
 /** Drop the RTC time if the GPS has been away for some time */
 #define RTC_VALID_FOR_PERIOD TIMER_HOURS(1)
 
+/** Time the GPS is held in reset, over 10ms as recommended by the datasheet of the L26 */
+#define GPS_RESET_PERIOD TIMER_MILLISECONDS(20)
+
 
 #include "lib/gps.h"
 
@@ -43,9 +46,13 @@ extern "C" {
 #include <math.h>
 
 #include "lib/tz.h"
+#include "lib/civil.h"
 #include "lib/timer.h"
 #include "lib/reactor.h"
+#include "lib/governor.h"
 
+#include "core/boot.h"
+#include "core/journal.h"
 #include "core/gps_manager.h"
 
 /** Local GPS object */
@@ -60,12 +67,31 @@ reactor_handle_t _gps_reactor_handle = 0;
 /** Last time the clock was valid */
 static timer_count_t _last_time_the_rtc_clock_was_valid = 0;
 
+/** True once the clock is dropped, until the next sync */
+static bool _gps_time_is_lost = false;
+
 /** Called by the timer interrupt to notify the reactor in all cases */
 static void _kick_reactor(void)
 {
    reactor_notify(_gps_reactor_handle);
 }
 
+/** Called by the timer once the GPS has been held in reset long enough */
+static void _gps_release_reset( timer_instance_t i, void *arg )
+{
+   // Back to running.
+   ioport_set_pin_high(GPS_N_RESET);
+
+   boot_stage_done(boot_gps_e);
+}
+
+/** Keep the polling rate and the baud rate as the clock changes */
+static void _on_clock_change(uint8_t shift)
+{
+   governor_scale_tc( &GPS_TIMER_TC, 1024, 3125, shift );
+   usart_set_baudrate( USART_HOST, USART_HOST_BAUDRATE, governor_get_hz() );
+}
+
 #ifdef DEBUG
 /** Helper for debugging - set the time by setting this to 1 */
 uint8_t override_time_once = 0;
@@ -83,6 +109,13 @@ void _gps_check_gps_data_age( timer_instance_t i, void *arg )
 {
    if ( timer_time_lapsed_since(_last_time_the_rtc_clock_was_valid) > RTC_VALID_FOR_PERIOD )
    {
+      // Journal the loss once, with the time last known
+      if ( ! _gps_time_is_lost )
+      {
+         journal_record(journal_gps_lost_e, 0);
+         _gps_time_is_lost = true;
+      }
+
       // Invalidate the system clock
       rtc_set_time(0);
    }
@@ -137,13 +170,13 @@ static void _gps_update(void)
                   .year=(uint16_t)year
                };
          
-               epochGps = tz_convert_to_cet( calendar_date_to_timestamp( &date ) );
-               calendar_timestamp_to_date( epochGps, &date );
+               epochGps = tz_convert_to_cet( civil_date_to_timestamp( &date ) );
+               civil_timestamp_to_date( epochGps, &date );
                
                // ************************************************************
                // Break point HERE and modify date
                // ************************************************************
-               rtc_set_time( calendar_date_to_timestamp( &date ) );
+               rtc_set_time( civil_date_to_timestamp( &date ) );
                
                ++override_time_once;
             }
@@ -170,16 +203,19 @@ static void _gps_update(void)
             };
          
             // Convert to CET (winter) epoch time
-			epochGps = calendar_date_to_timestamp( &date );
+			epochGps = civil_date_to_timestamp( &date );
 			
-			// Our GPS has missing a roll over of the week counter - adjust!
-			epochGps += (7168l * 24 * 60 * 60);
+			// Our GPS may have missed roll overs of the week counter - adjust!
+			epochGps = civil_gps_resolve_rollover( epochGps );
 			
             epochGps = tz_convert_to_cet( epochGps );
             uint32_t epochRtc = rtc_get_time();
 
+            // Signed drift, as an int is too short for a timestamp
+            int32_t drift = (int32_t)(epochGps - epochRtc);
+
             // Different?
-            if ( abs(epochGps - epochRtc) > MAX_SECONDS_DIFFERENCE_TO_UPDATE_RTC )
+            if ( labs(drift) > MAX_SECONDS_DIFFERENCE_TO_UPDATE_RTC )
             {
                // Update the RTC clock
                rtc_set_time(epochGps);
@@ -187,6 +223,8 @@ static void _gps_update(void)
 			
             // Indicate the system time has been synchronized
 			_last_time_the_rtc_clock_was_valid = timer_get_count();
+            _gps_time_is_lost = false;
+            boot_stage_done(boot_clock_e);
          }
       }         
    }
@@ -203,6 +241,8 @@ static void _gps_update(void)
  *  callback for when the buffer has data waiting to be processed.
  * Not mentioning the lack of transmit buffer...
  * So we use a timer to check the buffer on a regular basis.
+ * The GPS is held in reset for a while, so the boot stage of the GPS is
+ *  done later, and the stage of the clock at the first fix.
  */
 void gps_manager_init(void)
 {
@@ -225,20 +265,21 @@ void gps_manager_init(void)
    // Set the top to get 10Hz ( 32000000/1024/3125 )
    tc_write_period( &GPS_TIMER_TC, 3125 );
    tc_write_clock_source( &GPS_TIMER_TC, TC_CLKSEL_DIV1024_gc );
+
+   // The polling timer and the USART stop in the modes deeper than idle
+   sleepmgr_lock_mode( SLEEPMGR_IDLE );
    
    // Register with the reactor for power saving
    _gps_reactor_handle = reactor_register(&_gps_update);
+   governor_register(&_on_clock_change);
    
    // Reset the GPS to make sure it is not turned off or starting
    // We start configuring once it gets talking as this
    //  software is up and running much faster that the GPS from cold start.
    ioport_configure_pin(GPS_N_RESET, IOPORT_DIR_OUTPUT | IOPORT_INIT_LOW);
    
-   // Recommended delay >10ms from datasheet of L26
-   delay_ms(20);
-   
-   // Back to running.
-   ioport_set_pin_high(GPS_N_RESET);
+   // Release it from the timer rather than wait here
+   timer_arm_from_now( &_gps_release_reset, GPS_RESET_PERIOD, 0 );
 }
 
 void gps_configure(void)
@@ -0,0 +1,637 @@
+/**
+ * @addtogroup service
+ * @{
+ * @addtogroup history
+ * @{
+ *****************************************************************************
+ * Every minute, the filtered temperature is pushed into the minutes ring and
+ *  added to the current hour. Every hour, the hour average is pushed into the
+ *  hours ring and the hour range is stored in a small table.
+ * The range over the completed hours of the day (and over the completed days
+ *  of the week) is folded once per hour (or per day), so a query only
+ *  combines the folded range with the range of the current hour (or day).
+ * \n
+ * The checkpoint is written one EEPROM page per minute after the hour roll,
+ *  so the reactor is never held for long. The header is invalidated first and
+ *  written last, so a reset during the checkpoint loses it rather than
+ *  restoring a mix of old and new pages.
+ * The samples are not time stamped, so the time the device was off is
+ *  not accounted for on restore.
+ *****************************************************************************
+ * @file
+ * Implementation of the temperature history service
+ * @author software@arreckx.com
+ * @internal
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "lib/cpp.h"
+#include "lib/timer.h"
+#include "lib/delta_ring.h"
+
+#include "core/boot.h"
+#include "core/history.h"
+#include "core/measurements.h"
+
+/************************************************************************/
+/* Local defines                                                        */
+/************************************************************************/
+
+/**
+ * @def HISTORY_MINUTES_BUFFER_SIZE
+ * Bytes to code a day of minutes. A move of 1 takes 3 bits, so a day of a
+ *  temperature moving by 1 every minute fits. If it moves by more, the
+ *  oldest minutes are dropped, and the statistics of the day tell so.
+ */
+#ifndef HISTORY_MINUTES_BUFFER_SIZE
+#  define HISTORY_MINUTES_BUFFER_SIZE 540
+#endif
+
+/**
+ * @def HISTORY_HOURS_BUFFER_SIZE
+ * Bytes to code a week of hourly averages
+ */
+#ifndef HISTORY_HOURS_BUFFER_SIZE
+#  define HISTORY_HOURS_BUFFER_SIZE 160
+#endif
+
+/**
+ * @def HISTORY_CHECKPOINT_HOURS
+ * Hours between two checkpoints of the hourly history in EEPROM.
+ * 0 disables the checkpoint. At 6, the EEPROM endurance lasts decades.
+ */
+#ifndef HISTORY_CHECKPOINT_HOURS
+#  define HISTORY_CHECKPOINT_HOURS 6
+#endif
+
+// The simulator has no EEPROM
+#ifdef _WIN32
+#  undef HISTORY_CHECKPOINT_HOURS
+#  define HISTORY_CHECKPOINT_HOURS 0
+#endif
+
+#if HISTORY_CHECKPOINT_HOURS
+#  include <asf.h>
+#endif
+
+/** Minutes kept in the minutes ring */
+#define _HISTORY_MINUTES_PER_DAY 1440
+
+/** Minutes in an hour */
+#define _HISTORY_MINUTES_PER_HOUR 60
+
+/** Hours kept in the hours ring */
+#define _HISTORY_HOURS_PER_WEEK 168
+
+/** Hours in a day */
+#define _HISTORY_HOURS_PER_DAY 24
+
+/** Days in a week */
+#define _HISTORY_DAYS_PER_WEEK 7
+
+/** Marks a valid checkpoint */
+#define _HISTORY_MAGIC 0x4854
+
+/************************************************************************/
+/* Local types                                                          */
+/************************************************************************/
+
+/** Lowest and highest values. An empty range has min > max. */
+typedef struct
+{
+   int16_t min;
+   int16_t max;
+} _history_range_t;
+
+/** Part of the history checkpointed in EEPROM */
+typedef struct
+{
+   /** Hourly averages */
+   delta_ring_t hours;
+
+   /** Ranges of the last completed days */
+   _history_range_t days[_HISTORY_DAYS_PER_WEEK - 1];
+
+   /** Position of the oldest day */
+   uint8_t day_pos;
+
+   /** Hours completed in the current day */
+   uint8_t hour_of_day;
+
+   /** Storage for the hours ring */
+   uint8_t hour_buffer[HISTORY_HOURS_BUFFER_SIZE];
+} _history_persist_t;
+
+#if HISTORY_CHECKPOINT_HOURS
+/** Header of the checkpoint, in its own page */
+typedef struct
+{
+   /** #_HISTORY_MAGIC if valid */
+   uint16_t magic;
+
+   /** Size of the data, to reject the checkpoint of another layout */
+   uint16_t size;
+
+   /** Fletcher checksum of the data */
+   uint16_t checksum;
+} _history_header_t;
+
+/** Address of the checkpoint data */
+#define _HISTORY_EEPROM_DATA (HISTORY_EEPROM_ADDRESS + EEPROM_PAGE_SIZE)
+
+/** Number of pages of data */
+#define _HISTORY_EEPROM_PAGES \
+   ((sizeof(_history_persist_t) + EEPROM_PAGE_SIZE - 1) / EEPROM_PAGE_SIZE)
+
+_Static_assert(
+   HISTORY_EEPROM_ADDRESS % EEPROM_PAGE_SIZE == 0,
+   "The history checkpoint must be page aligned" );
+
+_Static_assert(
+   (_HISTORY_EEPROM_PAGES + 1) * EEPROM_PAGE_SIZE <= HISTORY_EEPROM_SIZE,
+   "The history checkpoint does not fit in HISTORY_EEPROM_SIZE" );
+
+_Static_assert(
+   _HISTORY_EEPROM_PAGES + 2 < _HISTORY_MINUTES_PER_HOUR,
+   "The history checkpoint cannot be written within the hour" );
+#endif
+
+/************************************************************************/
+/* Local variables                                                      */
+/************************************************************************/
+
+/** Storage for the minutes ring */
+static uint8_t _history_minute_buffer[HISTORY_MINUTES_BUFFER_SIZE];
+
+/** Samples of the last day */
+static delta_ring_t _history_minutes;
+
+/** Checkpointed part of the history */
+static _history_persist_t _history;
+
+/** Ranges of the last completed hours */
+static _history_range_t _history_hour_ranges[_HISTORY_HOURS_PER_DAY - 1];
+
+/** Position of the oldest hour range */
+static uint8_t _history_hour_pos = 0;
+
+/** Range of the current hour */
+static _history_range_t _history_hour;
+
+/** Sum of the samples of the current hour */
+static int32_t _history_hour_sum = 0;
+
+/** Minutes sampled in the current hour */
+static uint8_t _history_minute_of_hour = 0;
+
+/** Range of the current day */
+static _history_range_t _history_today;
+
+/** Range of all the completed hours of the last day */
+static _history_range_t _history_day_fold;
+
+/** Range of all the completed days of the last week */
+static _history_range_t _history_week_fold;
+
+/** Time of the next sample */
+static timer_count_t _history_next;
+
+#if HISTORY_CHECKPOINT_HOURS
+/** Hours left before the next checkpoint */
+static uint8_t _history_hours_to_checkpoint = HISTORY_CHECKPOINT_HOURS;
+
+/** Next step of the checkpoint on going. 0 if none. */
+static uint8_t _history_checkpoint_step = 0;
+
+/** Header written at the end of the checkpoint */
+static _history_header_t _history_header;
+#endif
+
+/************************************************************************/
+/* Local functions                                                      */
+/************************************************************************/
+
+/** Make a range empty */
+static inline void _history_range_clear( _history_range_t *pRange )
+{
+   pRange->min = INT16_MAX;
+   pRange->max = INT16_MIN;
+}
+
+/** Extend a range to include a value */
+static inline void _history_range_add( _history_range_t *pRange, int16_t value )
+{
+   if ( value < pRange->min )
+   {
+      pRange->min = value;
+   }
+
+   if ( value > pRange->max )
+   {
+      pRange->max = value;
+   }
+}
+
+/** @return true if the range holds no value */
+static inline bool _history_range_is_empty( const _history_range_t *pRange )
+{
+   return pRange->min > pRange->max;
+}
+
+/** Extend a range to include another range */
+static inline void _history_range_merge( _history_range_t *pRange, const _history_range_t *pOther )
+{
+   if ( ! _history_range_is_empty(pOther) )
+   {
+      _history_range_add( pRange, pOther->min );
+      _history_range_add( pRange, pOther->max );
+   }
+}
+
+/** @return A range covering all the ranges of a table */
+static _history_range_t _history_range_fold( const _history_range_t *pRanges, uint8_t count )
+{
+   _history_range_t fold;
+
+   _history_range_clear( &fold );
+
+   while ( count-- )
+   {
+      _history_range_merge( &fold, pRanges++ );
+   }
+
+   return fold;
+}
+
+#if HISTORY_CHECKPOINT_HOURS
+/** @return The Fletcher-16 checksum of a buffer */
+static uint16_t _history_checksum( const uint8_t *p, uint16_t length )
+{
+   uint16_t sum1 = 0;
+   uint16_t sum2 = 0;
+
+   while ( length-- )
+   {
+      sum1 = (sum1 + *p++) % 255;
+      sum2 = (sum2 + sum1) % 255;
+   }
+
+   return (sum2 << 8) | sum1;
+}
+
+/**
+ * Erase and write a page of the checkpoint, with the interrupts off from
+ *  the load of the page buffer to the start of the write, so the journal
+ *  cannot take the buffer over from an interrupt in between.
+ *
+ * @param address Address in EEPROM, within a page
+ * @param p Bytes to write
+ * @param length Number of bytes, up to the end of the page
+ */
+static void _history_write_page( eeprom_addr_t address, const void *p, uint16_t length )
+{
+   irqflags_t flags;
+
+   // Wait for the page operation on-going with the interrupts on. One the
+   //  journal starts in between is waited for with the interrupts off
+   nvm_wait_until_ready();
+
+   flags = cpu_irq_save();
+   nvm_eeprom_erase_and_write_buffer( address, p, length );
+   cpu_irq_restore( flags );
+}
+
+/**
+ * Write the next step of the checkpoint: the invalid header first, then one
+ *  page of data per call, then the valid header.
+ */
+static void _history_checkpoint_continue( void )
+{
+   uint8_t page = _history_checkpoint_step - 2;
+
+   if ( _history_checkpoint_step == 1 )
+   {
+      _history_header_t invalid = { 0 };
+
+      _history_write_page( HISTORY_EEPROM_ADDRESS, &invalid, sizeof(invalid) );
+   }
+   else if ( page < _HISTORY_EEPROM_PAGES )
+   {
+      uint16_t offset = page * EEPROM_PAGE_SIZE;
+      uint16_t length = sizeof(_history) - offset;
+
+      if ( length > EEPROM_PAGE_SIZE )
+      {
+         length = EEPROM_PAGE_SIZE;
+      }
+
+      _history_write_page(
+         _HISTORY_EEPROM_DATA + offset, (const uint8_t *)&_history + offset, length );
+   }
+   else
+   {
+      _history_write_page(
+         HISTORY_EEPROM_ADDRESS, &_history_header, sizeof(_history_header) );
+
+      _history_checkpoint_step = 0;
+
+      return;
+   }
+
+   ++_history_checkpoint_step;
+}
+
+/** @return true if a valid checkpoint was restored */
+static bool _history_restore( void )
+{
+   _history_header_t header;
+
+   nvm_eeprom_read_buffer( HISTORY_EEPROM_ADDRESS, &header, sizeof(header) );
+
+   if ( header.magic != _HISTORY_MAGIC || header.size != sizeof(_history) )
+   {
+      return false;
+   }
+
+   nvm_eeprom_read_buffer( _HISTORY_EEPROM_DATA, &_history, sizeof(_history) );
+
+   if ( _history_checksum((const uint8_t *)&_history, sizeof(_history)) != header.checksum )
+   {
+      return false;
+   }
+
+   // The buffer address may differ from the firmware which saved it
+   _history.hours.buffer = _history.hour_buffer;
+
+   return true;
+}
+#endif
+
+/** Start a new day, keeping the range of the day completed */
+static void _history_roll_day( void )
+{
+   _history.days[_history.day_pos] = _history_today;
+
+   if ( ++_history.day_pos == COUNTOF(_history.days) )
+   {
+      _history.day_pos = 0;
+   }
+
+   _history_week_fold = _history_range_fold( _history.days, COUNTOF(_history.days) );
+
+   _history_range_clear( &_history_today );
+   _history.hour_of_day = 0;
+}
+
+/** Start a new hour, keeping the average and range of the hour completed */
+static void _history_roll_hour( void )
+{
+   delta_ring_push( &_history.hours, (int16_t)(_history_hour_sum / _HISTORY_MINUTES_PER_HOUR) );
+
+   _history_hour_ranges[_history_hour_pos] = _history_hour;
+
+   if ( ++_history_hour_pos == COUNTOF(_history_hour_ranges) )
+   {
+      _history_hour_pos = 0;
+   }
+
+   _history_day_fold = _history_range_fold( _history_hour_ranges, COUNTOF(_history_hour_ranges) );
+
+   _history_range_clear( &_history_hour );
+   _history_hour_sum = 0;
+   _history_minute_of_hour = 0;
+
+   if ( ++_history.hour_of_day == _HISTORY_HOURS_PER_DAY )
+   {
+      _history_roll_day();
+   }
+
+#if HISTORY_CHECKPOINT_HOURS
+   if ( --_history_hours_to_checkpoint == 0 )
+   {
+      _history_hours_to_checkpoint = HISTORY_CHECKPOINT_HOURS;
+
+      // The checkpointed data only changes on the hour
+      _history_header.magic    = _HISTORY_MAGIC;
+      _history_header.size     = sizeof(_history);
+      _history_header.checksum =
+         _history_checksum( (const uint8_t *)&_history, sizeof(_history) );
+
+      _history_checkpoint_step = 1;
+   }
+#endif
+}
+
+/** Called every minute to sample the temperature */
+static void _history_on_minute( timer_instance_t ti, void *arg )
+{
+   int16_t value = measurement_get_temperature();
+
+   delta_ring_push( &_history_minutes, value );
+
+   _history_range_add( &_history_hour, value );
+   _history_range_add( &_history_today, value );
+   _history_hour_sum += value;
+
+   if ( ++_history_minute_of_hour == _HISTORY_MINUTES_PER_HOUR )
+   {
+      _history_roll_hour();
+   }
+
+#if HISTORY_CHECKPOINT_HOURS
+   if ( _history_checkpoint_step )
+   {
+      _history_checkpoint_continue();
+   }
+#endif
+
+   // Re-arm from the previous due time so the period does not drift
+   _history_next += TIMER_MINUTES(1);
+   timer_arm( _history_on_minute, _history_next, NULL );
+}
+
+/** Add a point to a trend */
+static void _history_trend_add( history_trend_t *pTrend, int16_t value )
+{
+   if ( pTrend->count == 0 || value < pTrend->min )
+   {
+      pTrend->min = value;
+   }
+
+   if ( pTrend->count == 0 || value > pTrend->max )
+   {
+      pTrend->max = value;
+   }
+
+   pTrend->points[pTrend->count++] = value;
+}
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/**
+ * Restore the hourly history from the checkpoint if valid, and sample the
+ *  temperature in a minute.
+ * The measurement service must be initialised first, and is best read
+ *  once, so the boot starts it after the stage of the sensors.
+ */
+void history_init( void )
+{
+   bool restored = false;
+
+#if HISTORY_CHECKPOINT_HOURS
+   restored = _history_restore();
+#endif
+
+   if ( ! restored )
+   {
+      memset( &_history, 0, sizeof(_history) );
+      delta_ring_init(
+         &_history.hours, _history.hour_buffer, sizeof(_history.hour_buffer), _HISTORY_HOURS_PER_WEEK );
+
+      for ( uint8_t i=0; i<COUNTOF(_history.days); ++i )
+      {
+         _history_range_clear( &_history.days[i] );
+      }
+   }
+
+   delta_ring_init(
+      &_history_minutes, _history_minute_buffer, sizeof(_history_minute_buffer), _HISTORY_MINUTES_PER_DAY );
+
+   for ( uint8_t i=0; i<COUNTOF(_history_hour_ranges); ++i )
+   {
+      _history_range_clear( &_history_hour_ranges[i] );
+   }
+
+   _history_range_clear( &_history_hour );
+   _history_range_clear( &_history_today );
+   _history_range_clear( &_history_day_fold );
+   _history_hour_pos = 0;
+   _history_hour_sum = 0;
+   _history_minute_of_hour = 0;
+   _history_week_fold = _history_range_fold( _history.days, COUNTOF(_history.days) );
+
+   _history_next = timer_get_count_from_now( TIMER_MINUTES(1) );
+   timer_arm( _history_on_minute, _history_next, NULL );
+
+   boot_stage_done( boot_history_e );
+}
+
+/**
+ * Get the minimum, maximum and average over the last day.
+ * The average is over the last 24 hours of minutes held, fewer once the
+ *  temperature moved too much to keep them all. The range is over the last
+ *  23 completed hours and the current hour.
+ *
+ * @param pStats Receives the statistics
+ * @return false if no sample was taken yet
+ */
+bool history_get_day( history_stats_t *pStats )
+{
+   _history_range_t range = _history_day_fold;
+
+   if ( delta_ring_count(&_history_minutes) == 0 )
+   {
+      return false;
+   }
+
+   _history_range_merge( &range, &_history_hour );
+
+   if ( _history_range_is_empty(&range) )
+   {
+      return false;
+   }
+
+   pStats->min = range.min;
+   pStats->max = range.max;
+   pStats->avg = delta_ring_average( &_history_minutes );
+   pStats->minutes = delta_ring_count( &_history_minutes );
+
+   return true;
+}
+
+/**
+ * Get the minimum, maximum and average over the last week.
+ * The range is over the last 6 completed days and the current day.
+ * The average weights the hours held and the current hour by their minutes.
+ *
+ * @param pStats Receives the statistics
+ * @return false if no sample was taken yet
+ */
+bool history_get_week( history_stats_t *pStats )
+{
+   _history_range_t range = _history_week_fold;
+   uint16_t count = delta_ring_count( &_history.hours );
+   int32_t minutes = (int32_t)count * _HISTORY_MINUTES_PER_HOUR + _history_minute_of_hour;
+
+   if ( minutes == 0 )
+   {
+      return false;
+   }
+
+   _history_range_merge( &range, &_history_today );
+
+   if ( _history_range_is_empty(&range) )
+   {
+      return false;
+   }
+
+   pStats->min = range.min;
+   pStats->max = range.max;
+   pStats->avg = (int16_t)(
+      (_history.hours.sum * _HISTORY_MINUTES_PER_HOUR + _history_hour_sum) / minutes );
+   pStats->minutes = (uint16_t)minutes;
+
+   return true;
+}
+
+/**
+ * Get the last hourly averages, and the average of the current hour so far.
+ * This decodes the hours ring, so it takes a time proportional to a week.
+ *
+ * @param pTrend Receives the points
+ */
+void history_get_trend( history_trend_t *pTrend )
+{
+   delta_ring_iter_t iter;
+   int16_t value;
+   uint8_t points = HISTORY_TREND_POINTS;
+   uint16_t skip = delta_ring_count( &_history.hours );
+
+   pTrend->count = 0;
+   pTrend->min = pTrend->max = 0;
+
+   // Leave room for the current hour
+   if ( _history_minute_of_hour )
+   {
+      --points;
+   }
+
+   skip = ( skip > points ) ? skip - points : 0;
+
+   delta_ring_iter_init( &iter, &_history.hours );
+
+   while ( delta_ring_iter_next(&iter, &value) )
+   {
+      if ( skip )
+      {
+         --skip;
+      }
+      else
+      {
+         _history_trend_add( pTrend, value );
+      }
+   }
+
+   if ( _history_minute_of_hour )
+   {
+      _history_trend_add( pTrend, (int16_t)(_history_hour_sum / _history_minute_of_hour) );
+   }
+}
+
+/**@} history */
+/**@} service */
+/*---------------------------  End of file  --------------------------- */
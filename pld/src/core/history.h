@@ -0,0 +1,126 @@
+#ifndef history_h_HAS_ALREADY_BEEN_INCLUDED
+#define history_h_HAS_ALREADY_BEEN_INCLUDED
+/**
+ * @addtogroup service
+ * @{
+ * @addtogroup history
+ * @{
+ *****************************************************************************
+ * Keeps the history of the temperature in a fixed amount of memory.
+ * The filtered temperature is sampled every minute and kept for 24 hours.
+ * The hourly averages are kept for a week.
+ * Both are delta coded (see [delta ring](group__delta__ring.html)) so a day
+ *  of minutes and a week of hours fit in a few hundred bytes. A temperature
+ *  moving too much to keep a day of minutes is reported by the statistics.
+ * \n
+ * The minimum, maximum and average over the last day and week are
+ *  maintained as the samples come in, so all queries take a constant time.
+ * \n
+ * The hourly history can be checkpointed in EEPROM every few hours (see
+ *  #HISTORY_CHECKPOINT_HOURS), and is restored on power up.
+ * \n
+ * Example:
+ * @code
+ * history_stats_t today;
+ *
+ * if ( history_get_day(&today) )
+ * {
+ *    printf( "%d..%d\n", today.min, today.max );
+ * }
+ * @endcode
+ *****************************************************************************
+ * @file
+ * Temperature history service API
+ * @author software@arreckx.com
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/************************************************************************/
+/* Public constants                                                     */
+/************************************************************************/
+
+/**
+ * @def HISTORY_TREND_POINTS
+ * Number of hourly points in a trend. The last point is the current hour.
+ */
+#ifndef HISTORY_TREND_POINTS
+#  define HISTORY_TREND_POINTS 24
+#endif
+
+/**
+ * @def HISTORY_EEPROM_ADDRESS
+ * Page aligned address of the checkpoint in EEPROM
+ */
+#ifndef HISTORY_EEPROM_ADDRESS
+#  define HISTORY_EEPROM_ADDRESS 0
+#endif
+
+/**
+ * @def HISTORY_EEPROM_SIZE
+ * Bytes of EEPROM kept for the checkpoint, its header page included. The
+ *  journal must start past them.
+ */
+#ifndef HISTORY_EEPROM_SIZE
+#  define HISTORY_EEPROM_SIZE 256
+#endif
+
+/************************************************************************/
+/* Public types                                                         */
+/************************************************************************/
+
+/** Statistics over a period, in 10th of degrees */
+typedef struct
+{
+   int16_t min;
+   int16_t max;
+   int16_t avg;
+
+   /** Minutes the average is over. Short of the period if some were dropped */
+   uint16_t minutes;
+} history_stats_t;
+
+/** Hourly averages over the last hours, in 10th of degrees */
+typedef struct
+{
+   /** Number of points, from 0 to #HISTORY_TREND_POINTS */
+   uint8_t count;
+
+   /** Lowest point */
+   int16_t min;
+
+   /** Highest point */
+   int16_t max;
+
+   /** Points from the oldest to the current hour */
+   int16_t points[HISTORY_TREND_POINTS];
+} history_trend_t;
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/** Restore the checkpoint if any, and start sampling */
+void history_init( void );
+
+/** Get the statistics over the last 24 hours. @return false if no sample yet */
+bool history_get_day( history_stats_t *pStats );
+
+/** Get the statistics over the last 7 days. @return false if no sample yet */
+bool history_get_week( history_stats_t *pStats );
+
+/** Get the hourly averages over the last hours */
+void history_get_trend( history_trend_t *pTrend );
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@} history */
+/**@} service */
+#endif /* ndef history_h_HAS_ALREADY_BEEN_INCLUDED */
@@ -0,0 +1,339 @@
+/**
+ * @addtogroup service
+ * @{
+ * @addtogroup journal
+ * @{
+ *****************************************************************************
+ * Implementation of the event journal.
+ * The ring is a table of slots of 8 bytes, so a page holds a whole number
+ *  of entries. The sequence of an entry follows the one of the previous
+ *  slot, so the newest entry is the one the next slot does not follow. An
+ *  erased slot reads 0xFF, and the sequence wraps at 255 to never take this
+ *  value. With less than 255 slots, the break is unique.
+ * On the XMEGA, an erase and write of a page only affects the bytes loaded
+ *  in the page buffer, so an entry is written without reading back, nor
+ *  touching, the other entries of its page.
+ * A reset during the write can leave the slot erased, which looks like a
+ *  ring not full yet, and the entries before it are kept.
+ * The page buffer is shared with the checkpoint of the history, which loads
+ *  and writes each of its pages with the interrupts off. An entry recorded
+ *  from an interrupt never finds the buffer half loaded.
+ * An alert is journaled the first time its line raises it in a boot only,
+ *  from a table of the lines in RAM. An alert raised in a loop, such as the
+ *  timer service out of slots, costs one page write rather than one each
+ *  time, which would hold the interrupts off for ms and wear the ring out.
+ *****************************************************************************
+ * @file
+ * Implementation of the event journal API
+ * @author software@arreckx.com
+ * @internal
+ */
+#include <asf.h>
+#include <stdio.h>
+
+#include "lib/timer.h"
+
+#include "core/boot.h"
+#include "core/history.h"
+#include "core/journal.h"
+
+/************************************************************************/
+/* Local defines                                                        */
+/************************************************************************/
+
+/**
+ * @def JOURNAL_EEPROM_ADDRESS
+ * Address of the ring in EEPROM, at its end by default
+ */
+#ifndef JOURNAL_EEPROM_ADDRESS
+#  define JOURNAL_EEPROM_ADDRESS (EEPROM_SIZE - JOURNAL_ENTRIES * sizeof(journal_entry_t))
+#endif
+
+/**
+ * @def JOURNAL_DUMP_PERIOD
+ * Time between two entries dumped at boot. Each one holds the reactor for
+ *  the time to send it at the baud rate of the UART
+ */
+#ifndef JOURNAL_DUMP_PERIOD
+#  define JOURNAL_DUMP_PERIOD TIMER_MILLISECONDS(100)
+#endif
+
+/** Sequence of an erased slot */
+#define _JOURNAL_ERASED 0xFF
+
+/** Number of sequences, so the sequence never reads as erased */
+#define _JOURNAL_SEQUENCES 255
+
+_Static_assert(
+   JOURNAL_ENTRIES < _JOURNAL_SEQUENCES,
+   "The sequence cannot tell the newest entry" );
+
+_Static_assert(
+   sizeof(journal_entry_t) == 8 && EEPROM_PAGE_SIZE % sizeof(journal_entry_t) == 0,
+   "An entry must not straddle two pages" );
+
+_Static_assert(
+   JOURNAL_EEPROM_ADDRESS % sizeof(journal_entry_t) == 0,
+   "The journal must be aligned on its entries" );
+
+_Static_assert(
+   HISTORY_EEPROM_ADDRESS + HISTORY_EEPROM_SIZE <= JOURNAL_EEPROM_ADDRESS,
+   "The journal overlaps the checkpoint of the history" );
+
+/************************************************************************/
+/* Local variables                                                      */
+/************************************************************************/
+
+/** True once the newest entry is known */
+static bool _journal_is_scanned = false;
+
+/** Slot of the next entry */
+static uint8_t _journal_next = 0;
+
+/** Sequence of the next entry */
+static uint8_t _journal_seq = 0;
+
+/** Number of entries kept */
+static uint8_t _journal_count = 0;
+
+/** Next entry to dump, from the oldest */
+static uint8_t _journal_dump_index = 0;
+
+/** Lines of the alerts journaled since the boot */
+static uint16_t _journal_alert_lines[JOURNAL_ALERT_LINES];
+
+/** Number of lines of the alerts journaled */
+static uint8_t _journal_alert_line_count = 0;
+
+/************************************************************************/
+/* Local functions                                                      */
+/************************************************************************/
+
+/** @return The address of a slot in EEPROM */
+static eeprom_addr_t _journal_address( uint8_t slot )
+{
+   return JOURNAL_EEPROM_ADDRESS + slot * sizeof(journal_entry_t);
+}
+
+/** @return The sequence of the entry of a slot, or #_JOURNAL_ERASED */
+static uint8_t _journal_read_seq( uint8_t slot )
+{
+   return nvm_eeprom_read_byte( _journal_address(slot) );
+}
+
+/** Find the newest entry. Reads 2 bytes per slot with the mapped EEPROM */
+static void _journal_scan( void )
+{
+   uint8_t slot;
+
+   for ( slot=0; slot<JOURNAL_ENTRIES; ++slot )
+   {
+      uint8_t seq = _journal_read_seq( slot );
+
+      if ( seq == _JOURNAL_ERASED )
+      {
+         continue;
+      }
+
+      ++_journal_count;
+
+      if ( _journal_read_seq((slot + 1) % JOURNAL_ENTRIES) != (seq + 1) % _JOURNAL_SEQUENCES )
+      {
+         _journal_next = (slot + 1) % JOURNAL_ENTRIES;
+         _journal_seq = (seq + 1) % _JOURNAL_SEQUENCES;
+      }
+   }
+
+   _journal_is_scanned = true;
+}
+
+/** Dump the next entry, and come back for the others */
+static void _journal_dump_next( timer_instance_t ti, void *arg )
+{
+   journal_entry_t entry;
+   char sentence[40];
+   uint8_t checksum = 0;
+   char *p;
+
+   while ( _journal_dump_index < _journal_count )
+   {
+      if ( journal_read(_journal_dump_index++, &entry) )
+      {
+         snprintf_P(
+            sentence, sizeof(sentence), PSTR("PPLDJ,%u,%u,%u,%lu"),
+            entry.seq, entry.event, entry.arg, (unsigned long)entry.time );
+
+         for ( p=sentence; *p; ++p )
+         {
+            checksum ^= *p;
+         }
+
+         printf_P( PSTR("$%s*%02X\r\n"), sentence, checksum );
+
+         timer_arm_from_now( &_journal_dump_next, JOURNAL_DUMP_PERIOD, NULL );
+
+         return;
+      }
+   }
+
+   boot_stage_done( boot_journal_e );
+}
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/**
+ * Find the newest entry, and record the cause of the reset.
+ * The RTC must be ready.
+ */
+void journal_init( void )
+{
+   reset_cause_t causes = reset_cause_get_causes();
+
+   if ( causes & CHIP_RESET_CAUSE_WDT )
+   {
+      journal_record( journal_watchdog_e, causes );
+   }
+   else if ( causes & CHIP_RESET_CAUSE_BOD_IO )
+   {
+      journal_record( journal_brownout_e, causes );
+   }
+   else
+   {
+      journal_record( journal_reset_e, causes );
+   }
+
+   reset_cause_clear_causes( causes );
+}
+
+/**
+ * Append an entry, overwriting the oldest once the ring is full.
+ * Waits for the page operation on-going, if any, and starts the write of
+ *  the entry, which completes in the background. Can be called before
+ *  #journal_init, and from an interrupt.
+ *
+ * @param event The event
+ * @param arg Argument of the event
+ */
+void journal_record( journal_event_t event, uint16_t arg )
+{
+   irqflags_t flags = cpu_irq_save();
+   journal_entry_t entry;
+   eeprom_addr_t address;
+   uint8_t i;
+
+   if ( ! _journal_is_scanned )
+   {
+      _journal_scan();
+   }
+
+   entry.seq = _journal_seq;
+   entry.event = event;
+   entry.arg = arg;
+   entry.time = rtc_get_time();
+
+   address = _journal_address( _journal_next );
+
+   nvm_eeprom_flush_buffer();
+
+   for ( i=0; i<sizeof(entry); ++i )
+   {
+      nvm_eeprom_load_byte_to_buffer( (address + i) % EEPROM_PAGE_SIZE, ((const uint8_t *)&entry)[i] );
+   }
+
+   nvm_eeprom_atomic_write_page( address / EEPROM_PAGE_SIZE );
+
+   _journal_next = (_journal_next + 1) % JOURNAL_ENTRIES;
+   _journal_seq = (_journal_seq + 1) % _JOURNAL_SEQUENCES;
+
+   if ( _journal_count < JOURNAL_ENTRIES )
+   {
+      ++_journal_count;
+   }
+
+   cpu_irq_restore( flags );
+}
+
+/**
+ * Journal an alert, unless its line was journaled already in this boot.
+ * An alert which stops is always journaled. Can be called from an interrupt.
+ *
+ * @param doAbort true if the alert stops the CPU
+ * @param line Line of the alert
+ */
+void journal_record_alert( bool doAbort, uint16_t line )
+{
+   irqflags_t flags = cpu_irq_save();
+   uint8_t i;
+
+   if ( ! doAbort )
+   {
+      for ( i=0; i<_journal_alert_line_count; ++i )
+      {
+         if ( _journal_alert_lines[i] == line )
+         {
+            cpu_irq_restore( flags );
+            return;
+         }
+      }
+
+      if ( _journal_alert_line_count == JOURNAL_ALERT_LINES )
+      {
+         cpu_irq_restore( flags );
+         return;
+      }
+
+      _journal_alert_lines[_journal_alert_line_count++] = line;
+   }
+
+   journal_record( doAbort ? journal_fatal_e : journal_alert_e, line );
+
+   cpu_irq_restore( flags );
+}
+
+/** @return The number of entries kept */
+uint8_t journal_get_count( void )
+{
+   return _journal_count;
+}
+
+/**
+ * Read an entry.
+ *
+ * @param index Index of the entry, from the oldest
+ * @param pEntry Where to read the entry
+ * @return false if the entry is not kept, or erased
+ */
+bool journal_read( uint8_t index, journal_entry_t *pEntry )
+{
+   uint8_t slot;
+
+   if ( index >= _journal_count )
+   {
+      return false;
+   }
+
+   slot = (_journal_next + JOURNAL_ENTRIES - _journal_count + index) % JOURNAL_ENTRIES;
+   nvm_eeprom_read_buffer( _journal_address(slot), pEntry, sizeof(*pEntry) );
+
+   return pEntry->seq != _JOURNAL_ERASED;
+}
+
+/**
+ * Dump the newest #JOURNAL_DUMP_ENTRIES entries over the UART, from the
+ *  oldest, one every #JOURNAL_DUMP_PERIOD. The stage of the journal is
+ *  done once dumped.
+ */
+void journal_dump( void )
+{
+   if ( _journal_count > JOURNAL_DUMP_ENTRIES )
+   {
+      _journal_dump_index = _journal_count - JOURNAL_DUMP_ENTRIES;
+   }
+
+   _journal_dump_next( TIMER_INVALID_INSTANCE, NULL );
+}
+
+/**@}*/
+/**@} ---------------------------  End of file  --------------------------- */
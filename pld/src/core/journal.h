@@ -0,0 +1,123 @@
+#ifndef journal_h_HAS_ALREADY_BEEN_INCLUDED
+#define journal_h_HAS_ALREADY_BEEN_INCLUDED
+/**
+ * @addtogroup service
+ * @{
+ * @addtogroup journal
+ * @{
+ *****************************************************************************
+ * Journal of the events which matter in the field, kept in EEPROM through
+ *  the resets: the alerts, the cause of each reset, such as the watchdog or
+ *  a brownout, and the losses of the GPS time.
+ * The entries are appended to a ring at the end of the EEPROM, away from
+ *  the checkpoint of the history at its start. Each entry goes to the next
+ *  slot, so all the slots wear evenly, and the oldest entries are
+ *  overwritten once the ring is full.
+ * An entry is loaded into the page buffer of the NVM and written with a
+ *  single erase and write of its page, so recording takes the time of one
+ *  page operation at most, plus the one on-going. It is safe from an
+ *  interrupt or before a reset by the watchdog.
+ * The alerts are journaled once per line in a boot, so a storm of alerts
+ *  does not hold the interrupts off nor wear the EEPROM.
+ * \n
+ * At boot, the ring is scanned for the newest entry and the cause of the
+ *  reset is recorded. The newest entries are then dumped over the UART by a
+ *  job of the boot, as proprietary NMEA sentences the GPS ignores:
+ * @code
+ * $PPLDJ,<sequence>,<event>,<argument>,<time>*<checksum>
+ * @endcode
+ *****************************************************************************
+ * @file
+ * Event journal API
+ * @author software@arreckx.com
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @def JOURNAL_ENTRIES
+ * Number of entries kept. Below 255 for the sequence to tell the newest
+ */
+#ifndef JOURNAL_ENTRIES
+   #define JOURNAL_ENTRIES 128
+#endif
+
+/**
+ * @def JOURNAL_DUMP_ENTRIES
+ * Number of the newest entries dumped over the UART at boot
+ */
+#ifndef JOURNAL_DUMP_ENTRIES
+   #define JOURNAL_DUMP_ENTRIES 16
+#endif
+
+/**
+ * @def JOURNAL_ALERT_LINES
+ * Number of lines of the alerts journaled in a boot. The alerts raised from
+ *  more lines are not journaled
+ */
+#ifndef JOURNAL_ALERT_LINES
+   #define JOURNAL_ALERT_LINES 8
+#endif
+
+/** Events journaled */
+typedef enum
+{
+   /** Reset for another cause. The argument has the reset flags */
+   journal_reset_e = 0,
+   /** Reset by the watchdog */
+   journal_watchdog_e,
+   /** Reset by a brownout */
+   journal_brownout_e,
+   /** Alert raised. The argument is the line */
+   journal_alert_e,
+   /** Alert raised, and the CPU stopped. The argument is the line */
+   journal_fatal_e,
+   /** The GPS time was too old, and the clock dropped */
+   journal_gps_lost_e,
+   /** Number of events */
+   JOURNAL_EVENTS
+} journal_event_t;
+
+/** An entry of the journal */
+typedef struct
+{
+   /** Sequence of the entry, from 0 to 254. 0xFF if erased */
+   uint8_t seq;
+   /** Event, as #journal_event_t */
+   uint8_t event;
+   /** Argument of the event */
+   uint16_t arg;
+   /** Time of the RTC. Counts from the boot until the GPS sets it */
+   uint32_t time;
+} journal_entry_t;
+
+/** Find the newest entry, and record the cause of the reset */
+void journal_init(void);
+
+/** Append an entry. Interrupt safe */
+void journal_record(journal_event_t event, uint16_t arg);
+
+/** Journal an alert, once per line and boot. Interrupt safe */
+void journal_record_alert(bool doAbort, uint16_t line);
+
+/** @return The number of entries kept */
+uint8_t journal_get_count(void);
+
+/** Read an entry, from the oldest */
+bool journal_read(uint8_t index, journal_entry_t *pEntry);
+
+/** Dump the newest entries over the UART. A job of the boot */
+void journal_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+/** @} */
+#endif /* ndef journal_h_HAS_ALREADY_BEEN_INCLUDED */
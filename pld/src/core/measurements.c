@@ -9,6 +9,23 @@
  *  and the ambient light level.
  * The values are available at all time as the measurements take place in the
  *  background.
+ * Both sensors are read back-to-back through the TWI job queue, and the
+ *  drivers update their filters from the reactor as the reads complete,
+ *  so no code waits for the bus.
+ * \n
+ * Each sensor is sampled at its own adaptive rate. Whilst the driver says
+ *  the signal is settled, the period doubles up to a maximum. As soon as a
+ *  change is seen, the sensor is sampled at its fastest rate again.
+ * Sensors due at the same time are still read in a single burst.
+ * \n
+ * A step in the light level is read at most one maximum period late. Since
+ *  the settled flag is only known once the reading completes, the next
+ *  reading can also be one maximum period away. The step then flushes
+ *  through the filter at the fastest rate. The sum must fit within
+ *  #MEASUREMENT_DARK_RESPONSE_TIME, which is checked at compile time.
+ * \n
+ * The measurements are started by a job of the boot. The stage of the
+ *  sensors is done once each sensor has been read once.
  *****************************************************************************
  * @file
  * Implementation of the measurement service API
@@ -16,109 +33,272 @@
  */ 
 
 #include <asf.h>
+#include <string.h>
 
+#include "driver/fb.h"
 #include "driver/lum.h"
 #include "driver/temperature.h"
+#include "driver/twi_queue.h"
 
+#include "lib/cpp.h"
 #include "lib/timer.h"
 
+#include "core/boot.h"
 #include "core/measurements.h"
 
 /************************************************************************/
 /* Local defines                                                        */
 /************************************************************************/
 
-/**
- * @def _LUM_DARK_THRESHOLD
- * Threshold in % of light sensor to switch off
- */
-#ifndef _LUM_DARK_THRESHOLD
-#  define _LUM_DARK_THRESHOLD 14
-#endif
+/**
+ * @def MEASUREMENT_TEMPERATURE_MIN_PERIOD
+ * Period between two temperature readings whilst it changes
+ */
+#ifndef MEASUREMENT_TEMPERATURE_MIN_PERIOD
+#  define MEASUREMENT_TEMPERATURE_MIN_PERIOD TIMER_MILLISECONDS(500)
+#endif
 
 /**
- * @def MEASUREMENT_ALTERNATE_PERIOD
- * Period to alternate measurements
+ * @def MEASUREMENT_TEMPERATURE_MAX_PERIOD
+ * Period between two temperature readings whilst it is steady
  */
-#ifndef MEASUREMENT_ALTERNATE_PERIOD
-#  define MEASUREMENT_ALTERNATE_PERIOD TIMER_MILLISECONDS(250)
+#ifndef MEASUREMENT_TEMPERATURE_MAX_PERIOD
+#  define MEASUREMENT_TEMPERATURE_MAX_PERIOD TIMER_SECONDS(32)
 #endif
 
 /**
- * @def TWI_BUS_SPEED
- * Normal i2c for all 
+ * @def MEASUREMENT_LUMINOSITY_MIN_PERIOD
+ * Period between two light readings whilst it changes
  */
-#ifndef TWI_BUS_SPEED
-#  define TWI_BUS_SPEED 100000
+#ifndef MEASUREMENT_LUMINOSITY_MIN_PERIOD
+#  define MEASUREMENT_LUMINOSITY_MIN_PERIOD TIMER_MILLISECONDS(500)
 #endif
 
+/**
+ * @def MEASUREMENT_LUMINOSITY_MAX_PERIOD
+ * Period between two light readings whilst it is steady
+ */
+#ifndef MEASUREMENT_LUMINOSITY_MAX_PERIOD
+#  define MEASUREMENT_LUMINOSITY_MAX_PERIOD TIMER_SECONDS(2)
+#endif
+
+/**
+ * @def MEASUREMENT_DARK_RESPONSE_TIME
+ * Worst case time for the dark or bright decision to follow a step in the
+ *  light level
+ */
+#ifndef MEASUREMENT_DARK_RESPONSE_TIME
+#  define MEASUREMENT_DARK_RESPONSE_TIME TIMER_SECONDS(20)
+#endif
+
+/**
+ * @def MEASUREMENT_PRIMING_POLL
+ * Period to check for the first readings of all the sensors at boot
+ */
+#ifndef MEASUREMENT_PRIMING_POLL
+#  define MEASUREMENT_PRIMING_POLL TIMER_MILLISECONDS(2)
+#endif
+
+_Static_assert(
+   2 * MEASUREMENT_LUMINOSITY_MAX_PERIOD + LUM_FILTER_SIZE * MEASUREMENT_LUMINOSITY_MIN_PERIOD
+      <= MEASUREMENT_DARK_RESPONSE_TIME,
+   "The luminosity sampling periods cannot guarantee the dark response time" );
+
+/** Period over which the statistics are collected */
+#define _MEASUREMENT_STATS_PERIOD TIMER_HOURS(24)
+
+/************************************************************************/
+/* Local types                                                          */
 /************************************************************************/
-/* Local variables                                                      */
-/************************************************************************/
 
-/** Current filtered temperature */
-static int16_t filtered_temperature = 0;
+/** Adaptive sampling state of a sensor */
+typedef struct
+{
+   /** Queue a new reading */
+   bool (*measure)(void);
 
-/** Current filtered luminosity */
-static uint8_t filtered_luminosity = 0;
+   /** Tell if the signal was steady on the last reading */
+   bool (*is_settled)(void);
+
+   /** Tell if a first reading was made */
+   bool (*is_primed)(void);
+
+   /** Fastest sampling period */
+   timer_count_t min_period;
+
+   /** Slowest sampling period */
+   timer_count_t max_period;
+
+   /** Current sampling period */
+   timer_count_t period;
+
+   /** Timer count of the next reading */
+   timer_count_t due;
+
+   /** Statistics of the current day */
+   measurement_sensor_stats_t *pStats;
+} _measurement_sensor_t;
+
+/************************************************************************/
+/* Local variables                                                      */
+/************************************************************************/
 
 //
 // For debug, allow override
 //
 #ifdef DEBUG
 bool override_measurements = false;
+
+/** Temperature returned whilst overridden */
+static int16_t filtered_temperature = 0;
+
+/** Luminosity returned whilst overridden */
+static uint8_t filtered_luminosity = 0;
+
+/** Dark room flag returned whilst overridden */
+static volatile bool luminosity_is_dark = false;
 #endif
 
-/** Type of measurement */
-typedef enum measurement_type_enum {
-   measurement_type_temperature=0,
-   measurement_type_luminosity=1
-} measurement_type_t;
+/** Statistics of the current day (0) and of the previous day (1) */
+static measurement_stats_t _measurement_stats[2];
+
+/** All the sensors, each sampled at its own pace */
+static _measurement_sensor_t _measurement_sensors[] = {
+   {
+      .measure      = &temperature_measure,
+      .is_settled   = &temperature_is_settled,
+      .is_primed    = &temperature_is_primed,
+      .min_period   = MEASUREMENT_TEMPERATURE_MIN_PERIOD,
+      .max_period   = MEASUREMENT_TEMPERATURE_MAX_PERIOD,
+      .pStats       = &_measurement_stats[0].temperature
+   },
+   {
+      .measure      = &lum_measure,
+      .is_settled   = &lum_is_settled,
+      .is_primed    = &lum_is_primed,
+      .min_period   = MEASUREMENT_LUMINOSITY_MIN_PERIOD,
+      .max_period   = MEASUREMENT_LUMINOSITY_MAX_PERIOD,
+      .pStats       = &_measurement_stats[0].luminosity
+   }
+};
+
+/** Timer count of the start of the current day statistics */
+static timer_count_t _measurement_stats_start = 0;
+
+/** Dark room decision the frame buffer refreshes for */
+static bool _measurement_was_dark = true;
 
 /************************************************************************/
 /* Local functions                                                      */
 /************************************************************************/
 
-/** Helper to initialise the i2c bus as master */
-static void _init_twi_bus_as_master( TWI_t *twi )
+/**
+ * Adapt the sampling period of a sensor and queue a reading.
+ * The settled flag reflects the previous reading, whose result arrived
+ *  since.
+ *
+ * @param pSensor The sensor to sample
+ * @param now The current timer count
+ */
+static void _measurement_sample( _measurement_sensor_t *pSensor, timer_count_t now )
 {
-   // Start the twi as i2c master running at 400KHz (fast i2c)
-   twi_options_t opt = {
-      .speed = TWI_BUS_SPEED,
-      .chip  = 0,  // We do not reply, but only drive      .speed_reg = TWI_BAUD(sysclk_get_cpu_hz(), TWI_BUS_SPEED)   };
-   
-   sysclk_enable_peripheral_clock(twi);
-   twi_master_init(twi, &opt);
-   twi_master_enable(twi);
+   measurement_sensor_stats_t *pStats = pSensor->pStats;
+   timer_count_t skipped;
+
+   if ( pSensor->is_settled() )
+   {
+      pSensor->period *= 2;
+
+      if ( pSensor->period > pSensor->max_period )
+      {
+         pSensor->period = pSensor->max_period;
+      }
+   }
+   else
+   {
+      pSensor->period = pSensor->min_period;
+   }
+
+   if ( pSensor->measure() )
+   {
+      ++pStats->samples;
+   }
+
+   // Readings skipped until the next one
+   skipped = pSensor->period / pSensor->min_period - 1;
+   pStats->saved += skipped;
+   _measurement_stats[0].transactions_saved += skipped;
+
+   pSensor->due = now + pSensor->period;
 }
-   
+
+/** @return The timer count of the next sensor due */
+static timer_count_t _measurement_next_due( void )
+{
+   timer_count_t next = _measurement_sensors[0].due;
+   uint8_t i;
+
+   for ( i=1; i<COUNTOF(_measurement_sensors); ++i )
+   {
+      if ( (int32_t)(_measurement_sensors[i].due - next) < 0 )
+      {
+         next = _measurement_sensors[i].due;
+      }
+   }
+
+   return next;
+}
+
 /** 
- * Self repeating function in charge of alternating measuring the temperature
- *  and the light flux.
- * The results are stored in the local storage.
+ * Self repeating function in charge of reading the sensors which are due.
+ * All the sensors due are queued back-to-back so they are read in a single
+ *  bus burst. The drivers update their filtered values from the reactor.
  */
 static void _make_a_measurement( timer_instance_t ti, void *arg )
 {
-   measurement_type_t type = (measurement_type_t)arg;
-   measurement_type_t next;
+   timer_count_t now = timer_get_count();
+   uint8_t i;
 
-   #ifdef DEBUG
-   if ( ! override_measurements )
-   #endif
-   
-   switch ( type )
+   // Roll the statistics over every day
+   if ( now - _measurement_stats_start >= _MEASUREMENT_STATS_PERIOD )
    {
-      case measurement_type_temperature:
-         next=measurement_type_luminosity;
-         filtered_temperature = temperature_get_filtered();
-         break;
-      case measurement_type_luminosity:
-      default:
-         next=measurement_type_temperature;
-         filtered_luminosity = lum_get_filtered();
+      _measurement_stats[1] = _measurement_stats[0];
+      memset( &_measurement_stats[0], 0, sizeof(_measurement_stats[0]) );
+      _measurement_stats_start = now;
+   }
+
+   for ( i=0; i<COUNTOF(_measurement_sensors); ++i )
+   {
+      _measurement_sensor_t *pSensor = &_measurement_sensors[i];
+
+      if ( (int32_t)(pSensor->due - now) <= 0 )
+      {
+         _measurement_sample( pSensor, now );
+      }
+   }
+
+   // A static frame buffer must follow the room turning dark or bright.
+   //  The light is sampled fast close to the thresholds, so it is soon
+   if ( measurement_luminosity_is_dark() != _measurement_was_dark )
+   {
+      _measurement_was_dark = ! _measurement_was_dark;
+      fb_refresh();
+   }
+
+   timer_arm( &_make_a_measurement, _measurement_next_due(), NULL );
+}
+
+/** Check for the first readings until all the sensors are read once */
+static void _measurement_wait_for_priming( timer_instance_t ti, void *arg )
+{
+   if ( measurement_is_valid() )
+   {
+      boot_stage_done( boot_sensors_e );
+   }
+   else
+   {
+      timer_arm_from_now( &_measurement_wait_for_priming, MEASUREMENT_PRIMING_POLL, NULL );
    }
-   
-   timer_arm_from_now( &_make_a_measurement, MEASUREMENT_ALTERNATE_PERIOD, (void *)next);
 }
 
 /************************************************************************/
@@ -128,49 +308,116 @@ static void _make_a_measurement( timer_instance_t ti, void *arg )
 /** @return The current temperature in 10th degrees */
 int16_t measurement_get_temperature(void)
 {
-   return filtered_temperature;
+   #ifdef DEBUG
+   if ( override_measurements )
+   {
+      return filtered_temperature;
+   }
+   #endif
+
+   return temperature_get_filtered();
 }
 
 /** @return The current luminosity in % */
 uint8_t measurement_get_luminosity(void)
 {
-   return filtered_luminosity;
+   #ifdef DEBUG
+   if ( override_measurements )
+   {
+      return filtered_luminosity;
+   }
+   #endif
+
+   return lum_get_filtered();
 }
 
+/** 
+ * Called from the frame buffer interrupt. The decision has hysteresis.
+ *
+ * @return true if the ambient light is dark
+ */
 bool measurement_luminosity_is_dark(void)
 {
-   return filtered_luminosity < _LUM_DARK_THRESHOLD;
+   #ifdef DEBUG
+   if ( override_measurements )
+   {
+      return luminosity_is_dark;
+   }
+   #endif
+
+   return lum_is_dark();
+}
+
+/**
+ * Tell if all the sensors were read once. Until then, the values are not
+ *  meaningful, and the room is dark.
+ *
+ * @return true once all the sensors are read
+ */
+bool measurement_is_valid(void)
+{
+   uint8_t i;
+
+   for ( i=0; i<COUNTOF(_measurement_sensors); ++i )
+   {
+      if ( ! _measurement_sensors[i].is_primed() )
+      {
+         return false;
+      }
+   }
+
+   return true;
 }
 
 /**
  * Initialise the analog measurement.
- * Following the function, both measurements are available
+ * The first measurements are queued, and are available shortly after the
+ *  reactor runs. Until then, the room is dark.
+ * The stage of the sensors of the boot is done once they are read.
  */
 void measurement_init(void)
 {
-   // Prepare the twi as master
-   _init_twi_bus_as_master(&TMP100_TWI);
+   // Start the i2c job queue shared by the sensors
+   twi_queue_init();
    
-   // Also init the lum i2c unless it is shared with the tmp100
-   if ( &MAX1036_TWI != &TMP100_TWI )
-   {
-      _init_twi_bus_as_master(&MAX1036_TWI);
-   }
-   
-   // Initialise the temperature API
+   // Configure the sensors and queue a first reading
    temperature_init();
-   filtered_temperature=temperature_get_filtered();
-   
-   // Initialise the luminosity API
    lum_init();
-   filtered_luminosity=lum_get_filtered();
-
-   // Alternate measuring temperature and luminosity
-   timer_arm_from_now( 
-      &_make_a_measurement, 
-      MEASUREMENT_ALTERNATE_PERIOD, 
-      (void*)measurement_type_temperature
-   );
+
+   // Start sampling at the fastest rate
+   timer_count_t now = timer_get_count();
+   uint8_t i;
+
+   for ( i=0; i<COUNTOF(_measurement_sensors); ++i )
+   {
+      _measurement_sensors[i].period = _measurement_sensors[i].min_period;
+      _measurement_sensors[i].due = now + _measurement_sensors[i].min_period;
+   }
+
+   _measurement_stats_start = now;
+
+   timer_arm( &_make_a_measurement, _measurement_next_due(), NULL );
+   timer_arm_from_now( &_measurement_wait_for_priming, MEASUREMENT_PRIMING_POLL, NULL );
+}
+
+/**
+ * Get the sampling statistics.
+ * The statistics roll over every 24 hours.
+ *
+ * @param pToday Where to copy the statistics of the current day. Can be NULL.
+ * @param pYesterday Where to copy the statistics of the previous day. Can be NULL.
+ */
+void measurement_get_stats( measurement_stats_t *pToday, measurement_stats_t *pYesterday )
+{
+   if ( pToday )
+   {
+      *pToday = _measurement_stats[0];
+   }
+
+   if ( pYesterday )
+   {
+      *pYesterday = _measurement_stats[1];
+   }
 }
 
 /**@}*/
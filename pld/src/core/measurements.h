@@ -19,9 +19,32 @@
 extern "C" {
 #endif
 
+/** Sampling statistics of a sensor */
+typedef struct
+{
+   /** Number of readings made */
+   uint32_t samples;
+
+   /** Number of readings saved compared to always sampling at the fastest rate */
+   uint32_t saved;
+} measurement_sensor_stats_t;
+
+/** Sampling statistics of all the sensors over a day */
+typedef struct
+{
+   /** Temperature sensor statistics */
+   measurement_sensor_stats_t temperature;
+
+   /** Luminosity sensor statistics */
+   measurement_sensor_stats_t luminosity;
+
+   /** TWI transactions saved. Each reading is a single transaction */
+   uint32_t transactions_saved;
+} measurement_stats_t;
+
 /**
  * Initialise the analog measurement.
- * Following the function, both measurements are available
+ * The first measurements are available shortly after the reactor runs
  */
 void measurement_init(void);
 
@@ -34,6 +57,12 @@ uint8_t measurement_get_luminosity(void);
 /** @return true if the ambient light is dark */
 bool measurement_luminosity_is_dark(void);
 
+/** @return true once all the sensors were read */
+bool measurement_is_valid(void);
+
+/** Get the sampling statistics of the current and of the previous day */
+void measurement_get_stats( measurement_stats_t *pToday, measurement_stats_t *pYesterday );
+
 #ifdef __cplusplus
 }
 #endif
@@ -8,6 +8,8 @@
  *****************************************************************************
  * This initial mode waits for the luminosity to be suitable to start
  *  displaying data.
+ * It is rendered before the sensors are read, so it looks again shortly
+ *  until the luminosity is known.
  *****************************************************************************
  * @file
  * Implementation of the metro mode
@@ -15,20 +17,30 @@
  * @internal
  */
 
-#include "lib/singleton.hpp"
 #include "core/measurements.h"
 #include "mode.hpp"
 
+namespace
+{
+   /** Time to look again whilst the sensors are not read yet */
+   const timer_count_t sensors_poll_period = TIMER_MILLISECONDS(10);
+}
+
 namespace mode
 {
-   class Boot : public lib::Singleton<IMode, Boot>
+   class Boot : public IMode
    {
+   public:
       /** Wait for the luminosity level to be high enough to show something */
-      timer_count_t update() override
+      timer_count_t update()
       {
          timer_count_t retval = TIMER_SECONDS(1);
       
-         if ( ! measurement_luminosity_is_dark() )
+         if ( ! measurement_is_valid() )
+         {
+            retval = sensors_poll_period;
+         }
+         else if ( ! measurement_luminosity_is_dark() )
          {
             retval = 0;
          }
@@ -39,7 +51,7 @@ namespace mode
 }
 
 /** Reserve static space for the singleton instance */
-ALLOCATE_INSTANCE(mode::Boot);
+ALLOCATE_MODE(mode::Boot);
 
 /**@}*/
 /**@}*/
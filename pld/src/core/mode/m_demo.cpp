@@ -14,7 +14,6 @@
  * @internal
  */
 
-#include "lib/cpp.h"
 #include "core/display/display.hpp"
 #include "mode.hpp"
 
@@ -35,47 +34,43 @@ namespace
    /** Update rate for the temperature display */
    const timer_count_t update_period = TIMER_SECONDS(1);
 
-   /** Handlers to be used */
-   IDisplay<> *handlers[]
-   {
-      lib::get_instance_ptr<IDisplay<>, Snake>(),
-      lib::get_instance_ptr<IDisplay<>, Fade>(),
-   };
+   /** Handlers to be used, in order */
+   typedef lib::Registry<Snake, Fade> handlers;
 }
 
 namespace mode
 {
-   class Demo : public lib::Singleton<IMode, Demo>
+   class Demo : public IMode
    {
       /** Current mode */
       uint8_t mode;
 
    public:
-      Demo() : mode(0)
+      constexpr Demo() : mode(0)
       {}
 
-      void reset() override
+      void reset()
       {
          mode = 0;
-         handlers[mode]->reset();
+         handlers::call<display::Resetter>(mode);
       }
       
       /** Wait for the luminosity level to be high enough to show something */
-      timer_count_t update() override
+      timer_count_t update()
       {
          timer_count_t next = 0;
          
-         if ( mode < countof(handlers) )
+         if ( mode < handlers::count )
          {
-            next = handlers[mode]->display(0);
+            next = handlers::call<display::Displayer>(mode);
             
             if ( next == 0 )
             {
                ++mode;
                
-               if ( mode < countof(handlers) )
+               if ( mode < handlers::count )
                {
-                  handlers[mode]->reset();
+                  handlers::call<display::Resetter>(mode);
                   next = TIMER_SECONDS(1);
                }
             }
@@ -87,7 +82,7 @@ namespace mode
 }
 
 /** Reserve static space for the singleton instance */
-ALLOCATE_INSTANCE(mode::Demo);
+ALLOCATE_MODE(mode::Demo);
 
 /**@}*/
 /**@}*/
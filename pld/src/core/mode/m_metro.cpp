@@ -6,7 +6,8 @@
  * @addtogroup metro
  * @{
  *****************************************************************************
- * This mode simulates the real metro display. It never resets the display.
+ * This mode simulates the real metro display. It never resets the display,
+ *  but the display starts its journey again when coming back to the mode.
  *****************************************************************************
  * @file
  * Implementation of the metro mode
@@ -24,18 +25,19 @@ namespace display { class Metro; }
 // ---------------------------------------------------------------------------
 namespace mode
 {
-   class Metro : public lib::Singleton<IMode, Metro>
+   class Metro : public IMode
    {
+   public:
       /** Called to refresh the temperature */
-      timer_count_t update() override
+      timer_count_t update()
       {
-         return lib::get_instance_ptr<display::IDisplay<>, display::Metro>()->display(0); 
+         return display::show<display::Metro>(); 
       }
    };
 }
 
 /** Reserve static space for the singleton instance */
-ALLOCATE_INSTANCE(mode::Metro);
+ALLOCATE_MODE(mode::Metro);
 
 /**@}*/
 /**@}*/
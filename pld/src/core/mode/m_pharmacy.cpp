@@ -21,7 +21,6 @@
 #include "mode.hpp"
 
 using namespace display;
-using lib::get_instance_ptr;
 
 // The display to use
 namespace display
@@ -65,7 +64,7 @@ namespace
 namespace mode
 {
    /** The pharmacy mode shows the time alternating with the temperature */
-   class Pharmacy : public lib::Singleton<IMode, Pharmacy>
+   class Pharmacy : public IMode
    {
       /** Current mode */
       Mode mode;
@@ -73,11 +72,10 @@ namespace mode
       /** Stay in mode till the given number of seconds */
       uint8_t seconds_to_switch;
    public:
-      Pharmacy() : mode(Mode::wait_for_clock), seconds_to_switch(-1) {}
+      constexpr Pharmacy() : mode(Mode::wait_for_clock), seconds_to_switch(-1) {}
 
-   protected:
       /** After a reset (comming back to pharma, show the time */
-      void reset() override
+      void reset()
          { mode = Mode::wait_for_clock; }
 
       /**
@@ -90,12 +88,12 @@ namespace mode
          if ( secsToMinute == 1 && date->minute == 29 )
          {
             mode = Mode::gong_half_hour;
-            get_instance_ptr<IDisplay <>, Snake>()->reset();
+            display::reset<Snake>();
          }
          else if ( secsToMinute == 1 && date->minute == 59 )
          {
             mode = Mode::gong_hour;
-            get_instance_ptr<IDisplay <>, Fade>()->reset();
+            display::reset<Fade>();
          }
          else if ( --seconds_to_switch == 0 ) // Time left in this mode
          {
@@ -124,7 +122,7 @@ namespace mode
       /** 
        * Grab the current mode and display
        */
-      timer_count_t update() override
+      timer_count_t update()
       {
          timer_count_t retval(TIMER_SECONDS(1));
          tz_datetime_t now;
@@ -140,18 +138,18 @@ namespace mode
                seconds_to_switch = SECS_TO_STAY_IN_TIME_MODE;
                // proceed to showing the time
             case Mode::time:
-               get_instance_ptr<IDisplay<calendar_date *>, Time>()->display(&now);
+               display::show<Time, tz_datetime_t *>(&now);
                compute_next_mode(&now);
                break;                  
             case Mode::temperature:
-               get_instance_ptr<IDisplay<int16_t>, Temperature>()->display( measurement_get_temperature() );
+               display::show<Temperature, int16_t>( measurement_get_temperature() );
                compute_next_mode(&now);
                break;
             case Mode::gong_hour:
-               retval = get_instance_ptr<IDisplay <>, Snake>()->display(0);
+               retval = display::show<Snake>();
                break;
             case Mode::gong_half_hour:
-               retval = get_instance_ptr<IDisplay <>, Fade>()->display(0);
+               retval = display::show<Fade>();
                break;
             }
             
@@ -171,10 +169,10 @@ namespace mode
             if ( mode != Mode::wait_for_clock )
             {
                mode = Mode::wait_for_clock;
-               get_instance_ptr<IDisplay <>, WaitForValidClock>()->reset();
+               display::reset<WaitForValidClock>();
             }
             
-            retval = get_instance_ptr<IDisplay <>, WaitForValidClock>()->display(0);
+            retval = display::show<WaitForValidClock>();
          }            
          
          return retval;
@@ -183,7 +181,7 @@ namespace mode
 }
 
 /** Reserve static space for the singleton instance */
-ALLOCATE_INSTANCE(mode::Pharmacy);
+ALLOCATE_MODE(mode::Pharmacy);
 
 /**@}*/
 /**@}*/
@@ -31,15 +31,13 @@ namespace
 // ---------------------------------------------------------------------------
 namespace mode
 {
-   class Temperature : public lib::Singleton<IMode, Temperature>
+   class Temperature : public IMode
    {
+   public:
       /** Called to refresh the temperature */
-      timer_count_t update() override
+      timer_count_t update()
       {
-         // return display::Temperature::instance()
-         lib::get_instance_ptr<display::IDisplay<int16_t>, display::Temperature>()->display(
-            measurement_get_temperature()
-         );
+         display::show<display::Temperature, int16_t>( measurement_get_temperature() );
          
          return repeat_period;
       }
@@ -47,7 +45,7 @@ namespace mode
 }
 
 /** Reserve static space for the singleton instance */
-ALLOCATE_INSTANCE(mode::Temperature);
+ALLOCATE_MODE(mode::Temperature);
 
 /**@}*/
 /**@}*/
@@ -26,19 +26,20 @@ namespace display { class XXX; }
 // ---------------------------------------------------------------------------
 namespace mode
 {
-   class XXX : public lib::Singleton<IMode, XXX>
+   class XXX : public IMode
    {
+   public:
       /** Called to refresh the display */
-      timer_count_t update() override
+      timer_count_t update()
       {
 		 // Delegate the display
-         return display::instance_display<display::XXX>();
+         return display::show<display::XXX>();
       }
    };
 }
 
 /** Reserve static space for the singleton instance */
-ALLOCATE_INSTANCE(mode::XXX);
+ALLOCATE_MODE(mode::XXX);
 
 /**@}*/
 /**@}*/
@@ -0,0 +1,58 @@
+/**
+ * @addtogroup core
+ * @{
+ * @addtogroup mode
+ * @{
+ * @addtogroup trend
+ * @{
+ *****************************************************************************
+ * This mode displays the temperature of the last hours. It never ends.
+ * It is stateless and does nothing on reset.
+ *****************************************************************************
+ * @file
+ * Implementation of the temperature trend mode
+ * @author software@arreckx.com
+ * @internal
+ */
+#include "mode.hpp"
+#include "core/display/display.hpp"
+#include "core/history.h"
+
+// The display to use
+namespace display { class Trend; }
+
+namespace 
+{
+   /** The current hour changes slowly */
+   const timer_count_t repeat_period = TIMER_SECONDS(10);
+}
+
+// ---------------------------------------------------------------------------
+// Class definition
+// ---------------------------------------------------------------------------
+namespace mode
+{
+   class Trend : public IMode
+   {
+   public:
+      /** Called to refresh the trend */
+      timer_count_t update()
+      {
+         history_trend_t trend;
+
+         history_get_trend( &trend );
+
+         display::show<display::Trend, const history_trend_t *>( &trend );
+         
+         return repeat_period;
+      }
+   };
+}
+
+/** Reserve static space for the singleton instance */
+ALLOCATE_MODE(mode::Trend);
+
+/**@}*/
+/**@}*/
+/**@}*/
+/* ---------------------------  End of file  --------------------------- */
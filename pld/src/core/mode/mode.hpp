@@ -7,17 +7,25 @@
  * @{
  *****************************************************************************
  * Base class for the modes.
+ * A mode is a singleton of its unit, reached from the others through
+ *  #mode::reset and #mode::update, which #ALLOCATE_MODE specializes for it.
+ *  The sequencer calls the modes of its registry with #Resetter and
+ *  #Updater.
  * @n
  * Example:
  * @code
- * #include "core/mode/mode.h"
+ * #include "core/mode/mode.hpp"
  * // Create a new mode
- * struct ModeSnake
+ * namespace mode
  * {
+ *    class Snake : public IMode
+ *    {
+ *    public:
+ *       timer_count_t update() { ... }
+ *    };
+ * }
  *
- * // Arm an event to be called in 1 hour and 12 minutes
- * // Pass the value 12 when calling
- * timer_arm_from_now( callback, TIMER_HOURS(1)+TIMER_MINUTES(12), (void*)12);
+ * ALLOCATE_MODE(mode::Snake);
  * @endcode
  *****************************************************************************
  * @file
@@ -31,42 +39,73 @@
 namespace mode
 {
    /**
-    * Base virtual mode class
-    * All modes should inherit from this class and override at least
-    *  the #update method.
+    * Base mode class
+    * All modes should inherit from this class and define at least a public
+    *  update method:
+    * @code
+    * timer_count_t update();
+    * @endcode
+    * It is called by the sequencer when after some time to update the LED
+    *  panel. The frame buffer is readily switched to a blank working frame
+    *  buffer and must be refilled entirely. It returns the time gap until the
+    *  next update, or 0 to move on to the next mode.
+    * The methods are called directly, so they hide the ones of the base.
     */
    struct IMode
    {
       /** 
        * This is called when the mode is restarted.
-       * Override for stateful modes to reset internal states.
+       * Hide it for stateful modes to reset internal states.
        */
-      virtual void reset() {}
-   
-      /** 
-       * Called by the sequencer when after some time to update the LED panel.
-       * This method must be overridden. The frame buffer is readily switched
-       *  to a blank working frame buffer and must be refilled entirely.
-       * If the mode is reset, the reset method is called prior to calling this
-       *  function.
-       *
-       * @return Time gap until the next update
-       */
-      virtual timer_count_t update() = 0;
+      void reset() {}
    };
 
    /**
-    * Shortcut to obtaining a mode singleton instance pointer
-    * @tparam M Class whose singleton pointer to get
-    * @return A pointer to the singleton instance
+    * Restart the mode M. Provided by #ALLOCATE_MODE
+    * @tparam M Class of the mode
+    */
+   template <class M> void reset();
+
+   /**
+    * Update the mode M. Provided by #ALLOCATE_MODE
+    * @tparam M Class of the mode
+    * @return Time gap until the next update
     */
-   template <class M> constexpr IMode *get_mode_ptr()
+   template <class M> timer_count_t update();
+
+   /** Operation of a #lib::Registry of modes, which restarts the mode */
+   struct Resetter
    {
-      return lib::get_instance_ptr<IMode, M>();
-   }
+      typedef void result_type;
+      template <class M> static void apply() { reset<M>(); }
+   };
+
+   /** Operation of a #lib::Registry of modes, which updates the mode */
+   struct Updater
+   {
+      typedef timer_count_t result_type;
+      template <class M> static timer_count_t apply() { return update<M>(); }
+   };
 
 } // End of namespace 'mode'
 
+/**
+ * Allocate the instance of the mode M, and let the other units reset and
+ *  update it.
+ * @warning This macro must be invoked outside of any namespace.
+ * @tparam M Name of the class of the mode.
+ */
+#define ALLOCATE_MODE(M) \
+   ALLOCATE_INSTANCE(M) \
+   namespace mode { \
+      template<> void reset<M>() { \
+         lib::instance<M>().reset(); \
+      } \
+      template<> timer_count_t update<M>() { \
+         return lib::instance<M>().update(); \
+      } \
+   }
+
 /**@}*/
 /**@}*/
 #endif /* ndef core_mode_mode_h_HAS_ALREADY_BEEN_INCLUDED */
\ No newline at end of file
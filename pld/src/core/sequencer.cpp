@@ -7,6 +7,9 @@
  *****************************************************************************
  * This sequencer relies on the timer service and a simple state machine
  *  to alternate the various modes of display.
+ * A push on the key renders the first frame of the new mode at once, with
+ *  no gap, and times it from the edge of the key to its latch.
+ * The first frame is rendered at boot, before the reactor runs.
  *****************************************************************************
  * @file
  * Implementation of the sequencer
@@ -14,7 +17,9 @@
  * @internal
  */
 #include "driver/fb.h"
+#include "driver/key.h"
 #include "lib/timer.h"
+#include "core/boot.h"
 #include "sequencer.h"
 #include "configuration.hpp"
 
@@ -63,8 +68,12 @@ namespace
    public:
       /** Reset all that's all. No timer is armed yet. A call to start is required. */
       ModeManager() : index(0), mode_is_demo(false)
+      {}
+
+      /** Restart the first mode. Called once the modes are constructed */
+      void init()
       {
-         short_push_sequence[index]->reset();
+         short_push_sequence::call<Resetter>(index);
       }
 
       /**
@@ -73,8 +82,12 @@ namespace
        */
       timer_count_t update()
       {
-         IMode *pMode = mode_is_demo ? long_push_mode : short_push_sequence[index];
-         return pMode->update();
+         if (mode_is_demo)
+         {
+            return mode::update<long_push_mode>();
+         }
+
+         return short_push_sequence::call<Updater>(index);
       }
 
       /**
@@ -82,25 +95,24 @@ namespace
        * If a demo was active, turn the demo mode off, and resume the previous
        *  mode.
        * Otherwise, advance (or rotate) to the next mode and reset it.
+       * The caller starts the new mode.
        */
       void next()
       {
          if (!mode_is_demo)
          {
             index = (index + 1) % number_of_sequence;
-            short_push_sequence[index]->reset();
+            short_push_sequence::call<Resetter>(index);
          }
 
          mode_is_demo = false;
-         sequencer_start();
       }
 
-      /** Switch to the long push mode */
+      /** Switch to the long push mode. The caller starts it */
       void demo()
       {
          mode_is_demo = true;
-         long_push_mode->reset();
-         sequencer_start();
+         mode::reset<long_push_mode>();
       }
    } mode_manager;
 }
@@ -111,36 +123,56 @@ namespace
 namespace
 {
    /** Called by the timer to handle the next move */
-   extern "C" void timer_callback(timer_instance_t instance, void *arg)
+   extern "C" void timer_callback(timer_instance_t instance, void *arg);
+
+   /** Render the frame of the current mode now, and arm its next update */
+   void render()
    {
       static fb_mem_t working_fb;
 
-      // Is this timer instance still valid?
-      if (instance == ongoing_timer_instance)
-      {
-         // Switch to the working copy of frame buffer
-         fb_use(&working_fb);
+      // Switch to the working copy of frame buffer
+      fb_use(&working_fb);
 
-         // Reset the frame buffer
-         fb_clear();
+      // Reset the frame buffer
+      fb_clear();
 
-         //
-         // Call the mode handler to update the frame buffer
-         //
-         timer_count_t nextCount = mode_manager.update();
+      //
+      // Call the mode handler to update the frame buffer
+      //
+      timer_count_t nextCount = mode_manager.update();
 
-         // Copy the modified frame buffer into the live frame buffer
-         fb_commit();
+      // Copy the modified frame buffer into the live frame buffer
+      fb_commit();
+      boot_stage_done(boot_frame_e);
 
-         // Check the reply : >0 - Stay in the same mode // 0 - Switch
-         if (nextCount > 0)
-         {
-            ongoing_timer_instance = timer_arm_from_now(timer_callback, nextCount, 0);
-         }
-         else
-         {
-            mode_manager.next();
-         }
+      // Check the reply : >0 - Stay in the same mode // 0 - Switch
+      if (nextCount > 0)
+      {
+         ongoing_timer_instance = timer_arm_from_now(timer_callback, nextCount, 0);
+      }
+      else
+      {
+         mode_manager.next();
+         sequencer_start();
+      }
+   }
+
+   /**
+    * Show the mode switched to by a push at once, skipping the gap.
+    * The update armed for the previous mode is invalidated.
+    */
+   void render_push()
+   {
+      fb_time_next_latch(key_get_edge_time());
+      render();
+   }
+
+   extern "C" void timer_callback(timer_instance_t instance, void *arg)
+   {
+      // Is this timer instance still valid?
+      if (instance == ongoing_timer_instance)
+      {
+         render();
       }
    }
 } // End of anonymous namespace
@@ -150,6 +182,13 @@ namespace
 // ---------------------------------------------------------------------------
 extern "C"
 {
+   /** Render the first mode at once */
+   void sequencer_init(void)
+   {
+      mode_manager.init();
+      render();
+   }
+
    /** Initialize and start the timer */
    void sequencer_start(void)
    { 
@@ -158,11 +197,11 @@ extern "C"
 
    /** A long key press takes back to the snake demo */
    void sequencer_switch_long(void)
-      { mode_manager.demo(); }
+      { mode_manager.demo(); render_push(); }
 
    /** A short key press allow toggling between all the available modes */
    void sequencer_switch_short(void)
-      { mode_manager.next(); }
+      { mode_manager.next(); render_push(); }
 }
 
 /**@}*/
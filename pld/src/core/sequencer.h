@@ -16,6 +16,9 @@
 extern "C" {
 #endif
 
+/** Show the first frame of the first mode now, and start the sequence */
+void sequencer_init(void);
+
 /** Initialise the sequencer. This one will self repeat once after */
 void sequencer_start(void);
 
@@ -11,6 +11,7 @@
 
 #include "lib/debug.h"
 #include "lib/timer.h"
+#include "lib/governor.h"
 #include "driver/fb.h"
 #include "core/measurements.h"
 
@@ -55,6 +56,34 @@ static uint_fast8_t _blink_count = 0;
 /** Buffer for the DMA transfer */
 static volatile uint8_t _spi_dma_tx_buffer[FB_NUMBER_OF_DRIVERS];
 
+/** True while the timer is stopped, and the latches hold a static pattern */
+static bool _is_static = false;
+
+/** True while the static pattern is transferred, with the locks taken */
+static volatile bool _is_latching = false;
+
+/** Stages of the timing of a frame, from an input to its latch */
+typedef enum
+{
+   /** No frame timed */
+   _latency_none_e = 0,
+   /** The frame is to be committed */
+   _latency_armed_e,
+   /** The frame is committed, and waits for the next transfer */
+   _latency_committed_e,
+   /** The frame is transferred, and latched on completion */
+   _latency_latching_e,
+} _latency_stage_t;
+
+/** Stage of the frame timed */
+static volatile _latency_stage_t _latency_stage = _latency_none_e;
+
+/** Time of the input which changed the frame timed */
+static timer_count_t _latency_since = 0;
+
+/** Times from the inputs to the latch so far */
+static fb_latency_stats_t _latency_stats;
+
 /** 
  * Convert a 4 bits light level count into a 5 bits using
  *  a non-linear relashionship x^1.5 * 31 / 15^1.5
@@ -75,6 +104,24 @@ fb_mem_t *fb_live;
 // Forward declaration
 static void _on_timer_tick(void);
 
+/** Account the time from the input to the latch of its frame, now */
+static void _latency_record(void)
+{
+   timer_count_t elapsed = timer_time_lapsed_since( _latency_since );
+   uint16_t ms = elapsed > UINT16_MAX ? UINT16_MAX : (uint16_t)elapsed;
+
+   _latency_stage = _latency_none_e;
+
+   ++_latency_stats.count;
+   _latency_stats.last_ms = ms;
+   _latency_stats.total_ms += ms;
+
+   if ( ms > _latency_stats.worst_ms )
+   {
+      _latency_stats.worst_ms = ms;
+   }
+}
+
 /** Prepare the latch pin and start the dma */
 static void _initiate_spi_dma_transfer(void)
 {
@@ -96,6 +143,18 @@ static void _on_dma_complete(enum dma_channel_status status)
    {
       // Arm the pins latch. It should be low during the data transfer
       ioport_set_pin_level( HC595_LATCH, false );
+
+      if ( _latency_stage == _latency_latching_e )
+      {
+         _latency_record();
+      }
+   }
+
+   if ( _is_latching )
+   {
+      _is_latching = false;
+      sleepmgr_unlock_mode( SLEEPMGR_IDLE );
+      governor_unlock();
    }
 }
 
@@ -134,12 +193,18 @@ static void _set_timer(void)
 	// Set the callback
 	tc_set_overflow_interrupt_callback( &FB_TIMER_TC, &_on_timer_tick );
 
+	// The refresh needs the full speed, which the period assumes
+	governor_lock();
+
 	// Set the top to get the correct cycle time around
 	tc_write_period( &FB_TIMER_TC, sysclk_get_main_hz() / _CYCLE_RATE );
 
 	// Source is main clock divided by 1
 	// This effectively starts the timer ticking
 	tc_write_clock_source( &FB_TIMER_TC, TC_CLKSEL_DIV1_gc );
+
+	// The timer and the DMA stop in the modes deeper than idle
+	sleepmgr_lock_mode( SLEEPMGR_IDLE );
 }
 
 /** Configure a DMA channel for copying the fb to the usart-spi */
@@ -218,6 +283,129 @@ void fb_init(void)
    _set_timer();
 }
 
+/**
+ * Compute the pattern of a frame which needs no refresh.
+ * Each LED must be off, or steadily on at full level, since the full level
+ *  is lit over the whole luminosity cycle.
+ *
+ * @param pattern Byte to latch for each driver
+ * @return false if some LED flashes or is dimmed
+ */
+static bool _get_static_pattern( uint8_t pattern[FB_NUMBER_OF_DRIVERS] )
+{
+   uint_fast8_t driver;
+   uint_fast8_t pos;
+   fb_led_t led;
+
+   for ( driver=0; driver < FB_NUMBER_OF_DRIVERS; ++driver )
+   {
+      pattern[driver] = 0;
+
+      for ( pos=0; pos < FB_BITS_PER_DRIVER; ++pos )
+      {
+         led = fb_current[(driver<<3) + pos];
+
+         pattern[driver] <<= 1;
+
+         if ( led.status == LED_ON && led.level == LED_LEVEL_FULL )
+         {
+            pattern[driver] |= 1;
+         }
+         else if ( led.status != LED_OFF )
+         {
+            return false;
+         }
+      }
+   }
+
+   return true;
+}
+
+/**
+ * @details Called on each commit, and by the measurements when the room
+ *  turns dark or bright.
+ * A dark room, or a frame with no LED flashing nor dimmed, shows a static
+ *  pattern. The pattern is latched once and the timer stopped, so neither
+ *  the timer interrupt nor the DMA run until the next change. Otherwise
+ *  the timer is restarted.
+ */
+void fb_refresh(void)
+{
+   uint8_t pattern[FB_NUMBER_OF_DRIVERS];
+   bool isStatic = true;
+   uint_fast8_t driver;
+
+   // The frame timed is committed. The next transfer shows it
+   if ( _latency_stage == _latency_armed_e )
+   {
+      _latency_stage = _latency_committed_e;
+   }
+
+   if ( measurement_luminosity_is_dark() )
+   {
+      memset( pattern, 0, sizeof(pattern) );
+   }
+   else
+   {
+      isStatic = _get_static_pattern( pattern );
+   }
+
+   if ( ! isStatic )
+   {
+      if ( _is_static )
+      {
+         _is_static = false;
+         sleepmgr_lock_mode( SLEEPMGR_IDLE );
+         governor_lock();
+         tc_write_clock_source( &FB_TIMER_TC, TC_CLKSEL_DIV1_gc );
+      }
+
+      return;
+   }
+
+   // Already latched
+   if ( _is_static && memcmp(pattern, (const void *)_spi_dma_tx_buffer, sizeof(pattern)) == 0 )
+   {
+      if ( _latency_stage == _latency_committed_e )
+      {
+         _latency_record();
+      }
+
+      return;
+   }
+
+   // Stop the timer and drop a tick pending, so the pattern is not replaced
+   if ( ! _is_static )
+   {
+      tc_write_clock_source( &FB_TIMER_TC, TC_CLKSEL_OFF_gc );
+      tc_clear_overflow( &FB_TIMER_TC );
+      sleepmgr_unlock_mode( SLEEPMGR_IDLE );
+      governor_unlock();
+      _is_static = true;
+   }
+
+   // Let the last transfer complete
+   while ( dma_channel_is_busy(HC595_DMA_CHANNEL) )
+   {
+   }
+
+   for ( driver=0; driver < FB_NUMBER_OF_DRIVERS; ++driver )
+   {
+      _spi_dma_tx_buffer[driver] = pattern[driver];
+   }
+
+   // The CPU sleeps in idle until latched, at the speed of the SPI baud rate
+   if ( _latency_stage == _latency_committed_e )
+   {
+      _latency_stage = _latency_latching_e;
+   }
+
+   _is_latching = true;
+   sleepmgr_lock_mode( SLEEPMGR_IDLE );
+   governor_lock();
+   _initiate_spi_dma_transfer();
+}
+
 /**
  * Create an offset lookup for the luminosity to spread the current
  * if all LEDs have the same level
@@ -300,6 +488,12 @@ static void _on_timer_tick(void)
       _lum_count = 0;
    }
 
+   // The frame timed is in this transfer
+   if ( _latency_stage == _latency_committed_e )
+   {
+      _latency_stage = _latency_latching_e;
+   }
+
    // Fire the DMA
    _initiate_spi_dma_transfer();
    
@@ -307,5 +501,32 @@ static void _on_timer_tick(void)
    debug_clear(FB);
 }
 
+/**
+ * Time the next frame committed, from an input to the completion of the
+ *  transfer which latches it. A frame timed already is not timed.
+ *
+ * @param since Time of the input, as the timer count
+ */
+void fb_time_next_latch(timer_count_t since)
+{
+   if ( _latency_stage == _latency_none_e )
+   {
+      _latency_since = since;
+      _latency_stage = _latency_armed_e;
+   }
+}
+
+/**
+ * Copy the times from the inputs to the latch of their frames so far.
+ *
+ * @param pStats Where to copy the times
+ */
+void fb_get_latency_stats(fb_latency_stats_t *pStats)
+{
+   cli();
+   *pStats = _latency_stats;
+   sei();
+}
+
 /**@}*/
 /**@} ---------------------------  End of file  --------------------------- */
\ No newline at end of file
@@ -44,6 +44,7 @@
 #include <string.h> // memcpy
 
 #include "config/conf_board.h"
+#include "lib/timer.h"
 
 #define LED_OFF          0x0 ///< Led if turned off. Nothing else matters.
 #define LED_ON           0xF ///< Led is steadily on
@@ -85,6 +86,19 @@ extern fb_mem_t fb_current;
 /** Current working copy of the buffer. This is to prevent glitches. */
 extern fb_mem_t *fb_live;
 
+/** Time from an input to the latch of the frame which shows it */
+typedef struct
+{
+   /** Number of inputs timed */
+   uint16_t count;
+   /** Time of the last input, in ms */
+   uint16_t last_ms;
+   /** Longest time, in ms */
+   uint16_t worst_ms;
+   /** Sum of the times, in ms */
+   uint32_t total_ms;
+} fb_latency_stats_t;
+
 /************************************************************************/
 /* API                                                                  */
 /************************************************************************/
@@ -92,6 +106,25 @@ extern fb_mem_t *fb_live;
 /** Initialise the framebuffer API */
 void fb_init(void);
 
+/** Refresh the LEDs as the content or the darkness of the room requires */
+void fb_refresh(void);
+
+/** Time the next frame committed, from an input to its latch */
+void fb_time_next_latch(timer_count_t since);
+
+/** Get the times from the inputs to the latch of their frame so far */
+void fb_get_latency_stats(fb_latency_stats_t *pStats);
+
+/**
+ * @def FB_COMMIT_HOOK
+ * Define to have #fb_on_commit called after each commit.
+ * Left undefined for the target. The simulators use it to record the frames.
+ */
+#ifdef FB_COMMIT_HOOK
+/** Called with the new content of #fb_current after each commit */
+void fb_on_commit(void);
+#endif
+
 /************************************************************************/
 /* Inline implementations                                               */
 /************************************************************************/
@@ -122,7 +155,13 @@ inline void fb_use( fb_mem_t *to )
  *        fully copied. Each group of LED will be atomically.
  */
 inline void fb_commit(void)
-   { memcpy( (void *)fb_current, (void *)(*fb_live), sizeof(fb_current) ); }
+{
+   memcpy( (void *)fb_current, (void *)(*fb_live), sizeof(fb_current) );
+   fb_refresh();
+#ifdef FB_COMMIT_HOOK
+   fb_on_commit();
+#endif
+}
 
 /** Set a LED using a composite value */
 inline void fb_set_composite(fb_index_t index, fb_led_t state)
@@ -7,13 +7,17 @@
  * @details Manages a single key or push button.
  * To use this API, first initialise it calling keyInit. A couple of callbacks
  *  are required. These are called when a key press is detected.
- * Also, the function keyScan must be called periodically, ideally every 20ms
- *  (50Hz) or thereabout.
+ * The key is idle until the pin changes. The pin change interrupt, which
+ *  wakes the CPU from any sleep mode, then starts keyScan every 20ms (50Hz)
+ *  from the timer service. Once the key is released and the push is
+ *  dispatched, the scan stops. No wake up is spent on the key while it is
+ *  not touched.
+ * Each edge is timed for #key_get_edge_time. The release of a short push is
+ *  handled on its edge rather than on the next scan, so the push is
+ *  dispatched at once.
  * The parameters #KEY_DEBOUNCE_CYCLES and #KEY_LONG_CYCLES can be adjusted
  *  in config.h to modify the responsivity of the keypad. They are set for a
  *  50Hz sampling rate at 3 and 40 respectively.
- * The function keyScan can be called within an interrupt, but the callback
- *  method would also be called with the same interrupt.
  *****************************************************************************
  * @file
  * Key API implementation
@@ -24,7 +28,9 @@
 #include <asf.h>
 
 #include "driver/key.h"
+#include "lib/timer.h"
 #include "lib/reactor.h"
+#include "lib/governor.h"
 
 /**
  * Set the default values.
@@ -51,10 +57,13 @@
 /** For a very long push cycle */
 #define _VERY_LONG_CYCLES (KEY_LONG_CYCLES*3)
 
-#if !defined KEY_PIN
-   #error "The key API requires the KEY_PIN resource to be defined"
+#if !defined KEY_PIN || !defined KEY_PIN_vect
+   #error "The key API requires the KEY_PIN and KEY_PIN_vect resources to be defined"
 #endif
 
+/** Time between 2 scans of the key */
+#define _KEY_SCAN_PERIOD TIMER_MILLISECONDS(1000 / KEY_SAMPLING_RATE)
+
 /** Mask to check for the short push flag in the dispatch flags */
 #define _KEY_SHORT_DISPATCH_FLAG_MASK (1<<1)
 
@@ -107,6 +116,12 @@ static volatile uint8_t _key_dispatch_flags = 0;
 /** Reactor processing handle to dispatch on key pressed */
 static volatile reactor_handle_t _key_reactor_handle = 0;
 
+/** True while the key is scanned, with the full speed locked */
+static volatile bool _key_is_scanning = false;
+
+/** Time of the first edge of the last push, or of its release if short */
+static volatile timer_count_t _key_edge_time = 0;
+
 
 /**
  * Dispatch to the callbacks if a key was pressed
@@ -148,10 +163,8 @@ static void _key_dispatch( void )
 
 /**
  * Scan the keypad for changes.
- * It is up to the application to call this method periodically
- *  every 20ms or thereabout.
- *
- * Called within a timer interrupt context
+ * Called from the timer service every 20ms or thereabout while the key is
+ *  active.
  */
 static void keyScan(void)
 {
@@ -221,6 +234,79 @@ static void keyScan(void)
    }
 }
 
+static void _key_on_scan( timer_instance_t instance, void *arg );
+
+/**
+ * Start scanning the key.
+ * The dispatch of a push is done at full speed, then the load decides.
+ * Called with the interrupts off, from the pin interrupt or the last scan.
+ * They stay off.
+ */
+static void _key_start_scan(void)
+{
+   _key_is_scanning = true;
+   governor_lock_from_isr();
+   
+   timer_arm_from_now( &_key_on_scan, _KEY_SCAN_PERIOD, NULL );
+}
+
+/**
+ * Scan the key, then scan again later until it is released and idle.
+ * Called by the timer service.
+ */
+static void _key_on_scan( timer_instance_t instance, void *arg )
+{
+   // The edge of a release may scan too
+   cli();
+   keyScan();
+   sei();
+   
+   if ( state != keyIdle_e || consecutiveDowns != 0 || ioport_pin_is_low(KEY_PIN) )
+   {
+      timer_arm_from_now( &_key_on_scan, _KEY_SCAN_PERIOD, NULL );
+      return;
+   }
+
+   // Idle again. Wait for the next change of the pin
+   governor_unlock();
+
+   cli();
+   _key_is_scanning = false;
+
+   // A push since the scan raised an interrupt which did nothing
+   if ( ioport_pin_is_low(KEY_PIN) )
+   {
+      _key_start_scan();
+   }
+   
+   sei();
+}
+
+/** The pin changed. Wakes the CPU up from any sleep mode */
+ISR( KEY_PIN_vect )
+{
+   // The bounces which follow an edge keep its time
+   if ( ! _key_is_scanning )
+   {
+      _key_edge_time = timer_get_count();
+      _key_start_scan();
+   }
+   else if ( state == keySingle_e && ! ioport_pin_is_low(KEY_PIN) )
+   {
+      // Released after the debounce. Dispatch the short push now
+      _key_edge_time = timer_get_count();
+      keyScan();
+   }
+}
+
+/**
+ * @return The time of the first edge of the last push, or of its release
+ *  for a short push, as the timer count
+ */
+timer_count_t key_get_edge_time(void)
+{
+   return _key_edge_time;
+}
 
 /**
  * Initialise the keypad and its state machine
@@ -245,34 +331,15 @@ void key_init(
    state = keyIdle_e;
    consecutiveDowns = 0;
    
-   // Arm the timer
-   // Enable the timer
-   tc_enable( &KEY_TIMER_TC );
-
-   // Simple timer compare mode required
-   tc_set_wgm( &KEY_TIMER_TC, TC_WG_NORMAL );
-
-   // The timer service interrupts run at low level to allow
-   //  other interrupts to take precedence
-   tc_set_overflow_interrupt_level( &KEY_TIMER_TC, TC_INT_LVL_MED );
-
-   // Set the callback
-   tc_set_overflow_interrupt_callback( &KEY_TIMER_TC, &keyScan );
-
-   // Aiming for 20ms - that's 50Hz clock
-   // That's 640,000 divider overall
-   // 2^10 * 625
-   
-   // Set the top to 
-   tc_write_period( &KEY_TIMER_TC, 625 );
-
-   // Source is main clock (assuming 32MHz) divided by 256
-   // Gives a overall clock as 125kHz
-   // This effectively starts the timer ticking
-   tc_write_clock_source( &KEY_TIMER_TC, TC_CLKSEL_DIV1024_gc );
-   
    // Regsiter with the reactor for power saving
    _key_reactor_handle = reactor_register(&_key_dispatch);
+   
+   // Both edges wake the CPU up from the modes deeper than idle
+   ioport_set_pin_sense_mode( KEY_PIN, IOPORT_SENSE_BOTHEDGES );
+
+   // Enable interrupt on the key pin. The scan starts on the first change
+   arch_ioport_pin_to_base( KEY_PIN )->INTCTRL = PORT_INT0LVL_MED_gc;
+   arch_ioport_pin_to_base( KEY_PIN )->INT0MASK = ioport_pin_to_mask( KEY_PIN );
 }
 
 /**@}*/
@@ -12,10 +12,12 @@
  * Defines the single key API.
  * - This API uses the reactor for dispatch.
  * - The key API must be initialised by calling keyInit.
- * - The KEY_PORT and KEY_PIN resource must be defined in config.h.
+ * - The KEY_PIN and KEY_PIN_vect resources must be defined in config.h.
  *****************************************************************************
  */
 
+#include "lib/timer.h"
+
 /** Preferred key sampling rate in Hz*/
 #define KEY_PREFERED_SCANNING_RATE 50
 
@@ -38,6 +40,12 @@ void key_init(
 /** Called handlers from the reactor loop */   
 void key_dispatch(void);
 
+/**
+ * Time of the first edge of the last push, or of its release for a short
+ *  push, to time the reaction to a push. The bounces do not move it.
+ */
+timer_count_t key_get_edge_time(void);
+
 #ifdef __cplusplus
 }
 #endif
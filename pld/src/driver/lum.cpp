@@ -0,0 +1,170 @@
+/**
+ * @addtogroup driver
+ * @{
+ * @addtogroup luminosity
+ * @{
+ *****************************************************************************
+ * This driver relies on the max1036 low level API to mesure the luminosity
+ *  level. The filter is updated from the reactor once a read completes.
+ * The filtered level also drives a comparator with hysteresis to decide if
+ *  the room is dark, so the display does not flicker on and off at dusk.
+ *****************************************************************************
+ * @file
+ * Luminosity driver implementation
+ * @author software@arreckx.com
+ */
+#include "lib/filter.hpp"
+
+extern "C" {
+
+#include <asf.h>
+#include "max1036.h"
+#include "lum.h"
+
+/**
+ * @def LUM_DARK_THRESHOLD
+ * Filtered level below which the room becomes dark
+ */
+#ifndef LUM_DARK_THRESHOLD
+#  define LUM_DARK_THRESHOLD 14
+#endif
+
+/**
+ * @def LUM_BRIGHT_THRESHOLD
+ * Filtered level from which a dark room becomes bright again
+ */
+#ifndef LUM_BRIGHT_THRESHOLD
+#  define LUM_BRIGHT_THRESHOLD 18
+#endif
+
+/**
+ * @def LUM_ACTIVITY_THRESHOLD
+ * Distance between a reading and the filtered level above which the light
+ *  is considered to be changing
+ */
+#ifndef LUM_ACTIVITY_THRESHOLD
+#  define LUM_ACTIVITY_THRESHOLD 3
+#endif
+
+/**
+ * @def LUM_GUARD_BAND
+ * Distance to the dark and bright thresholds within which the light is
+ *  never considered settled, so dusk and dawn are followed closely
+ */
+#ifndef LUM_GUARD_BAND
+#  define LUM_GUARD_BAND 6
+#endif
+
+/** Average the readings */
+static lib::BoxFilter<uint8_t, LUM_FILTER_SIZE, uint16_t> _average_filter;
+
+/** Bright (true) or dark (false) decision */
+static lib::Hysteresis<uint8_t, LUM_DARK_THRESHOLD, LUM_BRIGHT_THRESHOLD> _is_bright;
+
+/** True once the filter is loaded with a first reading */
+static bool _is_primed = false;
+
+/** True if the level is steady and away from the thresholds */
+static bool _is_settled = false;
+
+/**
+ * Called from the reactor once the ADC has been read.
+ * A failed read is simply skipped.
+ *
+ * @param job The read job
+ */
+static void _on_lum_read(twi_job_t *job)
+{
+   if ( job->status == STATUS_OK )
+   {
+      uint8_t l = max1036_get_raw();
+      
+      // Fill in the filter buffer with the first reading
+      if ( ! _is_primed )
+      {
+         _average_filter.fill(l);
+         _is_bright.reset(l);
+         _is_primed = true;
+      }
+      else
+      {
+         int16_t deviation = (int16_t)l - _average_filter.get();
+         
+         _average_filter.push(l);
+         
+         uint8_t filtered = _average_filter.get();
+         _is_bright.update(filtered);
+         
+         _is_settled = 
+            deviation <= LUM_ACTIVITY_THRESHOLD &&
+            deviation >= -LUM_ACTIVITY_THRESHOLD &&
+            ( filtered + LUM_GUARD_BAND < LUM_DARK_THRESHOLD ||
+              filtered >= LUM_BRIGHT_THRESHOLD + LUM_GUARD_BAND );
+      }
+   }
+}
+
+/** Init the driver, and queue a first measurement */
+void lum_init(void)
+{
+   // Prepare the chip
+   max1036_init(0
+      | MAX1036_SCAN_SEL_gc
+      | MAX1036_CHANNEL_AIN0_gc
+      | MAX1036_SEL_INT_REF_ON_gc
+      | MAX1036_CLOCK_EXTERNAL_gc
+      | MAX1036_MODE_SINGLE_ENDED_gc
+   );
+
+   // The first reading loads the filter
+   lum_measure();
+}
+
+/** 
+ * Queue a new measurement. The filtered value is updated from the reactor.
+ *
+ * @return false if the previous measurement has not completed yet
+ */
+bool lum_measure(void)
+{
+   return max1036_read(&_on_lum_read);
+}
+
+/** @return The filtered light level */
+uint8_t lum_get_filtered(void)
+{
+   return _average_filter.get();
+}
+
+/**
+ * Tell if the light has been steady, away from the dark and bright
+ *  thresholds, for the last reading.
+ *
+ * @return true if the light level can be sampled less often
+ */
+bool lum_is_settled(void)
+{
+   return _is_settled;
+}
+
+/** @return true once the filter is loaded with a first reading */
+bool lum_is_primed(void)
+{
+   return _is_primed;
+}
+
+/**
+ * Can be called from an interrupt, since the decision is a single byte.
+ * The room is dark until the first reading.
+ *
+ * @return true if the filtered light level says the room is dark
+ */
+bool lum_is_dark(void)
+{
+   return ! _is_bright.get();
+}
+
+} // End of extern "C"
+
+/**@}*/
+/**@} ---------------------------  End of file  --------------------------- */
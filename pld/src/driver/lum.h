@@ -11,20 +11,39 @@
  *****************************************************************************
  * Higher level driver for the light sensor.
  */ 
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @def LUM_FILTER_SIZE
+ * Depth of the luminosity filter. Powers of 2 are better since more efficient
+ */
+#ifndef LUM_FILTER_SIZE
+#  define LUM_FILTER_SIZE 32
+#endif
 
  #ifdef __cplusplus
 extern "C" {
 #endif
 
-/** Initialize this driver */
+/** Initialize this driver and queue a first measurement */
 void lum_init(void);
 
-/** Grab the luminosity level straight out of the ADC */
-uint8_t lum_get_raw(bool);
+/** Queue a new measurement */
+bool lum_measure(void);
 
 /** Get the filterer luminosity value */
 uint8_t lum_get_filtered(void);
 
+/** @return true if the light level is steady */
+bool lum_is_settled(void);
+
+/** @return true once the filter is loaded with a first reading */
+bool lum_is_primed(void);
+
+/** @return true if the room is dark, with hysteresis */
+bool lum_is_dark(void);
+
 #ifdef __cplusplus
 }
 #endif
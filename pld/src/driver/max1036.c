@@ -8,82 +8,74 @@
  * @{
  * @author software@arreckx.com
  *****************************************************************************
- * Perform background analog measurements for the temperature
- *  and the ambient light level.
- * The values are available at all time as the measurements take place in the
- *  background.
+ * The conversions are read through the TWI job queue, so the caller is
+ *  told from the reactor when a new value is available.
  */ 
 #include <asf.h>
+#include "twi_queue.h"
 #include "max1036.h"
 
+/** Setup and configuration bytes */
+static uint8_t _max1036_config[2];
+
+/** Last conversion, filled in by the read job */
+static uint8_t _max1036_data_received[1];
+
+/** Write the setup and configuration */
+static twi_job_t _max1036_config_job = {
+   .chip        = MAX1036_I2C_ADDR,
+   .addr_length = 0,
+   .buffer      = _max1036_config,
+   .length      = sizeof(_max1036_config),
+   .read        = false
+};
+
+/** Read a conversion */
+static twi_job_t _max1036_read_job = {
+   .chip        = MAX1036_I2C_ADDR,
+   .addr_length = 0,
+   .buffer      = _max1036_data_received,
+   .length      = sizeof(_max1036_data_received),
+   .read        = true
+};
+
 /** 
  * Initialise the max1036.
- * The twi interface MUST already be initialised along with its clock, pins etc.
+ * The twi job queue MUST already be initialised.
  * The configuration bits are spread between the config and setup register.
- * No initial conversion takes place.
+ * No initial conversion takes place. The configuration is queued, so it
+ *  completes before any read queued afterwards.
  *
- * @param twi Pointer to the device being used
  * @param setupAndConfig Bit fields used to apply the config.
  */
-void max1036_init( TWI_t *twi, uint16_t setupAndConfig )
+void max1036_init( uint16_t setupAndConfig )
 {
-   uint8_t data[] = {
-      (MAX1036_REGISTER_SETUP_gc | MAX1036_RESET_CONFIG_gc | setupAndConfig) & 0xFF,
-      (MAX1036_REGISTER_CONFIG_gc | setupAndConfig) >> 8
-   };
-   
-   twi_package_t config = {
-      .chip         = MAX1036_I2C_ADDR,   // TWI slave bus address
-      .addr         = {1},
-      .addr_length  = 0,                  // TWI slave memory address data size
-      .buffer       = data,
-      .length       = sizeof(data),       // transfer data size (bytes)
-      .no_wait      = false
-   };
+   _max1036_config[0] = 
+      (MAX1036_REGISTER_SETUP_gc | MAX1036_RESET_CONFIG_gc | setupAndConfig) & 0xFF;
+   _max1036_config[1] = (MAX1036_REGISTER_CONFIG_gc | setupAndConfig) >> 8;
    
-   // Transmit
-   twi_master_write(twi, &config);
+   twi_queue_submit(&_max1036_config_job);
 }
 
 /** 
- * Grab the raw adc value
+ * Queue a conversion.
+ * Once the callback is called with a successful job, the value is
+ *  available with #max1036_get_raw.
  *
- * @param twi Pointer to the device being used
- * @param no_wait True to use a value filled in by the i2c interrupt
- * @return The raw 8-bit value
+ * @param callback Called from the reactor once the conversion is read
+ * @return false if the previous conversion has not completed yet
  */
-uint8_t max1036_read( TWI_t *twi, bool no_wait)
+bool max1036_read( twi_job_callback_t callback )
 {
-   static uint8_t data_received[1];
-   uint8_t retval;
-   
-   twi_package_t packet_read =
-   {
-      .chip        = MAX1036_I2C_ADDR, // TWI slave bus address
-      .addr        = {0},
-      .addr_length = 0,                // Address of the length
-      .buffer      = data_received,    // Storage area
-      .length      = sizeof(data_received), // transfer data size (bytes)
-      .no_wait     = no_wait
-   };
+   _max1036_read_job.callback = callback;
    
-   // Not waiting means we rely on the last values
-   if ( no_wait )
-   {
-      // Convert to signed number
-      retval = data_received[0];
-   }
-   
-   twi_master_read(twi, &packet_read);
-   
-   // If waiting use the value here and now
-   if ( ! no_wait )
-   {
-      // Convert to signed number
-      retval = data_received[0];
-   }
-   
-   return retval;
+   return twi_queue_submit(&_max1036_read_job);
+}
+
+/** @return The raw 8-bit value of the last conversion */
+uint8_t max1036_get_raw( void )
+{
+   return _max1036_data_received[0];
 }
 
 /**@}*/
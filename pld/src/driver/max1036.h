@@ -19,15 +19,23 @@
  * Driver for the max1036 declaration
  */
  
- #ifdef __cplusplus
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "twi_queue.h"
+
+#ifdef __cplusplus
 extern "C" {
 #endif
 
 /** Initialise the device */
-void max1036_init( TWI_t *twi, uint16_t setupAndConfig );
+void max1036_init( uint16_t setupAndConfig );
+
+/** Queue the read of a single value from the device */
+bool max1036_read( twi_job_callback_t callback );
 
-/** Read a single value from the device */
-uint8_t max1036_read( TWI_t *twi, bool no_wait);
+/** Value of the last read */
+uint8_t max1036_get_raw( void );
 
 /** Address is always set and not changeable */
 #define MAX1036_I2C_ADDR 0b1100100
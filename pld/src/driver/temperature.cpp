@@ -0,0 +1,155 @@
+/**
+ * @addtogroup driver
+ * @{
+ * @addtogroup temperature
+ * @{
+ *****************************************************************************
+ * Access to the system filtered temperature.
+ * A median of 3 rejects the odd corrupted reading, then a sliding average
+ *  smooths the result.
+ * The sensor is read through the TWI job queue, and the filters are updated
+ *  from the reactor once the read completes.
+ *****************************************************************************
+ * @file
+ * Implementation of the temperature driver
+ * @author software@arreckx.com
+ * @internal
+ */
+#include "lib/filter.hpp"
+
+extern "C" {
+
+#include <asf.h>
+
+#include "temperature.h"
+#include "tmp100.h"
+
+/**
+ * @def TEMPERATURE_FILTER_SIZE
+ * Size of the sliding average filter buffer for the temperature
+ */
+#ifndef TEMPERATURE_FILTER_SIZE
+   #define TEMPERATURE_FILTER_SIZE 16
+#endif
+
+/**
+ * @def TEMPERATURE_SPIKE_FILTER_SIZE
+ * Depth of the median filter used to reject isolated wrong readings
+ */
+#ifndef TEMPERATURE_SPIKE_FILTER_SIZE
+   #define TEMPERATURE_SPIKE_FILTER_SIZE 3
+#endif
+
+/**
+ * @def TEMPERATURE_ACTIVITY_THRESHOLD
+ * Distance in 1/16th of a degree between a reading and the average above
+ *  which the temperature is considered to be changing
+ */
+#ifndef TEMPERATURE_ACTIVITY_THRESHOLD
+   #define TEMPERATURE_ACTIVITY_THRESHOLD 4
+#endif
+
+/** Reject the spikes */
+static lib::MedianFilter<int16_t, TEMPERATURE_SPIKE_FILTER_SIZE> _spike_filter;
+
+/** Average the readings */
+static lib::BoxFilter<int16_t, TEMPERATURE_FILTER_SIZE> _average_filter;
+
+/** Current filtered temperature in 10th of a degrees */
+static int16_t _filtered_temperature = 0;
+
+/** True once the filters are loaded with a first reading */
+static bool _is_primed = false;
+
+/** True if the last reading was close to the average */
+static bool _is_settled = false;
+
+/**
+ * Update the current temperature readings
+ *
+ * @param raw_temp raw temperature
+ * @return The average temperature in 10th of a degrees
+ */
+static int16_t _update_temperature(int16_t raw_temp)
+{
+   int16_t median = _spike_filter.push(raw_temp);
+   int16_t deviation = median - _average_filter.get();
+   int16_t sum = _average_filter.push(median);
+   
+   _is_settled = 
+      deviation <= TEMPERATURE_ACTIVITY_THRESHOLD &&
+      deviation >= -TEMPERATURE_ACTIVITY_THRESHOLD;
+   
+   // The raw result is a 12bit representing 1/16th of a degree
+   // We return 1/10th of a degree
+   int16_t retval = (sum * 10l) / (TEMPERATURE_FILTER_SIZE * 16);
+
+   return retval;
+}
+
+/**
+ * Called from the reactor once the sensor has been read.
+ * A failed read is simply skipped.
+ *
+ * @param job The read job
+ */
+static void _on_temperature_read(twi_job_t *job)
+{
+   if ( job->status == STATUS_OK )
+   {
+      int16_t t = tmp100_get_raw();
+   
+      // Pre-fill the filters with the first raw measurement
+      if ( ! _is_primed )
+      {
+         _spike_filter.fill(t);
+         _average_filter.fill(t);
+         _is_primed = true;
+      }
+   
+      _filtered_temperature = _update_temperature(t);
+   }
+}
+
+/** @return The filtered temperature in 10th of a degrees */
+int16_t temperature_get_filtered(void)
+{
+   return _filtered_temperature;
+}
+
+/** @return true if the temperature can be sampled less often */
+bool temperature_is_settled(void)
+{
+   return _is_settled;
+}
+
+/** @return true once the filters are loaded with a first reading */
+bool temperature_is_primed(void)
+{
+   return _is_primed;
+}
+
+/** 
+ * Queue a new measurement. The filtered value is updated from the reactor.
+ *
+ * @return false if the previous measurement has not completed yet
+ */
+bool temperature_measure(void)
+{
+   return tmp100_read(&_on_temperature_read);
+}
+
+/** Initialise the temperature API, and queue a first measurement */
+void temperature_init(void)
+{
+   // Init the device driver
+   tmp100_init();
+
+   // The first reading loads the filters
+   temperature_measure();
+}
+
+} // End of extern "C"
+
+ /**@}*/
+ /**@} ---------------------------  End of file  --------------------------- */
@@ -14,14 +14,27 @@
  * @author gax
  */
 #include <stdint.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/** Initialise the API and queue a first measurement */
 void temperature_init(void);
+
+/** Queue a new measurement */
+bool temperature_measure(void);
+
+/** @return The filtered temperature in 10th of a degrees */
 int16_t temperature_get_filtered(void);
 
+/** @return true if the temperature is steady */
+bool temperature_is_settled(void);
+
+/** @return true once the filters are loaded with a first reading */
+bool temperature_is_primed(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -11,83 +11,101 @@
  * This driver provide basic access to the data.
  * The chip i2c address must be provided in full through the TMP100_I2C_ADDR
  *  macro.
- * The twi interface is not initialised by this API.
+ * The transfers go through the TWI job queue, which must be initialised
+ *  first.
  */
 
 #include <asf.h>
+#include "twi_queue.h"
 #include "tmp100.h"
 
+/** Second byte of a general call which resets the tmp100 */
+#define _TMP100_GENERAL_CALL_RESET 0b110
+
+/** Pointer register value of the temperature register */
+#define _TMP100_POINTER_TEMPERATURE 0b00
+
+/** Pointer register value of the configuration register */
+#define _TMP100_POINTER_CONFIG 0b01
+
+/** Configuration for a 12-bits precision */
+#define _TMP100_CONFIG_12_BITS 0b01100000
+
+/** Command byte for the general call reset */
+static uint8_t _tmp100_reset_command[] = { _TMP100_GENERAL_CALL_RESET };
+
+/** Configuration register value */
+static uint8_t _tmp100_config[] = { _TMP100_CONFIG_12_BITS };
+
+/** Raw temperature register, filled in by the read job */
+static uint8_t _tmp100_data_received[2];
+
+/** Issue a general call to the tmp100 to reset it */
+static twi_job_t _tmp100_reset_job = {
+   .chip        = 0, // General call
+   .addr_length = 0,
+   .buffer      = _tmp100_reset_command,
+   .length      = sizeof(_tmp100_reset_command),
+   .read        = false
+};
+
+/** Set the precision */
+static twi_job_t _tmp100_config_job = {
+   .chip        = TMP100_I2C_ADDR,
+   .addr        = {_TMP100_POINTER_CONFIG},
+   .addr_length = 1,
+   .buffer      = _tmp100_config,
+   .length      = sizeof(_tmp100_config),
+   .read        = false
+};
+
+/** Read the temperature register */
+static twi_job_t _tmp100_read_job = {
+   .chip        = TMP100_I2C_ADDR,
+   .addr        = {_TMP100_POINTER_TEMPERATURE},
+   .addr_length = 1,
+   .buffer      = _tmp100_data_received,
+   .length      = sizeof(_tmp100_data_received),
+   .read        = true
+};
+
 /** 
- * Grab the raw value from the temperature sensor
+ * Queue a read of the temperature register.
+ * Once the callback is called with a successful job, the value is
+ *  available with #tmp100_get_raw.
  *
- * @param twi Pointer to the two wire device used
- * @param no_wait True to use a value filled in by the i2c interrupt
- * @return The raw temperature as a signed 16-bits matching the value
- *          returned by the sensor
+ * @param callback Called from the reactor once the read completes
+ * @return false if the previous read has not completed yet
  */
-int16_t tmp100_read(TWI_t *twi, bool no_wait)
+bool tmp100_read(twi_job_callback_t callback)
 {
-   static uint8_t data_received[2];
-   int16_t raw = 0;
+   _tmp100_read_job.callback = callback;
    
-   // Not waiting means we rely on the last values   
-   if ( no_wait )
-   {
-      // Convert to signed number
-      raw = data_received[0]<<8 | data_received[1];
-   }
-         
-   twi_package_t packet_read =
-   {
-     .chip        = TMP100_I2C_ADDR, // TWI slave bus address
-     .addr        = {0},
-     .addr_length = 1, // Length of the address
-     .buffer      = data_received,  // Storage area
-     .length      = 2,               // transfer data size (bytes)
-     .no_wait    = no_wait
-   };
-
-   twi_master_read(twi, &packet_read);
+   return twi_queue_submit(&_tmp100_read_job);
+}
 
-   // If waiting use the value here and now   
-   if ( ! no_wait )
-   {
-      // Convert to signed number
-      raw = data_received[0]<<8 | data_received[1];
-   }         
+/** 
+ * @return The raw temperature of the last read as a signed 16-bits matching
+ *  the value returned by the sensor
+ */
+int16_t tmp100_get_raw(void)
+{
+   // Convert to signed number
+   int16_t raw = _tmp100_data_received[0]<<8 | _tmp100_data_received[1];
    
    // Remove unused bits
    return raw >> 4;
 }
 
-/** Init the driver */
-void tmp100_init(TWI_t *twi)
+/**
+ * Init the driver.
+ * The reset and the configuration are queued, so they complete before
+ *  any read queued afterwards.
+ */
+void tmp100_init(void)
 {
-   // Issue a general call to the tmp100 to reset it
-   twi_package_t packet = {
-      .chip        = 0, // General call
-      .addr        = {0b110},
-      .addr_length = 0,
-      .buffer      = 0,
-      .length      = 0,
-      .no_wait     = false
-   };
-   
-   twi_master_write(twi, &packet);
-    
-   // Set the precision as 12-bits
-   uint8_t data[] = { 0b01100000 };
-   
-   twi_package_t config = {
-      .chip         = TMP100_I2C_ADDR,      // TWI slave bus address
-      .addr         = {0b01},
-      .addr_length  = 1,   // TWI slave memory address data size
-      .buffer       = data,
-      .length       = 1,  // transfer data size (bytes)
-      .no_wait      = false
-   };
- 
-   twi_master_write(twi, &config);
+   twi_queue_submit(&_tmp100_reset_job);
+   twi_queue_submit(&_tmp100_config_job);
 }
 
  /**@}*/
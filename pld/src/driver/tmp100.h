@@ -13,16 +13,22 @@
  * @author gax
  */ 
 #include <stdint.h>
+#include <stdbool.h>
+
+#include "twi_queue.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /** Initialise the driver */
-void tmp100_init(TWI_t *twi);
+void tmp100_init(void);
+
+/** Queue a read of a single value */
+bool tmp100_read(twi_job_callback_t callback);
 
-/** Read a single value */
-int16_t tmp100_read(TWI_t *twi, bool no_wait);
+/** Value of the last read */
+int16_t tmp100_get_raw(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,479 @@
+/**
+ * @addtogroup driver
+ * @{
+ * @addtogroup twi_queue
+ * @{
+ *****************************************************************************
+ * The queue is a linked list of caller owned jobs, so no memory is reserved
+ *  up front and any number of jobs can be pending.
+ * The head of the queue is the job on the bus. When it completes, the
+ *  interrupt moves it onto the done list and starts the next one straight
+ *  away, so a burst of jobs keeps the bus busy with no gap.
+ * The reactor then empties the done list, calling the callbacks.
+ * \n
+ * A slave holding the bus would stall the queue forever. The job on the bus
+ *  is therefore aborted with #ERR_TIMEOUT by the next submission, even one
+ *  rejected, if it has not completed after #TWI_QUEUE_TIMEOUT. The sensors
+ *  are read from a timer, so a submission always comes.
+ * \n
+ * This driver replaces the ASF twim driver, which owns the TWI interrupt
+ *  vectors and can only handle a single transfer at a time.
+ *****************************************************************************
+ * @file
+ * TWI job queue implementation
+ * @author software@arreckx.com
+ * @internal
+ */
+
+#include <asf.h>
+#include <string.h>
+
+#include "lib/timer.h"
+#include "lib/reactor.h"
+#include "lib/governor.h"
+#include "driver/twi_queue.h"
+
+/************************************************************************/
+/* Local defines                                                        */
+/************************************************************************/
+
+#if !defined TWI_QUEUE_TWI || !defined TWI_QUEUE_TWIM_vect
+#  error "The TWI queue requires TWI_QUEUE_TWI and TWI_QUEUE_TWIM_vect to be defined"
+#endif
+
+/**
+ * @def TWI_QUEUE_SPEED
+ * Bus clock in Hz. Normal i2c for all.
+ */
+#ifndef TWI_QUEUE_SPEED
+#  define TWI_QUEUE_SPEED 100000
+#endif
+
+/**
+ * @def TWI_QUEUE_TIMEOUT
+ * Time after which a job still on the bus is considered stuck
+ */
+#ifndef TWI_QUEUE_TIMEOUT
+#  define TWI_QUEUE_TIMEOUT TIMER_MILLISECONDS(20)
+#endif
+
+/**
+ * Number of ticks of a time stamp per millisecond of the timer service.
+ * A tick is 8us whatever the clock the governor sets.
+ */
+#define _TWI_QUEUE_TICKS_PER_MS 125
+
+/************************************************************************/
+/* Local variables                                                      */
+/************************************************************************/
+
+/** Job on the bus, followed by the pending jobs */
+static twi_job_t *_twi_queue_head = NULL;
+
+/** Last pending job */
+static twi_job_t *_twi_queue_tail = NULL;
+
+/** Completed jobs waiting for the reactor */
+static twi_job_t *_twi_queue_done_head = NULL;
+
+/** Last completed job */
+static twi_job_t *_twi_queue_done_tail = NULL;
+
+/** Number of address bytes sent for the job on the bus */
+static uint8_t _twi_queue_addr_count = 0;
+
+/** Number of data bytes transferred for the job on the bus */
+static uint8_t _twi_queue_data_count = 0;
+
+/** Time stamp of the start of the job on the bus */
+static uint16_t _twi_queue_started = 0;
+
+/** Timer count of the start of the job on the bus, to detect a stuck bus */
+static timer_count_t _twi_queue_started_ms = 0;
+
+/** Bus statistics */
+static twi_queue_stats_t _twi_queue_stats = {0};
+
+/** Timer count of the last reset of the statistics */
+static timer_count_t _twi_queue_stats_since = 0;
+
+/** Reactor handle to process the callbacks */
+static reactor_handle_t _twi_queue_reactor_handle = 0;
+
+/************************************************************************/
+/* Local functions                                                      */
+/************************************************************************/
+
+/**
+ * Combine the timer service counter and the hardware counter for a fine
+ *  time stamp. The value wraps around every 524ms which is plenty for a job.
+ * The hardware counts PER+1 per millisecond, which the governor changes with
+ *  the clock (126 at full speed, 252 at the slowest), so its count is scaled
+ *  to the ticks of the stamp.
+ * With the interrupts disabled across a roll over, the value can be 1ms
+ *  short, which only affects the statistics.
+ *
+ * @return A time stamp in ticks of 8us
+ */
+static uint16_t _twi_queue_timestamp( void )
+{
+   uint16_t count;
+   timer_count_t ms;
+
+   // Read again if the counter rolled over in between
+   do
+   {
+      count = tc_read_count( &TIMER_TC );
+      ms = timer_get_count();
+   } while ( tc_read_count( &TIMER_TC ) < count );
+
+   return (uint16_t)ms * _TWI_QUEUE_TICKS_PER_MS
+      + (uint16_t)( (uint32_t)count * _TWI_QUEUE_TICKS_PER_MS
+         / ((uint32_t)tc_read_period( &TIMER_TC ) + 1) );
+}
+
+/**
+ * Put a job on the bus by sending its slave address.
+ * Called with the TWI interrupt held off.
+ *
+ * @param now Time stamp of the start
+ */
+static void _twi_queue_start( uint16_t now )
+{
+   twi_job_t *job = _twi_queue_head;
+   uint8_t address = job->chip << 1;
+
+   _twi_queue_addr_count = 0;
+   _twi_queue_data_count = 0;
+   _twi_queue_started = now;
+   _twi_queue_started_ms = timer_get_count();
+
+   // Read straight away if there is no register address to write first
+   if ( job->read && job->addr_length == 0 )
+   {
+      address |= 0x01;
+   }
+
+   TWI_QUEUE_TWI.MASTER.ADDR = address;
+}
+
+/**
+ * Complete the job on the bus, and start the next one.
+ * Called with the TWI interrupt held off. The caller must notify the reactor.
+ *
+ * @param status Outcome of the job
+ */
+static void _twi_queue_complete( int8_t status )
+{
+   twi_job_t *job = _twi_queue_head;
+   uint16_t now = _twi_queue_timestamp();
+   uint16_t latency = now - job->submitted;
+
+   job->status = status;
+
+   // Account for the job
+   _twi_queue_stats.busy_ticks += (uint16_t)(now - _twi_queue_started);
+   _twi_queue_stats.latency_last = latency;
+
+   if ( latency > _twi_queue_stats.latency_max )
+   {
+      _twi_queue_stats.latency_max = latency;
+   }
+
+   if ( status == STATUS_OK )
+   {
+      ++_twi_queue_stats.done;
+   }
+   else if ( status == ERR_TIMEOUT )
+   {
+      ++_twi_queue_stats.timeouts;
+   }
+   else
+   {
+      ++_twi_queue_stats.errors;
+   }
+
+   // Move onto the done list
+   _twi_queue_head = job->next;
+   job->next = NULL;
+
+   if ( _twi_queue_done_tail )
+   {
+      _twi_queue_done_tail->next = job;
+   }
+   else
+   {
+      _twi_queue_done_head = job;
+   }
+
+   _twi_queue_done_tail = job;
+
+   // Chain the next job without releasing the bus for long
+   if ( _twi_queue_head )
+   {
+      _twi_queue_start( now );
+   }
+   else
+   {
+      _twi_queue_tail = NULL;
+      sleepmgr_unlock_mode( SLEEPMGR_IDLE );
+   }
+}
+
+/**
+ * Called by the reactor to process the completed jobs in order.
+ * A callback may submit its job again straight away.
+ */
+static void _twi_queue_dispatch( void )
+{
+   twi_job_t *job;
+
+   while ( true )
+   {
+      cli();
+      job = _twi_queue_done_head;
+
+      if ( job )
+      {
+         _twi_queue_done_head = job->next;
+
+         if ( _twi_queue_done_head == NULL )
+         {
+            _twi_queue_done_tail = NULL;
+         }
+
+         job->next = NULL;
+         job->busy = false;
+      }
+
+      sei();
+
+      if ( job == NULL )
+      {
+         break;
+      }
+
+      if ( job->callback )
+      {
+         job->callback( job );
+      }
+   }
+}
+
+/** Keep the speed of the bus as the clock changes */
+static void _twi_queue_on_clock_change( uint8_t shift )
+{
+   (void)shift;
+   TWI_QUEUE_TWI.MASTER.BAUD = TWI_BAUD( governor_get_hz(), TWI_QUEUE_SPEED );
+}
+
+/** TWI master interrupt. Run the state machine of the job on the bus. */
+ISR( TWI_QUEUE_TWIM_vect )
+{
+   twi_job_t *job = _twi_queue_head;
+   uint8_t status = TWI_QUEUE_TWI.MASTER.STATUS;
+
+   // Spurious, or the job was aborted
+   if ( job == NULL )
+   {
+      TWI_QUEUE_TWI.MASTER.STATUS = status;
+      return;
+   }
+
+   if ( status & TWI_MASTER_ARBLOST_bm )
+   {
+      TWI_QUEUE_TWI.MASTER.STATUS = status | TWI_MASTER_ARBLOST_bm;
+      TWI_QUEUE_TWI.MASTER.CTRLC = TWI_MASTER_CMD_STOP_gc;
+      _twi_queue_complete( ERR_BUSY );
+   }
+   else if ( status & (TWI_MASTER_BUSERR_bm | TWI_MASTER_RXACK_bm) )
+   {
+      TWI_QUEUE_TWI.MASTER.CTRLC = TWI_MASTER_CMD_STOP_gc;
+      _twi_queue_complete( ERR_IO_ERROR );
+   }
+   else if ( status & TWI_MASTER_WIF_bm )
+   {
+      if ( _twi_queue_addr_count < job->addr_length )
+      {
+         TWI_QUEUE_TWI.MASTER.DATA = job->addr[_twi_queue_addr_count++];
+         return;
+      }
+      else if ( job->read )
+      {
+         // Repeated start to read
+         TWI_QUEUE_TWI.MASTER.ADDR = (job->chip << 1) | 0x01;
+         return;
+      }
+      else if ( _twi_queue_data_count < job->length )
+      {
+         TWI_QUEUE_TWI.MASTER.DATA = job->buffer[_twi_queue_data_count++];
+         return;
+      }
+
+      TWI_QUEUE_TWI.MASTER.CTRLC = TWI_MASTER_CMD_STOP_gc;
+      _twi_queue_complete( STATUS_OK );
+   }
+   else if ( status & TWI_MASTER_RIF_bm )
+   {
+      job->buffer[_twi_queue_data_count++] = TWI_QUEUE_TWI.MASTER.DATA;
+
+      if ( _twi_queue_data_count < job->length )
+      {
+         TWI_QUEUE_TWI.MASTER.CTRLC = TWI_MASTER_CMD_RECVTRANS_gc;
+         return;
+      }
+
+      // Nack the last byte
+      TWI_QUEUE_TWI.MASTER.CTRLC = TWI_MASTER_ACKACT_bm | TWI_MASTER_CMD_STOP_gc;
+      _twi_queue_complete( STATUS_OK );
+   }
+   else
+   {
+      TWI_QUEUE_TWI.MASTER.CTRLC = TWI_MASTER_CMD_STOP_gc;
+      _twi_queue_complete( ERR_PROTOCOL );
+   }
+
+   reactor_notify( _twi_queue_reactor_handle );
+}
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/**
+ * Initialise the bus as master and the queue.
+ * The interrupts are enabled at medium level.
+ */
+void twi_queue_init( void )
+{
+   sysclk_enable_peripheral_clock( &TWI_QUEUE_TWI );
+
+   TWI_QUEUE_TWI.MASTER.BAUD = TWI_BAUD( governor_get_hz(), TWI_QUEUE_SPEED );
+   TWI_QUEUE_TWI.MASTER.CTRLA =
+      TWI_MASTER_INTLVL_MED_gc | TWI_MASTER_RIEN_bm | TWI_MASTER_WIEN_bm | TWI_MASTER_ENABLE_bm;
+   TWI_QUEUE_TWI.MASTER.STATUS = TWI_MASTER_BUSSTATE_IDLE_gc;
+
+   PMIC.CTRL |= PMIC_MEDLVLEN_bm;
+
+   _twi_queue_reactor_handle = reactor_register( &_twi_queue_dispatch );
+   governor_register( &_twi_queue_on_clock_change );
+   _twi_queue_stats_since = timer_get_count();
+}
+
+/**
+ * Add a job at the end of the queue. If the bus is free, the job starts
+ *  straight away.
+ * The callback of the job is called from the reactor once the job completes,
+ *  whether it succeeded or not.
+ * Can be called from the reactor callbacks, but not from an interrupt.
+ *
+ * @param job The job to process. It must remain valid until its callback.
+ * @return false if the job is still busy from a previous submission
+ */
+bool twi_queue_submit( twi_job_t *job )
+{
+   uint16_t now = _twi_queue_timestamp();
+   bool aborted = false;
+   bool retval = false;
+
+   cli();
+
+   // Unlock the queue if the job on the bus is stuck. Checked before the job
+   //  can be rejected, since all the jobs can be queued behind the stuck one
+   if ( _twi_queue_head &&
+        timer_time_lapsed_since(_twi_queue_started_ms) > TWI_QUEUE_TIMEOUT )
+   {
+      TWI_QUEUE_TWI.MASTER.CTRLC = TWI_MASTER_CMD_STOP_gc;
+      TWI_QUEUE_TWI.MASTER.STATUS = TWI_MASTER_BUSSTATE_IDLE_gc;
+      _twi_queue_complete( ERR_TIMEOUT );
+      aborted = true;
+   }
+
+   if ( job->busy )
+   {
+      ++_twi_queue_stats.rejected;
+   }
+   else
+   {
+      job->busy = true;
+      job->status = OPERATION_IN_PROGRESS;
+      job->submitted = now;
+      job->next = NULL;
+
+      if ( _twi_queue_head )
+      {
+         _twi_queue_tail->next = job;
+         _twi_queue_tail = job;
+      }
+      else
+      {
+         // The bus is clocked in idle only
+         sleepmgr_lock_mode( SLEEPMGR_IDLE );
+         _twi_queue_head = _twi_queue_tail = job;
+         _twi_queue_start( now );
+      }
+
+      retval = true;
+   }
+
+   sei();
+
+   if ( aborted )
+   {
+      reactor_notify( _twi_queue_reactor_handle );
+   }
+
+   return retval;
+}
+
+/**
+ * Copy the statistics with the interrupts held off, so the values are
+ *  consistent with each other.
+ *
+ * @param pStats Where to copy the statistics
+ */
+void twi_queue_get_stats( twi_queue_stats_t *pStats )
+{
+   cli();
+   *pStats = _twi_queue_stats;
+   sei();
+}
+
+/**
+ * Compute the share of the time the bus was driven since the statistics
+ *  were last reset.
+ *
+ * @return The utilisation in 1/1000th
+ */
+uint16_t twi_queue_get_utilisation( void )
+{
+   uint32_t busy;
+   timer_count_t elapsed = timer_time_lapsed_since( _twi_queue_stats_since );
+
+   cli();
+   busy = _twi_queue_stats.busy_ticks;
+   sei();
+
+   if ( elapsed == 0 )
+   {
+      return 0;
+   }
+
+   // The busy time is in 8us ticks
+   return (uint16_t)(
+      ((uint64_t)busy * 1000) / ((uint64_t)elapsed * _TWI_QUEUE_TICKS_PER_MS) );
+}
+
+/** Clear all the counters, and restart the utilisation measurement */
+void twi_queue_reset_stats( void )
+{
+   timer_count_t now = timer_get_count();
+
+   cli();
+   memset( &_twi_queue_stats, 0, sizeof(_twi_queue_stats) );
+   _twi_queue_stats_since = now;
+   sei();
+}
+
+/**@}*/
+/**@} ---------------------------  End of file  --------------------------- */
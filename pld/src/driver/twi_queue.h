@@ -0,0 +1,153 @@
+#ifndef twi_queue_h_HAS_ALREADY_BEEN_INCLUDED
+#define twi_queue_h_HAS_ALREADY_BEEN_INCLUDED
+/**
+ * @addtogroup driver
+ * @{
+ * @addtogroup twi_queue
+ * @{
+ *****************************************************************************
+ * Interrupt driven i2c master with a queue of transactions.
+ * Each transaction is described by a job, owned by the caller and usually
+ *  static, which is chained to the queue when submitted.
+ * The jobs are processed back-to-back by the TWI interrupt, so no code ever
+ *  waits for the bus.
+ * Once a job completes, its callback is called from the reactor, in the
+ *  order the jobs were submitted.
+ * A job must not be modified nor submitted again until its callback has
+ *  been called.
+ * \n
+ * The bus utilisation, errors and latency are accounted for and can be
+ *  retrieved with #twi_queue_get_stats.
+ * \n
+ * Example:
+ * @code
+ * static uint8_t data[2];
+ * static twi_job_t job = {
+ *    .chip        = 0x49,
+ *    .addr        = {0},
+ *    .addr_length = 1,
+ *    .buffer      = data,
+ *    .length      = sizeof(data),
+ *    .read        = true,
+ *    .callback    = &on_read
+ * };
+ *
+ * twi_queue_submit( &job );
+ * @endcode
+ *****************************************************************************
+ * @file
+ * TWI job queue API declaration
+ * @author software@arreckx.com
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/************************************************************************/
+/* Public types                                                         */
+/************************************************************************/
+
+/** @cond */
+struct twi_job_s;
+/** @endcond */
+
+/** Called from the reactor once a job has completed */
+typedef void (*twi_job_callback_t)( struct twi_job_s *job );
+
+/** Description of a single i2c transaction */
+typedef struct twi_job_s
+{
+   /** 7-bits slave address. 0 for the general call */
+   uint8_t chip;
+
+   /** Register address or command bytes written first */
+   uint8_t addr[3];
+
+   /** Number of bytes in addr */
+   uint8_t addr_length;
+
+   /** Data written or read */
+   uint8_t *buffer;
+
+   /** Number of bytes in buffer */
+   uint8_t length;
+
+   /** True to read the data, false to write it */
+   bool read;
+
+   /** Function called from the reactor on completion. Can be NULL. */
+   twi_job_callback_t callback;
+
+   /** Outcome of the job, as an ASF status code. Valid in the callback. */
+   volatile int8_t status;
+
+   /** @cond internal */
+   /** True from submission to the callback */
+   volatile bool busy;
+
+   /** Next job in the queue */
+   struct twi_job_s *next;
+
+   /** Time stamp of the submission */
+   uint16_t submitted;
+   /** @endcond */
+} twi_job_t;
+
+/**
+ * Bus statistics. Times are counted in ticks of 8us, 125 per millisecond of
+ *  the timer service at any clock speed.
+ */
+typedef struct
+{
+   /** Number of jobs completed successfully */
+   uint16_t done;
+
+   /** Number of jobs which completed in error (no ack, bus error, lost arbitration) */
+   uint16_t errors;
+
+   /** Number of jobs aborted as the bus was stuck */
+   uint16_t timeouts;
+
+   /** Number of submissions refused as the job was still busy */
+   uint16_t rejected;
+
+   /** Time from submission to completion of the last job */
+   uint16_t latency_last;
+
+   /** Longest time from submission to completion */
+   uint16_t latency_max;
+
+   /** Total time the bus was driven */
+   uint32_t busy_ticks;
+} twi_queue_stats_t;
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/** Initialise the bus and the queue */
+void twi_queue_init( void );
+
+/** Queue a job. @return false if the job is still busy */
+bool twi_queue_submit( twi_job_t *job );
+
+/** Take a consistent copy of the bus statistics since the last reset */
+void twi_queue_get_stats( twi_queue_stats_t *pStats );
+
+/** @return The bus utilisation since the last reset in 1/1000th */
+uint16_t twi_queue_get_utilisation( void );
+
+/** Clear the statistics */
+void twi_queue_reset_stats( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@} twi_queue */
+/**@} driver */
+#endif /* ndef twi_queue_h_HAS_ALREADY_BEEN_INCLUDED */
@@ -12,6 +12,7 @@
 #include <assert.h>
 
 #include "alert.h"
+#include "core/journal.h"
 
 #ifdef ALERT_RECORD
 #   ifndef ALERT_RECORD_OFFSET
@@ -22,7 +23,8 @@
 /**
  * We need to initialize the alert API
  * For LED notification, we need to set the LED direction.
- * For EEPROM storage, we need to ready some variables
+ * The alerts are recorded in the journal in EEPROM, which needs no
+ *  preparation.
  */
 void alert_init( void )
 {
@@ -50,6 +52,9 @@ void alert_init( void )
  */
 void alert_record( bool doAbort, int line, const char *file )
 {
+   // Keep a trace through the reset, once per line
+   journal_record_alert( doAbort, line );
+
    // Output to stdout?
    #ifdef ALERT_TO_STDOUT
    {
@@ -14,9 +14,9 @@
  *  fault has occurred.
  * The output mode goes from :
  *  - flashing an LED 
- *  - writing to the internal EEPROM
  *  - writing to the UART 
- * ... depending on the configuration.
+ * ... depending on the configuration. The alerts are also recorded in the
+ *  journal in EEPROM, once per line in a boot, so they survive the reset.
  *****************************************************************************
  * @file
  * Alert reporting API header
@@ -0,0 +1,273 @@
+/**
+ * @addtogroup service
+ * @{
+ * @addtogroup civil
+ * @{
+ *****************************************************************************
+ * The conversions work on a calendar whose years start on the 1st of March
+ *  and whose origin is the 1st of March 1600.
+ * 1600 is a multiple of 400 years, so the supported range (1970-2106) spans
+ *  two 400 years eras only, and all intermediate values remain positive.
+ * Within an era, the number of days only depends on the year of the era and
+ *  the day of the (shifted) year, with no table nor loop.
+ *****************************************************************************
+ * @file
+ * Implementation of the civil date conversion API
+ * @author software@arreckx.com
+ * @internal
+ */
+
+#include <stdbool.h>
+
+#include "civil.h"
+
+/************************************************************************/
+/* Local constants                                                      */
+/************************************************************************/
+
+/** Number of days in a 400 years era */
+#define _CIVIL_DAYS_PER_ERA 146097UL
+
+/** Days from 1600-03-01 (origin of the computation) to 1970-01-01 */
+#define _CIVIL_EPOCH_SHIFT 135080UL
+
+/** First year of the computation */
+#define _CIVIL_BASE_YEAR 1600
+
+/** First year of the range */
+#define _CIVIL_EPOCH_YEAR 1970
+
+/** Last year of the range */
+#define _CIVIL_LAST_YEAR 2106
+
+/** Last day of the range, 2106-02-07, in days since the epoch */
+#define _CIVIL_LAST_DAY 49710U
+
+/** Last second of the last day of the range, 06:28:15 */
+#define _CIVIL_LAST_SECOND_OF_DAY (UINT32_MAX - _CIVIL_LAST_DAY * CIVIL_SECS_PER_DAY)
+
+/** Index of the march month (0 based) */
+#define _CIVIL_MARCH 2
+
+/** Day of the week of the 1st of January 1970 (a Thursday) */
+#define _CIVIL_EPOCH_DAY_OF_WEEK 4
+
+/** Margin taken off the build date, since __DATE__ is the local build date */
+#define _CIVIL_BUILD_DATE_MARGIN CIVIL_SECS_PER_DAY
+
+/************************************************************************/
+/* Local variables                                                      */
+/************************************************************************/
+
+/** Length of the months of a common year */
+static const uint8_t _civil_month_length[12] =
+   { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+/** Cache the build timestamp to parse __DATE__ once only */
+static uint32_t _civil_build_timestamp = 0;
+
+/************************************************************************/
+/* Local functions                                                      */
+/************************************************************************/
+
+/** @return The number of days of a month (0 based) of a year */
+static uint8_t _civil_days_in_month( uint16_t year, uint8_t month )
+{
+   bool isLeap = (year % 4 == 0) && (year % 100 != 0 || year % 400 == 0);
+
+   return _civil_month_length[month] + (month == 1 && isLeap);
+}
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/**
+ * Compute the number of days elapsed since the 1st of January 1970.
+ *
+ * @param year Full year (1970-2106)
+ * @param month Month of the year. 0 is January.
+ * @param day Day of the month. 0 is the first day of the month.
+ * @return The number of days since the epoch
+ */
+uint16_t civil_days_from_civil( uint16_t year, uint8_t month, uint8_t day )
+{
+   uint8_t shiftedMonth;
+   uint16_t yearOfEra;
+   uint16_t dayOfYear;
+   uint32_t dayOfEra;
+   uint32_t days = 0;
+
+   // Start the year in March, so January and February belong to the previous year
+   if ( month < _CIVIL_MARCH )
+   {
+      --year;
+      shiftedMonth = month + 10;
+   }
+   else
+   {
+      shiftedMonth = month - _CIVIL_MARCH;
+   }
+
+   yearOfEra = year - _CIVIL_BASE_YEAR;
+
+   if ( yearOfEra >= 400 )
+   {
+      yearOfEra -= 400;
+      days = _CIVIL_DAYS_PER_ERA;
+   }
+
+   // Month lengths from March are 31,30,31,30,31,31,30,31,30,31,31,(28|29)
+   dayOfYear = (153 * shiftedMonth + 2) / 5 + day;
+   dayOfEra  = (uint32_t)yearOfEra * 365 + yearOfEra/4 - yearOfEra/100 + dayOfYear;
+
+   return (uint16_t)(days + dayOfEra - _CIVIL_EPOCH_SHIFT);
+}
+
+/**
+ * Convert a number of days since the epoch into a date.
+ * Only the year, month, date and day of week are filled in.
+ *
+ * @param days Number of days since the 1st of January 1970
+ * @param pDate Date to fill in
+ */
+void civil_from_days( uint16_t days, struct calendar_date *pDate )
+{
+   uint32_t dayOfEra = (uint32_t)days + _CIVIL_EPOCH_SHIFT;
+   uint16_t year = _CIVIL_BASE_YEAR;
+   uint16_t yearOfEra;
+   uint16_t dayOfYear;
+   uint8_t shiftedMonth;
+
+   if ( dayOfEra >= _CIVIL_DAYS_PER_ERA )
+   {
+      dayOfEra -= _CIVIL_DAYS_PER_ERA;
+      year += 400;
+   }
+
+   // Remove the leap days (every 4 years but the centuries but every 400 years)
+   yearOfEra = (dayOfEra - dayOfEra/1460 + dayOfEra/36524 - dayOfEra/146096) / 365;
+   dayOfYear = dayOfEra - ((uint32_t)yearOfEra * 365 + yearOfEra/4 - yearOfEra/100);
+
+   shiftedMonth = (5 * dayOfYear + 2) / 153;
+
+   pDate->date  = dayOfYear - (153 * shiftedMonth + 2) / 5;
+   pDate->month = shiftedMonth < 10 ? shiftedMonth + _CIVIL_MARCH : shiftedMonth - 10;
+   pDate->year  = year + yearOfEra + (pDate->month < _CIVIL_MARCH);
+   pDate->dayofweek = (days + _CIVIL_EPOCH_DAY_OF_WEEK) % 7;
+}
+
+/**
+ * Convert a date into a Unix timestamp.
+ * The day of the week is ignored.
+ *
+ * @param pDate Date to convert
+ * @return The Unix timestamp or 0 if the date is not valid, or out of range
+ */
+uint32_t civil_date_to_timestamp( const struct calendar_date *pDate )
+{
+   if (
+      pDate->year < _CIVIL_EPOCH_YEAR || pDate->year > _CIVIL_LAST_YEAR ||
+      pDate->month >= 12 || pDate->date >= _civil_days_in_month(pDate->year, pDate->month) ||
+      pDate->hour >= 24 || pDate->minute >= 60 || pDate->second >= 60 )
+   {
+      return 0;
+   }
+
+   uint16_t days = civil_days_from_civil( pDate->year, pDate->month, pDate->date );
+   uint32_t secsOfDay =
+      (uint32_t)pDate->hour * 3600 + (uint16_t)pDate->minute * 60 + pDate->second;
+
+   // The last day of the range ends in the morning
+   if ( days > _CIVIL_LAST_DAY || (days == _CIVIL_LAST_DAY && secsOfDay > _CIVIL_LAST_SECOND_OF_DAY) )
+   {
+      return 0;
+   }
+
+   return (uint32_t)days * CIVIL_SECS_PER_DAY + secsOfDay;
+}
+
+/**
+ * Convert a Unix timestamp into a date.
+ * All fields are filled in, including the day of the week.
+ *
+ * @param timestamp Unix timestamp to convert
+ * @param pDate Date to fill in
+ */
+void civil_timestamp_to_date( uint32_t timestamp, struct calendar_date *pDate )
+{
+   uint16_t days = timestamp / CIVIL_SECS_PER_DAY;
+   uint32_t secsOfDay = timestamp - (uint32_t)days * CIVIL_SECS_PER_DAY;
+   uint8_t hour = secsOfDay / 3600;
+   uint16_t secsOfHour = secsOfDay - (uint32_t)hour * 3600;
+   uint8_t minute = secsOfHour / 60;
+
+   pDate->hour   = hour;
+   pDate->minute = minute;
+   pDate->second = secsOfHour - minute * 60;
+
+   civil_from_days( days, pDate );
+}
+
+/**
+ * Parse the __DATE__ macro ("Mmm dd yyyy") once.
+ *
+ * @return The Unix timestamp of the start of the build day
+ */
+uint32_t civil_build_timestamp( void )
+{
+   if ( _civil_build_timestamp == 0 )
+   {
+      const char *d = __DATE__;
+      uint8_t month;
+      uint8_t day = (d[4] == ' ' ? 0 : d[4] - '0') * 10 + (d[5] - '0');
+      uint16_t year =
+         (d[7] - '0') * 1000 + (d[8] - '0') * 100 + (d[9] - '0') * 10 + (d[10] - '0');
+
+      switch ( d[0] )
+      {
+         case 'J': month = (d[1] == 'a') ? 0 : (d[2] == 'n' ? 5 : 6); break;
+         case 'F': month = 1; break;
+         case 'M': month = (d[2] == 'r') ? 2 : 4; break;
+         case 'A': month = (d[1] == 'p') ? 3 : 7; break;
+         case 'S': month = 8; break;
+         case 'O': month = 9; break;
+         case 'N': month = 10; break;
+         default:  month = 11; break;
+      }
+
+      _civil_build_timestamp =
+         (uint32_t)civil_days_from_civil( year, month, day - 1 ) * CIVIL_SECS_PER_DAY;
+   }
+
+   return _civil_build_timestamp;
+}
+
+/**
+ * The GPS broadcasts the week number on 10 bits only, so a receiver
+ *  which does not know the current epoch reports a date 1024 weeks
+ *  (or a multiple of) in the past.
+ * Since the time received cannot be older than the firmware itself, add as
+ *  many roll over periods as required to be past the build date.
+ *
+ * @param timestamp UTC timestamp decoded from the GPS
+ * @return The corrected timestamp
+ */
+uint32_t civil_gps_resolve_rollover( uint32_t timestamp )
+{
+   uint32_t oldest = civil_build_timestamp() - _CIVIL_BUILD_DATE_MARGIN;
+
+   if ( timestamp < oldest )
+   {
+      uint8_t periods =
+         (oldest - timestamp + CIVIL_GPS_ROLLOVER_SECS - 1) / CIVIL_GPS_ROLLOVER_SECS;
+
+      timestamp += periods * CIVIL_GPS_ROLLOVER_SECS;
+   }
+
+   return timestamp;
+}
+
+/**@} civil */
+/**@} service */
+/*---------------------------  End of file  --------------------------- */
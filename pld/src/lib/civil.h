@@ -0,0 +1,84 @@
+#ifndef civil_h_HAS_ALREADY_BEEN_INCLUDED
+#define civil_h_HAS_ALREADY_BEEN_INCLUDED
+/**
+ * @addtogroup service
+ * @{
+ * @addtogroup civil
+ * Constant time civil date conversions
+ * @{
+ *****************************************************************************
+ * Converts between a count of days (or seconds) since the Unix epoch and
+ *  a civil date, without iterating over the years or the months.
+ * The ASF calendar service walks the calendar one year and one month at a
+ *  time, which costs hundreds of 32-bit operations on the AVR.
+ * This API relies on the days-from-civil / civil-from-days algorithms which
+ *  shift the year to start in March, so the leap day is always the last day
+ *  of the year and the month lengths follow a simple linear pattern.
+ * \n
+ * The valid range is 1970-01-01 to 2106-02-07, which is the range of an
+ *  unsigned 32-bit Unix timestamp.
+ * \n
+ * The date structure is the ASF calendar structure, so months and days of the
+ *  month are 0 based.
+ * \n
+ * Example:
+ * @code
+ * #include "lib/civil.h"
+ * struct calendar_date date;
+ * civil_timestamp_to_date( rtc_get_time(), &date );
+ * @endcode
+ *****************************************************************************
+ * @file
+ * Civil date conversion API
+ * @author software@arreckx.com
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "calendar.h"
+
+/************************************************************************/
+/* Public constants                                                     */
+/************************************************************************/
+
+/** Number of seconds in a day */
+#define CIVIL_SECS_PER_DAY 86400UL
+
+/** A GPS week number is coded on 10 bits and rolls over every 1024 weeks */
+#define CIVIL_GPS_ROLLOVER_DAYS (1024UL * 7)
+
+/** Number of seconds in a GPS week number roll over period */
+#define CIVIL_GPS_ROLLOVER_SECS (CIVIL_GPS_ROLLOVER_DAYS * CIVIL_SECS_PER_DAY)
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/** Number of days since 1970-01-01 of a date. Month and day are 0 based. */
+uint16_t civil_days_from_civil( uint16_t year, uint8_t month, uint8_t day );
+
+/** Fill in the year, month, date and day of week from a number of days */
+void civil_from_days( uint16_t days, struct calendar_date *pDate );
+
+/** Convert a date into a Unix timestamp */
+uint32_t civil_date_to_timestamp( const struct calendar_date *pDate );
+
+/** Convert a Unix timestamp into a date */
+void civil_timestamp_to_date( uint32_t timestamp, struct calendar_date *pDate );
+
+/** @return The Unix timestamp of the day the firmware was built */
+uint32_t civil_build_timestamp( void );
+
+/** Undo the GPS week number roll overs of a timestamp */
+uint32_t civil_gps_resolve_rollover( uint32_t timestamp );
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@} civil */
+/**@} service */
+#endif /* civil_h_HAS_ALREADY_BEEN_INCLUDED */
@@ -0,0 +1,100 @@
+#ifndef lib_coroutine_hpp_HAS_ALREADY_BEEN_INCLUDED
+#define lib_coroutine_hpp_HAS_ALREADY_BEEN_INCLUDED
+/**
+ * @addtogroup service
+ * @{
+ * @addtogroup coroutine
+ * @{
+ *****************************************************************************
+ * Stackless coroutines, for the displays and the modes.
+ * A display or a mode is stepped by the sequencer, and returns the time
+ *  until its next step, which the sequencer arms with the timer service.
+ *  A coroutine writes this sequence of steps as straight-line code: each
+ *  #CO_DELAY returns the time to wait, and the next step resumes right
+ *  after it.
+ * The only state kept is the point to resume at, in the #lib::Coroutine
+ *  base, so the frame of the coroutine is the object itself and its size
+ *  is known at compile time. No heap, no stack of its own.
+ * \n
+ * The locals of the step function are lost at each suspension, so what
+ *  must survive goes in members. A local must be declared before
+ *  #CO_BEGIN, or within a block with no suspension point. A #CO_DELAY
+ *  cannot be used within a switch of the coroutine, and a delay of 0 would
+ *  end it.
+ * \n
+ * Example:
+ * @code
+ * #include "lib/coroutine.hpp"
+ * class Blink : public lib::Coroutine
+ * {
+ * public:
+ *    timer_count_t display()
+ *    {
+ *       CO_BEGIN;
+ *       for (;;)
+ *       {
+ *          fb_turn_on(led);
+ *          CO_DELAY( TIMER_MILLISECONDS(500) );
+ *          CO_DELAY( TIMER_MILLISECONDS(500) ); // Left off
+ *       }
+ *       CO_END;
+ *    }
+ * };
+ * @endcode
+ *****************************************************************************
+ * @file
+ * Header only stackless coroutine
+ * @author software@arreckx.com
+ */
+
+#include <stdint.h>
+
+#include "lib/timer.h"
+
+namespace lib
+{
+   /**
+    * Base of a coroutine. Keeps the point to resume at.
+    */
+   class Coroutine
+   {
+   protected:
+      /** Line of the suspension point to resume at, or 0 from the start */
+      uint16_t co_line;
+
+   public:
+      /** Start from the top */
+      constexpr Coroutine() : co_line(0) {}
+
+      /** Start again from the top at the next step */
+      void restart()
+         { co_line = 0; }
+   };
+} // End of namespace 'lib'
+
+/** Start the body of the coroutine, resuming where it left off */
+#define CO_BEGIN \
+   switch ( co_line ) { case 0:
+
+/**
+ * Suspend the coroutine for a time, and resume right after.
+ * @param delay Time until the next step. Must not be 0
+ */
+#define CO_DELAY(delay) \
+   do { co_line = __LINE__; return (delay); case __LINE__:; } while (0)
+
+/**
+ * Suspend the coroutine until a condition holds, looking again periodically.
+ * @param condition The condition to wait for
+ * @param period Time between two looks
+ */
+#define CO_AWAIT(condition, period) \
+   while ( ! (condition) ) { CO_DELAY(period); }
+
+/** End the body of the coroutine. It is over, and starts again if stepped */
+#define CO_END \
+   } co_line = 0; return 0
+
+/** @} */
+/** @} */
+#endif /* ndef lib_coroutine_hpp_HAS_ALREADY_BEEN_INCLUDED */
@@ -0,0 +1,270 @@
+/**
+ * @addtogroup service
+ * @{
+ * @addtogroup delta_ring
+ * @{
+ *****************************************************************************
+ * The differences are zig-zagged first (0, -1, 1, -2, 2 ... become 0, 1, 2,
+ *  3, 4 ...) so small negative and positive values both give small numbers.
+ * Each number n is then written as an Exp-Golomb code: k zero bits followed
+ *  by the k+1 bits of n+1, where k+1 is the number of significant bits of n+1.
+ * The codes are written most significant bit first in a circular buffer of
+ *  bits, so dropping the oldest sample only moves the head.
+ *****************************************************************************
+ * @file
+ * Implementation of the compressed ring of samples
+ * @author software@arreckx.com
+ * @internal
+ */
+
+#include "delta_ring.h"
+
+/************************************************************************/
+/* Local functions                                                      */
+/************************************************************************/
+
+/** @return The position following pos in the buffer */
+static inline uint16_t _delta_ring_next_pos( const delta_ring_t *pRing, uint16_t pos )
+{
+   return ( ++pos == pRing->size ) ? 0 : pos;
+}
+
+/** Read the bit at position pos */
+static inline uint8_t _delta_ring_get_bit( const delta_ring_t *pRing, uint16_t pos )
+{
+   return ( pRing->buffer[pos >> 3] >> (7 - (pos & 7)) ) & 1;
+}
+
+/** Write the bit at position pos */
+static inline void _delta_ring_set_bit( delta_ring_t *pRing, uint16_t pos, uint8_t bit )
+{
+   uint8_t mask = 0x80 >> (pos & 7);
+
+   if ( bit )
+   {
+      pRing->buffer[pos >> 3] |= mask;
+   }
+   else
+   {
+      pRing->buffer[pos >> 3] &= ~mask;
+   }
+}
+
+/** @return The zig-zagged difference between two samples */
+static inline uint16_t _delta_ring_encode_delta( int16_t from, int16_t to )
+{
+   int16_t delta = (int16_t)((uint16_t)to - (uint16_t)from);
+
+   return ((uint16_t)delta << 1) ^ (uint16_t)(delta >> 15);
+}
+
+/** @return The signed difference from its zig-zagged value */
+static inline int16_t _delta_ring_decode_delta( uint16_t n )
+{
+   return (int16_t)((n >> 1) ^ (uint16_t)-(int16_t)(n & 1));
+}
+
+/** @return The number of significant bits of v, less 1 */
+static uint8_t _delta_ring_log2( uint32_t v )
+{
+   uint8_t k = 0;
+
+   while ( v >>= 1 )
+   {
+      ++k;
+   }
+
+   return k;
+}
+
+/**
+ * Read the code at position pos
+ * @param pRing The ring to read
+ * @param pPos Position of the code, updated past the code
+ * @return The zig-zagged difference
+ */
+static uint16_t _delta_ring_read_code( const delta_ring_t *pRing, uint16_t *pPos )
+{
+   uint16_t pos = *pPos;
+   uint32_t value = 1;
+   uint8_t k = 0;
+
+   // Count the leading zeros, up to the leading 1
+   while ( _delta_ring_get_bit(pRing, pos) == 0 )
+   {
+      ++k;
+      pos = _delta_ring_next_pos( pRing, pos );
+   }
+
+   pos = _delta_ring_next_pos( pRing, pos );
+
+   while ( k-- )
+   {
+      value = (value << 1) | _delta_ring_get_bit( pRing, pos );
+      pos = _delta_ring_next_pos( pRing, pos );
+   }
+
+   *pPos = pos;
+
+   return (uint16_t)(value - 1);
+}
+
+/** Drop the oldest sample. There must be at least 2 samples. */
+static void _delta_ring_drop( delta_ring_t *pRing )
+{
+   uint16_t pos = pRing->head;
+   uint16_t n = _delta_ring_read_code( pRing, &pos );
+
+   pRing->sum   -= pRing->first;
+   pRing->first += _delta_ring_decode_delta( n );
+   pRing->used  -= (pos >= pRing->head) ? pos - pRing->head : pos + pRing->size - pRing->head;
+   pRing->head   = pos;
+   --pRing->count;
+}
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/**
+ * Make a ring empty.
+ *
+ * @param pRing The ring to initialise
+ * @param buffer Storage for the coded differences
+ * @param size Size of the buffer in bytes. At least 5 so any difference fits.
+ * @param max_count Maximum number of samples to keep
+ */
+void delta_ring_init( delta_ring_t *pRing, uint8_t *buffer, uint16_t size, uint16_t max_count )
+{
+   pRing->buffer    = buffer;
+   pRing->size      = size * 8;
+   pRing->head      = 0;
+   pRing->used      = 0;
+   pRing->count     = 0;
+   pRing->max_count = max_count;
+   pRing->first     = 0;
+   pRing->last      = 0;
+   pRing->sum       = 0;
+}
+
+/**
+ * Add a new sample.
+ * The oldest samples are dropped until the new difference fits and the ring
+ *  holds fewer than its maximum number of samples.
+ *
+ * @param pRing The ring to add to
+ * @param value The new sample
+ */
+void delta_ring_push( delta_ring_t *pRing, int16_t value )
+{
+   uint16_t n;
+   uint8_t k;
+   uint16_t pos;
+
+   if ( pRing->count == 0 || pRing->max_count == 1 )
+   {
+      pRing->head  = 0;
+      pRing->used  = 0;
+      pRing->count = 1;
+      pRing->first = pRing->last = value;
+      pRing->sum   = value;
+
+      return;
+   }
+
+   n = _delta_ring_encode_delta( pRing->last, value );
+   k = _delta_ring_log2( (uint32_t)n + 1 );
+
+   while (
+      pRing->count > 1 &&
+      (pRing->count >= pRing->max_count || pRing->used + 2*k + 1 > pRing->size) )
+   {
+      _delta_ring_drop( pRing );
+   }
+
+   // Write k zeros then the k+1 bits of n+1
+   pos = pRing->head + pRing->used;
+
+   if ( pos >= pRing->size )
+   {
+      pos -= pRing->size;
+   }
+
+   for ( uint8_t i=0; i<k; ++i )
+   {
+      _delta_ring_set_bit( pRing, pos, 0 );
+      pos = _delta_ring_next_pos( pRing, pos );
+   }
+
+   for ( int8_t i=k; i>=0; --i )
+   {
+      _delta_ring_set_bit( pRing, pos, (uint8_t)((((uint32_t)n + 1) >> i) & 1) );
+      pos = _delta_ring_next_pos( pRing, pos );
+   }
+
+   pRing->used += 2*k + 1;
+   pRing->last  = value;
+   pRing->sum  += value;
+   ++pRing->count;
+}
+
+/**
+ * Compute the average of the samples held from the running sum.
+ *
+ * @param pRing The ring
+ * @return The average, or 0 if the ring is empty
+ */
+int16_t delta_ring_average( const delta_ring_t *pRing )
+{
+   if ( pRing->count == 0 )
+   {
+      return 0;
+   }
+
+   return (int16_t)(pRing->sum / (int32_t)pRing->count);
+}
+
+/**
+ * Start reading a ring from its oldest sample.
+ * The ring must not be pushed to while being read.
+ *
+ * @param pIter The position to initialise
+ * @param pRing The ring to read
+ */
+void delta_ring_iter_init( delta_ring_iter_t *pIter, const delta_ring_t *pRing )
+{
+   pIter->ring  = pRing;
+   pIter->pos   = pRing->head;
+   pIter->left  = pRing->count;
+   pIter->value = pRing->first;
+}
+
+/**
+ * Read the next sample, from the oldest to the newest.
+ *
+ * @param pIter The current position
+ * @param pValue Receives the sample
+ * @return false once all samples have been read
+ */
+bool delta_ring_iter_next( delta_ring_iter_t *pIter, int16_t *pValue )
+{
+   if ( pIter->left == 0 )
+   {
+      return false;
+   }
+
+   // The oldest sample is not coded
+   if ( pIter->left != pIter->ring->count )
+   {
+      pIter->value += _delta_ring_decode_delta( _delta_ring_read_code(pIter->ring, &pIter->pos) );
+   }
+
+   --pIter->left;
+   *pValue = pIter->value;
+
+   return true;
+}
+
+/**@} delta_ring */
+/**@} service */
+/*---------------------------  End of file  --------------------------- */
@@ -0,0 +1,127 @@
+#ifndef delta_ring_h_HAS_ALREADY_BEEN_INCLUDED
+#define delta_ring_h_HAS_ALREADY_BEEN_INCLUDED
+/**
+ * @addtogroup service
+ * @{
+ * @addtogroup delta_ring
+ * Compressed ring of samples
+ * @{
+ *****************************************************************************
+ * Keeps the most recent samples of a slowly changing signal in a fixed
+ *  size buffer.
+ * Only the oldest sample is stored in full. Each following sample is stored
+ *  as its difference with the previous one, coded as a variable length
+ *  number of bits (an Exp-Golomb code of the zig-zagged difference):
+ * - A sample equal to the previous one takes 1 bit
+ * - A difference of +/-1 takes 3 bits
+ * - A difference of up to +/-3 takes 5 bits, and so on
+ * \n
+ * When a new sample does not fit, or the ring holds its maximum number of
+ *  samples, the oldest samples are dropped.
+ * The average of the samples held is maintained as samples come and go.
+ * \n
+ * Example:
+ * @code
+ * #include "lib/delta_ring.h"
+ * static uint8_t buffer[128];
+ * static delta_ring_t ring;
+ *
+ * delta_ring_init( &ring, buffer, sizeof(buffer), 60 );
+ * delta_ring_push( &ring, 215 );
+ * @endcode
+ *****************************************************************************
+ * @file
+ * Compressed ring of samples API
+ * @author software@arreckx.com
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/************************************************************************/
+/* Public types                                                         */
+/************************************************************************/
+
+/** State of a ring. The buffer is supplied by the owner. */
+typedef struct
+{
+   /** Coded differences */
+   uint8_t *buffer;
+
+   /** Size of the buffer in bits */
+   uint16_t size;
+
+   /** Bit position of the oldest difference */
+   uint16_t head;
+
+   /** Number of bits used */
+   uint16_t used;
+
+   /** Number of samples held */
+   uint16_t count;
+
+   /** Maximum number of samples held */
+   uint16_t max_count;
+
+   /** Value of the oldest sample */
+   int16_t first;
+
+   /** Value of the newest sample */
+   int16_t last;
+
+   /** Sum of all the samples held */
+   int32_t sum;
+} delta_ring_t;
+
+/** Position while reading a ring from the oldest sample */
+typedef struct
+{
+   /** The ring being read */
+   const delta_ring_t *ring;
+
+   /** Bit position of the next difference */
+   uint16_t pos;
+
+   /** Number of samples left to read */
+   uint16_t left;
+
+   /** Value of the last sample read */
+   int16_t value;
+} delta_ring_iter_t;
+
+/************************************************************************/
+/* Public API                                                           */
+/************************************************************************/
+
+/** Make a ring empty, using the given buffer */
+void delta_ring_init( delta_ring_t *pRing, uint8_t *buffer, uint16_t size, uint16_t max_count );
+
+/** Add a new sample, dropping the oldest as required */
+void delta_ring_push( delta_ring_t *pRing, int16_t value );
+
+/** @return The average of the samples held, or 0 if empty */
+int16_t delta_ring_average( const delta_ring_t *pRing );
+
+/** Start reading a ring from its oldest sample */
+void delta_ring_iter_init( delta_ring_iter_t *pIter, const delta_ring_t *pRing );
+
+/** Read the next sample. @return false once all samples have been read */
+bool delta_ring_iter_next( delta_ring_iter_t *pIter, int16_t *pValue );
+
+/** @return The number of samples held */
+static inline uint16_t delta_ring_count( const delta_ring_t *pRing )
+{
+   return pRing->count;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@} delta_ring */
+/**@} service */
+#endif /* delta_ring_h_HAS_ALREADY_BEEN_INCLUDED */
@@ -0,0 +1,263 @@
+#ifndef lib_filter_hpp_HAS_ALREADY_BEEN_INCLUDED
+#define lib_filter_hpp_HAS_ALREADY_BEEN_INCLUDED
+/**
+ * @addtogroup service
+ * @{
+ * @addtogroup filter
+ * @{
+ *****************************************************************************
+ * Streaming filters for the sensor readings.
+ * All filters are sized at compile time, use static storage only and
+ *  process a new sample in a time which does not depend on their depth
+ *  (but for the median, which is linear with its small depth).
+ * Depths which are powers of 2 are best, since the divisions become shifts.
+ * \n
+ * Example:
+ * @code
+ * #include "lib/filter.hpp"
+ * // Average 16 readings, and switch on at 20 and off at 15
+ * static lib::BoxFilter<int16_t, 16> average;
+ * static lib::Hysteresis<int16_t, 15, 20> comparator;
+ *
+ * average.fill( first_reading );
+ * bool isOn = comparator.update( average.push(reading) );
+ * @endcode
+ *****************************************************************************
+ * @file
+ * Header only streaming filter templates
+ * @author software@arreckx.com
+ */
+
+#include <stdint.h>
+
+namespace lib
+{
+   /**
+    * Sliding average over the last N samples.
+    * A running sum is kept, so each new sample costs one addition and one
+    *  subtraction, whatever the depth of the filter.
+    * @tparam T Type of the samples
+    * @tparam N Number of samples averaged
+    * @tparam S Type of the running sum. Must hold N times the largest sample.
+    */
+   template <typename T, uint8_t N, typename S = T> class BoxFilter
+   {
+      static_assert(N > 0, "The filter requires at least one sample");
+
+      /** Last N samples */
+      T samples[N];
+
+      /** Sum of all the samples */
+      S sum;
+
+      /** Position of the oldest sample */
+      uint8_t pos;
+
+   public:
+      /** Start with all samples at 0 */
+      BoxFilter() : samples(), sum(0), pos(0) {}
+
+      /** Set all the samples to the same value */
+      void fill( const T value )
+      {
+         for ( uint8_t i=0; i<N; ++i )
+         {
+            samples[i] = value;
+         }
+
+         sum = (S)value * N;
+      }
+
+      /**
+       * Add a new sample, dropping the oldest
+       * @return The sum of the last N samples
+       */
+      S push( const T value )
+      {
+         sum += (S)value - (S)samples[pos];
+         samples[pos] = value;
+
+         if ( ++pos == N )
+         {
+            pos = 0;
+         }
+
+         return sum;
+      }
+
+      /** @return The sum of the last N samples */
+      S get_sum() const
+         { return sum; }
+
+      /** @return The average of the last N samples */
+      T get() const
+         { return (T)(sum / N); }
+   };
+
+   /**
+    * Exponential moving average using shifts only.
+    * The state is kept scaled up by 2^K so no precision is lost, and each
+    *  sample moves the output by 1/2^K of its distance to the output.
+    * The time constant is about 2^K samples.
+    * @tparam T Type of the samples
+    * @tparam K Weight of a new sample as a power of 2
+    * @tparam S Type of the state. Must hold 2^K times the largest sample.
+    */
+   template <typename T, uint8_t K, typename S = int32_t> class EmaFilter
+   {
+      /** Output scaled by 2^K */
+      S state;
+
+   public:
+      /** Start from 0 */
+      EmaFilter() : state(0) {}
+
+      /** Jump straight to a value */
+      void fill( const T value )
+         { state = (S)value << K; }
+
+      /**
+       * Add a new sample
+       * @return The new output of the filter
+       */
+      T push( const T value )
+      {
+         state += (S)value - (state >> K);
+         return get();
+      }
+
+      /** @return The output of the filter */
+      T get() const
+         { return (T)(state >> K); }
+   };
+
+   /**
+    * Median of the last N samples, to reject isolated spikes.
+    * The window is kept sorted, so a new sample is inserted with at most N
+    *  moves.
+    * @tparam T Type of the samples
+    * @tparam N Number of samples. Should be odd.
+    */
+   template <typename T, uint8_t N> class MedianFilter
+   {
+      static_assert(N & 1, "The median filter requires an odd number of samples");
+
+      /** Samples in the order of arrival */
+      T samples[N];
+
+      /** Same samples sorted in increasing order */
+      T sorted[N];
+
+      /** Position of the oldest sample */
+      uint8_t pos;
+
+   public:
+      /** Start with all samples at 0 */
+      MedianFilter() : samples(), sorted(), pos(0) {}
+
+      /** Set all the samples to the same value */
+      void fill( const T value )
+      {
+         for ( uint8_t i=0; i<N; ++i )
+         {
+            samples[i] = sorted[i] = value;
+         }
+      }
+
+      /**
+       * Add a new sample, dropping the oldest
+       * @return The median of the last N samples
+       */
+      T push( const T value )
+      {
+         const T oldest = samples[pos];
+         uint8_t i = 0;
+
+         samples[pos] = value;
+
+         if ( ++pos == N )
+         {
+            pos = 0;
+         }
+
+         // Find the oldest in the sorted list
+         while ( sorted[i] != oldest )
+         {
+            ++i;
+         }
+
+         // Slide the value in place of the oldest, keeping the order
+         while ( i > 0 && sorted[i-1] > value )
+         {
+            sorted[i] = sorted[i-1];
+            --i;
+         }
+
+         while ( i < N-1 && sorted[i+1] < value )
+         {
+            sorted[i] = sorted[i+1];
+            ++i;
+         }
+
+         sorted[i] = value;
+
+         return get();
+      }
+
+      /** @return The median of the last N samples */
+      T get() const
+         { return sorted[N/2]; }
+   };
+
+   /**
+    * Comparator with hysteresis (Schmitt trigger).
+    * The output turns on when the input reaches HIGH, and only turns back off
+    *  once the input drops below LOW.
+    * This prevents the output from chattering when the input hovers around
+    *  a single threshold.
+    * @tparam T Type of the input
+    * @tparam LOW Input below which the output turns off
+    * @tparam HIGH Input from which the output turns on
+    */
+   template <typename T, T LOW, T HIGH> class Hysteresis
+   {
+      static_assert(LOW <= HIGH, "The low threshold must not exceed the high threshold");
+
+      /** Current output */
+      bool state;
+
+   public:
+      /** Start off */
+      Hysteresis() : state(false) {}
+
+      /** Set the output from a single value. The band counts as on. */
+      void reset( const T value )
+         { state = !(value < LOW); }
+
+      /**
+       * Process a new input
+       * @return The new output
+       */
+      bool update( const T value )
+      {
+         if ( value >= HIGH )
+         {
+            state = true;
+         }
+         else if ( value < LOW )
+         {
+            state = false;
+         }
+
+         return state;
+      }
+
+      /** @return The current output */
+      bool get() const
+         { return state; }
+   };
+} // End of namespace 'lib'
+
+/**@}*/
+/**@}*/
+#endif /* ndef lib_filter_hpp_HAS_ALREADY_BEEN_INCLUDED */
@@ -0,0 +1,329 @@
+/**
+ * @addtogroup service
+ * @{
+ * @addtogroup governor
+ * @{
+ *****************************************************************************
+ * Implementation of the clock governor.
+ * The load is the share of a window the reactor is busy, from the first
+ *  handler called after a wake up to the next sleep. The wake ups which do
+ *  not call any handler cost two tests only. The tick of the timer service
+ *  calls the timer dispatch each ms though, so while it runs each tick pays
+ *  for three reads of the timer count and two of the tick count.
+ * Each step of the clock divides the load by 4, so the clock steps up above
+ *  #GOVERNOR_LOAD_HIGH, and down if the load would stay below three
+ *  quarters of it. A lock steps up to the full speed at once, or as the
+ *  reactor gets idle if taken from an interrupt.
+ * The busy times are read from the count of the timer/counter of the timer
+ *  service tick, and converted to us at each change of the clock and at the
+ *  end of the window only.
+ *****************************************************************************
+ * @file
+ * Implementation of the clock governor API
+ * @author software@arreckx.com
+ * @internal
+ */
+#include <asf.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "alert.h"
+#include "timer.h"
+#include "governor.h"
+
+/** Prescaler of the system clock at each speed */
+static const uint8_t _prescalers[GOVERNOR_SPEEDS] = {
+   SYSCLK_PSADIV_1, SYSCLK_PSADIV_4, SYSCLK_PSADIV_16 };
+
+/** Division of each clock source of the timer/counters, from TC_CLKSEL_DIV1_gc */
+static const uint16_t _tc_divisions[] = { 1, 2, 4, 8, 64, 256, 1024 };
+
+/** Handlers called at each change */
+static governor_handler_t _handlers[GOVERNOR_MAX_HANDLERS] = {0};
+
+/** Current number of handlers */
+static uint8_t _next_handler = 0;
+
+/** Current speed, 0 being the full speed */
+static uint8_t _speed = 0;
+
+/** Number of locks of the full speed */
+static volatile uint8_t _locks = 0;
+
+/** Timer count the window started at */
+static timer_count_t _window_start = 0;
+
+/** Time the reactor was busy in the window, in us */
+static uint32_t _window_busy = 0;
+
+/** Time the reactor was busy since, in counts of the tick timer/counter */
+static uint32_t _busy_counts = 0;
+
+/** True while the reactor calls its handlers */
+static bool _is_busy = false;
+
+/** Timer count and count of the tick the reactor got busy at */
+static timer_count_t _busy_ms = 0;
+static uint16_t _busy_count = 0;
+
+/** Timer count of the last change */
+static timer_count_t _speed_since = 0;
+
+/** Changes so far */
+static governor_stats_t _stats;
+
+/** @return The position within the ms of the timer service tick, in us */
+static uint16_t _get_tick_us(void)
+{
+   return (uint32_t)tc_read_count(&TIMER_TC) * 1000 / ((uint32_t)tc_read_period(&TIMER_TC) + 1);
+}
+
+/** Move the busy counts to the window, in us, before the tick changes */
+static void _flush_busy(void)
+{
+   _window_busy += _busy_counts * 1000 / ((uint32_t)tc_read_period(&TIMER_TC) + 1);
+   _busy_counts = 0;
+}
+
+/**
+ * Change the clock and let the drivers follow.
+ * Called with the interrupts off.
+ *
+ * @param speed The new speed
+ */
+static void _set_speed(uint8_t speed)
+{
+   timer_count_t now = timer_get_count();
+   uint16_t start = _get_tick_us();
+   uint16_t duration;
+   uint8_t i;
+
+   _flush_busy();
+
+   // The handlers get the new clock from governor_get_hz
+   _stats.ms[_speed] += now - _speed_since;
+   _speed_since = now;
+   _speed = speed;
+
+   sysclk_set_prescalers(_prescalers[speed], SYSCLK_PSBCDIV_1_1);
+
+   for ( i=0; i<_next_handler; ++i )
+   {
+      _handlers[i](speed * 2);
+   }
+
+   duration = (_get_tick_us() + 1000 - start) % 1000;
+
+   ++_stats.changes;
+
+   if ( duration > _stats.worst_us )
+   {
+      _stats.worst_us = duration;
+   }
+}
+
+/** Run at full speed, with no handler */
+void governor_init(void)
+{
+   _speed = 0;
+   _locks = 0;
+   _next_handler = 0;
+}
+
+/** Add a handler called at each change of the clock */
+void governor_register(const governor_handler_t handler)
+{
+   _handlers[_next_handler++] = handler;
+}
+
+/**
+ * Forbid the slower speeds until #governor_unlock.
+ * The clock is at full speed on return. Not for an interrupt.
+ */
+void governor_lock(void)
+{
+   irqflags_t flags = cpu_irq_save();
+
+   if ( _locks++ == 0 && _speed != 0 )
+   {
+      _set_speed(0);
+   }
+
+   cpu_irq_restore(flags);
+}
+
+/**
+ * Forbid the slower speeds until #governor_unlock, from an interrupt.
+ * The clock steps up to full speed once the interrupt returns, as the
+ *  reactor gets idle, so the interrupt does not change the clock of the
+ *  peripherals under the other drivers.
+ */
+void governor_lock_from_isr(void)
+{
+   irqflags_t flags = cpu_irq_save();
+
+   ++_locks;
+
+   cpu_irq_restore(flags);
+}
+
+/**
+ * Release a lock taken with #governor_lock or #governor_lock_from_isr.
+ * The clock steps down at the end of the window if the load allows.
+ */
+void governor_unlock(void)
+{
+   irqflags_t flags = cpu_irq_save();
+
+   --_locks;
+
+   cpu_irq_restore(flags);
+}
+
+/**
+ * Note the time the reactor gets busy, unless it is busy already.
+ * Called by the reactor before it calls its handlers.
+ */
+void governor_enter_busy(void)
+{
+   if ( _is_busy )
+   {
+      return;
+   }
+
+   // Read again if the tick moved the count in between
+   do
+   {
+      _busy_ms = timer_get_count();
+      _busy_count = tc_read_count(&TIMER_TC);
+   } while ( _busy_ms != timer_get_count() );
+
+   _is_busy = true;
+}
+
+/**
+ * Account the time the reactor was busy, then step the clock once the load
+ *  of the window is known.
+ * Called by the reactor with the interrupts off, before it sleeps.
+ */
+void governor_enter_idle(void)
+{
+   timer_count_t now;
+   timer_count_t elapsed;
+   int32_t busy;
+   uint32_t load;
+
+   // A lock taken from an interrupt steps up here
+   if ( _locks != 0 && _speed != 0 )
+   {
+      _set_speed(0);
+   }
+
+   if ( ! _is_busy )
+   {
+      return;
+   }
+
+   _is_busy = false;
+   now = timer_get_count();
+
+   // A tick pending for the interrupts to be on is not counted yet
+   busy = (int32_t)(now - _busy_ms) * (tc_read_period(&TIMER_TC) + 1)
+      + tc_read_count(&TIMER_TC) - _busy_count;
+
+   if ( busy > 0 )
+   {
+      _busy_counts += busy;
+   }
+
+   elapsed = now - _window_start;
+
+   if ( elapsed < GOVERNOR_WINDOW )
+   {
+      return;
+   }
+
+   _flush_busy();
+   load = _window_busy / 10 / elapsed;
+
+   _window_start = now;
+   _window_busy = 0;
+
+   if ( _locks == 0 )
+   {
+      if ( load > GOVERNOR_LOAD_HIGH && _speed > 0 )
+      {
+         _set_speed(_speed - 1);
+      }
+      else if ( load * 4 < GOVERNOR_LOAD_HIGH * 3 / 4 && _speed < GOVERNOR_SPEEDS - 1 )
+      {
+         _set_speed(_speed + 1);
+      }
+   }
+}
+
+/** @return The clock of the CPU and the peripherals, in Hz */
+uint32_t governor_get_hz(void)
+{
+   return sysclk_get_main_hz() >> (_speed * 2);
+}
+
+/**
+ * Set the clock source and the period of a running timer/counter, so it
+ *  overflows at the rate it was configured for at full speed.
+ * The count is kept by the change of the clock source. It is scaled when
+ *  the period changes too, so the overflow in progress is not delayed.
+ *
+ * @param tc The timer/counter
+ * @param division Division of the clock source at full speed
+ * @param period Period at full speed
+ * @param shift The clock is divided by 1 << shift
+ */
+void governor_scale_tc(volatile void *tc, uint16_t division, uint16_t period, uint8_t shift)
+{
+   uint16_t target = division >> shift;
+   uint8_t i = sizeof(_tc_divisions) / sizeof(_tc_divisions[0]);
+   uint32_t top;
+   uint16_t count;
+
+   alert_and_stop_if( target == 0 );
+
+   // Largest clock source which divides the target. The period makes up
+   while ( target % _tc_divisions[--i] != 0 )
+   {
+   }
+
+   top = ((uint32_t)period + 1) * (target / _tc_divisions[i]);
+   alert_and_stop_if( top > 0x10000 );
+
+   if ( top - 1 == tc_read_period(tc) )
+   {
+      tc_write_clock_source(tc, (TC_CLKSEL_t)(i + 1));
+
+      return;
+   }
+
+   count = (uint32_t)tc_read_count(tc) * top / ((uint32_t)tc_read_period(tc) + 1);
+
+   tc_write_period(tc, (uint16_t)(top - 1));
+   tc_write_clock_source(tc, (TC_CLKSEL_t)(i + 1));
+   tc_write_count(tc, count);
+}
+
+/**
+ * Copy the changes of the clock so far.
+ *
+ * @param pStats Where to copy the changes
+ */
+void governor_get_stats( governor_stats_t *pStats )
+{
+   cli();
+   *pStats = _stats;
+   sei();
+
+   // Account for the current speed up to now
+   pStats->ms[_speed] += timer_get_count() - _speed_since;
+}
+
+/**@}*/
+/**@} ---------------------------  End of file  --------------------------- */
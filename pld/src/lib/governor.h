@@ -0,0 +1,116 @@
+#ifndef governor_h_HAS_ALREADY_BEEN_INCLUDED
+#define governor_h_HAS_ALREADY_BEEN_INCLUDED
+/**
+ * @file
+ * Clock governor API declaration
+ * @addtogroup service
+ * @{
+ * @addtogroup governor
+ * @{
+ *****************************************************************************
+ * Clock governor API.
+ * The CPU and the peripherals run from the 32MHz RC oscillator. When the
+ *  load is light, as with a dark or static display, the governor divides
+ *  the clock by 4 then 16 with the prescaler of the system clock, which
+ *  takes effect at once. The load is measured by the reactor over a window,
+ *  and the clock steps up as soon as the load gets high.
+ * The drivers register a handler to recompute their dividers at each change,
+ *  so the timers, the TWI and the USART keep their rate. The timer/counters
+ *  keep their phase with #governor_scale_tc.
+ * A driver which cannot work slower, such as the frame buffer refresh, or
+ *  must react fast, such as the key on a push, locks the full speed with
+ *  #governor_lock. The clock is then at full speed on return. An interrupt
+ *  locks with #governor_lock_from_isr, and the reactor steps the clock up
+ *  once out of the interrupt.
+ * @author software@arreckx.com
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of clock speeds, from the full speed */
+#define GOVERNOR_SPEEDS 3
+
+/**
+ * @def GOVERNOR_MAX_HANDLERS
+ * Maximum number of handlers called when the clock changes
+ */
+#ifndef GOVERNOR_MAX_HANDLERS
+   #define GOVERNOR_MAX_HANDLERS 4
+#endif
+
+/**
+ * @def GOVERNOR_WINDOW
+ * Time over which the load is measured, in ms
+ */
+#ifndef GOVERNOR_WINDOW
+   #define GOVERNOR_WINDOW 1000
+#endif
+
+/**
+ * @def GOVERNOR_LOAD_HIGH
+ * Load, in %, above which the clock steps up. The clock steps down when
+ *  the load would stay below three quarters of it at the slower speed
+ */
+#ifndef GOVERNOR_LOAD_HIGH
+   #define GOVERNOR_LOAD_HIGH 50
+#endif
+
+/**
+ * Called with the interrupts off after each change of the clock.
+ * The division of the clock is 1 << shift. #governor_get_hz gives the new
+ *  clock.
+ */
+typedef void (*governor_handler_t)(uint8_t shift);
+
+/** Changes of the clock so far */
+typedef struct
+{
+   /** Number of changes */
+   uint32_t changes;
+   /** Longest change measured, handlers included, in us */
+   uint16_t worst_us;
+   /** Time spent at each speed, from the full speed, in ms */
+   uint32_t ms[GOVERNOR_SPEEDS];
+} governor_stats_t;
+
+/** Run at full speed */
+void governor_init(void);
+
+/** Add a handler called at each change of the clock */
+void governor_register(const governor_handler_t handler);
+
+/** Forbid the slower speeds, at full speed on return. Not for an interrupt */
+void governor_lock(void);
+
+/** Forbid the slower speeds from an interrupt. The reactor steps up */
+void governor_lock_from_isr(void);
+
+/** Release a lock. Interrupt safe */
+void governor_unlock(void);
+
+/** Note the reactor gets busy. Called by the reactor */
+void governor_enter_busy(void);
+
+/** Account the time the reactor was busy, and apply the policy. Called by the reactor */
+void governor_enter_idle(void);
+
+/** @return The clock of the CPU and the peripherals, in Hz */
+uint32_t governor_get_hz(void);
+
+/** Rescale a timer/counter configured for the full speed, keeping its phase */
+void governor_scale_tc(volatile void *tc, uint16_t division, uint16_t period, uint8_t shift);
+
+/** Get the changes of the clock so far */
+void governor_get_stats( governor_stats_t *pStats );
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+/** @} */
+#endif /* ndef governor_h_HAS_ALREADY_BEEN_INCLUDED */
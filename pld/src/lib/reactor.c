@@ -9,6 +9,13 @@
  *  within the time frame of the main application.
  * When no asynchronous operation take place, the micro-controller is put to
  *  sleep saving power.
+ * The drivers lock the sleep modes they cannot work in with the sleep manager.
+ *  The timer service ticks every ms, and needs the idle mode. When the next
+ *  timer is far, the tick is suspended instead, and the RTC alarm wakes the
+ *  CPU up. The RTC counts seconds, so the reactor first waits in idle for
+ *  the start of a second, and sleeps deep up to the second before the next
+ *  timer. The time slept is then exact. If another interrupt wakes the CPU
+ *  up first, the time past the last second is lost.
  * The reactor cycle time can be monitored defining debug pins REACTOR_IDLE
  *  and REACTOR_BUSY
  *****************************************************************************
@@ -21,8 +28,13 @@
 #include <stdint.h>
 
 #include "debug.h"
+#include "timer.h"
+#include "governor.h"
 #include "reactor.h"
 
+/** Longest deep sleep, in seconds, when no timer is armed */
+#define _REACTOR_DEEP_SLEEP_MAX 3600
+
 /** @cond internal */
 // Force in the data segmemnt
 volatile reactor_handle_t reactor_notifications = 0;
@@ -34,6 +46,134 @@ static uint8_t _next_handle = 0;
 /** Keep an array of handlers whose position match the bit position of the handle */
 static reactor_handler_t _handlers[REACTOR_MAX_HANDLERS] = {0};
 
+/** Second of the RTC of the last alarm, or 0 if not known */
+static volatile uint32_t _rtc_edge = 0;
+
+/** Timer count at the last alarm */
+static volatile timer_count_t _rtc_edge_count = 0;
+
+/** Second of the RTC the alarm is set to */
+static uint32_t _rtc_alarm = 0;
+
+/** Residency in each sleep mode */
+static reactor_sleep_stats_t _sleep_stats;
+
+/** Called by the RTC interrupt at the start of the second of the alarm */
+static void _on_rtc_alarm(uint32_t time)
+{
+   _rtc_edge = time;
+   _rtc_edge_count = timer_get_count();
+}
+
+/** Set the RTC alarm, unless already set to the same second */
+static void _set_rtc_alarm(uint32_t second)
+{
+   if ( _rtc_alarm != second )
+   {
+      _rtc_alarm = second;
+      rtc_set_callback(&_on_rtc_alarm);
+      rtc_set_alarm(second);
+   }
+}
+
+/**
+ * Sleep deep with the timer service suspended, up to the second before the
+ *  next timer. Called at the start of a second of the RTC.
+ *
+ * @param mode Deepest mode allowed by the drivers
+ * @param next Time to the next timer
+ * @return The mode slept in
+ */
+static enum sleepmgr_mode _sleep_deep(enum sleepmgr_mode mode, timer_count_t next)
+{
+   uint32_t edge = _rtc_edge;
+   timer_count_t since = timer_get_count() - _rtc_edge_count;
+   uint32_t wake = _REACTOR_DEEP_SLEEP_MAX;
+   int32_t elapsed;
+
+   if ( next != TIMER_NEVER )
+   {
+      wake = (since + next) / 1000;
+   }
+
+   // The RTC must keep running
+   if ( mode > SLEEPMGR_PSAVE )
+   {
+      mode = SLEEPMGR_PSAVE;
+   }
+
+   _set_rtc_alarm(edge + wake);
+   timer_suspend();
+   sleepmgr_sleep(mode);
+   cli();
+
+   elapsed = (int32_t)(rtc_get_time() - edge) * 1000 - (int32_t)since;
+   timer_resume(elapsed > 0 ? (timer_count_t)elapsed : 0);
+
+   // Woken up by the alarm, the count is back in phase with the RTC
+   if ( _rtc_edge == edge + wake )
+   {
+      _rtc_edge_count = timer_get_count();
+   }
+   else
+   {
+      _rtc_edge = 0;
+   }
+
+   return mode;
+}
+
+/** 
+ * Sleep in the deepest mode allowed until an interrupt.
+ * Called with the interrupts off, returns with the interrupts on.
+ */
+static void _sleep(void)
+{
+   enum sleepmgr_mode mode = sleepmgr_get_sleep_mode();
+   timer_count_t start = timer_get_count();
+   timer_count_t next;
+   uint32_t second;
+
+   if ( mode == SLEEPMGR_ACTIVE )
+   {
+      sei();
+      return;
+   }
+
+   if ( mode > SLEEPMGR_IDLE )
+   {
+      next = timer_get_time_to_next();
+      second = rtc_get_time();
+
+      if ( next >= REACTOR_DEEP_SLEEP_MIN && second == _rtc_edge )
+      {
+         mode = _sleep_deep(mode, next);
+      }
+      else
+      {
+         // Wait for the start of the next second to sleep deep
+         if ( next >= REACTOR_DEEP_SLEEP_MIN )
+         {
+            _set_rtc_alarm(second + 1);
+         }
+
+         mode = SLEEPMGR_IDLE;
+      }
+   }
+
+   // The AVR guarantees that sleep is executed before any pending interrupts
+   if ( mode == SLEEPMGR_IDLE )
+   {
+      sleepmgr_sleep(mode);
+      cli();
+   }
+
+   ++_sleep_stats.sleeps[mode - SLEEPMGR_IDLE];
+   _sleep_stats.ms[mode - SLEEPMGR_IDLE] += timer_get_count() - start;
+
+   sei();
+}
+
 /** Initialize the reactor API */
 void reactor_init(void)
 {
@@ -41,9 +181,8 @@ void reactor_init(void)
    debug_init(REACTOR_IDLE);
    debug_init(REACTOR_BUSY);
 
-   // Allow simplest sleep mode to resume very fast
-   sleep_set_mode(SLEEP_SMODE_IDLE_gc);
-   sleep_enable();
+   // The drivers lock the modes they cannot sleep in
+   sleepmgr_init();
 }
 
 /** Add a new reactor process */
@@ -83,10 +222,8 @@ void reactor_run(void)
       if ( reactor_notifications == 0 )
       {
          debug_set(REACTOR_IDLE);
-
-         // The AVR guarantees that sleep is executed before any pending interrupts
-         sei();
-         sleep_cpu();
+         governor_enter_idle();
+         _sleep();
          debug_clear(REACTOR_IDLE);
       }
       else
@@ -95,6 +232,9 @@ void reactor_run(void)
          reactor_notifications = 0;
          debug_set(REACTOR_BUSY);
          sei();
+
+         // Follow the load with the clock
+         governor_enter_busy();
          
          // Handle the flags
          for ( i=0; i<_next_handle; ++i )
@@ -114,6 +254,16 @@ void reactor_run(void)
    };
 }
 
+/**
+ * Copy the residency in each sleep mode so far.
+ *
+ * @param pStats Where to copy the residency
+ */
+void reactor_get_sleep_stats( reactor_sleep_stats_t *pStats )
+{
+   *pStats = _sleep_stats;
+}
+
  /**@}*/
  /**@}*/
  /**@} ---------------------------  End of file  --------------------------- */
\ No newline at end of file
@@ -27,6 +27,10 @@
  *  using #reactor_register.
  * Finally, let the reactor loose once all the interrupts are up and running with
  *  #reactor_run.
+ * When idle, the reactor sleeps in the deepest mode the drivers allow through
+ *  the sleep manager. The timer service needs the idle mode to tick, unless
+ *  the next timer is far enough for the RTC to wake the CPU up instead.
+ *  The number of sleeps and the time spent in each mode are counted.
  * @author software@arreckx.com
  */
  
@@ -68,6 +72,31 @@ extern "C" {
 extern volatile reactor_handle_t reactor_notifications;
 /** @endcond */
 
+/**
+ * @def REACTOR_DEEP_SLEEP_MIN
+ * Time to the next timer, in ms, from which the CPU sleeps deeper than idle,
+ *  with the timer service suspended and the RTC to wake it up. The RTC
+ *  counts seconds, so this must be a couple of seconds at least.
+ */
+#ifndef REACTOR_DEEP_SLEEP_MIN
+   #define REACTOR_DEEP_SLEEP_MIN 3000
+#endif
+
+/** Number of sleep modes, from the idle to the power down */
+#define REACTOR_SLEEP_MODES 5
+
+/** Residency in each sleep mode, indexed from the idle mode */
+typedef struct
+{
+   /** Number of times the CPU went to sleep in the mode */
+   uint32_t sleeps[REACTOR_SLEEP_MODES];
+   /**
+    * Time spent in the mode, in ms. The timer service ticks count, so the
+    *  short sleeps of the idle mode are accounted for on average
+    */
+   uint32_t ms[REACTOR_SLEEP_MODES];
+} reactor_sleep_stats_t;
+
 /** Callback type called by the reactor when an event has been logged */
 typedef void (*reactor_handler_t)(void);
 
@@ -87,6 +116,9 @@ void reactor_notify( const reactor_handle_t handle );
 /** Process the reactor loop */
 void reactor_run(void);
 
+/** Get the residency in each sleep mode so far */
+void reactor_get_sleep_stats( reactor_sleep_stats_t *pStats );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,99 @@
+#ifndef lib_scratch_hpp_HAS_ALREADY_BEEN_INCLUDED
+#define lib_scratch_hpp_HAS_ALREADY_BEEN_INCLUDED
+/**
+ * @addtogroup service
+ * @{
+ * @addtogroup scratch
+ * @{
+ *****************************************************************************
+ * Static storage shared by objects never in use at the same time.
+ * The scratch holds one object at a time. Taking it for another type
+ *  constructs the new object in place of the previous one, which is simply
+ *  dropped: the types must not need a destructor.
+ * The types which share the scratch are listed in a #lib::Registry, and
+ *  the object held is known by the index of its type, in a byte.
+ * The size is fixed at compile time, and each type checks that it fits
+ *  where it is constructed, so a type too large fails the build.
+ * \n
+ * Example:
+ * @code
+ * #include "lib/scratch.hpp"
+ * typedef lib::Registry<Chaser, Fader> group;
+ * typedef lib::Scratch<group, 16> scratch;
+ *
+ * if ( ! scratch::holds<Chaser>() )
+ * {
+ *    scratch::construct<Chaser>().reset();
+ * }
+ *
+ * scratch::get<Chaser>().display();
+ * @endcode
+ *****************************************************************************
+ * @file
+ * Header only scratch storage template
+ * @author software@arreckx.com
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "lib/builtin.hpp"
+#include "lib/singleton.hpp"
+
+namespace lib
+{
+   /**
+    * Storage for one object at a time, of any type of a group.
+    * @tparam L The #lib::Registry of the types of the group
+    * @tparam N Size of the storage, in bytes
+    */
+   template <class L, size_t N> class Scratch
+   {
+      /** Storage, aligned for pointers */
+      union Storage
+      {
+         uint8_t bytes[N];
+         void *align;
+      };
+
+      /** Storage of the object held */
+      static Storage storage;
+
+      /** Index of the type of the object held, or the count of types */
+      static uint8_t owner;
+
+   public:
+      /** Size of the storage, in bytes */
+      static constexpr size_t size = N;
+
+      /** @return true if the scratch holds an object of type T */
+      template <class T> static bool holds()
+         { return owner == L::template index_of<T>(); }
+
+      /**
+       * Construct an object of type T, in place of the object held.
+       * @return The new object
+       */
+      template <class T> static T &construct()
+      {
+         static_assert( sizeof(T) <= N, "The scratch is too small for this type" );
+         static_assert( alignof(T) <= alignof(Storage), "The scratch is not aligned for this type" );
+
+         owner = L::template index_of<T>();
+
+         return *new (storage.bytes) T;
+      }
+
+      /** @return The object of type T held. It must be held */
+      template <class T> static T &get()
+         { return *static_cast<T *>(static_cast<void *>(storage.bytes)); }
+   };
+
+   template <class L, size_t N> typename Scratch<L, N>::Storage Scratch<L, N>::storage;
+
+   template <class L, size_t N> uint8_t Scratch<L, N>::owner = L::count;
+} // End of namespace 'lib'
+
+/** @} */
+/** @} */
+#endif /* ndef lib_scratch_hpp_HAS_ALREADY_BEEN_INCLUDED */
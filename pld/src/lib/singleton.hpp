@@ -5,103 +5,142 @@
  * @{
  * @addtogroup singleton
  *****************************************************************************
- * A statically allocated singleton implementation.
- * This template allow managing singleton instances, whose construction is
- *  triggered on the very first use, whilst using statically allocated
- *  memory.
+ * A statically allocated singleton implementation, and a registry of
+ *  singletons known at compile time.
+ * Each instance is a static object of the unit defining its type, made with
+ *  the macro #ALLOCATE_INSTANCE . It is constructed at init, before the
+ *  main, so using it costs no test and no indirection.
  * @n
- * Unlike global instances, whose order of creation cannot be controlled,
- *  this singleton pattern guarantee that the instance has been constructed.
- * The memory is statically allocated through the macro #ALLOCATE_INSTANCE .
+ * The implementation detail stays hidden in its unit. The other units only
+ *  see a forward declaration, and call the instance through function
+ *  templates the unit specializes next to its instance, such as
+ *  mode::update or display::show.
  * @n
- * This singleton pattern also allow the implementation detail to be
- *  hidden behind an interface. To use a derived implementation, a forward
- *  declaration is enough.
+ * A #lib::Registry lists such types. A call on the type at an index is
+ *  dispatched by a chain of tests on constants, which the compiler turns
+ *  into a switch of direct calls: no virtual table, no pointer to the
+ *  instances.
  * @n
  * Example:
  * @code
- * #include "lib/singleton.h"
- * using lib::Singleton;
- * struct ISequencer // Public interface
- * { virtual void doA() = 0; }
- * // Create a singleton of the interface
- * class SequencerA : Singleton<ISequencer, SequencerA>
- * { ... };
+ * #include "lib/singleton.hpp"
+ * // The operation, specialized by each sequencer
+ * template <class S> void doA();
+ * struct DoA
+ * {
+ *    typedef void result_type;
+ *    template <class S> static void apply() { doA<S>(); }
+ * };
+ *
+ * // In the unit of SequencerA
+ * class SequencerA
+ * { public: void doA() { ... } };
  * ALLOCATE_INSTANCE(SequencerA);
+ * template<> void doA<SequencerA>() { lib::instance<SequencerA>().doA(); }
  *
- * // To use the singleton from anywhere
- * // A forward declaration of SequencerA is enough.
- * Singleton<ISequencer, SequencerA>::instance().doA();
+ * // To use the singletons from anywhere
+ * // A forward declaration of SequencerA and SequencerB is enough.
+ * typedef lib::Registry<SequencerA, SequencerB> sequencers;
+ * sequencers::call<DoA>(index);
  * @endcode
  *****************************************************************************
  * @{
  * @file
- * [Mode](group__mode.html) base class and API
+ * Singleton and registry templates
  * @author gax
  */
 
-#include "lib/builtin.hpp"
+#include <stdint.h>
 
 namespace lib
 {
-   /** 
+   /**
+    * @ingroup singleton
+    * The instance of a given type.
+    * This is a placeholder only. The macro #ALLOCATE_INSTANCE provides the
+    *  actual instance in the unit defining the type.
+    * @tparam T The type of the instance
+    */
+   template <class T> T &instance();
+
+   /**
     * @ingroup singleton
-    * Allocate an objet of a given type.
-    * This is a placeholder only. The macro #ALLOCATE_INSTANCE takes
-    *  care of providing the actual typed instance of this function.
-    * @tparam A The type of object to allocate.
+    * Registry of singleton types, in order.
+    * An operation is a type with a result_type, and a static function
+    *  template apply called with the type of the singleton.
+    * @tparam T The types of the singletons
     */
-   template <class A> void *allocate();
-   
+   template <class... T> struct Registry;
+
    /**
     * @ingroup singleton
-    * Singleton class template definition.
-    * @tparam I The interface through which the template gets used
-    * @tparam T The type of object managed by the singleton
+    * Index of a type in a list of types. Fails the build if not listed.
+    * @tparam U The type to find
+    * @tparam T The list of types
     */
-   template <class I, class T> class Singleton : I
+   template <class U, class... T> struct IndexOf;
+
+   /** The type is further in the list */
+   template <class U, class H, class... T> struct IndexOf<U, H, T...>
+   {
+      static constexpr uint8_t value = 1 + IndexOf<U, T...>::value;
+   };
+
+   /** The type is the first of the list */
+   template <class U, class... T> struct IndexOf<U, U, T...>
    {
-      /** Force static memory allocation for each new type */
-      static I *storage;
-      
-   public:
-      /** @return The pointer to the abstract instance */
-      static I &instance()
+      static constexpr uint8_t value = 0;
+   };
+
+   /** End of the registry. Nothing at or beyond this index */
+   template <> struct Registry<>
+   {
+      /** Number of types */
+      static constexpr uint8_t count = 0;
+
+      /** @return The default result, for an index out of the registry */
+      template <class F> static typename F::result_type call(uint8_t)
+         { return typename F::result_type(); }
+   };
+
+   /** A type of the registry, followed by the others */
+   template <class H, class... T> struct Registry<H, T...>
+   {
+      /** Number of types */
+      static constexpr uint8_t count = 1 + sizeof...(T);
+
+      /** @return The index of the type U in the registry */
+      template <class U> static constexpr uint8_t index_of()
+         { return IndexOf<U, H, T...>::value; }
+
+      /**
+       * Apply an operation to the singleton at an index.
+       * @tparam F The operation
+       * @param index Index of the type in the registry
+       * @return The result of the operation
+       */
+      template <class F> static typename F::result_type call(uint8_t index)
       {
-         if ( storage == nullptr )
-         {
-            // Create a new object (Singleton<IMode, Boot>)
-            storage = (I *)allocate<T>();
-         }
-      
-         return *reinterpret_cast<I *>(storage);
+         return index == 0 ?
+            F::template apply<H>() : Registry<T...>::template call<F>(index - 1);
       }
    };
-   
-   template <class I, class T> I *Singleton<I, T>::storage = nullptr;
-
-   /**
-    * @ingroup singleton
-    * Shortcut to obtaining a instance pointer
-	*/
-   template <class I, class T> constexpr I *get_instance_ptr()
-      { return &Singleton<I, T>::instance(); }
 } // End of namespace 'lib'
 
 /**
- * Make provision for enough static memory to host an instance of T.
- * @warning This macro must be invoked outside of any namespace.
- * Otherwise it will fail.
+ * Allocate the instance of T, constructed at init.
+ * @warning This macro must be invoked outside of any namespace, once per
+ *  unit. Otherwise it will fail.
  * @tparam T Name of the class type to allocate.
  */
 #define ALLOCATE_INSTANCE(T) \
    namespace lib { \
-      namespace { char instance_storage[sizeof(T)]; } \
-      template<> void *allocate<T>() { \
-         return new (instance_storage) T; \
+      namespace { T instance_storage; } \
+      template<> T &instance<T>() { \
+         return instance_storage; \
       } \
    }
 
 /**@}*/
 /**@}*/
-#endif /* ndef lib_singleton_h_HAS_ALREADY_BEEN_INCLUDED */
\ No newline at end of file
+#endif /* ndef lib_singleton_h_HAS_ALREADY_BEEN_INCLUDED */
@@ -33,6 +33,7 @@
 #ifndef _WIN32
 #include <asf.h>
 #include "tc.h"
+#include "governor.h"
 
 typedef enum TC_INT_LEVEL_t _timer_int_level_t;
 
@@ -115,6 +116,11 @@ static timer_instance_t _timer_current_instance = TIMER_INVALID_INSTANCE;
 /** The API Handle for the reactor */
 static reactor_handle_t _timer_reactor_handle = 0;
 
+#ifndef _WIN32
+/** Clock source of the tick, kept while suspended */
+static uint8_t _timer_clock_source = TC_CLKSEL_DIV256_gc;
+#endif
+
 
 /************************************************************************/
 /* Private helpers                                                      */
@@ -140,6 +146,14 @@ static inline int32_t _timer_distance_of(timer_count_t from, timer_count_t to)
 	return retval;
 }
 
+#ifndef _WIN32
+/** Keep the 1ms tick as the clock changes */
+static void _timer_on_clock_change(uint8_t shift)
+{
+	governor_scale_tc(&TIMER_TC, 256, 125, shift);
+}
+#endif
+
 /************************************************************************/
 /* Local API                                                            */
 /************************************************************************/
@@ -197,6 +211,9 @@ void timer_init(void)
 	// Gives a overall clock as 125kHz
 	// This effectively starts the timer ticking
 	tc_write_clock_source(&TIMER_TC, TC_CLKSEL_DIV256_gc);
+
+	// Follow the clock
+	governor_register(&_timer_on_clock_change);
 #endif   
 
 	// Register with the reactor
@@ -372,5 +389,57 @@ void timer_dispatch(void)
 	}
 }
 
+/**
+ * Tell how long the CPU could sleep without missing a timer.
+ *
+ * @return The time to the first timer armed, 0 if expired or #TIMER_NEVER
+ */
+timer_count_t timer_get_time_to_next(void)
+{
+	_timer_future_t* pFuture = &_timer_future_sorted_list[_timer_slot_active];
+	int32_t distance;
+
+	if (_timer_slot_active == _timer_slot_avail && pFuture->cb == NULL)
+	{
+		return TIMER_NEVER;
+	}
+
+	distance = _timer_distance_of(timer_get_count(), pFuture->count);
+
+	return distance > 0 ? (timer_count_t)distance : 0;
+}
+
+/**
+ * Stop the tick, so the CPU can sleep deeper than idle.
+ * The counter no longer moves until #timer_resume.
+ */
+void timer_suspend(void)
+{
+#ifndef _WIN32
+	_timer_clock_source = ((TC0_t*)&TIMER_TC)->CTRLA;
+	tc_write_clock_source(&TIMER_TC, TC_CLKSEL_OFF_gc);
+#endif
+}
+
+/**
+ * Add the time slept to the counter and tick again.
+ *
+ * @param elapsed Time slept since #timer_suspend, as measured by the caller
+ */
+void timer_resume(timer_count_t elapsed)
+{
+	TIMER_ATOMIC_BLOCK()
+	{
+		_timer_free_running_ms_counter += elapsed;
+	}
+
+#ifndef _WIN32
+	tc_write_clock_source(&TIMER_TC, (TC_CLKSEL_t)_timer_clock_source);
+#endif
+
+	// Process the timers which may be due
+	reactor_notify(_timer_reactor_handle);
+}
+
 /**@}*/
 /**@} ---------------------------  End of file  --------------------------- */
\ No newline at end of file
@@ -74,6 +74,9 @@ typedef void (*timer_callback_t)( timer_instance_t, void * );
 /** Number of timer count in the given number of hours */
 #define TIMER_HOURS(x) TIMER_MINUTES(60*x)
 
+/** Time to the next timer when none is armed */
+#define TIMER_NEVER ((timer_count_t)-1)
+
 
 /************************************************************************/
 /* Public API                                                           */
@@ -109,6 +112,15 @@ static inline timer_instance_t timer_arm_from_now(
 /** To be called from the reactor only. Look for expired jobs and process */
 void timer_dispatch(void);
 
+/** Get the time to the next timer armed */
+timer_count_t timer_get_time_to_next(void);
+
+/** Stop the tick for a deep sleep. To be called from the reactor only */
+void timer_suspend(void);
+
+/** Catch up with the time slept and tick again. To be called from the reactor only */
+void timer_resume(timer_count_t elapsed);
+
 #ifdef __cplusplus
 }
 #endif
@@ -15,6 +15,7 @@
  */
 
 #include "tz.h"
+#include "civil.h"
 
 /** @cond simulator_only */
 // Prototype to be added to the simulator
@@ -42,7 +43,7 @@ static bool tz_is_summer_time( const uint32_t epochIn )
    struct calendar_date date;
 
    // We need the day of week - convert back
-   calendar_timestamp_to_date(epochIn, &date);
+   civil_timestamp_to_date(epochIn, &date);
  
    // Quickly rule out cases outside of the month
    if (date.month < MARCH_MONTH || date.month > OCTOBER_MONTH)
@@ -114,7 +115,7 @@ tz_datetime_t *tz_now( tz_datetime_t *pDate )
    tz_convert_to_cet(timeNow);
 
    // Convert to a date
-   calendar_timestamp_to_date( timeNow, pDate );
+   civil_timestamp_to_date( timeNow, pDate );
    
    return pDate;
 }
@@ -10,7 +10,7 @@
  * Timezone helper API
  * @author software@arreckx.com
  *****************************************************************************
- * Relies on the ASF calendar service
+ * Relies on the [civil](group__civil.html) date conversion service
  */ 
 
 #include <stdint.h>
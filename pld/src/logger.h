@@ -10,6 +10,8 @@
  *  its macros overridden.
  *
  * @usage       Define NDEBUG to disable this library
+ *              Define LOGGER_BINARY to record the traces in binary form and
+ *               format them later with LOG_FLUSH
  *
  * @author      ste, mrl, gpa
  *****************************************************************************
@@ -130,9 +132,21 @@ typedef enum {
 /** @see _log_set_domain_redirection */
 #  undef  LOG_SETDOMAINREDIRECTION
 #  define LOG_SETDOMAINREDIRECTION(d,f) _LOG_SETDOMAINREDIRECTION(d,f)
+/** @see _log_set_domain_rate */
+#  undef  LOG_SETDOMAINRATE
+#  define LOG_SETDOMAINRATE(d,l,r,b)   _LOG_SETDOMAINRATE(d,l,r,b)
+/** Start or stop profiling the LOG_HEADER and LOG_THIS_HEADER scopes. @see _log_profile */
+#  undef  LOG_PROFILE
+#  define LOG_PROFILE(enable)          _LOG_PROFILE(enable)
+/** Write the scopes profiled as folded stacks. @see _log_profile_write */
+#  undef  LOG_PROFILE_WRITE
+#  define LOG_PROFILE_WRITE(path)      _LOG_PROFILE_WRITE(path)
 /** @see _log_get_limit */
 #  undef  LOG_GETLIMIT
 #  define LOG_GETLIMIT                 _LOG_GETLIMIT
+/** Format the traces recorded in binary mode, report the traces dropped by the rate limits, and wait for the output to be written. @see _log_flush */
+#  undef  LOG_FLUSH
+#  define LOG_FLUSH()                  _LOG_FLUSH()
 
 /** Use to protect strings that may be null */
 #  undef  LOG_EMPTY_IF_NULL
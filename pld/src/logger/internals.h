@@ -58,6 +58,31 @@
 #endif
 
 
+/**
+ * Description of a LOG_HEADER or LOG_THIS_HEADER statement.
+ * One is statically allocated per statement. It holds the name of the
+ *  scope once formed, and the time spent in the scope while profiling.
+ */
+struct _logScopeSite_t
+{
+   unsigned long line;
+   const char   *file;
+   const char   *function;
+   const char   *mask;
+   /** Mangled class name the name was formed for */
+   const char   *classname;
+   /** Printable name of the scope, formed on first use */
+   char         *name;
+   /** Number of calls profiled */
+   unsigned long long calls;
+   /** Time spent in the scope in ns, including and excluding the inner scopes */
+   unsigned long long inclusive, exclusive;
+   /** Next site profiled */
+   _logScopeSite_t *next;
+   /** true once in the list of sites profiled */
+   bool profiled;
+};
+
 /**
  *****************************************************************************
  * Helper class which is used to add IN/OUT statement within methods or
@@ -69,24 +94,32 @@ class _logScopeObj_c
    {
 public:
    _logScopeObj_c(
-      unsigned long line,
-      const char   *file,
-      const char   *function,
-      const void   *pThis,
-      const char   *classname,
-      const char   *mask );
+      _logScopeSite_t *site,
+      const void      *pThis,
+      const char      *classname );
    ~_logScopeObj_c();
 protected:
-   void out( const char *strInOrOut );
+   void out( const char *strInOrOut, unsigned long line );
 private:
-   unsigned long m_line;
-   const char   *m_file;
-   const char   *m_function;
-   const void   *m_this;
-   const char   *m_classname;
-   const char   *m_mask;
+   _logScopeSite_t *m_site;
+   const void      *m_this;
+   const char      *m_classname;
+   bool             m_traced;
+   bool             m_profiled;
    };
 
+   /** True while the scopes are profiled */
+   extern volatile bool _log_profiling;
+
+   /** @return The printable name of a scope. The lock must be taken. */
+   const char *_log_scope_name( _logScopeSite_t *site, const char *classname );
+
+   /** Record the entry in a scope, in the profiler ring of the thread */
+   void _log_profile_enter( _logScopeSite_t *site );
+
+   /** Record the exit from a scope, in the profiler ring of the thread */
+   void _log_profile_exit( _logScopeSite_t *site );
+
    // Recall C method to avoid the compiler from implicitly casting
    //  the trace back to the C++ prototype, causing a endless loop (and crashing the code)
    extern "C" void _log_trace( const char *mask, const char *format, ...);
@@ -119,10 +152,45 @@ int  _log_set_domain_level( const char *domains, logLevel_t level );
 int  _log_clear_domain_level( const char *domains );
 int  _log_get_domain_levels( logDomainLevelPair_t* map, size_t maxBuffer, size_t maxDomains );
 int  _log_set_domain_redirection( const char *domains, FILE *pf );
+int  _log_set_domain_rate( const char *domains, logLevel_t level, unsigned long rate, unsigned long burst );
 long _log_get_limit( logLimit_t limitType );
 void _log_trace_stack();
 void _log_set_datetime_callback( LogDatetime_t );
 void _log_set_external_logger( LogCallback_t );
+void _log_os_flush();
+void _log_flush( void );
+void _log_profile( bool enable );
+int  _log_profile_write( const char *path );
+
+#ifdef LOGGER_BINARY
+/** Maximum number of arguments of a binary trace */
+#define _LOG_BINARY_MAX_ARGS 8
+
+/**
+ * Description of a trace statement in binary mode.
+ * One is statically allocated per call site and its address identifies the
+ *  format when the trace is recorded.
+ */
+typedef struct
+{
+   logLevel_t    level;
+   unsigned long line;
+   const char   *file;
+   const char   *function;
+   const char   *domain;
+   const char   *format;
+   /** Filter generation the cached decision was made for. 0 until used */
+   volatile unsigned long generation;
+   /** Cached filter decision */
+   volatile bool enabled;
+   /** Type of each argument. Empty if the format cannot be recorded */
+   char signature[_LOG_BINARY_MAX_ARGS + 1];
+} _logSite_t;
+
+void _log_binary_refresh( _logSite_t *site );
+void _log_binary_trace( _logSite_t *site, ... );
+void _log_binary_flush( void );
+#endif
 
 /*****************************************************************************
  *  Exported Data
@@ -135,6 +203,109 @@ extern const char    *_log_function;   /* Function name          */
 
 extern FILE   *_log_outfile;           /* Output file or 0 for system logger */
 extern char  **_log_public_domain_level_lookup;  /* Fake domain level lookup */
+extern volatile unsigned long _log_filter_generation; /* Changes with the filters */
+
+/*****************************************************************************
+ *  Domain filtering
+ *  Each domain name is reduced to an identifier, a hash computed at compile
+ *   time when the name is a literal. The identifier selects an entry of
+ *   _log_domain_table which holds the highest level shown for the domain.
+ *  The masks and the domain levels are matched against a domain the first
+ *   time it is traced after they change. All other traces of the domain are
+ *   filtered with a single load and compare.
+ ****************************************************************************/
+
+/** Number of entries of the domain table. Must be a power of 2 */
+#ifndef _LOG_DOMAIN_TABLE_SIZE
+#  ifdef LOGGER_SMALL
+#    define _LOG_DOMAIN_TABLE_SIZE 16
+#  else
+#    define _LOG_DOMAIN_TABLE_SIZE 64
+#  endif
+#endif
+
+/*
+ * An entry holds the identifier of the domain it was resolved for, or 0 if
+ *  empty. The low 4 bits of the identifiers are 0 and hold the highest level
+ *  shown + 1 in the entry (0 for a domain not shown at all).
+ */
+#define _LOG_DOMAIN_ID_FROM_HASH(h) \
+   ( ((h) & ~0xFUL) ? ((h) & ~0xFUL) : 0x10UL )
+
+#define _LOG_DOMAIN_ENTRY(id) \
+   _log_domain_table[ ((id) >> 4) & (_LOG_DOMAIN_TABLE_SIZE - 1) ]
+
+extern volatile unsigned long _log_domain_table[_LOG_DOMAIN_TABLE_SIZE];
+
+bool _log_domain_resolve( unsigned long id, const char *domain, logLevel_t level );
+
+#ifdef __cplusplus
+/** FNV-1a hash of the domain name, folded at compile time for literals */
+constexpr unsigned long _log_domain_hash( const char *domain, unsigned long h = 2166136261UL )
+{
+   return *domain ? _log_domain_hash( domain + 1, (h ^ (unsigned char)*domain) * 16777619UL ) : h;
+}
+
+/** Identifier of a domain name. 0 for the reserved NULL domain */
+constexpr unsigned long _log_domain_id( const char *domain )
+{
+   return domain ? _LOG_DOMAIN_ID_FROM_HASH( _log_domain_hash(domain) ) : 0UL;
+}
+#else
+/** Identifier of a domain name, from its FNV-1a hash. 0 for the reserved NULL domain */
+static inline unsigned long _log_domain_id( const char *domain )
+{
+   unsigned long h = 2166136261UL;
+
+   if ( ! domain )
+   {
+      return 0;
+   }
+
+   while ( *domain )
+   {
+      h = (h ^ (unsigned char)*domain++) * 16777619UL;
+   }
+
+   return _LOG_DOMAIN_ID_FROM_HASH( h );
+}
+#endif
+
+/**
+ * @param id     Identifier of the domain, from _log_domain_id
+ * @param domain The domain name, or NULL for the reserved domain
+ * @param level  Level of the trace
+ * @return true if the trace is to be shown
+ */
+static inline bool _log_domain_is_enabled( unsigned long id, const char *domain, logLevel_t level )
+{
+   unsigned long entry;
+
+   if ( ! domain )
+   {
+      return _log_level >= level;
+   }
+
+   entry = _LOG_DOMAIN_ENTRY(id) ^ id;
+
+   if ( entry <= 0xF )
+   {
+      return entry > (unsigned long)level;
+   }
+
+   // Not resolved since the filters changed, or shared with another domain
+   return _log_domain_resolve( id, domain, level );
+}
+
+#ifdef __cplusplus
+#  define _LOG_DOMAIN_SHOWS(dom, level) \
+      _log_domain_is_enabled( _log_domain_id(dom), dom, level )
+#else
+/* The identifier is hashed at run time in C. Skip it when the level alone rules the trace out */
+#  define _LOG_DOMAIN_SHOWS(dom, level) \
+      ( ! (_log_level < level && _LOG_DOMAIN_LEVEL_LOOKUP_IS_EMPTY) && \
+        _log_domain_is_enabled( _log_domain_id(dom), dom, level ) )
+#endif
 
 #ifdef LOGGER_SMALL
 #  define _LOG_INIT(x)                  _log_init(false, x)
@@ -152,6 +323,9 @@ extern char  **_log_public_domain_level_lookup;  /* Fake domain level lookup */
 #  define _LOG_CLEARDOMAINLEVEL(d)      _log_clear_domain_level(d)
 #  define _LOG_GETDOMAINLEVELS(a,b,c)   _log_get_domain_levels(a,b,c)
 #  define _LOG_SETDOMAINREDIRECTION(d,f) _log_set_domain_redirection(d,f)
+#  define _LOG_SETDOMAINRATE(d,l,r,b)   _log_set_domain_rate(d, (logLevel_t)l, r, b)
+#  define _LOG_PROFILE(enable)          _log_profile(enable)
+#  define _LOG_PROFILE_WRITE(path)      _log_profile_write(path)
 #  define _LOG_TRACE_STACK()            _log_trace_stack();
 #  define _LOG_SET_DATETIME_CALLBACK(c) _log_set_datetime_callback(c)
 #  define _LOG_SET_EXTERNAL_LOGGER(c)   _log_set_external_logger(c)
@@ -171,21 +345,49 @@ extern char  **_log_public_domain_level_lookup;  /* Fake domain level lookup */
 #  define _LOG_DOMAIN_LEVEL_LOOKUP_IS_EMPTY \
     (*((char *)_log_public_domain_level_lookup)==0)
 
-#  define _LOG_CHECK_LEVEL_AND_TRACE(level) \
-      if ( _log_level < level && _LOG_DOMAIN_LEVEL_LOOKUP_IS_EMPTY ) {} else _LOG_TRACE_AT_LEVEL(level)
+#  define _LOG_CHECK_LEVEL_AND_TRACE(level, dom, ...) \
+      if ( ! _LOG_DOMAIN_SHOWS(dom, level) ) {} \
+      else _LOG_TRACE_AT_LEVEL(level)(dom, __VA_ARGS__)
 
-#  define _LOG_ERROR _LOG_TRACE_AT_LEVEL(LOG_LEVEL_ERROR)
-#  define _LOG_WARN  _LOG_CHECK_LEVEL_AND_TRACE(LOG_LEVEL_WARN)
-#  define _LOG_MILE  _LOG_CHECK_LEVEL_AND_TRACE(LOG_LEVEL_MILE)
-#  define _LOG_INFO  _LOG_CHECK_LEVEL_AND_TRACE(LOG_LEVEL_INFO)
-#  define _LOG_TRACE _LOG_CHECK_LEVEL_AND_TRACE(LOG_LEVEL_TRACE)
-#  define _LOG_DEBUG _LOG_CHECK_LEVEL_AND_TRACE(LOG_LEVEL_DEBUG)
+#ifdef LOGGER_BINARY
+/*
+ * Binary mode: the call site only records the address of its description
+ *  and the raw arguments. The filter decision is cached in the description
+ *  until the filters change. The text is formed later by _log_binary_flush.
+ */
+#  define _LOG_BINARY_AT_LEVEL(level, dom, fmt, ...) \
+      do { \
+         static _logSite_t _log_site = { level, __LINE__, __FILE__, __FUNCTION__, dom, fmt }; \
+         if ( _log_site.generation != _log_filter_generation ) \
+            _log_binary_refresh( &_log_site ); \
+         if ( _log_site.enabled ) \
+            _log_binary_trace( &_log_site, ##__VA_ARGS__ ); \
+      } while (0)
+
+#  define _LOG_ERROR(...) _LOG_BINARY_AT_LEVEL(LOG_LEVEL_ERROR, __VA_ARGS__)
+#  define _LOG_WARN(...)  _LOG_BINARY_AT_LEVEL(LOG_LEVEL_WARN, __VA_ARGS__)
+#  define _LOG_MILE(...)  _LOG_BINARY_AT_LEVEL(LOG_LEVEL_MILE, __VA_ARGS__)
+#  define _LOG_INFO(...)  _LOG_BINARY_AT_LEVEL(LOG_LEVEL_INFO, __VA_ARGS__)
+#  define _LOG_TRACE(...) _LOG_BINARY_AT_LEVEL(LOG_LEVEL_TRACE, __VA_ARGS__)
+#  define _LOG_DEBUG(...) _LOG_BINARY_AT_LEVEL(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#  define _LOG_FLUSH()    _log_binary_flush()
+#else
+/* The errors are not filtered at the call site, as before the domain table */
+#  define _LOG_ERROR(...) _LOG_TRACE_AT_LEVEL(LOG_LEVEL_ERROR)(__VA_ARGS__)
+#  define _LOG_WARN(...)  _LOG_CHECK_LEVEL_AND_TRACE(LOG_LEVEL_WARN, __VA_ARGS__)
+#  define _LOG_MILE(...)  _LOG_CHECK_LEVEL_AND_TRACE(LOG_LEVEL_MILE, __VA_ARGS__)
+#  define _LOG_INFO(...)  _LOG_CHECK_LEVEL_AND_TRACE(LOG_LEVEL_INFO, __VA_ARGS__)
+#  define _LOG_TRACE(...) _LOG_CHECK_LEVEL_AND_TRACE(LOG_LEVEL_TRACE, __VA_ARGS__)
+#  define _LOG_DEBUG(...) _LOG_CHECK_LEVEL_AND_TRACE(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#  define _LOG_FLUSH()               _log_flush()
+#endif
 
 /* Special case for assert - we do not want to strip the code, by simply to error */
 #     define _LOG_ASSERT(exp, expstr) \
       { \
          if ( ! (exp) ) { \
             _LOG_ERROR( NULL, "Assertion %s failed", expstr); \
+            _LOG_FLUSH(); \
             _log_trace_stack(); \
             abort(); \
          } \
@@ -194,7 +396,7 @@ extern char  **_log_public_domain_level_lookup;  /* Fake domain level lookup */
 #     ifdef __cplusplus
 
          #define _LOG_STREAM(dom,level,os) \
-            if ( _log_level < level && _LOG_DOMAIN_LEVEL_LOOKUP_IS_EMPTY ) {} \
+            if ( ! _LOG_DOMAIN_SHOWS(dom, level) ) {} \
             else { \
                _log_lock(); \
                _log_type = level; \
@@ -204,10 +406,11 @@ extern char  **_log_public_domain_level_lookup;  /* Fake domain level lookup */
                std::ostringstream ss; ss << os; \
                _log_trace(dom, ss.str().c_str()); }
 #        define _LOG_THIS_HEADER(dom) \
-            volatile _logScopeObj_c _log_scope = _logScopeObj_c( \
-               __LINE__, __FILE__, __FUNCTION__, this, typeid( *this ).name(), dom )
+            static _logScopeSite_t _log_scope_site = { __LINE__, __FILE__, __FUNCTION__, dom }; \
+            volatile _logScopeObj_c _log_scope( &_log_scope_site, this, typeid( *this ).name() )
 #        define _LOG_HEADER(dom) \
-            volatile _logScopeObj_c _log_scope( __LINE__, __FILE__, __FUNCTION__, 0, 0, dom )
+            static _logScopeSite_t _log_scope_site = { __LINE__, __FILE__, __FUNCTION__, dom }; \
+            volatile _logScopeObj_c _log_scope( &_log_scope_site, 0, 0 )
 #    endif
 
 #ifdef __cplusplus
@@ -249,9 +452,13 @@ static void _log_trace_nill(const char *domain, const char *format, ...) {}
 #  define _LOG_SETLEVEL(a)              ((void)0)
 #  define _LOG_GETDOMAINLEVELS(a,b,c)   ((void)0)
 #  define _LOG_SETDOMAINLEVEL(a,b)      ((void)0)
+#  define _LOG_SETDOMAINRATE(a,b,c,d)   ((void)0)
+#  define _LOG_PROFILE(a)               ((void)0)
+#  define _LOG_PROFILE_WRITE(a)         ((int)-1)
 #  define _LOG_GETLIMIT(a)              ((int)-1)
 #  define _LOG_TRACE_STACK()            ((void)0)
 #  define _LOG_SET_DATETIME_CALLBACK(c) ((void)0)
+#  define _LOG_FLUSH()                  ((void)0)
 
 #  define _LOG_WARN         1 ? (void)0 : _log_trace_nill
 #  define _LOG_MILE         1 ? (void)0 : _log_trace_nill
@@ -0,0 +1,528 @@
+/*-
+ *****************************************************************************
+ * Binary mode of the tracing library.
+ * A trace statement records the address of its call site description (which
+ *  holds the format, the domain, the file, the function and the line) and
+ *  its raw arguments in a ring of fixed size records. No formatting and no
+ *  lock take place.
+ * The text is formed later from the description by _log_binary_flush, in
+ *  the context of the caller, usually an idle or UI thread.
+ * The ring keeps the most recent records: if the traces are not flushed in
+ *  time, the oldest are lost and counted.
+ * Formats with a '*' width or precision, or with too many arguments, are
+ *  formatted straight away as in the text mode.
+ *
+ * @usage       Define LOGGER_BINARY
+ * @author gpa
+ *****************************************************************************
+ */
+
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_DEPRECATE
+#endif
+
+//----------------------------------------------------------------------------
+//  Local include
+//----------------------------------------------------------------------------
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "logger.h"
+#include "logger_os.h"
+#include "logger_limits.h"
+
+#ifdef LOGGER_BINARY
+
+//----------------------------------------------------------------------------
+//  Local types
+//----------------------------------------------------------------------------
+
+/** A recorded trace */
+typedef struct
+{
+   /**
+    * Index of the record plus 1 once complete.
+    * Set to the index whilst being written.
+    */
+   volatile unsigned long sequence;
+
+   /** Call site description */
+   const _logSite_t *site;
+
+   /** Thread which made the trace */
+   _LOG_THREAD_ID thread;
+
+   /** Number of arguments recorded. Can be less than the format requires. */
+   unsigned char count;
+
+   /** Raw arguments, in their native representation */
+   unsigned char data[_LOG_BINARY_SLOT_DATA];
+} _logBinaryRecord_t;
+
+//----------------------------------------------------------------------------
+//  Local variables
+//----------------------------------------------------------------------------
+
+/** Records ring */
+static _logBinaryRecord_t _log_binary_ring[_LOG_BINARY_RING_SLOTS];
+
+/** Index of the next record to write */
+static volatile unsigned long _log_binary_head = 0;
+
+/** Index of the next record to format */
+static unsigned long _log_binary_tail = 0;
+
+/** Conversion characters ending a format specification */
+static const char _log_binary_conversions[] = "diouxXcfFeEgGaAsp";
+
+//----------------------------------------------------------------------------
+//  External functions
+//----------------------------------------------------------------------------
+
+/** Defined in logger_common.c */
+void _log_vtrace( const char *domain, const char *format, va_list pList );
+
+/** Defined in logger_common.c */
+bool _log_filter_trace( const char *domain );
+
+/** Defined in logger_common.c. Thread reported by the next trace if not 0 */
+extern _LOG_THREAD_ID _log_thread_override;
+
+//----------------------------------------------------------------------------
+//  Local functions
+//----------------------------------------------------------------------------
+
+/**
+ * Work out the type of each argument from the format.
+ * The signature is set to "?" if the format cannot be recorded.
+ *
+ * @param site  The call site description to update
+ */
+static void _log_binary_parse( _logSite_t *site )
+{
+   const char *f = site->format;
+   size_t n = 0;
+
+   while ( *f )
+   {
+      int longs = 0;
+      bool isSize = false;
+      char type;
+
+      if ( *f++ != '%' )
+      {
+         continue;
+      }
+
+      if ( *f == '%' )
+      {
+         ++f;
+         continue;
+      }
+
+      // Skip the flags, width and precision
+      while ( *f && strchr( "-+ #0123456789.", *f ) )
+      {
+         ++f;
+      }
+
+      // Length modifiers
+      while ( *f && strchr( "hlzjtL*", *f ) )
+      {
+         switch ( *f++ )
+         {
+            case 'h': break;
+            case 'l': ++longs; break;
+            case 'z': isSize = true; break;
+            default: goto unsupported; // '*', intmax_t, ptrdiff_t and long double
+         }
+      }
+
+      switch ( *f++ )
+      {
+         case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': case 'c':
+            type = isSize ? 'z' : longs == 0 ? 'i' : longs == 1 ? 'l' : 'q';
+            break;
+         case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            type = 'd';
+            break;
+         case 's':
+            if ( longs )
+            {
+               goto unsupported;
+            }
+            type = 's';
+            break;
+         case 'p':
+            type = 'p';
+            break;
+         default:
+            goto unsupported;
+      }
+
+      if ( n == _LOG_BINARY_MAX_ARGS )
+      {
+         goto unsupported;
+      }
+
+      site->signature[n++] = type;
+   }
+
+   site->signature[n] = '\0';
+   return;
+
+unsupported:
+   strcpy( site->signature, "?" );
+}
+
+/**
+ * Append a value to a record if there is room
+ *
+ * @return The position following the value, or NULL if there is no room
+ */
+static unsigned char *_log_binary_put(
+   unsigned char *pTo, const unsigned char *pEnd, const void *pValue, size_t size )
+{
+   if ( pTo == NULL || (size_t)(pEnd - pTo) < size )
+   {
+      return NULL;
+   }
+
+   memcpy( pTo, pValue, size );
+
+   return pTo + size;
+}
+
+/**
+ * Form the text of a record, argument by argument
+ *
+ * @param pRecord  The record to format
+ * @param text     Receives the text
+ * @param size     Size of the text buffer
+ */
+static void _log_binary_format( const _logBinaryRecord_t *pRecord, char *text, size_t size )
+{
+   const _logSite_t *site = pRecord->site;
+   const char *f = site->format;
+   const char *type = site->signature;
+   const unsigned char *pFrom = pRecord->data;
+   unsigned char left = pRecord->count;
+   size_t n = 0;
+
+   while ( *f && n + 1 < size )
+   {
+      char spec[16];
+      const char *start = f;
+      size_t length;
+      int written = 0;
+
+      if ( *f != '%' )
+      {
+         text[n++] = *f++;
+         continue;
+      }
+
+      if ( f[1] == '%' )
+      {
+         text[n++] = '%';
+         f += 2;
+         continue;
+      }
+
+      // Isolate the specification
+      while ( *++f && ! strchr( _log_binary_conversions, *f ) ) {}
+
+      if ( *f++ == '\0' )
+      {
+         break;
+      }
+
+      length = (size_t)(f - start) < sizeof(spec) ? (size_t)(f - start) : sizeof(spec) - 1;
+      memcpy( spec, start, length );
+      spec[length] = '\0';
+
+      // The record was too short for this argument
+      if ( left == 0 )
+      {
+         written = snprintf( text + n, size - n, "<?>" );
+      }
+      else switch ( --left, *type++ )
+      {
+#        define _LOG_BINARY_FORMAT_AS(T) \
+            { T v; memcpy( &v, pFrom, sizeof(v) ); pFrom += sizeof(v); \
+              written = snprintf( text + n, size - n, spec, v ); } break
+
+         case 'i': _LOG_BINARY_FORMAT_AS(int);
+         case 'l': _LOG_BINARY_FORMAT_AS(long);
+         case 'q': _LOG_BINARY_FORMAT_AS(long long);
+         case 'z': _LOG_BINARY_FORMAT_AS(size_t);
+         case 'd': _LOG_BINARY_FORMAT_AS(double);
+         case 'p': _LOG_BINARY_FORMAT_AS(void *);
+
+#        undef _LOG_BINARY_FORMAT_AS
+
+         case 's':
+         {
+            char str[256];
+            unsigned char l = *pFrom++;
+
+            memcpy( str, pFrom, l );
+            str[l] = '\0';
+            pFrom += l;
+
+            written = snprintf( text + n, size - n, spec, str );
+            break;
+         }
+      }
+
+      if ( written > 0 )
+      {
+         n += ( (size_t)written < size - n ) ? (size_t)written : size - n - 1;
+      }
+   }
+
+   text[n] = '\0';
+}
+
+/**
+ * Print a text as if traced from a call site.
+ * The lock must be taken and is released.
+ */
+static void _log_binary_print( const _logSite_t *site, _LOG_THREAD_ID thread, const char *format, ... )
+{
+   va_list pList;
+
+   _log_line            = site->line;
+   _log_filename        = site->file;
+   _log_function        = site->function;
+   _log_type            = site->level;
+   _log_thread_override = thread;
+
+   va_start( pList, format );
+   _log_vtrace( site->domain, format, pList );
+   va_end( pList );
+}
+
+//----------------------------------------------------------------------------
+//  Public API
+//----------------------------------------------------------------------------
+
+/**
+ *****************************************************************************
+ * Update the filter decision cached in a call site description.
+ * Called by the trace macros the first time through and each time the
+ *  filters changed.
+ *
+ * @param site  The call site description
+ *****************************************************************************
+ */
+void _log_binary_refresh( _logSite_t *site )
+{
+   unsigned long generation;
+
+   _log_lock();
+
+   generation = _log_filter_generation;
+
+   if ( site->generation == 0 )
+   {
+      _log_binary_parse( site );
+   }
+
+   _log_type = site->level;
+   site->enabled = _log_filter_trace( site->domain );
+   site->generation = generation;
+
+   _log_unlock();
+}
+
+/**
+ *****************************************************************************
+ * Record a trace. Called by the trace macros once the trace is known to pass
+ *  the filters.
+ * Arguments which do not fit in the record are dropped, and strings are
+ *  truncated to fit.
+ *
+ * @param site  The call site description
+ * @param ...   The arguments of the format
+ *****************************************************************************
+ */
+void _log_binary_trace( _logSite_t *site, ... )
+{
+   va_list pList;
+   unsigned long index;
+   _logBinaryRecord_t *pRecord;
+   unsigned char *pTo;
+   const unsigned char *pEnd;
+   const char *type;
+
+   va_start( pList, site );
+
+   if ( site->signature[0] == '?' )
+   {
+      // Cannot be recorded. Trace as text now.
+      _log_lock();
+      _log_line     = site->line;
+      _log_filename = site->file;
+      _log_function = site->function;
+      _log_type     = site->level;
+      _log_vtrace( site->domain, site->format, pList );
+      va_end( pList );
+
+      return;
+   }
+
+   index   = _log_atomic_increment( &_log_binary_head );
+   pRecord = &_log_binary_ring[index & (_LOG_BINARY_RING_SLOTS - 1)];
+   pTo     = pRecord->data;
+   pEnd    = pRecord->data + sizeof(pRecord->data);
+
+   // Mark as being written
+   _log_atomic_store( &pRecord->sequence, index );
+
+   pRecord->site   = site;
+   pRecord->thread = _log_get_current_thread_id();
+   pRecord->count  = 0;
+
+   for ( type = site->signature; *type && pTo; ++type )
+   {
+      switch ( *type )
+      {
+#        define _LOG_BINARY_RECORD_AS(T) \
+            { T v = va_arg( pList, T ); pTo = _log_binary_put( pTo, pEnd, &v, sizeof(v) ); } break
+
+         case 'i': _LOG_BINARY_RECORD_AS(int);
+         case 'l': _LOG_BINARY_RECORD_AS(long);
+         case 'q': _LOG_BINARY_RECORD_AS(long long);
+         case 'z': _LOG_BINARY_RECORD_AS(size_t);
+         case 'd': _LOG_BINARY_RECORD_AS(double);
+         case 'p': _LOG_BINARY_RECORD_AS(void *);
+
+#        undef _LOG_BINARY_RECORD_AS
+
+         case 's':
+         {
+            const char *str = va_arg( pList, const char * );
+            size_t room = pEnd - pTo;
+            size_t l;
+
+            str = _LOG_EMPTY_IF_NULL( str );
+            l = strlen( str );
+
+            if ( room == 0 )
+            {
+               pTo = NULL;
+               break;
+            }
+
+            // Keep what fits
+            if ( l > room - 1 )
+            {
+               l = room - 1;
+            }
+
+            if ( l > 255 )
+            {
+               l = 255;
+            }
+
+            *pTo++ = (unsigned char)l;
+            memcpy( pTo, str, l );
+            pTo += l;
+            break;
+         }
+      }
+
+      if ( pTo )
+      {
+         ++pRecord->count;
+      }
+   }
+
+   va_end( pList );
+
+   // Publish
+   _log_atomic_store( &pRecord->sequence, index + 1 );
+}
+
+/**
+ *****************************************************************************
+ * Format and print all the complete records, from the oldest.
+ * The records being written are left for the next call.
+ * The number of records lost since the last call, if any, is reported.
+ * Returns once the OS layer has written the text out.
+ *****************************************************************************
+ */
+void _log_binary_flush( void )
+{
+   static const _logSite_t lostSite = {
+      LOG_LEVEL_WARN, __LINE__, __FILE__, "_log_binary_flush", "log", "" };
+   static char text[_LOG_SIZED_FOR(_LOG_MAX_TRACE)];
+   unsigned long head;
+   unsigned long lost = 0;
+
+   // Single consumer
+   _log_lock();
+
+   head = _log_binary_head;
+
+   if ( head - _log_binary_tail > _LOG_BINARY_RING_SLOTS )
+   {
+      lost += head - _log_binary_tail - _LOG_BINARY_RING_SLOTS;
+      _log_binary_tail = head - _LOG_BINARY_RING_SLOTS;
+   }
+
+   while ( _log_binary_tail != head )
+   {
+      _logBinaryRecord_t *pRecord =
+         &_log_binary_ring[_log_binary_tail & (_LOG_BINARY_RING_SLOTS - 1)];
+      unsigned long sequence = pRecord->sequence;
+      long ahead = (long)(sequence - (_log_binary_tail + 1));
+      _logBinaryRecord_t copy;
+
+      // Still being written
+      if ( ahead < 0 )
+      {
+         break;
+      }
+
+      ++_log_binary_tail;
+
+      // Overwritten by a later record
+      if ( ahead > 0 )
+      {
+         ++lost;
+         continue;
+      }
+
+      memcpy( &copy, (const void *)pRecord, sizeof(copy) );
+
+      // Overwritten whilst copied
+      if ( pRecord->sequence != sequence )
+      {
+         ++lost;
+         continue;
+      }
+
+      _log_binary_format( &copy, text, sizeof(text) );
+
+      _log_lock(); // The trace will unlock
+      _log_binary_print( copy.site, copy.thread, "%s", text );
+   }
+
+   if ( lost )
+   {
+      _log_lock();
+      _log_binary_print( &lostSite, 0, "%lu traces lost", lost );
+   }
+
+   _log_unlock();
+
+   _log_flush();
+}
+
+#endif // def LOGGER_BINARY
+
+/* ---------------------------- End of file ------------------------------- */
@@ -71,6 +71,36 @@ typedef struct
 } _logDomainFilePair_t;
 #endif // ndef LOGGER_HAS_NO_FILE_SUPPORT
 
+/** Define the per domain rate limits, for a level and all the less severe ones */
+typedef struct
+{
+   _logDomainIdentifier_t domain;
+   logLevel_t level;
+   /** Traces per second */
+   unsigned long rate;
+   /** Traces allowed in a row */
+   unsigned long burst;
+} _logDomainRatePair_t;
+
+/** Token bucket of a domain for a level */
+typedef struct
+{
+   /** Thousandths of traces allowed */
+   unsigned long tokens;
+   /** Time of the last refill in ms */
+   unsigned long last;
+   /** Traces dropped since the last summary */
+   unsigned long dropped;
+} _logBucket_t;
+
+/** Rate limit state of an entry of the domain table */
+typedef struct
+{
+   /** The limit applying to the domain, or NULL */
+   const _logDomainRatePair_t *limit;
+   _logBucket_t bucket[LOG_LEVEL_DEBUG + 1];
+} _logDomainRate_t;
+
 //----------------------------------------------------------------------------
 //  Local variables
 //----------------------------------------------------------------------------
@@ -107,6 +137,12 @@ _logDomainFilePair_t _log_domain_file_lookup[_LOG_MAX_DOMAIN_FILE_REDIRECTION];
 /** Allow specific levels on specific domains */
 _logDomainLevelPair_t _log_domain_level_lookup[_LOG_MAX_DOMAIN_LEVEL_FILTERS];
 
+/**
+ * Incremented each time the level, the masks or the domain levels change,
+ *  so decisions cached by the call sites can be invalidated
+ */
+volatile unsigned long _log_filter_generation = 1;
+
 /** Set the fake domain level lookup */
 char **_log_public_domain_level_lookup = (char **)_log_domain_level_lookup;
 
@@ -120,6 +156,33 @@ static _logDomainIdentifier_t _log_mask[_LOG_MAX_DOMAINS + 1 /* End Mark */];
 /** @see _log_mask */
 static _logDomainIdentifier_t _log_not_mask[_LOG_MAX_DOMAINS + 1 /* End Mark */];
 
+/** If not 0, thread reported by the next trace in place of the current one */
+_LOG_THREAD_ID _log_thread_override = 0;
+
+/**
+ * Highest level shown for each domain traced so far, indexed by the domain
+ *  identifier. @see _log_domain_is_enabled
+ */
+volatile unsigned long _log_domain_table[_LOG_DOMAIN_TABLE_SIZE];
+
+/** Name of the domain of each entry of #_log_domain_table, empty if too long */
+static _logDomainIdentifier_t _log_domain_names[_LOG_DOMAIN_TABLE_SIZE];
+
+/** Allow rate limits on specific domains */
+static _logDomainRatePair_t _log_domain_rate_lookup[_LOG_MAX_DOMAIN_RATE_LIMITS];
+
+/** Rate limit state of each entry of #_log_domain_table */
+static _logDomainRate_t _log_domain_rates[_LOG_DOMAIN_TABLE_SIZE];
+
+/** Traces dropped by the rate limits since the last summary */
+static unsigned long _log_rate_dropped = 0;
+
+/** Part of #_log_rate_dropped from domains no longer in the table */
+static unsigned long _log_rate_dropped_others = 0;
+
+/** Time of the last summary of the traces dropped, in ms */
+static unsigned long _log_rate_last_summary = 0;
+
 /** Structure with settings since the last call to trace */
 static _logSetting_t _log_last;
 
@@ -144,6 +207,8 @@ static LogCallback_t _log_logger_callback = NULL;
 /** Separators between domains */
 static const char seps[]   = "|:;,!/";
 
+static void _log_filters_changed( void );
+
 
 //----------------------------------------------------------------------------
 //  Public API
@@ -367,10 +432,11 @@ const char * const log_get_truncated_string(
 {
    static const char wasTruncated[]="...";
 
-   size_t l = strlen(p) - maxLength - 1 /* \0 */;
+   size_t length = strlen(p);
 
-   if ( l > 0 )
+   if ( length > (size_t)maxLength + 1 /* \0 */ )
    {
+      size_t l = length - maxLength - 1;
       *pTruncationMarkBuffer = wasTruncated;
       return &p[l+sizeof(wasTruncated)];
    }
@@ -408,8 +474,10 @@ void _log_init( bool splitPatternOff )
    // All domain activated
    memset( _log_mask, 0, sizeof(_log_mask) );
 
-   // No domain level filtering
+   // No domain level filtering, nor rate limits
    _log_reset_domain_level_filters();
+   memset( _log_domain_rate_lookup, 0, sizeof(_log_domain_rate_lookup) );
+   _log_filters_changed();
 
    // Create the print sync mutex
    _log_mutex_init();
@@ -767,33 +835,19 @@ bool _log_is_set( const char *mask )
 
 
 /**
- * Quick check to see if domain filtering is activated.
+ * Match a domain against the masks and the domain levels.
  * Assumes the lock is taken.
- * The lock is left untouched.
  *
- * @param domain The domain to filter
- * @return true to indicate that the domain is to proceed.
- *         false means that domain should not be displayed
+ * @param domain The domain to match
+ * @return The highest level shown for the domain, or -1 if not shown at all
  */
-bool _log_filter_trace( const char *domain )
+static int _log_get_domain_threshold( const char *domain )
 {
-   // Empty domain means display in all cases.
-   if ( ! domain )
-   {
-      return _log_level >= _log_type;
-   }
-
    // Short cut for 99% of cases where there are no domain level filtering
    if ( _LOG_DOMAIN_LEVEL_LOOKUP_IS_EMPTY )
    {
-      // If the level is OK
-      if ( _log_level >= _log_type )
-      {
-         // Check domain in show list or not in hide list
-         return _log_is_set(domain);
-      }
-
-      return false;
+      // Check domain in show list or not in hide list
+      return _log_is_set(domain) ? (int)_log_level : -1;
    }
 
    // Check to see if the domain has a level associated
@@ -819,22 +873,313 @@ bool _log_filter_trace( const char *domain )
 
    if (matches)
    {
-      // The domain is in the list - Check the level and return now !
-      return ( level >= _log_type );
+      // The domain is in the list - Its level applies
+      return (int)level;
    }
 
    // We're back where we started. The domain list is not empty, but this domain
    //  is not affected
-   // If the level is OK
-   if ( _log_level >= _log_type )
+   return _log_is_set(domain) ? (int)_log_level : -1;
+}
+
+
+/**
+ * Match a domain against the rate limits.
+ * Assumes the lock is taken.
+ *
+ * @param domain The domain to match
+ * @return The best matching limit, or NULL
+ */
+static const _logDomainRatePair_t *_log_get_domain_rate( const char *domain )
+{
+   const _logDomainRatePair_t *limit = NULL;
+   int bestScore = 0;
+   size_t i;
+
+   for (
+      i=0;
+      i<_LOG_MAX_DOMAIN_RATE_LIMITS && _log_domain_rate_lookup[i].domain.name[0];
+      ++i )
    {
-      // Check domain in show list or not in hide list
-      return _log_is_set(domain);
+      if ( wildcmp( _log_domain_rate_lookup[i].domain.name, domain, &bestScore ) )
+      {
+         limit = &_log_domain_rate_lookup[i];
+      }
+   }
+
+   return limit;
+}
+
+
+/**
+ * Attach the rate limit of a domain to an entry of #_log_domain_table, with
+ *  full buckets. Assumes the lock is taken.
+ *
+ * @param i         Index of the entry
+ * @param domain    The domain of the entry, or NULL if not known
+ * @param newDomain true if the entry was used by another domain
+ */
+static void _log_set_entry_rate( size_t i, const char *domain, bool newDomain )
+{
+   _logDomainRate_t *pRate = &_log_domain_rates[i];
+   unsigned long now = _log_get_tick_ms();
+   size_t l;
+
+   for ( l=0; l<=LOG_LEVEL_DEBUG; ++l )
+   {
+      if ( newDomain )
+      {
+         // Still reported, without the name
+         _log_rate_dropped_others += pRate->bucket[l].dropped;
+         pRate->bucket[l].dropped = 0;
+      }
+
+      pRate->bucket[l].last = now;
+   }
+
+   pRate->limit = domain ? _log_get_domain_rate(domain) : NULL;
+
+   for ( l=0; l<=LOG_LEVEL_DEBUG; ++l )
+   {
+      pRate->bucket[l].tokens = pRate->limit ? pRate->limit->burst * 1000 : 0;
+   }
+}
+
+
+/**
+ * Recompute the entries of #_log_domain_table from the masks, the domain
+ *  levels and the rate limits. Called with the lock taken, each time they
+ *  change.
+ */
+static void _log_filters_changed( void )
+{
+   size_t i;
+
+   ++_log_filter_generation;
+
+   for ( i=0; i<_LOG_DOMAIN_TABLE_SIZE; ++i )
+   {
+      if ( _log_domain_names[i].name[0] )
+      {
+         _log_domain_table[i] = (_log_domain_table[i] & ~0xFUL) |
+            (unsigned long)(_log_get_domain_threshold(_log_domain_names[i].name) + 1);
+
+         _log_set_entry_rate( i, _log_domain_names[i].name, false );
+      }
+      else
+      {
+         // Resolved again when next traced
+         _log_domain_table[i] = 0;
+
+         _log_set_entry_rate( i, NULL, true );
+      }
+   }
+}
+
+
+/**
+ * Add a domain to #_log_domain_table.
+ * Called by _log_domain_is_enabled the first time a domain is traced, or
+ *  when its entry is used by another domain.
+ *
+ * @param id     Identifier of the domain
+ * @param domain The domain name
+ * @param level  Level of the trace
+ * @return true if the trace is to be shown
+ */
+bool _log_domain_resolve( unsigned long id, const char *domain, logLevel_t level )
+{
+   size_t i = (id >> 4) & (_LOG_DOMAIN_TABLE_SIZE - 1);
+   unsigned long entry;
+
+   _log_lock();
+
+   entry = id | (unsigned long)(_log_get_domain_threshold(domain) + 1);
+
+   // Long names are not kept, and resolved again after each change
+   if ( strlcpy(_log_domain_names[i].name, domain, _LOG_MAX_DOMAIN_REPR_LENGTH)
+        >= _LOG_MAX_DOMAIN_REPR_LENGTH )
+   {
+      _log_domain_names[i].name[0] = '\0';
+   }
+
+   _log_domain_table[i] = entry;
+   _log_set_entry_rate( i, domain, true );
+
+   _log_unlock();
+
+   return (entry & 0xF) > (unsigned long)level;
+}
+
+
+/**
+ * Check if a trace of the current level (#_log_type) is to be shown.
+ * The lock is left untouched.
+ *
+ * @param domain The domain to filter
+ * @return true to indicate that the domain is to proceed.
+ *         false means that domain should not be displayed
+ */
+bool _log_filter_trace( const char *domain )
+{
+   return _log_domain_is_enabled( _log_domain_id(domain), domain, _log_type );
+}
+
+
+/**
+ * Take a trace of the current level (#_log_type) from the bucket of its
+ *  domain. Assumes the lock is taken, and the trace passed the filters.
+ *
+ * @param domain The domain of the trace
+ * @return false if the trace is to be dropped
+ */
+static bool _log_rate_allows( const char *domain )
+{
+   unsigned long id = _log_domain_id( domain );
+   size_t i = (id >> 4) & (_LOG_DOMAIN_TABLE_SIZE - 1);
+   const _logDomainRatePair_t *limit = _log_domain_rates[i].limit;
+   _logBucket_t *pBucket;
+   unsigned long capacity, elapsed, now;
+
+   // No limit, or the entry is used by another domain
+   if ( ! limit || _log_type < limit->level || (_log_domain_table[i] & ~0xFUL) != id )
+   {
+      return true;
+   }
+
+   pBucket  = &_log_domain_rates[i].bucket[_log_type];
+   capacity = limit->burst * 1000;
+   now      = _log_get_tick_ms();
+   elapsed  = now - pBucket->last;
+
+   pBucket->last = now;
+
+   // Refill at rate traces per second, i.e. rate thousandths per ms
+   if ( elapsed > capacity / limit->rate )
+   {
+      pBucket->tokens = capacity;
+   }
+   else
+   {
+      pBucket->tokens += elapsed * limit->rate;
+
+      if ( pBucket->tokens > capacity )
+      {
+         pBucket->tokens = capacity;
+      }
+   }
+
+   if ( pBucket->tokens >= 1000 )
+   {
+      pBucket->tokens -= 1000;
+
+      return true;
    }
 
+   ++pBucket->dropped;
+   ++_log_rate_dropped;
+
    return false;
 }
 
+
+/**
+ * Trace the number of traces dropped by the rate limits per domain, once
+ *  every #_LOG_RATE_SUMMARY_PERIOD ms at most.
+ * Assumes the lock is taken. The settings of the current trace are kept.
+ *
+ * @param force true to trace it now, whatever the time of the last one
+ */
+static void _log_rate_summary( bool force )
+{
+   char summary[_LOG_SIZED_FOR(_LOG_MAX_TRACE / 2)];
+   size_t length = 0;
+   unsigned long now;
+   size_t i, l;
+
+   if ( _log_rate_dropped == 0 )
+   {
+      return;
+   }
+
+   now = _log_get_tick_ms();
+
+   if ( ! force && now - _log_rate_last_summary < _LOG_RATE_SUMMARY_PERIOD )
+   {
+      return;
+   }
+
+   summary[0] = '\0';
+
+   for ( i=0; i<_LOG_DOMAIN_TABLE_SIZE; ++i )
+   {
+      unsigned long dropped = 0;
+
+      for ( l=0; l<=LOG_LEVEL_DEBUG; ++l )
+      {
+         dropped += _log_domain_rates[i].bucket[l].dropped;
+         _log_domain_rates[i].bucket[l].dropped = 0;
+      }
+
+      if ( dropped && length < sizeof(summary) )
+      {
+         length += snprintf(
+            summary + length, sizeof(summary) - length, " %s:%lu",
+            _log_domain_names[i].name[0] ? _log_domain_names[i].name : "?", dropped );
+      }
+   }
+
+   if ( _log_rate_dropped_others && length < sizeof(summary) )
+   {
+      snprintf(
+         summary + length, sizeof(summary) - length, " ?:%lu", _log_rate_dropped_others );
+   }
+
+   {
+      // Trace the summary on behalf of the current trace
+      logLevel_t      type     = _log_type;
+      unsigned long   line     = _log_line;
+      const char     *filename = _log_filename;
+      const char     *function = _log_function;
+      _LOG_THREAD_ID  thread   = _log_thread_override;
+      unsigned long   dropped  = _log_rate_dropped;
+
+      _log_rate_dropped        = 0;
+      _log_rate_dropped_others = 0;
+      _log_rate_last_summary   = now;
+      _log_thread_override     = 0;
+
+      _log_lock(); // The trace will unlock
+      _log_type     = LOG_LEVEL_WARN;
+      _log_line     = __LINE__;
+      _log_filename = __FILE__;
+      _log_function = "_log_rate_summary";
+      _log_trace( "log", "%lu traces dropped by the rate limits:%s", dropped, summary );
+
+      _log_type            = type;
+      _log_line            = line;
+      _log_filename        = filename;
+      _log_function        = function;
+      _log_thread_override = thread;
+   }
+}
+
+/**
+ *****************************************************************************
+ * Write out the traces so far, with the traces dropped by the rate limits
+ *  and not reported yet. A summary otherwise waits for a later trace, which
+ *  may never come after a storm, or on exit.
+ *****************************************************************************
+ */
+void _log_flush( void )
+{
+   _log_lock();
+   _log_rate_summary( true );
+   _log_unlock();
+
+   _log_os_flush();
+}
+
 #ifndef LOGGER_HAS_NO_FILE_SUPPORT
 /**
  * Update #_log_outfile if domain is in #_log_domain_file_lookup
@@ -885,10 +1230,10 @@ void _log_redirect_outfile( const char *domain )
  *                 reserved domains used by LOG_ASSERT
  *                 like messages and are always displayed
  * @param format   Printf format string
- * @param ...      Format arguments
+ * @param pList    Format arguments
  *****************************************************************************
  */
-void _log_trace(const char* domain, const char *format, ...)
+void _log_vtrace(const char* domain, const char *format, va_list pList)
 {
 #ifndef LOGGER_HAS_NO_FILE_SUPPORT
    FILE *bkupOutfile;
@@ -920,6 +1265,15 @@ void _log_trace(const char* domain, const char *format, ...)
       return;
    }
 
+   // Report the traces dropped by the rate limits now and then
+   _log_rate_summary( false );
+
+   if ( domain && ! _log_rate_allows(domain) )
+   {
+      _log_unlock();
+      return;
+   }
+
    const char * const oneBlankSpace=" ";
 
    _LOG_THREAD_ID current_thread;
@@ -932,8 +1286,9 @@ void _log_trace(const char* domain, const char *format, ...)
    // Reset pointer
    memset( (char *)p, 0,  sizeof(p) );
 
-   // Obtain current thread id
-   current_thread = _log_get_current_thread_id();
+   // Obtain current thread id, unless traced on behalf of another thread
+   current_thread = _log_thread_override ? _log_thread_override : _log_get_current_thread_id();
+   _log_thread_override = 0;
 
    if ( ! domain )
    {
@@ -1044,8 +1399,6 @@ void _log_trace(const char* domain, const char *format, ...)
    snprintf( lineNumberBuffer, sizeof(lineNumberBuffer), "%ld} ", _log_line );
    p[eEND] = lineNumberBuffer;
 
-   // Add arguments
-   va_list pList;
    int count=0;
 
    // Prepend with the header
@@ -1065,14 +1418,11 @@ void _log_trace(const char* domain, const char *format, ...)
    }
 
    // Write the lot
-   va_start( pList, format );
-
    vsnprintf( pTo, sizeof(_log_buffer)-count, format, pList );
 
    // Terminate the buffer in case the string got truncated
    _log_buffer[ sizeof(_log_buffer) - 1 ] = '\0';
    _log_print( _log_buffer );
-   va_end( pList );
 
    // Inject into external logger too
    if ( _log_logger_callback )
@@ -1103,6 +1453,25 @@ void _log_trace(const char* domain, const char *format, ...)
 }
 
 
+/**
+ *****************************************************************************
+ * Variadic version of #_log_vtrace, called from the macros
+ *
+ * @param domain   Text name of concerned domains or NULL
+ * @param format   Printf format string
+ * @param ...      Format arguments
+ *****************************************************************************
+ */
+void _log_trace(const char* domain, const char *format, ...)
+{
+   va_list pList;
+
+   va_start( pList, format );
+   _log_vtrace( domain, format, pList );
+   va_end( pList );
+}
+
+
 /**
  *****************************************************************************
  * Helper which creates a list of domain identifier from a string
@@ -1153,6 +1522,8 @@ static void _log_apply_mask_to_list(
       }
    }
 
+   _log_filters_changed();
+
    // Unlock operation
    _log_unlock();
 }
@@ -1337,6 +1708,7 @@ void _log_set_level( logLevel_t level )
    if ( level <= LOG_LEVEL_DEBUG )
    {
       _log_level = level;
+      _log_filters_changed();
    }
 
    _log_unlock();
@@ -1441,6 +1813,7 @@ int _log_set_domain_level( const char *domains, logLevel_t level )
       }
    }
 
+   _log_filters_changed();
    _log_unlock();
 
    return actuallySet;
@@ -1525,6 +1898,7 @@ int _log_clear_domain_level( const char *domains )
       }
    }
 
+   _log_filters_changed();
    _log_unlock();
 
    return actuallyCleared;
@@ -1661,6 +2035,111 @@ int _log_set_domain_redirection( const char *domains, FILE *pf )
 }
 #endif // ndef LOGGER_HAS_NO_FILE_SUPPORT
 
+/**
+ *****************************************************************************
+ * Given a list of domains, limit the rate of their traces of the given level
+ *  and all the less severe levels.
+ * Each domain and level has its own token bucket: up to burst traces can be
+ *  output in a row, and rate traces per second on average. The other traces
+ *  are dropped, and the number dropped per domain is traced every
+ *  #_LOG_RATE_SUMMARY_PERIOD ms at most, and by #LOG_FLUSH.
+ * There only up to #_LOG_MAX_DOMAIN_RATE_LIMITS domains which can be setup
+ *  this way.
+ *
+ * @param domains   A string with domains as strings, separated by an
+ *                   appropriate separators. A null pointer or empty string
+ *                   will have no effect.
+ * @param level     Most severe level limited
+ * @param rate      Traces per second. 0 removes the limit of the domains.
+ * @param burst     Traces allowed in a row, at least 1
+ *
+ * @return  The number of domains actually set or removed. If 0, no domains
+ *           were set as the list is full
+ *****************************************************************************
+ */
+int _log_set_domain_rate(
+   const char *domains, logLevel_t level, unsigned long rate, unsigned long burst )
+{
+   char *token, *p = NULL;
+   int actuallySet = 0;
+
+   if ( burst == 0 )
+   {
+      burst = 1;
+   }
+
+   // We do not want to change the limits half way through a trace !
+   _log_lock();
+
+   if ( domains && domains[0] != '\0' )
+   {
+      char buf[_LOG_MAX_DOMAIN_LIST_LENGTH];
+
+      strlcpy( buf, domains, _LOG_MAX_DOMAIN_LIST_LENGTH );
+      token = log_strtok_r( buf, seps, &p );
+
+      while ( token != 0 )
+      {
+         size_t i;
+
+         // Look for the domain in the list, or the first free slot
+         for (
+            i=0;
+            i<_LOG_MAX_DOMAIN_RATE_LIMITS && _log_domain_rate_lookup[i].domain.name[0];
+            ++i )
+         {
+            if ( strncmp(
+               _log_domain_rate_lookup[i].domain.name,
+               token,
+               _LOG_MAX_DOMAIN_REPR_LENGTH ) == 0 )
+            {
+               break;
+            }
+         }
+
+         if ( rate == 0 )
+         {
+            if ( i<_LOG_MAX_DOMAIN_RATE_LIMITS && _log_domain_rate_lookup[i].domain.name[0] )
+            {
+               // Shift the last active slot into the deleted one to leave no hole
+               size_t j=_LOG_MAX_DOMAIN_RATE_LIMITS;
+
+               while ( --j != i )
+               {
+                  if ( _log_domain_rate_lookup[j].domain.name[0] != '\0' )
+                  {
+                     _log_domain_rate_lookup[i] = _log_domain_rate_lookup[j];
+                     break;
+                  }
+               }
+
+               _log_domain_rate_lookup[j].domain.name[0] = '\0';
+               actuallySet++;
+            }
+         }
+         else if ( i<_LOG_MAX_DOMAIN_RATE_LIMITS )
+         {
+            strlcpy(
+               _log_domain_rate_lookup[i].domain.name,
+               token,
+               _LOG_MAX_DOMAIN_REPR_LENGTH );
+
+            _log_domain_rate_lookup[i].level = level;
+            _log_domain_rate_lookup[i].rate  = rate;
+            _log_domain_rate_lookup[i].burst = burst;
+            actuallySet++;
+         }
+
+         token = log_strtok_r( NULL, seps, &p );
+      }
+   }
+
+   _log_filters_changed();
+   _log_unlock();
+
+   return actuallySet;
+}
+
 /**
  * Allow an external application to intercept all statements being logged.
  * This is on top of the existing logging which cannot be stopped.
@@ -43,7 +43,6 @@ extern "C"
    /** Helper to truncated a string and show the truncation */
    const char * const log_get_truncated_string( const char *, int, const char ** );
 
-   bool _log_filter_trace( const char *domain );
    void _log_reset_last_function();
 }  //  End of extern "C"
 
@@ -133,73 +132,6 @@ namespace
 }
 
 
-/**
- *****************************************************************************
- * Implementation of the logScopeObj constructor.
- * The constructor stores the mask in m_mask and calls the out method with
- *  IN as the string
- *
- * @param line       Line number, filled in by the macro
- * @param file       File name, filled in by the macro
- * @param function   Function name, filled in by the macro
- * @param pThis      this pointer
- * @param classname  Name of the class as reported through the RTTI
- * @param mask       The debugging mask
- *****************************************************************************
- */
-_logScopeObj_c::_logScopeObj_c(
-   unsigned long line,
-   const char   *file,
-   const char   *function,
-   const void   *pThis,
-   const char   *classname,
-   const char   *mask )
-{
-   _log_lock();
-   
-   _log_type = LOG_LEVEL_TRACE;
-
-   if ( _log_filter_trace(mask) )
-   {
-       m_line=line;
-       m_file=file;
-       m_function=function;
-       m_this=pThis;
-       m_classname=classname;
-       m_mask=mask;
-
-       this->out( "--> IN" );
-   }
-   else
-   {
-      m_line = 0;
-   }
-
-   _log_unlock();
-}
-
-
-/**
- *****************************************************************************
- * Implementation of the logScopeObj destructor.
- * It calls the out method with OUT as the string
- *
- * @note   Since the destructor is called internally be the compiler, no line
- *         number will be available. The filename is rembered from the
- *         constructor.
- *****************************************************************************
- */
-_logScopeObj_c::~_logScopeObj_c()
-{
-   if ( m_line > 0 )
-   {
-      // Mark the line number as unknown (nobody's perfect)
-      m_line = 0;
-
-      this->out( "<-- OUT" );
-   }
-}
-
 /**
  * Create a single instance of the demangler
  */
@@ -208,19 +140,17 @@ static Abi_demangler _log_demangler;
 
 /**
  *****************************************************************************
- * Dumps the header/footer statement on the string taking a string which
- *  specifies whether it is a IN or OUT operation.
- * On gcc system, the function should be complete.
- *
- * @notes   Rtti must be active
- * @notes   The function reads m_this and if not zero, assumes it is an
- *           object pointer. It then uses the RTTI to compute the function
- *           name.
+ * Form the printable name of a scope: the class name and the method name
+ *  separated by a ::, or the function name alone.
+ * Room is left for the this marker if in a class.
+ * The demangler is not reentrant. The lock must be taken.
  *
- * @param   strInOrOut   A string which gets appended to the trace.
+ * @param function   Function name, as given by the compiler
+ * @param classname  Name of the class as reported through the RTTI, or 0
+ * @param dest       Receives the name
  *****************************************************************************
  */
-void _logScopeObj_c::out( const char *strInOrOut )
+static void _log_form_scope_name( const char *function, const char *classname, char *dest )
 {
    enum _item_
    {
@@ -233,10 +163,6 @@ void _logScopeObj_c::out( const char *strInOrOut )
       eEND
    };
 
-   // Split the repr into 2 pieces
-   // The function name is made of the class name and the method sep'd by a ::
-   //                           123456
-   static char THIS_MARKER[] = " this=%.8p";
    //                                 0x0123456789ABCDEF - Up to 64 bits
    //                          -----------------
    //                           123456789012345678901234 = 24
@@ -259,23 +185,17 @@ void _logScopeObj_c::out( const char *strInOrOut )
    static const size_t MAX_METHODNAME_REPR(
       MAX_CLASS_METHOD_UNDECORATED_REPR - MAX_CLASSNAME_REPR );
 
-   // Store the address of the object
-   static char thisBuffer[THIS_MARKER_REPR_LENGTH+1];
-
    // Keep the name in chunks
-   static const char* p[eEND+1];
+   const char* p[eEND+1];
 
-   // The demangler is not reentrant !!
-   _log_lock();   // Trace will unlock
-
-   // The final debug is concatenation of segmented strings
+   // The final name is concatenation of segmented strings
    // Reset pointer
    memset( p, 0, sizeof(p));
 
    // Are we inside an object?
-   if ( m_classname != 0 )
+   if ( classname != 0 )
    {
-      char *className = _log_demangler.demangle(m_classname);
+      char *className = _log_demangler.demangle(classname);
 
       // Skip front numbers which GNU inserts
       while ( *className >= '0' && *className <= '9' )
@@ -291,7 +211,7 @@ void _logScopeObj_c::out( const char *strInOrOut )
 
       // Get the string length for both segments
       size_t classNameLength(strlen(className));
-      size_t methodNameLength(strlen(m_function));
+      size_t methodNameLength(strlen(function));
 
       // Give extra to the function name
       if ( classNameLength < MAX_CLASSNAME_REPR )
@@ -315,39 +235,29 @@ void _logScopeObj_c::out( const char *strInOrOut )
       int dtorMarkerLength(0);
 
       // If the '~' cropped out from the name?
-      if ( m_function[0] == '~' && methodNameLength >= MAX_METHODNAME_REPR )
+      if ( function[0] == '~' && methodNameLength >= MAX_METHODNAME_REPR )
       {
          dtorMarkerLength=1;
          p[eDESTRUCTOR_TILDE]="~";
       }
 
       p[eMETHODNAME]=log_get_truncated_string(
-         m_function, MAX_METHODNAME_REPR+sparesForMethodName-dtorMarkerLength,
+         function, MAX_METHODNAME_REPR+sparesForMethodName-dtorMarkerLength,
          &p[eMETHODNAME_TRUNCATION] );
-
-      snprintf( thisBuffer, sizeof(thisBuffer), THIS_MARKER, m_this );
-      p[eEND] = thisBuffer;
    }
    else
    {
       // Use up all the repr space for the function name
       p[eMETHODNAME]=log_get_truncated_string(
-         m_function, _LOG_MAX_FUNCTION_REPR_LENGTH, &p[eMETHODNAME_TRUNCATION] );
+         function, _LOG_MAX_FUNCTION_REPR_LENGTH, &p[eMETHODNAME_TRUNCATION] );
    }
 
-   //
-   // Change the built in variables
-   //
-   _log_line     = m_line;
-   _log_filename = m_file;
-
    // Concat into single string
-   static char fullFunctionName[_LOG_SIZED_FOR(_LOG_MAX_FUNCTION_REPR_LENGTH)];
-   char *pTo = fullFunctionName;
+   char *pTo = dest;
 
-   for ( register int i=0; i<=eEND; ++i )
+   for ( int i=0; i<eEND; ++i )
    {
-      register const char *pFrom = p[i];
+      const char *pFrom = p[i];
 
       while ( pFrom && *pFrom )
       {
@@ -357,13 +267,167 @@ void _logScopeObj_c::out( const char *strInOrOut )
 
    // Terminate
    *pTo = '\0';
+}
+
+
+/**
+ *****************************************************************************
+ * Return the printable name of a scope.
+ * The name is formed and kept the first time. Demangling is expensive.
+ * The site is shared by all the classes deriving from the class of the
+ *  method. The name of the first class seen is kept, the others are formed
+ *  each time.
+ * The lock must be taken.
+ *
+ * @param site       The scope
+ * @param classname  Name of the class as reported through the RTTI, or 0
+ * @return The name. Valid until the lock is released.
+ *****************************************************************************
+ */
+const char *_log_scope_name( _logScopeSite_t *site, const char *classname )
+{
+   static char name[_LOG_SIZED_FOR(_LOG_MAX_FUNCTION_REPR_LENGTH)];
+
+   if ( site->name && site->classname == classname )
+   {
+      return site->name;
+   }
+
+   _log_form_scope_name( site->function, classname, name );
+
+   if ( ! site->name )
+   {
+      site->name = (char *)malloc( strlen(name) + 1 );
+
+      if ( site->name )
+      {
+         strcpy( site->name, name );
+         site->classname = classname;
+      }
+   }
+
+   return name;
+}
+
+
+/**
+ *****************************************************************************
+ * Implementation of the logScopeObj constructor.
+ * The constructor calls the out method with IN as the string if the domain
+ *  of the site is traced, and records the entry if profiling.
+ *
+ * @param site       The LOG_HEADER statement, filled in by the macro
+ * @param pThis      this pointer
+ * @param classname  Name of the class as reported through the RTTI
+ *****************************************************************************
+ */
+_logScopeObj_c::_logScopeObj_c(
+   _logScopeSite_t *site,
+   const void      *pThis,
+   const char      *classname ) :
+   m_site(site),
+   m_this(pThis),
+   m_classname(classname),
+   m_traced(false),
+   m_profiled(false)
+{
+   if ( _log_domain_is_enabled(_log_domain_id(site->mask), site->mask, LOG_LEVEL_TRACE) )
+   {
+      m_traced = true;
+
+      this->out( "--> IN", site->line );
+   }
+
+   if ( _log_profiling )
+   {
+      // Name the scope now, while the class is known
+      if ( ! site->name )
+      {
+         _log_lock();
+         _log_scope_name( site, classname );
+         _log_unlock();
+      }
+
+      m_profiled = true;
+
+      _log_profile_enter( site );
+   }
+}
+
+
+/**
+ *****************************************************************************
+ * Implementation of the logScopeObj destructor.
+ * It calls the out method with OUT as the string
+ *
+ * @note   Since the destructor is called internally be the compiler, no line
+ *         number will be available. The filename is rembered from the
+ *         constructor.
+ *****************************************************************************
+ */
+_logScopeObj_c::~_logScopeObj_c()
+{
+   if ( m_profiled )
+   {
+      _log_profile_exit( m_site );
+   }
+
+   if ( m_traced )
+   {
+      // Mark the line number as unknown (nobody's perfect)
+      this->out( "<-- OUT", 0 );
+   }
+}
+
+
+/**
+ *****************************************************************************
+ * Dumps the header/footer statement on the string taking a string which
+ *  specifies whether it is a IN or OUT operation.
+ * On gcc system, the function should be complete.
+ *
+ * @notes   Rtti must be active
+ * @notes   The function reads m_this and if not zero, assumes it is an
+ *           object pointer. It then uses the RTTI to compute the function
+ *           name.
+ *
+ * @param   strInOrOut   A string which gets appended to the trace.
+ * @param   line         Line number to show
+ *****************************************************************************
+ */
+void _logScopeObj_c::out( const char *strInOrOut, unsigned long line )
+{
+   //                           123456
+   static char THIS_MARKER[] = " this=%.8p";
+
+   // Name of the scope and address of the object
+   static char fullFunctionName[_LOG_SIZED_FOR(_LOG_MAX_FUNCTION_REPR_LENGTH)];
+
+   // The demangler is not reentrant !!
+   _log_lock();   // Trace will unlock
+
+   strlcpy( fullFunctionName, _log_scope_name(m_site, m_classname), sizeof(fullFunctionName) );
+
+   if ( m_classname != 0 )
+   {
+      size_t length = strlen( fullFunctionName );
+
+      snprintf(
+         fullFunctionName + length, sizeof(fullFunctionName) - length, THIS_MARKER, m_this );
+   }
+
+   //
+   // Change the built in variables
+   //
+   _log_line     = line;
+   _log_filename = m_site->file;
 
    // Force new function name
    _log_function = fullFunctionName;
 
    // Dump on the screen
    _log_type = LOG_LEVEL_TRACE;
-   _log_trace( m_mask, strInOrOut );
+   _log_trace( m_site->mask, strInOrOut );
 
    // Reset old debug so that the function name appears clearly
    _log_reset_last_function();
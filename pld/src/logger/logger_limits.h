@@ -47,9 +47,33 @@
 /** Define the maximum number of supported domain file redirection */
 #define _LOG_MAX_DOMAIN_FILE_REDIRECTION   16
 
+/** Define the maximum number of supported domain rate limits */
+#define _LOG_MAX_DOMAIN_RATE_LIMITS     16
+
 /** Maximum length of the command line */
 #define _LOG_MAX_COMMAND_LINE_LENGTH    256
 
+/** Number of records held by the binary ring. Must be a power of 2 */
+#define _LOG_BINARY_RING_SLOTS          1024
+
+/** Bytes of arguments held by a binary record */
+#define _LOG_BINARY_SLOT_DATA           48
+
+/** Number of traces queued for the POSIX writer thread. Must be a power of 2 */
+#define _LOG_POSIX_QUEUE_SLOTS          1024
+
+/** Maximum number of traces written by one writev */
+#define _LOG_POSIX_WRITE_BATCH          64
+
+/** Number of scope entries and exits a thread records before they are folded */
+#define _LOG_PROFILE_RING_SLOTS         1024
+
+/** Maximum depth of the scopes profiled */
+#define _LOG_PROFILE_MAX_DEPTH          64
+
+/** Maximum length of a chain of scopes in the folded stacks */
+#define _LOG_PROFILE_MAX_PATH           4096
+
 #else /* def LOGGER_SMALL */
 
 /** Start of log split */
@@ -86,9 +110,33 @@
 /** Define the maximum number of supported domain file redirection */
 #define _LOG_MAX_DOMAIN_FILE_REDIRECTION  0
 
+/** Define the maximum number of supported domain rate limits */
+#define _LOG_MAX_DOMAIN_RATE_LIMITS     2
+
 /** Maximum length of the command line */
 #define _LOG_MAX_COMMAND_LINE_LENGTH    32
 
+/** Number of records held by the binary ring. Must be a power of 2 */
+#define _LOG_BINARY_RING_SLOTS          64
+
+/** Bytes of arguments held by a binary record */
+#define _LOG_BINARY_SLOT_DATA           16
+
+/** Number of traces queued for the POSIX writer thread. Must be a power of 2 */
+#define _LOG_POSIX_QUEUE_SLOTS          16
+
+/** Maximum number of traces written by one writev */
+#define _LOG_POSIX_WRITE_BATCH          4
+
+/** Number of scope entries and exits a thread records before they are folded */
+#define _LOG_PROFILE_RING_SLOTS         64
+
+/** Maximum depth of the scopes profiled */
+#define _LOG_PROFILE_MAX_DEPTH          16
+
+/** Maximum length of a chain of scopes in the folded stacks */
+#define _LOG_PROFILE_MAX_PATH           256
+
 #endif
 
 /**
@@ -97,6 +145,9 @@
  */
 #define _LOG_SIZED_FOR(repr_length) (repr_length+1)
 
+/** Minimum time between two summaries of the traces dropped by the rate limits, in ms */
+#define _LOG_RATE_SUMMARY_PERIOD        10000
+
 /** Define the maximum length of domains string */
 #define _LOG_MAX_DOMAIN_LIST_LENGTH     (_LOG_MAX_DOMAINS * (_LOG_MAX_DOMAIN_REPR_LENGTH + 1))
 
@@ -50,15 +50,27 @@ void log_os_set_process_name(char *_log_process_name, size_t max);
 /** Print function - the text is already formatted */
 void _log_print(const char *string);
 
+/** Wait until the text passed to _log_print is written out */
+void _log_os_flush();
+
 /** Create a portable mutex */
 void _log_mutex_init();
 
+/** Get a time in ms, for the rate limits. Wraps around. */
+unsigned long _log_get_tick_ms();
+
 /** Lock log mutex which protects printf operations */
 void _log_lock();
 
 /** Unlock log mutex */
 void _log_unlock();
 
+/** Atomically increment a counter. @return The value before the increment */
+unsigned long _log_atomic_increment(volatile unsigned long *p);
+
+/** Store a value once all previous writes are visible to other threads */
+void _log_atomic_store(volatile unsigned long *p, unsigned long value);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,495 @@
+/*-
+ *****************************************************************************
+ * POSIX implementation for the tracing library
+ * The traces are formatted by the calling thread, copied into a slot of a
+ *  bounded lock free queue, and written out by a background writer thread.
+ * A thread producing a trace never waits for the output. If the queue is
+ *  full, the trace is dropped and counted. The writer reports the number of
+ *  traces dropped once it catches up.
+ * The writer gathers consecutive traces going to the same file in a single
+ *  writev call.
+ *
+ * @author gpa
+ *****************************************************************************
+ */
+
+
+//----------------------------------------------------------------------------
+//  Local include
+//----------------------------------------------------------------------------
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#  include <sys/syscall.h>
+#endif
+
+#include "logger.h"
+#include "logger_os.h"
+#include "logger_limits.h"
+
+
+//----------------------------------------------------------------------------
+//  Local types
+//----------------------------------------------------------------------------
+
+/** A trace waiting to be written */
+typedef struct
+{
+   /**
+    * Position in the queue the slot is free for, or position + 1 once the
+    *  trace is ready to be written
+    */
+   volatile unsigned long sequence;
+   /** File descriptor to write to */
+   int fd;
+   /** Number of chars in text, including the end of line */
+   size_t length;
+   /** The trace, followed by an end of line */
+   char text[_LOG_SIZED_FOR(_LOG_MAX_TRACE)];
+} _logPosixSlot_t;
+
+
+//----------------------------------------------------------------------------
+//  Local storage
+//----------------------------------------------------------------------------
+
+/** The log lock for access to container etc.. */
+static pthread_mutex_t _log_mutex;
+
+/** Held by the thread writing out the queue */
+static pthread_mutex_t _log_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Posted to wake the writer up */
+static sem_t _log_writer_wakeup;
+
+/** Non zero when the writer waits for traces */
+static volatile unsigned long _log_writer_idle;
+
+/** Start the writer once only */
+static pthread_once_t _log_writer_once = PTHREAD_ONCE_INIT;
+
+/** The queue of traces */
+static _logPosixSlot_t _log_queue[_LOG_POSIX_QUEUE_SLOTS];
+
+/** Position of the next trace to queue */
+static volatile unsigned long _log_queue_head;
+
+/** Position of the next trace to write out */
+static volatile unsigned long _log_queue_tail;
+
+/** Number of traces dropped since the start, as the queue was full or the write failed */
+static volatile unsigned long _log_dropped;
+
+/** Number of traces dropped already reported */
+static unsigned long _log_dropped_reported;
+
+
+//----------------------------------------------------------------------------
+//  Local functions
+//----------------------------------------------------------------------------
+
+/**
+ * Write out a set of buffers in full.
+ *
+ * @param fd     File to write to
+ * @param iov    The buffers. Modified.
+ * @param count  Number of buffers
+ * @return false if the write failed
+ */
+static bool _log_writev_all( int fd, struct iovec *iov, int count )
+{
+   while ( count )
+   {
+      ssize_t written = writev( fd, iov, count );
+
+      if ( written < 0 )
+      {
+         if ( errno == EINTR )
+         {
+            continue;
+         }
+
+         return false;
+      }
+
+      // Skip what has been written
+      while ( count && (size_t)written >= iov->iov_len )
+      {
+         written -= iov->iov_len;
+         ++iov;
+         --count;
+      }
+
+      if ( count )
+      {
+         iov->iov_base = (char *)iov->iov_base + written;
+         iov->iov_len -= written;
+      }
+   }
+
+   return true;
+}
+
+/**
+ * Write out the traces ready in the queue, in order.
+ *
+ * @return The number of traces dropped since the last call
+ */
+static unsigned long _log_write_queue( void )
+{
+   struct iovec iov[_LOG_POSIX_WRITE_BATCH];
+   unsigned long dropped;
+
+   // Single consumer
+   pthread_mutex_lock( &_log_writer_mutex );
+
+   for (;;)
+   {
+      unsigned long tail = _log_queue_tail;
+      int count = 0;
+      int fd = -1;
+
+      // Gather the ready traces going to the same file
+      while ( count < _LOG_POSIX_WRITE_BATCH )
+      {
+         _logPosixSlot_t *pSlot = &_log_queue[(tail + count) & (_LOG_POSIX_QUEUE_SLOTS - 1)];
+
+         if ( __atomic_load_n(&pSlot->sequence, __ATOMIC_ACQUIRE) != tail + count + 1 )
+         {
+            break;
+         }
+
+         if ( count && pSlot->fd != fd )
+         {
+            break;
+         }
+
+         fd = pSlot->fd;
+         iov[count].iov_base = pSlot->text;
+         iov[count].iov_len  = pSlot->length;
+         ++count;
+      }
+
+      if ( count == 0 )
+      {
+         break;
+      }
+
+      if ( ! _log_writev_all(fd, iov, count) )
+      {
+         __atomic_fetch_add( &_log_dropped, count, __ATOMIC_RELAXED );
+      }
+
+      // Release the slots for the next round
+      while ( count-- )
+      {
+         __atomic_store_n(
+            &_log_queue[tail & (_LOG_POSIX_QUEUE_SLOTS - 1)].sequence,
+            tail + _LOG_POSIX_QUEUE_SLOTS,
+            __ATOMIC_RELEASE );
+
+         ++tail;
+      }
+
+      _log_queue_tail = tail;
+   }
+
+   dropped = __atomic_load_n( &_log_dropped, __ATOMIC_RELAXED ) - _log_dropped_reported;
+   _log_dropped_reported += dropped;
+
+   pthread_mutex_unlock( &_log_writer_mutex );
+
+   return dropped;
+}
+
+/**
+ * Write out the traces ready in the queue, and report the traces dropped.
+ * The report is queued like any other trace.
+ */
+static void _log_write_and_report( void )
+{
+   unsigned long dropped = _log_write_queue();
+
+   if ( dropped )
+   {
+      LOG_WARN( "log", "%lu traces dropped", dropped );
+   }
+}
+
+/** Body of the writer thread */
+static void *_log_writer( void *arg )
+{
+   (void)arg;
+
+   for (;;)
+   {
+      struct timespec timeout;
+
+      _log_write_and_report();
+
+      // Tell the producers to wake us up, then check nothing came in since
+      __atomic_store_n( &_log_writer_idle, 1, __ATOMIC_SEQ_CST );
+
+      if ( __atomic_load_n(&_log_queue[_log_queue_tail & (_LOG_POSIX_QUEUE_SLOTS - 1)].sequence,
+              __ATOMIC_SEQ_CST) == _log_queue_tail + 1 )
+      {
+         __atomic_store_n( &_log_writer_idle, 0, __ATOMIC_SEQ_CST );
+         continue;
+      }
+
+      // The timeout covers a wake up lost to a flush
+      clock_gettime( CLOCK_REALTIME, &timeout );
+      timeout.tv_sec += 1;
+
+      while ( sem_timedwait(&_log_writer_wakeup, &timeout) != 0 && errno == EINTR )
+      {
+      }
+
+      __atomic_store_n( &_log_writer_idle, 0, __ATOMIC_SEQ_CST );
+   }
+
+   return NULL;
+}
+
+/** Write out what is left on exit, with the traces dropped by the rate limits */
+static void _log_writer_exit( void )
+{
+   _log_flush();
+}
+
+/** Create the writer thread */
+static void _log_writer_start( void )
+{
+   pthread_t thread;
+   pthread_attr_t attr;
+   unsigned long i;
+
+   for ( i=0; i<_LOG_POSIX_QUEUE_SLOTS; ++i )
+   {
+      _log_queue[i].sequence = i;
+   }
+
+   sem_init( &_log_writer_wakeup, 0, 0 );
+
+   pthread_attr_init( &attr );
+   pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+
+   if ( pthread_create(&thread, &attr, _log_writer, NULL) != 0 )
+   {
+      // Traces are written by _log_os_flush only
+      assert( false );
+   }
+
+   pthread_attr_destroy( &attr );
+
+   atexit( _log_writer_exit );
+}
+
+
+//----------------------------------------------------------------------------
+//  Implement OS specific functions
+//----------------------------------------------------------------------------
+
+/** Get hold of the current thread id */
+_LOG_THREAD_ID _log_get_current_thread_id()
+{
+#ifdef __linux__
+   return (_LOG_THREAD_ID)syscall( SYS_gettid );
+#else
+   return (_LOG_THREAD_ID)pthread_self();
+#endif
+}
+
+/** Return a string with the debug configuration */
+const char *log_get_config_string()
+   { return getenv("LOG"); }
+
+unsigned long _log_get_tick_ms()
+{
+   struct timespec now;
+
+   clock_gettime( CLOCK_MONOTONIC, &now );
+
+   return (unsigned long)now.tv_sec * 1000UL + (unsigned long)(now.tv_nsec / 1000000L);
+}
+
+void _log_mutex_init()
+{
+   static bool created = false;
+   pthread_mutexattr_t attr;
+
+   // The lock is recursive, as the mask functions call each other
+   if ( ! created )
+   {
+      pthread_mutexattr_init( &attr );
+      pthread_mutexattr_settype( &attr, PTHREAD_MUTEX_RECURSIVE );
+      pthread_mutex_init( &_log_mutex, &attr );
+      pthread_mutexattr_destroy( &attr );
+
+      created = true;
+   }
+
+   pthread_once( &_log_writer_once, _log_writer_start );
+}
+
+void _log_lock()
+{
+   int result = pthread_mutex_lock( &_log_mutex );
+   assert( result == 0 );
+   (void)result;
+}
+
+void _log_unlock()
+{
+   int result = pthread_mutex_unlock( &_log_mutex );
+   assert( result == 0 );
+   (void)result;
+}
+
+unsigned long _log_atomic_increment(volatile unsigned long *p)
+{
+   return __atomic_fetch_add( p, 1, __ATOMIC_SEQ_CST );
+}
+
+void _log_atomic_store(volatile unsigned long *p, unsigned long value)
+{
+   __atomic_store_n( p, value, __ATOMIC_SEQ_CST );
+}
+
+
+/**
+ *****************************************************************************
+ * Queue a trace for the writer thread.
+ * The trace goes to #_log_outfile, or the standard error if not set.
+ * The caller never waits. If the queue is full, the trace is dropped.
+ *
+ * @param string   The string to print
+ *****************************************************************************
+ */
+void _log_print(const char *string)
+{
+   unsigned long head = __atomic_load_n( &_log_queue_head, __ATOMIC_RELAXED );
+   _logPosixSlot_t *pSlot;
+   size_t length;
+
+   // Reserve a slot
+   for (;;)
+   {
+      long diff;
+
+      pSlot = &_log_queue[head & (_LOG_POSIX_QUEUE_SLOTS - 1)];
+      diff  = (long)(__atomic_load_n(&pSlot->sequence, __ATOMIC_ACQUIRE) - head);
+
+      if ( diff == 0 )
+      {
+         if ( __atomic_compare_exchange_n(
+                 &_log_queue_head, &head, head + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+         {
+            break;
+         }
+      }
+      else if ( diff < 0 )
+      {
+         // Still held by the previous round. The queue is full.
+         __atomic_fetch_add( &_log_dropped, 1, __ATOMIC_RELAXED );
+
+         return;
+      }
+      else
+      {
+         head = __atomic_load_n( &_log_queue_head, __ATOMIC_RELAXED );
+      }
+   }
+
+   length = strlen( string );
+
+   if ( length > _LOG_MAX_TRACE - 1 )
+   {
+      length = _LOG_MAX_TRACE - 1;
+   }
+
+   memcpy( pSlot->text, string, length );
+   pSlot->text[length] = '\n';
+   pSlot->length = length + 1;
+   pSlot->fd = _log_outfile ? fileno(_log_outfile) : STDERR_FILENO;
+
+   // Publish
+   __atomic_store_n( &pSlot->sequence, head + 1, __ATOMIC_RELEASE );
+
+   if ( __atomic_exchange_n(&_log_writer_idle, 0, __ATOMIC_SEQ_CST) )
+   {
+      sem_post( &_log_writer_wakeup );
+   }
+}
+
+
+/**
+ *****************************************************************************
+ * Write out the traces queued so far, from the calling thread.
+ * Used before aborting and on exit, as the writer may not run again.
+ *****************************************************************************
+ */
+void _log_os_flush()
+{
+   _log_write_and_report();
+
+   // Write the report out too
+   _log_write_queue();
+}
+
+
+/**
+ *****************************************************************************
+ * Returns a string with a timestamp or 0 if the time has not changed
+ *  sufficiently.
+ * @param epoch Optional number of seconds since Jan 1970. If 0, the
+ *              function must get the local time from the OS.
+ *
+ * @return   String with the timestamp
+ *****************************************************************************
+ */
+const char *log_os_timestamp( unsigned long t )
+{
+   return 0;
+}
+
+
+/**
+ *****************************************************************************
+ * Parse os specific parameters
+ *
+ * @param  env_log   Env string
+ * @return true on success
+ *****************************************************************************
+ */
+bool log_os_parse_config( char *env_log)
+{
+   return false;
+}
+
+
+/**
+ *****************************************************************************
+ * Get hold of the process name and store in the global
+ *  variable _log_process_name.
+ * The method is called first. It is a good place for running other
+ *  initialisations
+ *
+ *****************************************************************************
+ */
+void log_os_set_process_name( char *_log_process_name, size_t maxLength )
+{
+   // By default, the process is LOG
+   strcpy(_log_process_name, "LOG");
+}
+
+
+/* ---------------------------- End of file ------------------------------- */
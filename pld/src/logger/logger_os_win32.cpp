@@ -42,6 +42,9 @@ _LOG_THREAD_ID _log_get_current_thread_id()
 const char *log_get_config_string()
    { return getenv("LOG"); }
 
+unsigned long _log_get_tick_ms()
+   { return (unsigned long)GetTickCount(); }
+
 void _log_mutex_init()
 {
    _log_mutex = CreateMutex(NULL,FALSE,NULL);
@@ -62,6 +65,17 @@ void _log_unlock()
    assert( bSuccess != FALSE );
 }
 
+unsigned long _log_atomic_increment(volatile unsigned long *p)
+{
+   return (unsigned long)InterlockedIncrement( (volatile LONG *)p ) - 1;
+}
+
+void _log_atomic_store(volatile unsigned long *p, unsigned long value)
+{
+   // Full barrier
+   InterlockedExchange( (volatile LONG *)p, (LONG)value );
+}
+
 
 /**
  *****************************************************************************
@@ -92,6 +106,16 @@ void _log_print(const char *string)
 }
 
 
+/**
+ *****************************************************************************
+ * Nothing to do, _log_print writes the text out straight away
+ *****************************************************************************
+ */
+void _log_os_flush()
+{
+}
+
+
 /**
  *****************************************************************************
  * Returns a string with a timestamp or 0 if the time has not changed
@@ -0,0 +1,438 @@
+/*-
+ *****************************************************************************
+ * Profiler of the scopes marked with LOG_HEADER and LOG_THIS_HEADER.
+ * While profiling, each scope records its entry and exit times in a ring
+ *  owned by the thread, without locking. The ring is folded into a call tree
+ *  under the log lock when the outermost scope of the thread exits, or when
+ *  the ring is full.
+ * Each node of the tree holds the time spent in a scope when called from a
+ *  given chain of scopes. The tree is written as folded stacks, one line per
+ *  chain with the time spent in the innermost scope, which the flame graph
+ *  tools read.
+ * The time spent in each scope, including and excluding the inner scopes,
+ *  is also kept per site and traced when the tree is written.
+ *
+ * @author gpa
+ *****************************************************************************
+ */
+
+
+//----------------------------------------------------------------------------
+//  Local include
+//----------------------------------------------------------------------------
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+
+#include "logger.h"
+#include "logger_os.h"
+#include "logger_limits.h"
+
+
+//----------------------------------------------------------------------------
+//  Local types
+//----------------------------------------------------------------------------
+
+namespace
+{
+   /** Time spent in a scope called from a chain of scopes */
+   struct Node
+   {
+      _logScopeSite_t *site;
+      Node *parent;
+      Node *child;
+      Node *sibling;
+      unsigned long long calls;
+      unsigned long long inclusive;
+      unsigned long long exclusive;
+   };
+
+   /** Entry in or exit from a scope */
+   struct Event
+   {
+      _logScopeSite_t *site;
+      unsigned long long time;
+      bool enter;
+   };
+
+   /** Scope open in a thread, while folding */
+   struct Frame
+   {
+      Node *node;
+      unsigned long long start;
+      unsigned long long inner;
+   };
+
+   /** Profiling state of a thread */
+   struct Thread
+   {
+      Event ring[_LOG_PROFILE_RING_SLOTS];
+      size_t count;
+      /** Scopes entered and not exited, in the ring or not */
+      size_t open;
+      Frame stack[_LOG_PROFILE_MAX_DEPTH];
+      /** Number of scopes open while folding. Can exceed the stack size */
+      size_t depth;
+   };
+
+   /** Owns the profiling state of the thread, created on first use */
+   class Thread_owner
+   {
+      Thread *thread;
+
+   public:
+      Thread_owner() : thread(0) {}
+      ~Thread_owner();
+
+      Thread *get()
+      {
+         if ( ! thread )
+         {
+            thread = (Thread *)calloc( 1, sizeof(Thread) );
+         }
+
+         return thread;
+      }
+   };
+}
+
+
+//----------------------------------------------------------------------------
+//  Local variables
+//----------------------------------------------------------------------------
+
+/** True while the scopes are profiled */
+volatile bool _log_profiling = false;
+
+/** Root of the call tree. Its children are the outermost scopes */
+static Node _log_profile_root;
+
+/** Sites profiled, linked by their next field */
+static _logScopeSite_t *_log_profile_sites = 0;
+
+/** Profiling state of the calling thread */
+static thread_local Thread_owner _log_profile_thread;
+
+
+//----------------------------------------------------------------------------
+//  Local functions
+//----------------------------------------------------------------------------
+
+/** @return A time in ns */
+static inline unsigned long long _log_profile_now()
+{
+   return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+/**
+ * Find or add the node of a site, below a node.
+ *
+ * @param parent  The node of the calling scope
+ * @param site    The scope called
+ * @return The node, or 0 if out of memory
+ */
+static Node *_log_profile_child( Node *parent, _logScopeSite_t *site )
+{
+   Node *node;
+
+   for ( node = parent->child; node; node = node->sibling )
+   {
+      if ( node->site == site )
+      {
+         return node;
+      }
+   }
+
+   node = (Node *)calloc( 1, sizeof(Node) );
+
+   if ( node )
+   {
+      node->site     = site;
+      node->parent   = parent;
+      node->sibling  = parent->child;
+      parent->child  = node;
+   }
+
+   // First time profiled
+   if ( ! site->profiled )
+   {
+      site->profiled = true;
+      site->next = _log_profile_sites;
+      _log_profile_sites = site;
+   }
+
+   return node;
+}
+
+/**
+ * Fold the events of the ring of a thread into the call tree.
+ *
+ * @param pThread  The thread
+ */
+static void _log_profile_fold( Thread *pThread )
+{
+   size_t i;
+
+   _log_lock();
+
+   for ( i=0; i<pThread->count; ++i )
+   {
+      const Event *pEvent = &pThread->ring[i];
+
+      if ( pEvent->enter )
+      {
+         if ( pThread->depth < _LOG_PROFILE_MAX_DEPTH )
+         {
+            Frame *pFrame = &pThread->stack[pThread->depth];
+            Node *parent = pThread->depth ? pThread->stack[pThread->depth - 1].node : &_log_profile_root;
+
+            pFrame->node  = parent ? _log_profile_child( parent, pEvent->site ) : 0;
+            pFrame->start = pEvent->time;
+            pFrame->inner = 0;
+         }
+
+         ++pThread->depth;
+      }
+      else if ( pThread->depth )
+      {
+         --pThread->depth;
+
+         if ( pThread->depth < _LOG_PROFILE_MAX_DEPTH )
+         {
+            Frame *pFrame = &pThread->stack[pThread->depth];
+            unsigned long long elapsed = pEvent->time - pFrame->start;
+            size_t j;
+            bool recursive = false;
+
+            if ( pFrame->node )
+            {
+               pFrame->node->calls     += 1;
+               pFrame->node->inclusive += elapsed;
+               pFrame->node->exclusive += elapsed - pFrame->inner;
+            }
+
+            // Count the time of a recursive scope in its outermost call only
+            for ( j=0; j<pThread->depth; ++j )
+            {
+               if ( pThread->stack[j].node && pThread->stack[j].node->site == pEvent->site )
+               {
+                  recursive = true;
+               }
+            }
+
+            pEvent->site->calls     += 1;
+            pEvent->site->exclusive += elapsed - pFrame->inner;
+
+            if ( ! recursive )
+            {
+               pEvent->site->inclusive += elapsed;
+            }
+
+            if ( pThread->depth )
+            {
+               pThread->stack[pThread->depth - 1].inner += elapsed;
+            }
+         }
+      }
+   }
+
+   pThread->count = 0;
+
+   _log_unlock();
+}
+
+/** Fold what is left when the thread ends */
+Thread_owner::~Thread_owner()
+{
+   if ( thread )
+   {
+      _log_profile_fold( thread );
+      free( thread );
+   }
+}
+
+/**
+ * Record an event in the ring of the calling thread.
+ *
+ * @param site   The scope
+ * @param enter  true on entry
+ */
+static void _log_profile_record( _logScopeSite_t *site, bool enter )
+{
+   Thread *pThread = _log_profile_thread.get();
+   Event *pEvent;
+
+   if ( ! pThread )
+   {
+      return;
+   }
+
+   pEvent = &pThread->ring[pThread->count++];
+   pEvent->site  = site;
+   pEvent->enter = enter;
+   pEvent->time  = _log_profile_now();
+
+   if ( enter )
+   {
+      ++pThread->open;
+   }
+   else if ( pThread->open )
+   {
+      --pThread->open;
+   }
+
+   if ( pThread->count == _LOG_PROFILE_RING_SLOTS || pThread->open == 0 )
+   {
+      _log_profile_fold( pThread );
+   }
+}
+
+/**
+ * Write the folded stacks of a node and all the nodes below.
+ *
+ * @param f       File to write to
+ * @param node    The node
+ * @param path    Chain of scopes leading to the node, separated by ;
+ * @param length  Length of the path
+ * @return The number of lines written
+ */
+static int _log_profile_write_node( FILE *f, const Node *node, char *path, size_t length )
+{
+   int lines = 0;
+   const Node *child;
+
+   if ( node->site )
+   {
+      const char *name = node->site->name ? node->site->name : node->site->function;
+
+      length += snprintf(
+         path + length, _LOG_PROFILE_MAX_PATH - length, "%s%s", length ? ";" : "", name );
+
+      if ( length >= _LOG_PROFILE_MAX_PATH )
+      {
+         length = _LOG_PROFILE_MAX_PATH - 1;
+      }
+
+      // In microseconds, as the tools expect integer samples
+      if ( node->exclusive >= 1000 )
+      {
+         fprintf( f, "%s %llu\n", path, node->exclusive / 1000 );
+         ++lines;
+      }
+   }
+
+   for ( child = node->child; child; child = child->sibling )
+   {
+      lines += _log_profile_write_node( f, child, path, length );
+   }
+
+   path[length] = '\0';
+
+   return lines;
+}
+
+
+//----------------------------------------------------------------------------
+//  Public API
+//----------------------------------------------------------------------------
+
+/**
+ *****************************************************************************
+ * Record the entry in a scope. Called by the scope objects while profiling.
+ *
+ * @param site  The scope
+ *****************************************************************************
+ */
+void _log_profile_enter( _logScopeSite_t *site )
+{
+   _log_profile_record( site, true );
+}
+
+
+/**
+ *****************************************************************************
+ * Record the exit from a scope. Called by the scope objects which recorded
+ *  their entry.
+ *
+ * @param site  The scope
+ *****************************************************************************
+ */
+void _log_profile_exit( _logScopeSite_t *site )
+{
+   _log_profile_record( site, false );
+}
+
+
+/**
+ *****************************************************************************
+ * Start or stop profiling the scopes.
+ * The scopes already open when profiling starts are not profiled.
+ *
+ * @param enable  true to start
+ *****************************************************************************
+ */
+void _log_profile( bool enable )
+{
+   _log_profiling = enable;
+}
+
+
+/**
+ *****************************************************************************
+ * Write the call tree profiled so far as folded stacks, and trace the time
+ *  spent in each scope, including and excluding the inner scopes.
+ * Each line of the file is the chain of scopes from the outermost one,
+ *  separated by ;, followed by the time spent in the innermost scope in us.
+ * The scopes still open in other threads are not counted yet.
+ *
+ * @param path  Name of the file to write
+ * @return The number of lines written, or -1 if the file cannot be created
+ *****************************************************************************
+ */
+int _log_profile_write( const char *path )
+{
+   static char chain[_LOG_PROFILE_MAX_PATH];
+   _logScopeSite_t *site;
+   FILE *f;
+   int lines;
+
+   // Fold the calling thread first
+   if ( _log_profile_thread.get() && _log_profile_thread.get()->count )
+   {
+      _log_profile_fold( _log_profile_thread.get() );
+   }
+
+   f = fopen( path, "w" );
+
+   if ( ! f )
+   {
+      return -1;
+   }
+
+   _log_lock();
+
+   chain[0] = '\0';
+   lines = _log_profile_write_node( f, &_log_profile_root, chain, 0 );
+
+   for ( site = _log_profile_sites; site; site = site->next )
+   {
+      LOG_MILE(
+         "prof",
+         "%s calls=%llu inclusive=%lluus exclusive=%lluus",
+         site->name ? site->name : site->function,
+         site->calls,
+         site->inclusive / 1000,
+         site->exclusive / 1000 );
+   }
+
+   _log_unlock();
+
+   fclose( f );
+
+   return lines;
+}
+
+
+/* ---------------------------- End of file ------------------------------- */
@@ -15,14 +15,32 @@
 #include "driver/fb.h"
 #include "driver/key.h"
 
+#include "lib/cpp.h"
 #include "lib/alert.h"
 #include "lib/timer.h"
 #include "lib/reactor.h"
+#include "lib/governor.h"
 
+#include "core/boot.h"
+#include "core/journal.h"
 #include "core/sequencer.h"
 #include "core/measurements.h"
+#include "core/history.h"
 #include "core/gps_manager.h"
 
+/**
+ * Jobs of the boot, by stage.
+ * The GPS is reset whilst the sensors are read, and the clock waits for
+ *  its first fix. The journal is dumped on the UART once the GPS is up.
+ */
+static const boot_job_t _boot_jobs[] = {
+   { boot_sensors_e, &measurement_init, 0 },
+   { boot_gps_e,     &gps_manager_init, 0 },
+   { boot_history_e, &history_init,     BOOT_AFTER(boot_sensors_e) },
+   { boot_clock_e,   NULL,              BOOT_AFTER(boot_gps_e) },
+   { boot_journal_e, &journal_dump,     BOOT_AFTER(boot_gps_e) },
+};
+
 /**
  * Main entry point called once the build-in initialization is complete
  * This function must not return ever.
@@ -31,6 +49,8 @@
  * The main task is used to manage the GPS data and process all the timer callback
  *  very much like a reactor loop.
  * The watchdog is activated to make sure the reactor look is alive.
+ * The display and the key come up first. The other services are started
+ *  by the reactor as jobs of the boot, as their dependencies allow.
  */
 int main(void)
 {
@@ -46,20 +66,24 @@ int main(void)
    // 
    alert_init();       // Allow alerts
    board_init();       // Clocks, I/O, etc.
+   governor_init();    // Run at full speed until the load is known
    reactor_init();     // Prepare the reactor
    rtc_init();         // Ready the RTC and reset the clock
+   journal_init();     // Record the cause of the reset
    sio2host_init();    // Initialize the serial I/O library
    timer_init();       // Ready the timer API
+   boot_init();        // Time the boot from here
    fb_init();          // Ready the frame buffer API
-   measurement_init(); // Ready the systems measurements (lum and temp)
    key_init(           // Ready the key pad API
       &sequencer_switch_short, 
       &sequencer_switch_long, 
       &reset_do_soft_reset);
-   gps_manager_init(); // Read the GPS manager
    
-   // Start the sequencer to start the led displays
-   sequencer_start();
+   // Show the first frame now
+   sequencer_init();
+
+   // Start the other services from the reactor
+   boot_run(_boot_jobs, COUNTOF(_boot_jobs));
 
    // All is set, let the reactor run... forever
    reactor_run();
@@ -30,6 +30,22 @@ extern "C"
 	{
 		memset((void *)FbLeds, 0, sizeof(FbLeds));
 	}
+
+	/** The display is refreshed by its own timer */
+	void fb_refresh(void)
+	{
+	}
+
+	/** The frames are not timed */
+	void fb_time_next_latch(timer_count_t since)
+	{
+	}
+
+	/** No time to report */
+	void fb_get_latency_stats(fb_latency_stats_t *pStats)
+	{
+		memset(pStats, 0, sizeof(*pStats));
+	}
 }
 
 static uint8_t cycle_counter = 0;
@@ -1,5 +1,6 @@
 #include "stdafx.h"
 
+#include "core/boot.h"
 #include "core/measurements.h"
 
 namespace {
@@ -19,7 +20,9 @@ extern "C"
 	* Following the function, both measurements are available
 	*/
 	void measurement_init(void)
-	{}
+	{
+		boot_stage_done(boot_sensors_e);
+	}
 
 	/** @return The current temperature in 10th degrees */
 	int16_t measurement_get_temperature(void)
@@ -39,4 +42,10 @@ extern "C"
 		return false;
 	}
 
+	/** @return true, as the values are simulated */
+	bool measurement_is_valid(void)
+	{
+		return true;
+	}
+
 }
\ No newline at end of file
@@ -5,7 +5,9 @@
 #include "driver/fb.h"
 #include "lib/timer.h"
 #include "lib/alert.h"
+#include "core/boot.h"
 #include "core/measurements.h"
+#include "core/history.h"
 #include "core/sequencer.h"
 #include "lib/tz.h"
 
@@ -29,6 +31,15 @@ HANDLE hThreads[3];
 // Flag to tell the threads to bugger off
 bool AppExitFlag = FALSE;
 
+// Time of the last push on the buttons
+static timer_count_t KeyEdgeTime = 0;
+
+/** The push is timed when the button is clicked */
+extern "C" timer_count_t key_get_edge_time(void)
+{
+   return KeyEdgeTime;
+}
+
 // Global pointer for static callbacks
 PldSimulator* pDemoApp = nullptr;
 
@@ -190,9 +201,11 @@ LRESULT CALLBACK windowprocessforwindow2(HWND hwnd, UINT message, WPARAM wParam,
       switch LOWORD(wParam)
       {
       case SHORT_BTN_ID:
+         KeyEdgeTime = timer_get_count();
          sequencer_switch_short();
          break;
       case LONG_BTN_ID:
+         KeyEdgeTime = timer_get_count();
          sequencer_switch_long();
          break;
       case COMBO_ID:
@@ -237,6 +250,9 @@ LRESULT CALLBACK windowprocessforwindow2(HWND hwnd, UINT message, WPARAM wParam,
          area.left = 20;
          //{ 20, 38, 200, 20 };
          InvalidateRect(hwnd, &area, TRUE);
+
+         // Format the traces recorded in binary mode off the simulated threads
+         LOG_FLUSH();
       }
       break;
    }
@@ -665,6 +681,7 @@ LRESULT CALLBACK PldSimulator::WndProc(HWND hwnd, UINT message, WPARAM wParam, L
          case WM_CLOSE:
             AppExitFlag = true;
             WaitForMultipleObjects(3, hThreads, TRUE, INFINITE);
+            LOG_FLUSH();
             result = 1;
             break;
 
@@ -815,9 +832,11 @@ int WINAPI WinMain(
             alert_init();       // Allow alerts
             reactor_init();     // Prepare the reactor
             timer_init();       // Ready the timer API
+            boot_init();        // Time the boot from here
             fb_init();          // Ready the frame buffer API
             measurement_init(); // Ready the systems measurements (lum and temp)
-            sequencer_start();
+            history_init();     // Record the temperature history
+            sequencer_init();
 
             // Create a thread for the simulated framebuffer
             hThreads[0] = CreateThread(0, 0, FbTask, (LPVOID)&app, 0, 0);